@@ -0,0 +1,135 @@
+#include <benchmark/benchmark.h>
+#include <imu_advanced_navigation_anpp/Driver.hpp>
+#include <imu_advanced_navigation_anpp/Protocol.hpp>
+#include <imu_advanced_navigation_anpp/StreamGenerator.hpp>
+#include <iodrivers_base/Exceptions.hpp>
+#include <cstdlib>
+#include <unistd.h>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+
+/** A typical driver configuration, as packet periods with a 1ms packet
+ * timer period
+ */
+struct StreamConfiguration
+{
+    map<uint8_t, uint32_t> periods;
+    StreamGenerator::Corruption corruption;
+};
+
+/** What the set*Period methods of Driver configure for a control loop at
+ * 200Hz: status, position, orientation and velocity with their errors, and
+ * angular velocity
+ */
+static StreamConfiguration control200Hz()
+{
+    StreamConfiguration conf;
+    conf.periods = {
+        { protocol::UnixTime::ID, 5 },
+        { protocol::Status::ID, 5 },
+        { protocol::GeodeticPositionStandardDeviation::ID, 5 },
+        { protocol::NEDVelocityStandardDeviation::ID, 5 },
+        { protocol::EulerOrientationStandardDeviation::ID, 5 },
+        { protocol::GeodeticPosition::ID, 5 },
+        { protocol::NEDVelocity::ID, 5 },
+        { protocol::QuaternionOrientation::ID, 5 },
+        { protocol::AngularVelocity::ID, 5 }
+    };
+    return conf;
+}
+
+/** Raw IMU at 1kHz */
+static StreamConfiguration rawIMU1kHz()
+{
+    StreamConfiguration conf;
+    conf.periods = {
+        { protocol::UnixTime::ID, 1 },
+        { protocol::RawSensors::ID, 1 }
+    };
+    return conf;
+}
+
+/** Raw IMU at 1kHz on a noisy line */
+static StreamConfiguration rawIMU1kHzNoisy()
+{
+    StreamConfiguration conf = rawIMU1kHz();
+    conf.corruption.bit_flip = 0.01;
+    conf.corruption.garbage = 0.05;
+    conf.corruption.false_header = 0.01;
+    return conf;
+}
+
+/** GNSS survey: position at 100Hz, full GNSS information at 10Hz */
+static StreamConfiguration gnssSurvey()
+{
+    StreamConfiguration conf;
+    conf.periods = {
+        { protocol::UnixTime::ID, 10 },
+        { protocol::Status::ID, 100 },
+        { protocol::GeodeticPositionStandardDeviation::ID, 10 },
+        { protocol::RawGNSS::ID, 100 },
+        { protocol::Satellites::ID, 100 },
+        { protocol::DetailedSatellites::ID, 100 },
+        { protocol::GeodeticPosition::ID, 10 }
+    };
+    return conf;
+}
+
+/** Runs Driver::poll() over a synthetic capture, read from a file
+ *
+ * Each iteration processes the whole capture, from the read() calls in
+ * iodrivers_base to the update of the driver's samples
+ */
+static void BM_poll(benchmark::State& state, StreamConfiguration (*configure)())
+{
+    StreamConfiguration conf = configure();
+    StreamGenerator generator;
+    generator.setPacketPeriods(conf.periods);
+    generator.setCorruption(conf.corruption);
+    vector<uint8_t> stream;
+    generator.generate(stream, 1 << 20);
+    // End on clean packets, so that all the packets can be framed
+    generator.setCorruption(StreamGenerator::Corruption());
+    generator.generate(stream, protocol::MAX_PACKET_SIZE);
+    uint64_t packets = generator.getStatistics().valid_packets;
+
+    char path[] = "/tmp/imu_advanced_navigation_anpp_benchmark.XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0)
+    {
+        state.SkipWithError("cannot create a temporary file");
+        return;
+    }
+    unlink(path);
+    if (write(fd, stream.data(), stream.size()) != static_cast<ssize_t>(stream.size()))
+    {
+        close(fd);
+        state.SkipWithError("cannot write the temporary file");
+        return;
+    }
+
+    Driver driver;
+    driver.setFileDescriptor(fd);
+    driver.setReplayConfiguration(conf.periods, true);
+    for (auto _ : state)
+    {
+        lseek(fd, 0, SEEK_SET);
+        try
+        {
+            for (uint64_t i = 0; i < packets; ++i)
+                benchmark::DoNotOptimize(driver.poll());
+        }
+        catch (iodrivers_base::TimeoutError const&)
+        {
+            state.SkipWithError("some packets could not be read back");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * packets);
+    state.SetBytesProcessed(state.iterations() * stream.size());
+}
+BENCHMARK_CAPTURE(BM_poll, control_200Hz, control200Hz)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_poll, raw_imu_1kHz, rawIMU1kHz)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_poll, raw_imu_1kHz_noisy, rawIMU1kHzNoisy)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_poll, gnss_survey, gnssSurvey)->Unit(benchmark::kMillisecond);
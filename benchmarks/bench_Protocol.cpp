@@ -0,0 +1,163 @@
+#include <benchmark/benchmark.h>
+#include <imu_advanced_navigation_anpp/Protocol.hpp>
+#include <imu_advanced_navigation_anpp/StreamGenerator.hpp>
+#include <random>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+using protocol::Header;
+
+static vector<uint8_t> randomBytes(size_t size)
+{
+    mt19937 random(0);
+    uniform_int_distribution<int> byte(0, 255);
+    vector<uint8_t> result(size);
+    for (auto& b : result)
+        b = byte(random);
+    return result;
+}
+
+/** A stream of the packets that the driver usually processes */
+static vector<uint8_t> generateStream(StreamGenerator::Corruption const& corruption)
+{
+    StreamGenerator generator;
+    generator.setPacketPeriods({
+        { protocol::UnixTime::ID, 1 },
+        { protocol::Status::ID, 1 },
+        { protocol::RawSensors::ID, 1 },
+        { protocol::NEDVelocity::ID, 1 },
+        { protocol::QuaternionOrientation::ID, 1 },
+        { protocol::RawGNSS::ID, 100 },
+        { protocol::DetailedSatellites::ID, 100 }
+    });
+    generator.setCorruption(corruption);
+    vector<uint8_t> stream;
+    generator.generate(stream, 1 << 20);
+    return stream;
+}
+
+static void BM_crc(benchmark::State& state)
+{
+    auto payload = randomBytes(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(protocol::crc(payload.data(), payload.data() + payload.size()));
+    state.SetBytesProcessed(state.iterations() * payload.size());
+}
+BENCHMARK(BM_crc)->Arg(4)->Arg(64)->Arg(255);
+
+/** What extractPacket does when it looks for the next header in noise */
+static void BM_Header_isValid_scan(benchmark::State& state)
+{
+    auto noise = randomBytes(65536);
+    for (auto _ : state)
+    {
+        size_t count = 0;
+        for (size_t i = 0; i + Header::SIZE <= noise.size(); ++i)
+            count += reinterpret_cast<Header const&>(noise[i]).isValid();
+        benchmark::DoNotOptimize(count);
+    }
+    state.SetBytesProcessed(state.iterations() * noise.size());
+}
+BENCHMARK(BM_Header_isValid_scan);
+
+/** Frame a whole stream the way iodrivers_base does with
+ * Driver::extractPacket, which forwards to protocol::extractPacket
+ */
+static void extractAll(benchmark::State& state, vector<uint8_t> const& stream)
+{
+    size_t packets = 0;
+    for (auto _ : state)
+    {
+        packets = 0;
+        for (size_t start = 0; start < stream.size(); )
+        {
+            int result = protocol::extractPacket(&stream[start], stream.size() - start);
+            if (result > 0)
+            {
+                packets++;
+                start += result;
+            }
+            else if (result < 0)
+                start += -result;
+            else
+                break;
+        }
+        benchmark::DoNotOptimize(packets);
+    }
+    state.SetItemsProcessed(state.iterations() * packets);
+    state.SetBytesProcessed(state.iterations() * stream.size());
+}
+
+static void BM_extractPacket_clean(benchmark::State& state)
+{
+    extractAll(state, generateStream(StreamGenerator::Corruption()));
+}
+BENCHMARK(BM_extractPacket_clean)->Unit(benchmark::kMicrosecond);
+
+static void BM_extractPacket_noisy(benchmark::State& state)
+{
+    StreamGenerator::Corruption corruption;
+    corruption.bit_flip = 0.01;
+    corruption.truncation = 0.01;
+    corruption.garbage = 0.05;
+    corruption.false_header = 0.01;
+    extractAll(state, generateStream(corruption));
+}
+BENCHMARK(BM_extractPacket_noisy)->Unit(benchmark::kMicrosecond);
+
+template<typename Packet>
+static void BM_unmarshal(benchmark::State& state)
+{
+    // The values do not matter, only that the floating-point fields are
+    // not denormals, as unmarshal only copies bytes
+    vector<uint8_t> payload(Packet::SIZE);
+    for (size_t i = 0; i < payload.size(); ++i)
+        payload[i] = (i * 7 + 1) % 64;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(Packet::unmarshal(payload.begin(), payload.end()));
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_unmarshal, protocol::Acknowledge);
+BENCHMARK_TEMPLATE(BM_unmarshal, protocol::DeviceInformation);
+BENCHMARK_TEMPLATE(BM_unmarshal, protocol::SystemState);
+BENCHMARK_TEMPLATE(BM_unmarshal, protocol::UnixTime);
+BENCHMARK_TEMPLATE(BM_unmarshal, protocol::Status);
+BENCHMARK_TEMPLATE(BM_unmarshal, protocol::GeodeticPositionStandardDeviation);
+BENCHMARK_TEMPLATE(BM_unmarshal, protocol::NEDVelocityStandardDeviation);
+BENCHMARK_TEMPLATE(BM_unmarshal, protocol::EulerOrientationStandardDeviation);
+BENCHMARK_TEMPLATE(BM_unmarshal, protocol::RawSensors);
+BENCHMARK_TEMPLATE(BM_unmarshal, protocol::RawGNSS);
+BENCHMARK_TEMPLATE(BM_unmarshal, protocol::Satellites);
+BENCHMARK_TEMPLATE(BM_unmarshal, protocol::GeodeticPosition);
+BENCHMARK_TEMPLATE(BM_unmarshal, protocol::NEDVelocity);
+BENCHMARK_TEMPLATE(BM_unmarshal, protocol::BodyVelocity);
+BENCHMARK_TEMPLATE(BM_unmarshal, protocol::Acceleration);
+BENCHMARK_TEMPLATE(BM_unmarshal, protocol::BodyAcceleration);
+BENCHMARK_TEMPLATE(BM_unmarshal, protocol::QuaternionOrientation);
+BENCHMARK_TEMPLATE(BM_unmarshal, protocol::AngularVelocity);
+BENCHMARK_TEMPLATE(BM_unmarshal, protocol::AngularAcceleration);
+BENCHMARK_TEMPLATE(BM_unmarshal, protocol::LocalMagneticField);
+BENCHMARK_TEMPLATE(BM_unmarshal, protocol::NorthSeekingInitializationStatus);
+BENCHMARK_TEMPLATE(BM_unmarshal, protocol::MagneticCalibrationStatus);
+
+static void BM_unmarshal_DetailedSatellites(benchmark::State& state)
+{
+    uint8_t payload[protocol::MAX_PACKET_SIZE];
+    uint8_t* payload_end = payload;
+    for (int i = 0; i < state.range(0); ++i)
+    {
+        protocol::SatelliteInfo info { protocol::SATELLITE_SYSTEM_GPS,
+            static_cast<uint8_t>(i + 1), protocol::SATELLITE_FREQUENCY_L1CA, 45, 180, 40 };
+        payload_end = info.marshal(payload_end);
+    }
+
+    vector<protocol::SatelliteInfo> info;
+    for (auto _ : state)
+    {
+        info.clear();
+        protocol::DetailedSatellites::unmarshal(payload, payload_end, info);
+        benchmark::DoNotOptimize(info.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_unmarshal_DetailedSatellites)->Arg(1)->Arg(10)->Arg(36);
@@ -0,0 +1,33 @@
+#include <benchmark/benchmark.h>
+#include <imu_advanced_navigation_anpp/UTMBatchConverter.hpp>
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+
+/** Conversion of random positions within UTM zone 32 in a single thread */
+static void BM_UTMBatchConverter_convertToNWU(benchmark::State& state)
+{
+    size_t count = state.range(0);
+    mt19937 random(0);
+    uniform_real_distribution<double> latitude(-80, 84);
+    uniform_real_distribution<double> longitude(6, 12);
+    vector<double> latitudes(count), longitudes(count), altitudes(count, 100);
+    for (size_t i = 0; i < count; ++i)
+    {
+        latitudes[i] = latitude(random);
+        longitudes[i] = longitude(random);
+    }
+
+    UTMBatchConverter converter(32, true);
+    vector<double> x(count), y(count), z(count);
+    for (auto _ : state)
+    {
+        converter.convertToNWU(latitudes.data(), longitudes.data(), altitudes.data(), count,
+                               x.data(), y.data(), z.data(), 1);
+        benchmark::DoNotOptimize(x.data());
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_UTMBatchConverter_convertToNWU)->Arg(1000)->Arg(65536);
@@ -0,0 +1,31 @@
+#include <imu_advanced_navigation_anpp/AllocationCounter.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+static atomic<size_t> allocation_count(0);
+
+size_t imu_advanced_navigation_anpp::getAllocationCount()
+{
+    return allocation_count.load(memory_order_relaxed);
+}
+
+void* operator new(size_t size)
+{
+    allocation_count.fetch_add(1, memory_order_relaxed);
+    if (void* ptr = malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    free(ptr);
+}
@@ -0,0 +1,25 @@
+#ifndef ADVANCED_NAVIGATION_ANPP_ALLOCATION_COUNTER_HPP
+#define ADVANCED_NAVIGATION_ANPP_ALLOCATION_COUNTER_HPP
+
+#include <cstddef>
+
+namespace imu_advanced_navigation_anpp
+{
+    /** Number of calls to the global operator new done so far
+     *
+     * This is only available in the executables that link the
+     * imu_advanced_navigation_anpp_allocation_counter library, which
+     * replaces the global operator new and delete to count the allocations
+     * of the whole process. It is used by the ctl tool's bench command and
+     * the allocation regression tests, and is not part of the driver
+     * library itself.
+     *
+     * The counter is incremented atomically, so it can be used in processes
+     * that allocate from several threads. Only the allocations done between
+     * two calls in a single-threaded section can be attributed to that
+     * section, though.
+     */
+    size_t getAllocationCount();
+}
+
+#endif
@@ -0,0 +1,330 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <imu_advanced_navigation_anpp/CaptureReader.hpp>
+#include <imu_advanced_navigation_anpp/ColumnarExport.hpp>
+#include <imu_advanced_navigation_anpp/CaptureCodec.hpp>
+#include <imu_advanced_navigation_anpp/CaptureMerger.hpp>
+#include <imu_advanced_navigation_anpp/LogReplay.hpp>
+#include <imu_advanced_navigation_anpp/GoldenOutput.hpp>
+#include <imu_advanced_navigation_anpp/Driver.hpp>
+#include <imu_advanced_navigation_anpp/StreamGenerator.hpp>
+#include <imu_advanced_navigation_anpp/Protocol.hpp>
+#include <iodrivers_base/Exceptions.hpp>
+#include <cstdio>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+
+int usage()
+{
+    cerr
+        << "Usage: imu_advanced_navigation_anpp_capture COMMAND [args]\n"
+        << "Known commands:\n"
+        << "  export CAPTURE DIRECTORY\n"
+        << "  compress CAPTURE OUTPUT\n"
+        << "  decompress INPUT CAPTURE\n"
+        << "  merge OUTPUT CAPTURE [CAPTURE...]\n"
+        << "  replay LOG\n"
+        << "  generate OUTPUT SIZE [OPTIONS]\n"
+        << "  golden-record LOG GOLDEN\n"
+        << "  golden-compare LOG GOLDEN [--tolerance=T] [--max-differences=N]\n"
+        << "\n"
+        << "generate writes a synthetic capture of at least SIZE bytes. Options:\n"
+        << "  --period=ID:PERIOD  packet period, can be repeated (default: period 1\n"
+        << "                      for UnixTime, Status, RawSensors, NEDVelocity\n"
+        << "                      and QuaternionOrientation)\n"
+        << "  --timer=US          packet timer period in microseconds (default 1000)\n"
+        << "  --flip=P            per-packet probability of a bit flip\n"
+        << "  --truncate=P        per-packet probability of a truncation\n"
+        << "  --garbage=P         per-packet probability of inserted garbage\n"
+        << "  --false-header=P    per-packet probability of an inserted false header\n"
+        << "  --noise=SCALE       sensor noise, 1 being the typical device noise\n"
+        << "  --seed=SEED         seed of the generator\n"
+        << "\n"
+        << "golden-record writes the driver's outputs over LOG to the GOLDEN file,\n"
+        << "golden-compare compares them with a GOLDEN file. The comparison is\n"
+        << "bit-exact unless a tolerance is given, relative to the values' magnitude\n"
+        << "above 1 and absolute below.\n";
+    return 1;
+}
+
+void writeFile(string const& path, vector<uint8_t> const& data)
+{
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file)
+        throw iodrivers_base::UnixError("cannot open " + path);
+    size_t written = fwrite(data.data(), 1, data.size(), file);
+    fclose(file);
+    if (written != data.size())
+        throw iodrivers_base::UnixError("failed to write " + path);
+}
+
+static int generate(string const& path, size_t size, int argc, char** argv)
+{
+    map<uint8_t, uint32_t> periods;
+    StreamGenerator::Corruption corruption;
+    base::Time timer_period = base::Time::fromMilliseconds(1);
+    double noise = 0;
+    uint32_t seed = 0;
+    for (int i = 0; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg.compare(0, 9, "--period=") == 0)
+        {
+            size_t separator = arg.find(':');
+            if (separator == string::npos)
+                return usage();
+            periods[stoul(arg.substr(9, separator - 9))] = stoul(arg.substr(separator + 1));
+        }
+        else if (arg.compare(0, 8, "--timer=") == 0)
+            timer_period = base::Time::fromMicroseconds(stoul(arg.substr(8)));
+        else if (arg.compare(0, 7, "--flip=") == 0)
+            corruption.bit_flip = stod(arg.substr(7));
+        else if (arg.compare(0, 11, "--truncate=") == 0)
+            corruption.truncation = stod(arg.substr(11));
+        else if (arg.compare(0, 10, "--garbage=") == 0)
+            corruption.garbage = stod(arg.substr(10));
+        else if (arg.compare(0, 15, "--false-header=") == 0)
+            corruption.false_header = stod(arg.substr(15));
+        else if (arg.compare(0, 8, "--noise=") == 0)
+            noise = stod(arg.substr(8));
+        else if (arg.compare(0, 7, "--seed=") == 0)
+            seed = stoul(arg.substr(7));
+        else
+        {
+            cerr << "invalid generate argument '" << arg << "'\n";
+            return usage();
+        }
+    }
+
+    if (periods.empty())
+    {
+        periods = {
+            { protocol::UnixTime::ID, 1 },
+            { protocol::Status::ID, 1 },
+            { protocol::RawSensors::ID, 1 },
+            { protocol::NEDVelocity::ID, 1 },
+            { protocol::QuaternionOrientation::ID, 1 }
+        };
+    }
+
+    StreamGenerator generator(seed);
+    generator.setPacketPeriods(periods);
+    generator.setPacketTimerPeriod(timer_period);
+    generator.setCorruption(corruption);
+    generator.setNoise(noise);
+
+    vector<uint8_t> data;
+    data.reserve(size + protocol::MAX_PACKET_SIZE * periods.size());
+    generator.generate(data, size);
+    writeFile(path, data);
+
+    auto const& stats = generator.getStatistics();
+    cout << "Generated " << stats.trains << " trains, " << stats.bytes << " bytes\n"
+         << "  valid packets: " << stats.valid_packets << "\n";
+    for (auto const& id_and_count : stats.valid_packets_by_id)
+        cout << "    packet " << static_cast<int>(id_and_count.first)
+             << ": " << id_and_count.second << "\n";
+    cout << "  bit flips: " << stats.bit_flips << "\n"
+         << "  truncations: " << stats.truncations << "\n"
+         << "  garbage: " << stats.garbage_insertions << " insertions, "
+         << stats.garbage_bytes << " bytes\n"
+         << "  false headers: " << stats.false_headers << endl;
+    return 0;
+}
+
+static int goldenRecord(string const& log_path, string const& golden_path)
+{
+    ofstream out(golden_path, ios::binary);
+    if (!out)
+        throw iodrivers_base::UnixError("cannot open " + golden_path);
+
+    golden::Writer writer(out);
+    uint64_t count = golden::replay(log_path,
+        [&writer](golden::Record const& record) { writer.write(record); });
+    out.close();
+    if (!out)
+        throw iodrivers_base::UnixError("failed to write " + golden_path);
+
+    cout << "Recorded " << count << " outputs of "
+         << golden::getFieldNames().size() << " values" << endl;
+    return 0;
+}
+
+static int goldenCompare(string const& log_path, string const& golden_path, int argc, char** argv)
+{
+    double tolerance = 0;
+    size_t max_differences = 20;
+    for (int i = 0; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg.compare(0, 12, "--tolerance=") == 0)
+            tolerance = stod(arg.substr(12));
+        else if (arg.compare(0, 18, "--max-differences=") == 0)
+            max_differences = stoul(arg.substr(18));
+        else
+        {
+            cerr << "invalid golden-compare argument '" << arg << "'\n";
+            return usage();
+        }
+    }
+
+    ifstream in(golden_path, ios::binary);
+    if (!in)
+        throw iodrivers_base::UnixError("cannot open " + golden_path);
+    golden::Reader reader(in);
+    auto const& names = golden::getFieldNames();
+    if (reader.getFieldNames() != names)
+    {
+        cerr << golden_path << " has been recorded with different fields, re-record it\n";
+        return 1;
+    }
+
+    golden::Comparison comparison(tolerance, max_differences);
+    golden::Record expected;
+    golden::replay(log_path, [&](golden::Record const& actual) {
+        if (reader.next(expected))
+            comparison.add(expected, actual);
+        else
+            comparison.addExtra();
+    });
+    while (reader.next(expected))
+        comparison.addMissing();
+
+    cout << setprecision(17);
+    for (auto const& difference : comparison.getDifferences())
+    {
+        cout << "output " << difference.record << ": "
+             << (difference.field < 0 ? string("period") : names[difference.field])
+             << " expected " << difference.expected
+             << ", got " << difference.actual << "\n";
+    }
+    cout << "Compared " << comparison.getRecordCount() << " outputs: "
+         << comparison.getDifferingRecordCount() << " differ ("
+         << comparison.getDifferingValueCount() << " values), "
+         << comparison.getMissingRecordCount() << " missing, "
+         << comparison.getExtraRecordCount() << " extra" << endl;
+    return comparison.isMatching() ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+        return usage();
+
+    string cmd = argv[1];
+    if (cmd == "export")
+    {
+        if (argc != 4)
+            return usage();
+
+        CaptureReader reader(argv[2]);
+        reader.index();
+
+        ColumnarExporter exporter(argv[3]);
+        for (auto const& packet : reader.getPackets())
+            exporter.add(reader.getPacketData(packet), packet.size);
+        exporter.flush();
+
+        cout
+            << "Exported " << exporter.getExportedPacketCount() << " packets"
+            << ", ignored " << exporter.getIgnoredPacketCount() << " packets"
+            << " and " << reader.getDiscardedBytes() << " bytes of garbage" << endl;
+    }
+    else if (cmd == "compress" || cmd == "decompress")
+    {
+        if (argc != 4)
+            return usage();
+
+        CaptureReader reader(argv[2]);
+        vector<uint8_t> result;
+        if (cmd == "compress")
+            result = codec::compress(reader.getData(), reader.getSize());
+        else
+            result = codec::decompress(reader.getData(), reader.getSize());
+        writeFile(argv[3], result);
+
+        cout << reader.getSize() << " bytes -> " << result.size() << " bytes" << endl;
+    }
+    else if (cmd == "merge")
+    {
+        if (argc < 4)
+            return usage();
+
+        vector<string> paths(argv + 3, argv + argc);
+        CaptureMerger merger(paths);
+        merger.write(argv[2]);
+        for (auto const& source : merger.getSources())
+        {
+            cout << source.path << ": ";
+            if (source.has_device_information)
+            {
+                DeviceInformation const& info = source.device_information;
+                cout << "serial number " << setfill('0')
+                     << setw(8) << info.serial_number_part0
+                     << setw(8) << info.serial_number_part1
+                     << setw(8) << info.serial_number_part2
+                     << setfill(' ') << "\n";
+            }
+            else
+                cout << "no device information\n";
+        }
+    }
+    else if (cmd == "replay")
+    {
+        if (argc != 3)
+            return usage();
+
+        auto periods = LogReplay::inferPacketPeriods(argv[2]);
+        bool use_device_time = LogReplay::hasDeviceTime(argv[2]);
+        if (!use_device_time)
+            cout << "No UnixTime packets in the log, timestamping with the host time\n";
+        Driver driver;
+        driver.setReplayConfiguration(periods, use_device_time);
+        LogReplay replay(driver, argv[2]);
+
+        map<int, size_t> completed;
+        int result;
+        while (replay.next(result))
+        {
+            if (result > 0)
+                completed[result]++;
+        }
+
+        cout << "Processed " << replay.getPacketCount() << " packets"
+             << " and skipped " << replay.getDiscardedBytes() << " bytes of garbage\n";
+        for (auto const& id_and_period : periods)
+            cout << "  packet " << static_cast<int>(id_and_period.first)
+                 << ": period " << id_and_period.second << "\n";
+        for (auto const& period_and_count : completed)
+            cout << "  period " << period_and_count.first << " completed "
+                 << period_and_count.second << " times\n";
+        cout << "Last update: " << driver.getCurrentTimestamp() << endl;
+    }
+    else if (cmd == "golden-record")
+    {
+        if (argc != 4)
+            return usage();
+        return goldenRecord(argv[2], argv[3]);
+    }
+    else if (cmd == "golden-compare")
+    {
+        if (argc < 4)
+            return usage();
+        return goldenCompare(argv[2], argv[3], argc - 4, argv + 4);
+    }
+    else if (cmd == "generate")
+    {
+        if (argc < 4)
+            return usage();
+        return generate(argv[2], stoul(argv[3]), argc - 4, argv + 4);
+    }
+    else
+    {
+        cerr << "Unknown command '" << cmd << "'\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,427 @@
+#include <imu_advanced_navigation_anpp/CaptureCodec.hpp>
+#include <imu_advanced_navigation_anpp/Protocol.hpp>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <zlib.h>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+using protocol::Header;
+
+namespace
+{
+    /** Encoding state of a single payload field */
+    struct Field
+    {
+        uint8_t offset;
+        uint8_t width;
+        /** The last two values of the field, as raw bit patterns */
+        uint64_t previous = 0;
+        uint64_t previous2 = 0;
+
+        Field(uint8_t offset, uint8_t width)
+            : offset(offset), width(width) {}
+    };
+
+    /** Per-packet ID encoding state */
+    struct PacketState
+    {
+        size_t size = numeric_limits<size_t>::max();
+        vector<Field> fields;
+    };
+
+    /** Offsets of the double fields of a given packet */
+    vector<uint8_t> getDoubleOffsets(uint8_t packet_id)
+    {
+        switch(packet_id)
+        {
+            case protocol::SystemState::ID: return { 12, 20, 28 };
+            case protocol::RawGNSS::ID: return { 8, 16, 24 };
+            case protocol::GeodeticPosition::ID: return { 0, 8, 16 };
+            default: return {};
+        }
+    }
+
+    /** (Re)initialize the state of a packet ID when the payload size
+     * changes (e.g. DetailedSatellites) */
+    void updateLayout(PacketState& state, uint8_t packet_id, size_t size)
+    {
+        if (state.size == size)
+            return;
+
+        state.size = size;
+        state.fields.clear();
+        auto doubles = getDoubleOffsets(packet_id);
+        size_t offset = 0;
+        while (offset < size)
+        {
+            uint8_t width;
+            if (offset + 8 <= size && find(doubles.begin(), doubles.end(), offset) != doubles.end())
+                width = 8;
+            else if (offset + 4 <= size)
+                width = 4;
+            else
+                width = 1;
+            state.fields.emplace_back(offset, width);
+            offset += width;
+        }
+    }
+
+    uint64_t shiftLeft(uint64_t value, unsigned shift)
+    {
+        return shift >= 64 ? 0 : value << shift;
+    }
+
+    uint64_t shiftRight(uint64_t value, unsigned shift)
+    {
+        return shift >= 64 ? 0 : value >> shift;
+    }
+
+    uint64_t mask(unsigned bits)
+    {
+        return bits >= 64 ? ~0ULL : (1ULL << bits) - 1;
+    }
+
+    /** LSB-first bit writer */
+    class BitWriter
+    {
+        vector<uint8_t>& mOut;
+        uint64_t mAccumulator = 0;
+        unsigned mCount = 0;
+
+    public:
+        explicit BitWriter(vector<uint8_t>& out)
+            : mOut(out) {}
+
+        /** Write the @a bits least significant bits of value. The other
+         * bits must be zero */
+        void write(uint64_t value, unsigned bits)
+        {
+            mAccumulator |= shiftLeft(value, mCount);
+            mCount += bits;
+            if (mCount >= 64)
+            {
+                size_t size = mOut.size();
+                mOut.resize(size + 8);
+                protocol::write64(&mOut[size], mAccumulator);
+                mCount -= 64;
+                mAccumulator = shiftRight(value, bits - mCount);
+            }
+        }
+
+        void flush()
+        {
+            for (; mCount > 0; mCount -= min(mCount, 8u))
+            {
+                mOut.push_back(mAccumulator & 0xFF);
+                mAccumulator >>= 8;
+            }
+        }
+    };
+
+    /** LSB-first bit reader, counterpart of BitWriter */
+    class BitReader
+    {
+        uint8_t const* mIt;
+        uint8_t const* mEnd;
+        uint64_t mAccumulator = 0;
+        unsigned mCount = 0;
+
+        uint64_t refill()
+        {
+            if (mIt == mEnd)
+                throw std::runtime_error("truncated field stream");
+
+            uint8_t bytes[8] = { 0 };
+            size_t count = min<size_t>(8, mEnd - mIt);
+            copy(mIt, mIt + count, bytes);
+            mIt += count;
+            return protocol::read64<uint64_t>(bytes);
+        }
+
+    public:
+        BitReader(uint8_t const* begin, uint8_t const* end)
+            : mIt(begin), mEnd(end) {}
+
+        uint64_t read(unsigned bits)
+        {
+            if (bits <= mCount)
+            {
+                uint64_t value = mAccumulator & mask(bits);
+                mAccumulator = shiftRight(mAccumulator, bits);
+                mCount -= bits;
+                return value;
+            }
+
+            uint64_t value = mAccumulator;
+            unsigned missing = bits - mCount;
+            uint64_t next = refill();
+            value |= shiftLeft(next, mCount);
+            value &= mask(bits);
+            mAccumulator = shiftRight(next, missing);
+            mCount = 64 - missing;
+            return value;
+        }
+    };
+
+    template<typename T>
+    T zigzag(T delta)
+    {
+        typedef typename make_signed<T>::type Signed;
+        return static_cast<T>(delta << 1) ^ static_cast<T>(static_cast<Signed>(delta) >> (sizeof(T) * 8 - 1));
+    }
+
+    template<typename T>
+    T unzigzag(T value)
+    {
+        return static_cast<T>(value >> 1) ^ static_cast<T>(-static_cast<T>(value & 1));
+    }
+
+    template<typename T>
+    unsigned significantBits(T value)
+    {
+        return value ? 64 - __builtin_clzll(value) : 0;
+    }
+
+    /** Encode a field value
+     *
+     * Unchanged values are encoded as a single zero bit. Otherwise, the
+     * value is predicted either as the previous value or as the linear
+     * extrapolation of the two previous ones, the integer difference
+     * between the bit pattern of the value and of the prediction is zigzag
+     * encoded and written as its number of significant bits followed by
+     * the significant bits minus the implicit most significant one.
+     */
+    template<typename T, unsigned LOG>
+    void encodeField(BitWriter& writer, Field& field, T value)
+    {
+        T previous = field.previous;
+        T extrapolated = 2 * previous - static_cast<T>(field.previous2);
+        field.previous2 = previous;
+        field.previous = value;
+        if (value == previous)
+        {
+            writer.write(0, 1);
+            return;
+        }
+
+        T delta = zigzag<T>(value - previous);
+        T extrapolated_delta = zigzag<T>(value - extrapolated);
+        bool use_extrapolation = extrapolated_delta < delta;
+        T residual = use_extrapolation ? extrapolated_delta : delta;
+        unsigned bits = significantBits(residual);
+        writer.write(1 | use_extrapolation << 1, 2);
+        writer.write(bits, LOG + 1);
+        if (bits > 1)
+            writer.write(residual & mask(bits - 1), bits - 1);
+    }
+
+    template<typename T, unsigned LOG>
+    T decodeField(BitReader& reader, Field& field)
+    {
+        T previous = field.previous;
+        T extrapolated = 2 * previous - static_cast<T>(field.previous2);
+        field.previous2 = previous;
+        if (!reader.read(1))
+            return previous;
+
+        bool use_extrapolation = reader.read(1);
+        unsigned bits = reader.read(LOG + 1);
+        if (bits > sizeof(T) * 8)
+            throw std::runtime_error("invalid residual size in field stream");
+
+        T residual = 0;
+        if (bits > 0)
+            residual = static_cast<T>(shiftLeft(1, bits - 1) | (bits > 1 ? reader.read(bits - 1) : 0));
+        T value = (use_extrapolation ? extrapolated : previous) + unzigzag(residual);
+        field.previous = value;
+        return value;
+    }
+
+    void writeVarint(vector<uint8_t>& out, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back((value & 0x7F) | 0x80);
+            value >>= 7;
+        }
+        out.push_back(value);
+    }
+
+    uint64_t readVarint(uint8_t const*& it, uint8_t const* end)
+    {
+        uint64_t value = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7)
+        {
+            if (it == end)
+                throw std::runtime_error("truncated control stream");
+            uint8_t byte = *it++;
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+                return value;
+        }
+        throw std::runtime_error("invalid varint in control stream");
+    }
+
+    void writeGarbage(vector<uint8_t>& control, uint8_t const* begin, uint8_t const* end)
+    {
+        if (begin == end)
+            return;
+        writeVarint(control, 0);
+        writeVarint(control, end - begin);
+        control.insert(control.end(), begin, end);
+    }
+
+    uint64_t readHeader64(uint8_t const*& it, uint8_t const* end)
+    {
+        if (end - it < 8)
+            throw std::runtime_error("truncated compressed capture");
+        uint64_t value = protocol::read64<uint64_t>(it);
+        it += 8;
+        return value;
+    }
+}
+
+vector<uint8_t> codec::compress(uint8_t const* data, size_t size)
+{
+    array<PacketState, protocol::PACKET_ID_COUNT> states;
+    vector<uint8_t> control;
+    vector<uint8_t> fields;
+    fields.reserve(size / 2);
+    BitWriter writer(fields);
+
+    size_t pos = 0;
+    size_t garbage_start = 0;
+    while (pos < size)
+    {
+        int result = protocol::extractPacket(data + pos, size - pos);
+        if (result == 0)
+            break;
+        else if (result < 0)
+        {
+            pos += -result;
+            continue;
+        }
+
+        writeGarbage(control, data + garbage_start, data + pos);
+
+        uint8_t packet_id = data[pos + 1];
+        uint8_t const* payload = data + pos + Header::SIZE;
+        size_t payload_size = result - Header::SIZE;
+        writeVarint(control, packet_id + 1);
+        writeVarint(control, payload_size);
+
+        PacketState& state = states[packet_id];
+        updateLayout(state, packet_id, payload_size);
+        for (auto& field : state.fields)
+        {
+            uint8_t const* it = payload + field.offset;
+            switch(field.width)
+            {
+                case 8: encodeField<uint64_t, 6>(writer, field, protocol::read64<uint64_t>(it)); break;
+                case 4: encodeField<uint32_t, 5>(writer, field, protocol::read32<uint32_t>(it)); break;
+                default: encodeField<uint8_t, 3>(writer, field, *it); break;
+            }
+        }
+
+        pos += result;
+        garbage_start = pos;
+    }
+    writeGarbage(control, data + garbage_start, data + size);
+    writer.flush();
+
+    uLongf compressed_size = compressBound(control.size());
+    vector<uint8_t> out(sizeof(CODEC_MAGIC) + 24 + compressed_size + 8 + fields.size());
+    uint8_t* it = out.data();
+    it = copy(CODEC_MAGIC, CODEC_MAGIC + sizeof(CODEC_MAGIC), it);
+    protocol::write64(it, static_cast<uint64_t>(size));
+    protocol::write64(it + 8, static_cast<uint64_t>(control.size()));
+    int result = compress2(it + 24, &compressed_size,
+            control.data(), control.size(), Z_BEST_SPEED);
+    if (result != Z_OK)
+        throw std::runtime_error("failed to compress control stream");
+    protocol::write64(it + 16, static_cast<uint64_t>(compressed_size));
+    it += 24 + compressed_size;
+    protocol::write64(it, static_cast<uint64_t>(fields.size()));
+    it = copy(fields.begin(), fields.end(), it + 8);
+    out.resize(it - out.data());
+    return out;
+}
+
+vector<uint8_t> codec::decompress(uint8_t const* data, size_t size)
+{
+    uint8_t const* it = data;
+    uint8_t const* end = data + size;
+    if (size < sizeof(CODEC_MAGIC) || !equal(CODEC_MAGIC, CODEC_MAGIC + sizeof(CODEC_MAGIC), data))
+        throw std::runtime_error("not a compressed ANPP capture");
+    it += sizeof(CODEC_MAGIC);
+
+    uint64_t original_size = readHeader64(it, end);
+    uint64_t control_size = readHeader64(it, end);
+    uint64_t compressed_size = readHeader64(it, end);
+    if (static_cast<uint64_t>(end - it) < compressed_size)
+        throw std::runtime_error("truncated compressed capture");
+
+    vector<uint8_t> control(control_size);
+    uLongf uncompressed_size = control_size;
+    if (uncompress(control.data(), &uncompressed_size, it, compressed_size) != Z_OK ||
+        uncompressed_size != control_size)
+        throw std::runtime_error("failed to uncompress control stream");
+    it += compressed_size;
+
+    uint64_t fields_size = readHeader64(it, end);
+    if (static_cast<uint64_t>(end - it) < fields_size)
+        throw std::runtime_error("truncated compressed capture");
+    BitReader reader(it, it + fields_size);
+
+    array<PacketState, protocol::PACKET_ID_COUNT> states;
+    vector<uint8_t> out;
+    out.reserve(original_size);
+
+    uint8_t const* control_it = control.data();
+    uint8_t const* control_end = control_it + control.size();
+    while (control_it != control_end)
+    {
+        uint64_t tag = readVarint(control_it, control_end);
+        uint64_t length = readVarint(control_it, control_end);
+        if (tag == 0)
+        {
+            if (static_cast<uint64_t>(control_end - control_it) < length)
+                throw std::runtime_error("truncated control stream");
+            out.insert(out.end(), control_it, control_it + length);
+            control_it += length;
+            continue;
+        }
+        else if (tag > protocol::PACKET_ID_COUNT || length + Header::SIZE > protocol::MAX_PACKET_SIZE)
+            throw std::runtime_error("invalid packet in control stream");
+
+        uint8_t packet_id = tag - 1;
+        size_t packet_start = out.size();
+        out.resize(packet_start + Header::SIZE + length);
+        uint8_t* payload = &out[packet_start + Header::SIZE];
+
+        PacketState& state = states[packet_id];
+        updateLayout(state, packet_id, length);
+        for (auto& field : state.fields)
+        {
+            uint8_t* field_it = payload + field.offset;
+            switch(field.width)
+            {
+                case 8: protocol::write64(field_it, decodeField<uint64_t, 6>(reader, field)); break;
+                case 4: protocol::write32(field_it, decodeField<uint32_t, 5>(reader, field)); break;
+                default: *field_it = decodeField<uint8_t, 3>(reader, field); break;
+            }
+        }
+
+        Header header(packet_id, payload, payload + length);
+        memcpy(&out[packet_start], &header, Header::SIZE);
+    }
+
+    if (out.size() != original_size)
+        throw std::runtime_error("decompressed capture size does not match the original size");
+    return out;
+}
@@ -0,0 +1,64 @@
+#ifndef ADVANCED_NAVIGATION_ANPP_CAPTURE_CODEC_HPP
+#define ADVANCED_NAVIGATION_ANPP_CAPTURE_CODEC_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace imu_advanced_navigation_anpp
+{
+    /** Lossless compression of raw ANPP captures
+     *
+     * The capture is framed with protocol::extractPacket. Packet payloads
+     * are split into fields (64 bit words for the double fields of
+     * GeodeticPosition, RawGNSS and SystemState, 32 bit words otherwise,
+     * bytes for the remainder) and each field is encoded relative to the
+     * same field of the previous packets with the same ID, in the spirit of
+     * Facebook's Gorilla time-series database: unchanged values take a
+     * single bit, and changed values are stored as the zigzag-encoded
+     * integer difference between their IEEE bit pattern and a prediction
+     * (either the previous value or the linear extrapolation of the two
+     * previous ones), prefixed by its number of significant bits.
+     * Slowly-varying floats and doubles therefore only cost the bits that
+     * actually change.
+     *
+     * Headers are not stored, but recomputed from the packet ID and payload
+     * on decompression. Since the codec only considers packets with a
+     * valid LRC and CRC, this gives back the original headers. Bytes that
+     * are not part of a valid packet are stored verbatim, so that
+     * decompression gives back the exact original capture.
+     *
+     * The resulting format is:
+     *
+     * <pre>
+     * CODEC_MAGIC
+     * uint64 original size
+     * uint64 size of the uncompressed control stream
+     * uint64 size of the zlib-compressed control stream
+     * compressed control stream
+     * uint64 size of the field stream
+     * field stream
+     * </pre>
+     *
+     * The control stream is a sequence of LEB128-encoded tags. A tag of
+     * zero is followed by a length and that many bytes of garbage. A
+     * nonzero tag is the packet ID plus one, followed by the payload length.
+     * The field stream is the bit-packed payloads, in packet order.
+     */
+    namespace codec
+    {
+        static const char CODEC_MAGIC[8] = { 'A', 'N', 'P', 'P', 'C', 'D', 'C', '1' };
+
+        /** Compress a raw capture */
+        std::vector<uint8_t> compress(uint8_t const* data, size_t size);
+
+        /** Decompress data generated by compress()
+         *
+         * @throw std::runtime_error if the data is not a valid compressed
+         *   capture
+         */
+        std::vector<uint8_t> decompress(uint8_t const* data, size_t size);
+    }
+}
+
+#endif
@@ -0,0 +1,142 @@
+#include <imu_advanced_navigation_anpp/CaptureMerger.hpp>
+#include <imu_advanced_navigation_anpp/CaptureStreamReader.hpp>
+#include <imu_advanced_navigation_anpp/Protocol.hpp>
+#include <iodrivers_base/Exceptions.hpp>
+#include <algorithm>
+#include <cstdio>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+using protocol::Header;
+
+const char CaptureMerger::MERGE_MAGIC[8] = { 'A', 'N', 'P', 'P', 'M', 'R', 'G', '1' };
+
+bool CaptureMerger::Head::operator < (Head const& other) const
+{
+    // std::priority_queue is a max-heap, reverse the order
+    if (device_time != other.device_time)
+        return device_time > other.device_time;
+    return source > other.source;
+}
+
+CaptureMerger::CaptureMerger(vector<string> const& paths)
+    : mDeviceTimes(paths.size(), 0)
+{
+    for (auto const& path : paths)
+    {
+        Source source;
+        source.path = path;
+        source.device_information = DeviceInformation();
+        mSources.push_back(source);
+        mReaders.emplace_back(new CaptureStreamReader(path));
+    }
+
+    for (uint32_t i = 0; i < mReaders.size(); ++i)
+        advance(i);
+}
+
+CaptureMerger::~CaptureMerger()
+{
+}
+
+vector<CaptureMerger::Source> const& CaptureMerger::getSources() const
+{
+    return mSources;
+}
+
+void CaptureMerger::advance(uint32_t source)
+{
+    size_t size;
+    uint8_t const* packet = mReaders[source]->next(size);
+    if (!packet)
+        return;
+
+    if (packet[1] == protocol::UnixTime::ID)
+    {
+        try
+        {
+            auto time = protocol::UnixTime::unmarshal(packet + Header::SIZE, packet + size);
+            mDeviceTimes[source] = static_cast<int64_t>(time.seconds) * 1000000 + time.microseconds;
+        }
+        catch(std::length_error const&) {}
+    }
+    else if (packet[1] == protocol::DeviceInformation::ID &&
+             !mSources[source].has_device_information)
+    {
+        try
+        {
+            mSources[source].device_information =
+                protocol::DeviceInformation::unmarshal(packet + Header::SIZE, packet + size);
+            mSources[source].has_device_information = true;
+        }
+        catch(std::length_error const&) {}
+    }
+    mHeads.push(Head { source, mDeviceTimes[source], packet, size });
+}
+
+bool CaptureMerger::next(Record& record)
+{
+    // The packet returned by the last call is owned by the source's reader,
+    // it can only be advanced now
+    if (mPendingSource != -1)
+        advance(mPendingSource);
+    mPendingSource = -1;
+
+    if (mHeads.empty())
+        return false;
+
+    Head head = mHeads.top();
+    mHeads.pop();
+    record = Record { head.source, head.device_time, head.packet, head.size };
+    mPendingSource = head.source;
+    return true;
+}
+
+void CaptureMerger::write(string const& path)
+{
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file)
+        throw iodrivers_base::UnixError("cannot open " + path);
+
+    uint8_t buffer[12 + protocol::DeviceInformation::SIZE];
+    fwrite(MERGE_MAGIC, 1, sizeof(MERGE_MAGIC), file);
+    protocol::write32(buffer, static_cast<uint32_t>(mSources.size()));
+    fwrite(buffer, 1, 4, file);
+
+    // The device information is gathered during the merge, reserve the
+    // source table and fill it at the end
+    long table_offset = ftell(file);
+    fill(buffer, buffer + protocol::DeviceInformation::SIZE, 0);
+    for (size_t i = 0; i < mSources.size(); ++i)
+        fwrite(buffer, 1, protocol::DeviceInformation::SIZE, file);
+
+    Record record;
+    while (next(record))
+    {
+        protocol::write32(buffer, record.source);
+        protocol::write64(buffer + 4, record.device_time);
+        fwrite(buffer, 1, 12, file);
+        fwrite(record.packet, 1, record.size, file);
+    }
+
+    if (fseek(file, table_offset, SEEK_SET) != 0)
+    {
+        fclose(file);
+        throw iodrivers_base::UnixError("cannot seek in " + path);
+    }
+    for (auto const& source : mSources)
+    {
+        DeviceInformation const& info = source.device_information;
+        protocol::write32(buffer, info.software_version);
+        protocol::write32(buffer + 4, info.device_id);
+        protocol::write32(buffer + 8, info.hardware_revision);
+        protocol::write32(buffer + 12, info.serial_number_part0);
+        protocol::write32(buffer + 16, info.serial_number_part1);
+        protocol::write32(buffer + 20, info.serial_number_part2);
+        fwrite(buffer, 1, protocol::DeviceInformation::SIZE, file);
+    }
+
+    bool failed = ferror(file);
+    if (fclose(file) != 0 || failed)
+        throw iodrivers_base::UnixError("failed to write " + path);
+}
@@ -0,0 +1,118 @@
+#ifndef ADVANCED_NAVIGATION_ANPP_CAPTURE_MERGER_HPP
+#define ADVANCED_NAVIGATION_ANPP_CAPTURE_MERGER_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <queue>
+#include <imu_advanced_navigation_anpp/DeviceInformation.hpp>
+
+namespace imu_advanced_navigation_anpp
+{
+    class CaptureStreamReader;
+
+    /** Time-ordered merge of the raw captures of several devices
+     *
+     * Each packet is timestamped with the device time of the last UnixTime
+     * packet that has been received from the same device, UnixTime
+     * included. Packets received before the first UnixTime get a time of
+     * zero. Packets from the same capture stay in the capture order, and
+     * packets with the same time from different captures are ordered by
+     * capture index.
+     *
+     * The merge is a streaming k-way merge: only one packet per capture is
+     * held in memory at any given time, through a CaptureStreamReader.
+     */
+    class CaptureMerger
+    {
+    public:
+        static const char MERGE_MAGIC[8];
+
+        /** A merged packet */
+        struct Record
+        {
+            /** Index of the capture the packet comes from */
+            uint32_t source;
+            /** Device time in microseconds */
+            int64_t device_time;
+            /** The packet, header included. It is valid until the next call
+             * to next() */
+            uint8_t const* packet;
+            /** The packet size, header included */
+            size_t size;
+        };
+
+        /** Information about one of the merged captures */
+        struct Source
+        {
+            std::string path;
+            /** Whether a DeviceInformation packet has been found in the
+             * capture so far */
+            bool has_device_information = false;
+            /** The device information, zeroed if has_device_information is
+             * false */
+            DeviceInformation device_information;
+        };
+
+    private:
+        struct Head
+        {
+            uint32_t source;
+            int64_t device_time;
+            uint8_t const* packet;
+            size_t size;
+
+            bool operator < (Head const& other) const;
+        };
+
+        std::vector<Source> mSources;
+        std::vector< std::unique_ptr<CaptureStreamReader> > mReaders;
+        std::vector<int64_t> mDeviceTimes;
+        std::priority_queue<Head> mHeads;
+        int mPendingSource = -1;
+
+        void advance(uint32_t source);
+
+    public:
+        /** Open the given captures
+         *
+         * @throw iodrivers_base::UnixError if a capture cannot be opened
+         */
+        explicit CaptureMerger(std::vector<std::string> const& paths);
+        ~CaptureMerger();
+
+        /** Information about the merged captures, in the order they were
+         * given to the constructor
+         *
+         * The captures are not scanned ahead of the merge: the device
+         * information of a capture is only known once its first
+         * DeviceInformation packet has been merged. It is therefore
+         * complete only after next() returned false, or after write()
+         */
+        std::vector<Source> const& getSources() const;
+
+        /** Get the next packet in time order
+         *
+         * @return false once all captures have been fully read
+         */
+        bool next(Record& record);
+
+        /** Merge all the captures into a file
+         *
+         * The file starts with MERGE_MAGIC and a uint32 source count,
+         * followed by the DeviceInformation packet payload of each source
+         * (DeviceInformation::SIZE bytes, zeroed if none was found). It is
+         * then a sequence of records, each being the uint32 source index,
+         * the int64 device time in microseconds and the raw packet, header
+         * included. All values are little-endian.
+         *
+         * The source table is written once the merge is done, so the file
+         * must be seekable.
+         *
+         * @throw iodrivers_base::UnixError if the file cannot be written
+         */
+        void write(std::string const& path);
+    };
+}
+
+#endif
@@ -0,0 +1,172 @@
+#include <imu_advanced_navigation_anpp/CaptureReader.hpp>
+#include <imu_advanced_navigation_anpp/Protocol.hpp>
+#include <iodrivers_base/Exceptions.hpp>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+
+CaptureReader::CaptureReader(string const& path)
+{
+    mFD = ::open(path.c_str(), O_RDONLY);
+    if (mFD == -1)
+        throw iodrivers_base::UnixError("cannot open " + path);
+
+    struct stat info;
+    if (fstat(mFD, &info) == -1)
+    {
+        ::close(mFD);
+        throw iodrivers_base::UnixError("cannot stat " + path);
+    }
+
+    mSize = info.st_size;
+    if (mSize == 0)
+        return;
+
+    void* data = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, mFD, 0);
+    if (data == MAP_FAILED)
+    {
+        ::close(mFD);
+        throw iodrivers_base::UnixError("cannot map " + path);
+    }
+    madvise(data, mSize, MADV_SEQUENTIAL);
+    mData = static_cast<uint8_t const*>(data);
+}
+
+CaptureReader::~CaptureReader()
+{
+    if (mData)
+        munmap(const_cast<uint8_t*>(mData), mSize);
+    ::close(mFD);
+}
+
+void CaptureReader::frameChunk(size_t begin, size_t end, vector<Packet>& packets) const
+{
+    // Any packet that starts within the chunk fits within 'limit'. A zero
+    // return from extractPacket therefore means that we reached the end of
+    // the file
+    size_t limit = min(mSize, end + protocol::MAX_PACKET_SIZE);
+    size_t pos = begin;
+    while (pos < end)
+    {
+        int result = protocol::extractPacket(mData + pos, limit - pos);
+        if (result > 0)
+        {
+            packets.push_back(Packet { pos, static_cast<size_t>(result) });
+            pos += result;
+        }
+        else if (result < 0)
+            pos += -result;
+        else
+            break;
+    }
+}
+
+static bool isBefore(CaptureReader::Packet const& packet, size_t offset)
+{
+    return packet.offset < offset;
+}
+
+void CaptureReader::merge(vector< vector<Packet> > const& chunks)
+{
+    mPackets.clear();
+
+    size_t pos = 0;
+    for (auto const& chunk : chunks)
+    {
+        // Re-frame sequentially from the end of the last accepted packet
+        // until we land on a packet that the chunk also found. In the
+        // common case, this does nothing as the chunk resynchronized on the
+        // packet that directly follows the previous chunk's last packet
+        auto it = lower_bound(chunk.begin(), chunk.end(), pos, isBefore);
+        while (it != chunk.end() && it->offset != pos)
+        {
+            size_t limit = min(mSize, it->offset + protocol::MAX_PACKET_SIZE);
+            int result = protocol::extractPacket(mData + pos, limit - pos);
+            if (result > 0)
+            {
+                mPackets.push_back(Packet { pos, static_cast<size_t>(result) });
+                pos += result;
+            }
+            else if (result < 0)
+                pos += -result;
+            else
+                break;
+            it = lower_bound(it, chunk.end(), pos, isBefore);
+        }
+
+        if (it != chunk.end())
+        {
+            mPackets.insert(mPackets.end(), it, chunk.end());
+            pos = mPackets.back().offset + mPackets.back().size;
+        }
+    }
+}
+
+void CaptureReader::index(size_t thread_count, size_t chunk_size)
+{
+    if (chunk_size <= static_cast<size_t>(protocol::MAX_PACKET_SIZE))
+        throw std::invalid_argument("chunk size must be bigger than the maximum packet size");
+    if (thread_count == 0)
+        thread_count = max(1u, std::thread::hardware_concurrency());
+
+    size_t chunk_count = (mSize + chunk_size - 1) / chunk_size;
+    vector< vector<Packet> > chunks(chunk_count);
+    atomic<size_t> next_chunk(0);
+    auto worker = [&]() {
+        for (size_t i = next_chunk++; i < chunk_count; i = next_chunk++)
+        {
+            size_t begin = i * chunk_size;
+            size_t end   = min(mSize, begin + chunk_size);
+            frameChunk(begin, end, chunks[i]);
+        }
+    };
+
+    vector<thread> threads;
+    for (size_t i = 1; i < min(thread_count, chunk_count); ++i)
+        threads.emplace_back(worker);
+    worker();
+    for (auto& t : threads)
+        t.join();
+
+    merge(chunks);
+}
+
+vector<CaptureReader::Packet> const& CaptureReader::getPackets() const
+{
+    return mPackets;
+}
+
+uint8_t const* CaptureReader::getPacketData(Packet const& packet) const
+{
+    return mData + packet.offset;
+}
+
+uint8_t CaptureReader::getPacketID(Packet const& packet) const
+{
+    return reinterpret_cast<protocol::Header const*>(mData + packet.offset)->packet_id;
+}
+
+uint8_t const* CaptureReader::getData() const
+{
+    return mData;
+}
+
+size_t CaptureReader::getSize() const
+{
+    return mSize;
+}
+
+size_t CaptureReader::getDiscardedBytes() const
+{
+    size_t used = 0;
+    for (auto const& packet : mPackets)
+        used += packet.size;
+    return mSize - used;
+}
@@ -0,0 +1,89 @@
+#ifndef ADVANCED_NAVIGATION_ANPP_CAPTURE_READER_HPP
+#define ADVANCED_NAVIGATION_ANPP_CAPTURE_READER_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace imu_advanced_navigation_anpp
+{
+    /** Offline access to a raw ANPP capture, i.e. a file containing the bytes
+     * as they have been received from the device
+     *
+     * The file is memory-mapped and split into chunks that are framed in
+     * parallel. Each chunk resynchronizes on the first position that
+     * validates both the header LRC and the payload CRC. The per-chunk
+     * results are then merged in file order, re-framing sequentially across
+     * a chunk boundary whenever two chunks do not agree on where packets
+     * start.
+     *
+     * Only the framing is done in parallel. Feeding the packets to a Driver
+     * has to be done sequentially, as the driver's state depends on the packet
+     * order.
+     */
+    class CaptureReader
+    {
+    public:
+        /** Default size of the chunks that are framed in parallel */
+        static constexpr size_t DEFAULT_CHUNK_SIZE = 4 * 1024 * 1024;
+
+        /** Position of a valid packet in the capture */
+        struct Packet
+        {
+            /** Offset of the packet header from the start of the file */
+            size_t offset;
+            /** Packet size, header included */
+            size_t size;
+        };
+
+    private:
+        int mFD = -1;
+        uint8_t const* mData = nullptr;
+        size_t mSize = 0;
+        std::vector<Packet> mPackets;
+
+        void frameChunk(size_t begin, size_t end, std::vector<Packet>& packets) const;
+        void merge(std::vector< std::vector<Packet> > const& chunks);
+
+    public:
+        /** Map the given capture file
+         *
+         * @throw iodrivers_base::UnixError if the file cannot be opened or
+         *   mapped
+         */
+        explicit CaptureReader(std::string const& path);
+        ~CaptureReader();
+
+        CaptureReader(CaptureReader const&) = delete;
+        CaptureReader& operator = (CaptureReader const&) = delete;
+
+        /** Frame the whole capture
+         *
+         * @param thread_count the number of threads to use. Zero means one
+         *   thread per available core.
+         * @param chunk_size the size of the chunks that are framed in
+         *   parallel. It must be bigger than protocol::MAX_PACKET_SIZE
+         */
+        void index(size_t thread_count = 0, size_t chunk_size = DEFAULT_CHUNK_SIZE);
+
+        /** The packets found by index(), in file order */
+        std::vector<Packet> const& getPackets() const;
+
+        /** Pointer to the start of the given packet's header */
+        uint8_t const* getPacketData(Packet const& packet) const;
+
+        /** The packet ID of the given packet */
+        uint8_t getPacketID(Packet const& packet) const;
+
+        /** The raw capture data */
+        uint8_t const* getData() const;
+
+        /** The size of the capture in bytes */
+        size_t getSize() const;
+
+        /** The number of bytes that are not part of any valid packet */
+        size_t getDiscardedBytes() const;
+    };
+}
+
+#endif
@@ -0,0 +1,81 @@
+#include <imu_advanced_navigation_anpp/CaptureStreamReader.hpp>
+#include <imu_advanced_navigation_anpp/Protocol.hpp>
+#include <iodrivers_base/Exceptions.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+
+CaptureStreamReader::CaptureStreamReader(string const& path, size_t buffer_size)
+{
+    if (buffer_size < 2 * static_cast<size_t>(protocol::MAX_PACKET_SIZE))
+        throw std::invalid_argument("buffer size must be at least two times the maximum packet size");
+
+    mFD = ::open(path.c_str(), O_RDONLY);
+    if (mFD == -1)
+        throw iodrivers_base::UnixError("cannot open " + path);
+    posix_fadvise(mFD, 0, 0, POSIX_FADV_SEQUENTIAL);
+    mBuffer.resize(buffer_size);
+}
+
+CaptureStreamReader::~CaptureStreamReader()
+{
+    ::close(mFD);
+}
+
+void CaptureStreamReader::fill()
+{
+    copy(mBuffer.begin() + mStart, mBuffer.begin() + mEnd, mBuffer.begin());
+    mEnd -= mStart;
+    mStart = 0;
+
+    while (!mEOF && mEnd < mBuffer.size())
+    {
+        ssize_t result = ::read(mFD, &mBuffer[mEnd], mBuffer.size() - mEnd);
+        if (result == 0)
+            mEOF = true;
+        else if (result < 0 && errno != EINTR)
+            throw iodrivers_base::UnixError("failed to read capture");
+        else if (result > 0)
+            mEnd += result;
+    }
+}
+
+uint8_t const* CaptureStreamReader::next(size_t& size)
+{
+    while (true)
+    {
+        // Having MAX_PACKET_SIZE bytes in the buffer guarantees that
+        // extractPacket only returns zero at the end of the file
+        if (mEnd - mStart < static_cast<size_t>(protocol::MAX_PACKET_SIZE) && !mEOF)
+            fill();
+
+        int result = protocol::extractPacket(mBuffer.data() + mStart, mEnd - mStart);
+        if (result > 0)
+        {
+            uint8_t const* packet = mBuffer.data() + mStart;
+            size = result;
+            mStart += result;
+            return packet;
+        }
+        else if (result < 0)
+        {
+            mStart += -result;
+            mDiscardedBytes += -result;
+        }
+        else
+        {
+            mDiscardedBytes += mEnd - mStart;
+            mStart = mEnd;
+            return nullptr;
+        }
+    }
+}
+
+size_t CaptureStreamReader::getDiscardedBytes() const
+{
+    return mDiscardedBytes;
+}
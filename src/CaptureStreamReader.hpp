@@ -0,0 +1,60 @@
+#ifndef ADVANCED_NAVIGATION_ANPP_CAPTURE_STREAM_READER_HPP
+#define ADVANCED_NAVIGATION_ANPP_CAPTURE_STREAM_READER_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace imu_advanced_navigation_anpp
+{
+    /** Sequential access to the packets of a raw ANPP capture, with a
+     * fixed-size read buffer
+     *
+     * Unlike CaptureReader, the memory used does not depend on the capture
+     * size, which makes it suitable to process many captures at the same
+     * time.
+     */
+    class CaptureStreamReader
+    {
+    public:
+        static constexpr size_t DEFAULT_BUFFER_SIZE = 64 * 1024;
+
+    private:
+        int mFD = -1;
+        bool mEOF = false;
+        std::vector<uint8_t> mBuffer;
+        size_t mStart = 0;
+        size_t mEnd = 0;
+        size_t mDiscardedBytes = 0;
+
+        void fill();
+
+    public:
+        /** Open the given capture file
+         *
+         * @param buffer_size the read buffer size. It must be at least two
+         *   times protocol::MAX_PACKET_SIZE
+         * @throw iodrivers_base::UnixError if the file cannot be opened
+         */
+        explicit CaptureStreamReader(std::string const& path,
+                                     size_t buffer_size = DEFAULT_BUFFER_SIZE);
+        ~CaptureStreamReader();
+
+        CaptureStreamReader(CaptureStreamReader const&) = delete;
+        CaptureStreamReader& operator = (CaptureStreamReader const&) = delete;
+
+        /** Get the next valid packet
+         *
+         * @param size set to the packet size, header included
+         * @return a pointer to the packet header, valid until the next call
+         *   to next(), or nullptr at the end of the capture
+         */
+        uint8_t const* next(size_t& size);
+
+        /** The number of bytes that have been skipped so far because they
+         * were not part of a valid packet */
+        size_t getDiscardedBytes() const;
+    };
+}
+
+#endif
@@ -0,0 +1,567 @@
+#include <imu_advanced_navigation_anpp/ColumnarExport.hpp>
+#include <imu_advanced_navigation_anpp/Protocol.hpp>
+#include <iodrivers_base/Exceptions.hpp>
+#include <algorithm>
+#include <limits>
+#include <cerrno>
+#include <zlib.h>
+#include <sys/stat.h>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+using namespace imu_advanced_navigation_anpp::columnar;
+using imu_advanced_navigation_anpp::protocol::Header;
+
+size_t columnar::getTypeSize(COLUMN_TYPES type)
+{
+    switch(type)
+    {
+        case COLUMN_UINT8: return 1;
+        case COLUMN_UINT16: return 2;
+        case COLUMN_UINT32: return 4;
+        case COLUMN_INT64: return 8;
+        case COLUMN_FLOAT: return 4;
+        case COLUMN_DOUBLE: return 8;
+        default:
+            throw std::invalid_argument("invalid column type");
+    }
+}
+
+static COLUMN_TYPES columnType(uint8_t) { return COLUMN_UINT8; }
+static COLUMN_TYPES columnType(uint16_t) { return COLUMN_UINT16; }
+static COLUMN_TYPES columnType(uint32_t) { return COLUMN_UINT32; }
+static COLUMN_TYPES columnType(int64_t) { return COLUMN_INT64; }
+static COLUMN_TYPES columnType(float) { return COLUMN_FLOAT; }
+static COLUMN_TYPES columnType(double) { return COLUMN_DOUBLE; }
+
+static void writeValue(uint8_t* out, uint8_t value) { *out = value; }
+static void writeValue(uint8_t* out, uint16_t value) { protocol::write16(out, value); }
+static void writeValue(uint8_t* out, uint32_t value) { protocol::write32(out, value); }
+static void writeValue(uint8_t* out, int64_t value) { protocol::write64(out, value); }
+static void writeValue(uint8_t* out, float value) { protocol::write32(out, value); }
+static void writeValue(uint8_t* out, double value) { protocol::write64(out, value); }
+
+constexpr int BlockHeader::SIZE;
+
+uint8_t* BlockHeader::marshal(uint8_t* out) const
+{
+    protocol::write32(out, row_count);
+    protocol::write32(out + 4, compressed_size);
+    protocol::write64(out + 8, min);
+    protocol::write64(out + 16, max);
+    return out + SIZE;
+}
+
+BlockHeader BlockHeader::unmarshal(uint8_t const* begin, uint8_t const* end)
+{
+    if (end - begin != SIZE)
+        throw std::length_error("BlockHeader::unmarshal: buffer size is not expected size");
+
+    BlockHeader header;
+    header.row_count       = protocol::read32<uint32_t>(begin);
+    header.compressed_size = protocol::read32<uint32_t>(begin + 4);
+    header.min             = protocol::read64<double>(begin + 8);
+    header.max             = protocol::read64<double>(begin + 16);
+    return header;
+}
+
+ColumnWriter::ColumnWriter(string const& path, COLUMN_TYPES type)
+    : mPath(path)
+    , mType(type)
+    , mMin(numeric_limits<double>::infinity())
+    , mMax(-numeric_limits<double>::infinity())
+{
+    mFile = fopen(path.c_str(), "w");
+    if (!mFile)
+        throw iodrivers_base::UnixError("cannot open " + path);
+
+    uint8_t type_code = type;
+    try
+    {
+        write(COLUMN_MAGIC, sizeof(COLUMN_MAGIC));
+        write(&type_code, 1);
+    }
+    catch(...)
+    {
+        fclose(mFile);
+        throw;
+    }
+    mValues.reserve(BLOCK_ROWS * getTypeSize(type));
+}
+
+ColumnWriter::~ColumnWriter()
+{
+    fclose(mFile);
+}
+
+void ColumnWriter::write(void const* data, size_t size)
+{
+    if (fwrite(data, 1, size, mFile) != size)
+        throw iodrivers_base::UnixError("cannot write " + mPath);
+}
+
+COLUMN_TYPES ColumnWriter::getType() const
+{
+    return mType;
+}
+
+template<typename T>
+void ColumnWriter::append(T value)
+{
+    if (columnType(value) != mType)
+        throw std::invalid_argument("value type does not match column type");
+
+    size_t size = mValues.size();
+    mValues.resize(size + sizeof(T));
+    writeValue(&mValues[size], value);
+
+    double as_double = value;
+    mMin = min(mMin, as_double);
+    mMax = max(mMax, as_double);
+    if (++mRowCount == BLOCK_ROWS)
+        flush();
+}
+
+void ColumnWriter::add(uint8_t value) { append(value); }
+void ColumnWriter::add(uint16_t value) { append(value); }
+void ColumnWriter::add(uint32_t value) { append(value); }
+void ColumnWriter::add(int64_t value) { append(value); }
+void ColumnWriter::add(float value) { append(value); }
+void ColumnWriter::add(double value) { append(value); }
+
+void ColumnWriter::flush()
+{
+    if (mRowCount == 0)
+        return;
+
+    uLongf compressed_size = compressBound(mValues.size());
+    mCompressed.resize(compressed_size);
+    int result = compress2(&mCompressed[0], &compressed_size,
+            mValues.data(), mValues.size(), Z_BEST_SPEED);
+    if (result != Z_OK)
+        throw std::runtime_error("failed to compress column block");
+
+    BlockHeader header = { mRowCount, static_cast<uint32_t>(compressed_size), mMin, mMax };
+    uint8_t marshalled[BlockHeader::SIZE];
+    header.marshal(marshalled);
+    write(marshalled, BlockHeader::SIZE);
+    write(mCompressed.data(), compressed_size);
+    // Report the write errors now rather than losing them in fclose
+    if (fflush(mFile) != 0)
+        throw iodrivers_base::UnixError("cannot write " + mPath);
+
+    mValues.clear();
+    mRowCount = 0;
+    mMin = numeric_limits<double>::infinity();
+    mMax = -numeric_limits<double>::infinity();
+}
+
+ColumnReader::ColumnReader(string const& path)
+{
+    mFile = fopen(path.c_str(), "r");
+    if (!mFile)
+        throw iodrivers_base::UnixError("cannot open " + path);
+
+    char magic[sizeof(COLUMN_MAGIC)];
+    uint8_t type_code;
+    if (fread(magic, 1, sizeof(magic), mFile) != sizeof(magic) ||
+        !equal(magic, magic + sizeof(magic), COLUMN_MAGIC) ||
+        fread(&type_code, 1, 1, mFile) != 1)
+    {
+        fclose(mFile);
+        throw std::runtime_error(path + " is not a column file");
+    }
+    mType = static_cast<COLUMN_TYPES>(type_code);
+
+    BlockInfo info;
+    uint8_t marshalled[BlockHeader::SIZE];
+    while (fread(marshalled, BlockHeader::SIZE, 1, mFile) == 1)
+    {
+        info.header = BlockHeader::unmarshal(marshalled, marshalled + BlockHeader::SIZE);
+        info.data_offset = ftell(mFile);
+        mBlocks.push_back(info);
+        fseek(mFile, info.header.compressed_size, SEEK_CUR);
+    }
+}
+
+ColumnReader::~ColumnReader()
+{
+    fclose(mFile);
+}
+
+COLUMN_TYPES ColumnReader::getType() const
+{
+    return mType;
+}
+
+vector<BlockInfo> const& ColumnReader::getBlocks() const
+{
+    return mBlocks;
+}
+
+void ColumnReader::readBlockRaw(size_t index, vector<uint8_t>& values) const
+{
+    BlockInfo const& info = mBlocks.at(index);
+    vector<uint8_t> compressed(info.header.compressed_size);
+    fseek(mFile, info.data_offset, SEEK_SET);
+    if (fread(compressed.data(), 1, compressed.size(), mFile) != compressed.size())
+        throw std::runtime_error("truncated column file");
+
+    uLongf size = info.header.row_count * getTypeSize(mType);
+    values.resize(size);
+    if (uncompress(values.data(), &size, compressed.data(), compressed.size()) != Z_OK)
+        throw std::runtime_error("failed to uncompress column block");
+}
+
+vector<double> ColumnReader::readBlock(size_t index) const
+{
+    vector<uint8_t> raw;
+    readBlockRaw(index, raw);
+
+    size_t row_count = mBlocks[index].header.row_count;
+    vector<double> result(row_count);
+    uint8_t const* it = raw.data();
+    for (size_t i = 0; i < row_count; ++i)
+    {
+        switch(mType)
+        {
+            case COLUMN_UINT8: result[i] = it[i]; break;
+            case COLUMN_UINT16: result[i] = protocol::read16<uint16_t>(it + 2 * i); break;
+            case COLUMN_UINT32: result[i] = protocol::read32<uint32_t>(it + 4 * i); break;
+            case COLUMN_INT64: result[i] = protocol::read64<int64_t>(it + 8 * i); break;
+            case COLUMN_FLOAT: result[i] = protocol::read32<float>(it + 4 * i); break;
+            case COLUMN_DOUBLE: result[i] = protocol::read64<double>(it + 8 * i); break;
+        }
+    }
+    return result;
+}
+
+vector<double> columnar::selectTimeRange(string const& directory,
+        string const& table, string const& field,
+        int64_t start, int64_t end)
+{
+    ColumnReader time(directory + "/" + table + ".device_time.col");
+    ColumnReader values(directory + "/" + table + "." + field + ".col");
+    if (time.getBlocks().size() != values.getBlocks().size())
+        throw std::runtime_error("block count mismatch between the time and value columns");
+
+    vector<double> result;
+    for (size_t i = 0; i < time.getBlocks().size(); ++i)
+    {
+        BlockHeader const& stats = time.getBlocks()[i].header;
+        if (stats.max < start || stats.min > end)
+            continue;
+
+        vector<double> block_time   = time.readBlock(i);
+        vector<double> block_values = values.readBlock(i);
+        for (size_t row = 0; row < block_time.size(); ++row)
+        {
+            if (block_time[row] >= start && block_time[row] <= end)
+                result.push_back(block_values[row]);
+        }
+    }
+    return result;
+}
+
+ColumnarExporter::Table::Table(string const& prefix)
+    : mPrefix(prefix)
+{
+}
+
+void ColumnarExporter::Table::beginRow(int64_t device_time)
+{
+    mCursor = 0;
+    add("device_time", device_time);
+}
+
+template<typename T>
+void ColumnarExporter::Table::add(char const* name, T value)
+{
+    // Columns are created while writing the first row, and are then
+    // addressed by position
+    if (mRowCount == 0)
+    {
+        mColumns.emplace_back(new ColumnWriter(
+            mPrefix + "." + name + ".col", columnType(value)));
+    }
+    mColumns[mCursor++]->add(value);
+}
+
+void ColumnarExporter::Table::endRow()
+{
+    ++mRowCount;
+}
+
+void ColumnarExporter::Table::flush()
+{
+    for (auto& column : mColumns)
+        column->flush();
+}
+
+ColumnarExporter::ColumnarExporter(string const& directory)
+    : mDirectory(directory)
+{
+    if (mkdir(directory.c_str(), 0755) == -1 && errno != EEXIST)
+        throw iodrivers_base::UnixError("cannot create " + directory);
+}
+
+ColumnarExporter::~ColumnarExporter()
+{
+}
+
+ColumnarExporter::Table& ColumnarExporter::getTable(uint8_t packet_id, char const* name)
+{
+    auto& table = mTables[packet_id];
+    if (!table)
+        table.reset(new Table(mDirectory + "/" + name));
+    return *table;
+}
+
+template<typename Packet>
+void ColumnarExporter::dispatch(uint8_t const* packet, uint8_t const* packet_end, char const* name)
+{
+    Packet payload = Packet::unmarshal(packet + Header::SIZE, packet_end);
+    Table& table = getTable(Packet::ID, name);
+    table.beginRow(mDeviceTime);
+    write(table, payload);
+    table.endRow();
+}
+
+void ColumnarExporter::add(uint8_t const* packet, size_t packet_size)
+{
+    Header const& header(reinterpret_cast<Header const&>(*packet));
+    uint8_t const* packet_end = packet + packet_size;
+
+#define EXPORT_DISPATCH_CASE(packet_name) \
+        case protocol::packet_name::ID: \
+            dispatch<protocol::packet_name>(packet, packet_end, #packet_name); \
+            break;
+    try
+    {
+        switch(header.packet_id)
+        {
+            EXPORT_DISPATCH_CASE(Status);
+            EXPORT_DISPATCH_CASE(QuaternionOrientation);
+            EXPORT_DISPATCH_CASE(EulerOrientationStandardDeviation);
+            EXPORT_DISPATCH_CASE(NEDVelocity);
+            EXPORT_DISPATCH_CASE(NEDVelocityStandardDeviation);
+            EXPORT_DISPATCH_CASE(BodyAcceleration);
+            EXPORT_DISPATCH_CASE(BodyVelocity);
+            EXPORT_DISPATCH_CASE(AngularVelocity);
+            EXPORT_DISPATCH_CASE(AngularAcceleration);
+            EXPORT_DISPATCH_CASE(RawSensors);
+            EXPORT_DISPATCH_CASE(RawGNSS);
+            EXPORT_DISPATCH_CASE(Satellites);
+            EXPORT_DISPATCH_CASE(GeodeticPosition);
+            EXPORT_DISPATCH_CASE(GeodeticPositionStandardDeviation);
+            EXPORT_DISPATCH_CASE(NorthSeekingInitializationStatus);
+            case protocol::UnixTime::ID:
+                exportUnixTime(packet, packet_end);
+                break;
+            case protocol::DetailedSatellites::ID:
+                exportDetailedSatellites(packet, packet_end);
+                break;
+            default:
+                ++mIgnoredPackets;
+                return;
+        }
+    }
+    catch(std::length_error const&)
+    {
+        ++mIgnoredPackets;
+        return;
+    }
+#undef EXPORT_DISPATCH_CASE
+    ++mExportedPackets;
+}
+
+void ColumnarExporter::flush()
+{
+    for (auto& table : mTables)
+        table.second->flush();
+}
+
+size_t ColumnarExporter::getExportedPacketCount() const
+{
+    return mExportedPackets;
+}
+
+size_t ColumnarExporter::getIgnoredPacketCount() const
+{
+    return mIgnoredPackets;
+}
+
+void ColumnarExporter::exportUnixTime(uint8_t const* packet, uint8_t const* packet_end)
+{
+    // Update the device time first, so that the UnixTime row is stamped with
+    // its own time
+    auto payload = protocol::UnixTime::unmarshal(packet + Header::SIZE, packet_end);
+    mDeviceTime =
+        static_cast<int64_t>(payload.seconds) * 1000000 +
+        static_cast<int64_t>(payload.microseconds);
+
+    Table& table = getTable(protocol::UnixTime::ID, "UnixTime");
+    table.beginRow(mDeviceTime);
+    table.add("seconds", payload.seconds);
+    table.add("microseconds", payload.microseconds);
+    table.endRow();
+}
+
+void ColumnarExporter::write(Table& table, protocol::Status const& payload)
+{
+    table.add("system_status", payload.system_status);
+    table.add("filter_status", payload.filter_status);
+}
+
+void ColumnarExporter::write(Table& table, protocol::GeodeticPositionStandardDeviation const& payload)
+{
+    table.add("latitude_stddev", payload.lat_lon_z_stddev[0]);
+    table.add("longitude_stddev", payload.lat_lon_z_stddev[1]);
+    table.add("height_stddev", payload.lat_lon_z_stddev[2]);
+}
+
+void ColumnarExporter::write(Table& table, protocol::QuaternionOrientation const& payload)
+{
+    table.add("w", payload.im);
+    table.add("x", payload.xyz[0]);
+    table.add("y", payload.xyz[1]);
+    table.add("z", payload.xyz[2]);
+}
+
+void ColumnarExporter::write(Table& table, protocol::EulerOrientationStandardDeviation const& payload)
+{
+    table.add("roll_stddev", payload.rpy[0]);
+    table.add("pitch_stddev", payload.rpy[1]);
+    table.add("yaw_stddev", payload.rpy[2]);
+}
+
+void ColumnarExporter::write(Table& table, protocol::NEDVelocity const& payload)
+{
+    table.add("north", payload.ned[0]);
+    table.add("east", payload.ned[1]);
+    table.add("down", payload.ned[2]);
+}
+
+void ColumnarExporter::write(Table& table, protocol::NEDVelocityStandardDeviation const& payload)
+{
+    table.add("north_stddev", payload.ned[0]);
+    table.add("east_stddev", payload.ned[1]);
+    table.add("down_stddev", payload.ned[2]);
+}
+
+void ColumnarExporter::write(Table& table, protocol::BodyAcceleration const& payload)
+{
+    table.add("x", payload.xyz[0]);
+    table.add("y", payload.xyz[1]);
+    table.add("z", payload.xyz[2]);
+    table.add("g", payload.g);
+}
+
+void ColumnarExporter::write(Table& table, protocol::BodyVelocity const& payload)
+{
+    table.add("x", payload.xyz[0]);
+    table.add("y", payload.xyz[1]);
+    table.add("z", payload.xyz[2]);
+}
+
+void ColumnarExporter::write(Table& table, protocol::AngularVelocity const& payload)
+{
+    table.add("x", payload.xyz[0]);
+    table.add("y", payload.xyz[1]);
+    table.add("z", payload.xyz[2]);
+}
+
+void ColumnarExporter::write(Table& table, protocol::AngularAcceleration const& payload)
+{
+    table.add("x", payload.xyz[0]);
+    table.add("y", payload.xyz[1]);
+    table.add("z", payload.xyz[2]);
+}
+
+void ColumnarExporter::write(Table& table, protocol::RawSensors const& payload)
+{
+    table.add("accelerometers_x", payload.accelerometers_xyz[0]);
+    table.add("accelerometers_y", payload.accelerometers_xyz[1]);
+    table.add("accelerometers_z", payload.accelerometers_xyz[2]);
+    table.add("gyroscopes_x", payload.gyroscopes_xyz[0]);
+    table.add("gyroscopes_y", payload.gyroscopes_xyz[1]);
+    table.add("gyroscopes_z", payload.gyroscopes_xyz[2]);
+    table.add("magnetometers_x", payload.magnetometers_xyz[0]);
+    table.add("magnetometers_y", payload.magnetometers_xyz[1]);
+    table.add("magnetometers_z", payload.magnetometers_xyz[2]);
+    table.add("imu_temperature_C", payload.imu_temperature_C);
+    table.add("pressure", payload.pressure);
+    table.add("pressure_temperature_C", payload.pressure_temperature_C);
+}
+
+void ColumnarExporter::write(Table& table, protocol::RawGNSS const& payload)
+{
+    table.add("unix_time_seconds", payload.unix_time_seconds);
+    table.add("unix_time_microseconds", payload.unix_time_microseconds);
+    table.add("latitude", payload.lat_lon_z[0]);
+    table.add("longitude", payload.lat_lon_z[1]);
+    table.add("height", payload.lat_lon_z[2]);
+    table.add("velocity_north", payload.velocity_ned[0]);
+    table.add("velocity_east", payload.velocity_ned[1]);
+    table.add("velocity_down", payload.velocity_ned[2]);
+    table.add("latitude_stddev", payload.lat_lon_z_stddev[0]);
+    table.add("longitude_stddev", payload.lat_lon_z_stddev[1]);
+    table.add("height_stddev", payload.lat_lon_z_stddev[2]);
+    table.add("pitch", payload.pitch);
+    table.add("yaw", payload.yaw);
+    table.add("pitch_stddev", payload.pitch_stddev);
+    table.add("yaw_stddev", payload.yaw_stddev);
+    table.add("status", payload.status);
+}
+
+void ColumnarExporter::write(Table& table, protocol::Satellites const& payload)
+{
+    table.add("hdop", payload.hdop);
+    table.add("vdop", payload.vdop);
+    table.add("gps_satellite_count", payload.gps_satellite_count);
+    table.add("glonass_satellite_count", payload.glonass_satellite_count);
+    table.add("beidou_satellite_count", payload.beidou_satellite_count);
+    table.add("galileo_satellite_count", payload.galileo_satellite_count);
+    table.add("sbas_satellite_count", payload.sbas_satellite_count);
+}
+
+void ColumnarExporter::write(Table& table, protocol::GeodeticPosition const& payload)
+{
+    table.add("latitude", payload.lat_lon_z[0]);
+    table.add("longitude", payload.lat_lon_z[1]);
+    table.add("height", payload.lat_lon_z[2]);
+}
+
+void ColumnarExporter::write(Table& table, protocol::NorthSeekingInitializationStatus const& payload)
+{
+    table.add("flags", payload.flags);
+    for (int i = 0; i < 4; ++i)
+    {
+        static char const* names[] = { "progress_0", "progress_1", "progress_2", "progress_3" };
+        table.add(names[i], payload.progress[i]);
+    }
+    table.add("current_rotation_angle", payload.current_rotation_angle);
+    table.add("gyroscope_bias_x", payload.gyroscope_bias_solution_xyz[0]);
+    table.add("gyroscope_bias_y", payload.gyroscope_bias_solution_xyz[1]);
+    table.add("gyroscope_bias_z", payload.gyroscope_bias_solution_xyz[2]);
+    table.add("gyroscope_bias_solution_error", payload.gyroscope_bias_solution_error);
+}
+
+void ColumnarExporter::exportDetailedSatellites(uint8_t const* packet, uint8_t const* packet_end)
+{
+    std::vector<protocol::SatelliteInfo> satellite_info;
+    protocol::DetailedSatellites::unmarshal(packet + Header::SIZE, packet_end, satellite_info);
+
+    Table& table = getTable(protocol::DetailedSatellites::ID, "DetailedSatellites");
+    for (auto const& satellite : satellite_info)
+    {
+        table.beginRow(mDeviceTime);
+        table.add("system", satellite.system);
+        table.add("prn", satellite.prn);
+        table.add("frequencies", satellite.frequencies);
+        table.add("elevation", satellite.elevation);
+        table.add("azimuth", satellite.azimuth);
+        table.add("snr", satellite.snr);
+        table.endRow();
+    }
+}
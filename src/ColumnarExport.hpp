@@ -0,0 +1,260 @@
+#ifndef ADVANCED_NAVIGATION_ANPP_COLUMNAR_EXPORT_HPP
+#define ADVANCED_NAVIGATION_ANPP_COLUMNAR_EXPORT_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <cstdint>
+#include <cstdio>
+
+namespace imu_advanced_navigation_anpp
+{
+    /** Export of ANPP packets into a columnar on-disk format
+     *
+     * The export is a directory with one file per packet field, named
+     * TABLE.FIELD.col where TABLE is the packet name (e.g. RawSensors) and
+     * FIELD the field name (e.g. gyroscopes_z). All tables have a
+     * device_time column, in microseconds, which is the time of the last
+     * UnixTime packet that preceded the row (zero if none has been seen yet).
+     * DetailedSatellites has one row per satellite.
+     *
+     * Each column file starts with COLUMN_MAGIC and the value type (one of
+     * COLUMN_TYPES), followed by blocks of at most BLOCK_ROWS values. A block
+     * is a BlockHeader (BlockHeader::SIZE bytes, little-endian) followed by
+     * the zlib-compressed little-endian values.
+     * All the columns of a table have the same block boundaries, so that the
+     * block statistics of one column (e.g. device_time) can be used to select
+     * the blocks to read in the others.
+     */
+    namespace columnar
+    {
+        static const char COLUMN_MAGIC[8] = { 'A', 'N', 'P', 'P', 'C', 'O', 'L', '1' };
+        static constexpr uint32_t BLOCK_ROWS = 65536;
+
+        enum COLUMN_TYPES
+        {
+            COLUMN_UINT8  = 0,
+            COLUMN_UINT16 = 1,
+            COLUMN_UINT32 = 2,
+            COLUMN_INT64  = 3,
+            COLUMN_FLOAT  = 4,
+            COLUMN_DOUBLE = 5
+        };
+
+        /** Size in bytes of a value of the given type */
+        size_t getTypeSize(COLUMN_TYPES type);
+
+        struct BlockHeader
+        {
+            static constexpr int SIZE = 24;
+
+            uint32_t row_count;
+            uint32_t compressed_size;
+            double min;
+            double max;
+
+            /** Write the header in its on-disk layout, SIZE bytes */
+            uint8_t* marshal(uint8_t* out) const;
+
+            /** Read a header written by marshal() */
+            static BlockHeader unmarshal(uint8_t const* begin, uint8_t const* end);
+        };
+
+        /** Block statistics, as stored in the column files */
+        struct BlockInfo
+        {
+            BlockHeader header;
+            /** Offset of the compressed data in the column file */
+            uint64_t data_offset;
+        };
+
+        /** Write side of a single column
+         *
+         * The values are written by blocks. flush() must be called once all
+         * values have been added, as the destructor only closes the file
+         * and drops the pending values.
+         */
+        class ColumnWriter
+        {
+            std::string mPath;
+            FILE* mFile;
+            COLUMN_TYPES mType;
+            std::vector<uint8_t> mValues;
+            std::vector<uint8_t> mCompressed;
+            uint32_t mRowCount = 0;
+            double mMin;
+            double mMax;
+
+            template<typename T>
+            void append(T value);
+            void write(void const* data, size_t size);
+
+        public:
+            /**
+             * @throw iodrivers_base::UnixError if the file cannot be created
+             */
+            ColumnWriter(std::string const& path, COLUMN_TYPES type);
+            ~ColumnWriter();
+
+            COLUMN_TYPES getType() const;
+
+            void add(uint8_t value);
+            void add(uint16_t value);
+            void add(uint32_t value);
+            void add(int64_t value);
+            void add(float value);
+            void add(double value);
+
+            /** Compress and write the pending values as a block
+             *
+             * @throw iodrivers_base::UnixError if the block could not be
+             *   written
+             */
+            void flush();
+        };
+
+        /** Read side of a single column
+         *
+         * Only the block headers are read on construction. Block data is
+         * read and uncompressed on demand.
+         */
+        class ColumnReader
+        {
+            FILE* mFile;
+            COLUMN_TYPES mType;
+            std::vector<BlockInfo> mBlocks;
+
+            void readBlockRaw(size_t index, std::vector<uint8_t>& values) const;
+
+        public:
+            explicit ColumnReader(std::string const& path);
+            ~ColumnReader();
+
+            COLUMN_TYPES getType() const;
+            std::vector<BlockInfo> const& getBlocks() const;
+
+            /** Read a block, converting the values to double */
+            std::vector<double> readBlock(size_t index) const;
+        };
+
+        /** Read the values of a column for the rows whose device_time is
+         * within [start, end]
+         *
+         * Only the blocks whose device_time statistics intersect the range
+         * are read
+         *
+         * @param directory the export directory
+         * @param table the table name (e.g. RawSensors)
+         * @param field the field name (e.g. gyroscopes_z)
+         */
+        std::vector<double> selectTimeRange(std::string const& directory,
+                                            std::string const& table,
+                                            std::string const& field,
+                                            int64_t start, int64_t end);
+    }
+
+    namespace protocol
+    {
+        struct UnixTime;
+        struct Status;
+        struct GeodeticPositionStandardDeviation;
+        struct GeodeticPosition;
+        struct QuaternionOrientation;
+        struct EulerOrientationStandardDeviation;
+        struct NEDVelocity;
+        struct NEDVelocityStandardDeviation;
+        struct BodyAcceleration;
+        struct BodyVelocity;
+        struct AngularVelocity;
+        struct AngularAcceleration;
+        struct RawSensors;
+        struct RawGNSS;
+        struct Satellites;
+        struct NorthSeekingInitializationStatus;
+    }
+
+    /** Converts a stream of ANPP packets into a columnar export
+     *
+     * It handles all the packets that are supported by Driver::poll(). The
+     * export is complete only once flush() has been called.
+     */
+    class ColumnarExporter
+    {
+        class Table
+        {
+            std::string mPrefix;
+            std::vector< std::unique_ptr<columnar::ColumnWriter> > mColumns;
+            size_t mCursor = 0;
+            size_t mRowCount = 0;
+
+        public:
+            explicit Table(std::string const& prefix);
+
+            void beginRow(int64_t device_time);
+            template<typename T>
+            void add(char const* name, T value);
+            void endRow();
+            void flush();
+        };
+
+        std::string mDirectory;
+        std::map<uint8_t, std::unique_ptr<Table>> mTables;
+        int64_t mDeviceTime = 0;
+        size_t mExportedPackets = 0;
+        size_t mIgnoredPackets = 0;
+
+        Table& getTable(uint8_t packet_id, char const* name);
+
+        template<typename Packet>
+        void dispatch(uint8_t const* packet, uint8_t const* packet_end, char const* name);
+        void exportUnixTime(uint8_t const* packet, uint8_t const* packet_end);
+        void exportDetailedSatellites(uint8_t const* packet, uint8_t const* packet_end);
+
+        void write(Table& table, protocol::Status const& payload);
+        void write(Table& table, protocol::GeodeticPositionStandardDeviation const& payload);
+        void write(Table& table, protocol::QuaternionOrientation const& payload);
+        void write(Table& table, protocol::EulerOrientationStandardDeviation const& payload);
+        void write(Table& table, protocol::NEDVelocity const& payload);
+        void write(Table& table, protocol::NEDVelocityStandardDeviation const& payload);
+        void write(Table& table, protocol::BodyAcceleration const& payload);
+        void write(Table& table, protocol::BodyVelocity const& payload);
+        void write(Table& table, protocol::AngularVelocity const& payload);
+        void write(Table& table, protocol::AngularAcceleration const& payload);
+        void write(Table& table, protocol::RawSensors const& payload);
+        void write(Table& table, protocol::RawGNSS const& payload);
+        void write(Table& table, protocol::Satellites const& payload);
+        void write(Table& table, protocol::GeodeticPosition const& payload);
+        void write(Table& table, protocol::NorthSeekingInitializationStatus const& payload);
+
+    public:
+        /** Create an exporter that writes in the given directory
+         *
+         * The directory is created if it does not exist
+         */
+        explicit ColumnarExporter(std::string const& directory);
+        ~ColumnarExporter();
+
+        /** Export a single packet, header included
+         *
+         * Packets that are not supported by Driver::poll() and packets whose
+         * payload cannot be unmarshalled are ignored
+         */
+        void add(uint8_t const* packet, size_t packet_size);
+
+        /** Write all pending blocks
+         *
+         * @throw iodrivers_base::UnixError if the blocks could not be
+         *   written
+         */
+        void flush();
+
+        /** Number of packets that have been exported */
+        size_t getExportedPacketCount() const;
+
+        /** Number of packets that have been ignored */
+        size_t getIgnoredPacketCount() const;
+    };
+}
+
+#endif
@@ -0,0 +1,461 @@
+#include <imu_advanced_navigation_anpp/DeviceSimulator.hpp>
+#include <imu_advanced_navigation_anpp/Protocol.hpp>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+using protocol::Header;
+using protocol::appendPacket;
+
+template<typename Packet>
+static vector<uint8_t> marshalPayload(Packet const& packet)
+{
+    vector<uint8_t> payload(Packet::SIZE);
+    packet.marshal(payload.begin());
+    return payload;
+}
+
+static uint8_t checkVerificationSequence(uint8_t const* expected,
+                                         uint8_t const* payload, size_t payload_size)
+{
+    if (payload_size != 4)
+        return ACK_FAILED_PACKET_VALIDATION_SIZE;
+    else if (!equal(expected, expected + 4, payload))
+        return ACK_FAILED_OUT_OF_RANGE;
+    return ACK_SUCCESS;
+}
+
+DeviceSimulator::DeviceSimulator()
+    : DeviceSimulator(Options())
+{
+}
+
+DeviceSimulator::DeviceSimulator(Options const& options)
+    : mOptions(options)
+    , mRandom(options.seed)
+    , mTelemetry(options.seed)
+{
+    mTelemetry.setNoise(options.noise);
+    mDeviceInformation.software_version = 1000;
+    mDeviceInformation.device_id = 0;
+    mDeviceInformation.hardware_revision = 0;
+    mDeviceInformation.serial_number_part0 = 0;
+    mDeviceInformation.serial_number_part1 = 0;
+    mDeviceInformation.serial_number_part2 = 1;
+    restoreFactorySettings();
+    reset();
+}
+
+bool DeviceSimulator::isTelemetryPacket(uint8_t packet_id)
+{
+    return SimulatedTelemetry::isSupported(packet_id);
+}
+
+void DeviceSimulator::restoreFactorySettings()
+{
+    mPermanentSettings.clear();
+    mPermanentSettings[protocol::PacketTimerPeriod::ID] =
+        marshalPayload(protocol::PacketTimerPeriod { 0, 1, 1000 });
+    mPermanentSettings[protocol::BaudRates::ID] =
+        marshalPayload(protocol::BaudRates { 0, mOptions.baudrate, 115200, 115200, 0 });
+
+    protocol::Alignment alignment;
+    alignment.permanent = 0;
+    for (int i = 0; i < 9; ++i)
+        alignment.dcm[i] = (i % 4 == 0) ? 1 : 0;
+    for (int i = 0; i < 3; ++i)
+    {
+        alignment.gnss_antenna_offset_xyz[i] = 0;
+        alignment.odometer_offset_xyz[i] = 0;
+        alignment.external_data_offset_xyz[i] = 0;
+    }
+    mPermanentSettings[protocol::Alignment::ID] = marshalPayload(alignment);
+
+    protocol::FilterOptions filter_options;
+    filter_options.permanent = 0;
+    filter_options.vehicle_type = VEHICLE_CAR;
+    filter_options.enabled_internal_gnss = 1;
+    filter_options.enabled_atmospheric_altitude = 1;
+    filter_options.enabled_velocity_heading = 0;
+    filter_options.enabled_reversing_detection = 0;
+    filter_options.enabled_motion_analysis = 0;
+    mPermanentSettings[protocol::FilterOptions::ID] = marshalPayload(filter_options);
+
+    protocol::MagneticCalibrationValues magnetic_calibration;
+    magnetic_calibration.permanent = 0;
+    for (int i = 0; i < 3; ++i)
+        magnetic_calibration.hard_iron_bias_xyz[i] = 0;
+    for (int i = 0; i < 9; ++i)
+        magnetic_calibration.soft_iron_transformation[i] = (i % 4 == 0) ? 1 : 0;
+    mPermanentSettings[protocol::MagneticCalibrationValues::ID] = marshalPayload(magnetic_calibration);
+
+    // The device streams the system state at 50Hz out of the box
+    mPermanentPeriods.clear();
+    mPermanentPeriods[protocol::SystemState::ID] = 20;
+}
+
+void DeviceSimulator::reset()
+{
+    mSettings = mPermanentSettings;
+    mPeriods = mPermanentPeriods;
+    mTick = 0;
+    mNextTick = base::Time();
+    mOutputOverflow = false;
+}
+
+void DeviceSimulator::receive(uint8_t const* data, size_t size)
+{
+    mInput.insert(mInput.end(), data, data + size);
+
+    size_t start = 0;
+    while (start < mInput.size())
+    {
+        int result = protocol::extractPacket(&mInput[start], mInput.size() - start);
+        if (result == 0)
+            break;
+        else if (result < 0)
+        {
+            mStatistics.rejected_bytes += -result;
+            start += -result;
+        }
+        else
+        {
+            handlePacket(&mInput[start], result);
+            start += result;
+        }
+    }
+    mInput.erase(mInput.begin(), mInput.begin() + start);
+}
+
+void DeviceSimulator::handlePacket(uint8_t const* packet, size_t packet_size)
+{
+    Header const& header = reinterpret_cast<Header const&>(*packet);
+    uint8_t const* payload = packet + Header::SIZE;
+    size_t payload_size = packet_size - Header::SIZE;
+    mStatistics.received_packets++;
+
+    switch (header.packet_id)
+    {
+        case protocol::Request::ID:
+            for (size_t i = 0; i < payload_size; ++i)
+                respond(payload[i]);
+            break;
+        case protocol::BootMode::ID:
+            acknowledge(packet, payload_size == protocol::BootMode::SIZE ?
+                ACK_SUCCESS : ACK_FAILED_PACKET_VALIDATION_SIZE);
+            break;
+        case protocol::RestoreFactorySettings::ID:
+        {
+            uint8_t result = checkVerificationSequence(
+                protocol::RestoreFactorySettings().verification_sequence, payload, payload_size);
+            acknowledge(packet, result);
+            if (result == ACK_SUCCESS)
+                restoreFactorySettings();
+            break;
+        }
+        case protocol::HotStartReset::ID:
+        {
+            uint8_t result = checkVerificationSequence(
+                protocol::HotStartReset().verification_sequence, payload, payload_size);
+            if (result != ACK_SUCCESS)
+            {
+                result = checkVerificationSequence(
+                    protocol::ColdStartReset().verification_sequence, payload, payload_size);
+            }
+            acknowledge(packet, result);
+            if (result == ACK_SUCCESS)
+            {
+                reset();
+                mStatistics.resets++;
+            }
+            break;
+        }
+        case protocol::PacketPeriods::ID:
+            acknowledge(packet, handlePacketPeriods(payload, payload_size));
+            break;
+        case protocol::PacketTimerPeriod::ID:
+        case protocol::BaudRates::ID:
+        case protocol::Alignment::ID:
+        case protocol::FilterOptions::ID:
+        case protocol::MagneticCalibrationValues::ID:
+            acknowledge(packet, handleSetting(header.packet_id, payload, payload_size));
+            break;
+        case protocol::MagneticCalibrationConfiguration::ID:
+            acknowledge(packet, payload_size == protocol::MagneticCalibrationConfiguration::SIZE ?
+                ACK_SUCCESS : ACK_FAILED_PACKET_VALIDATION_SIZE);
+            break;
+        default:
+            acknowledge(packet, ACK_FAILED_UNKNOWN_PACKET);
+    }
+}
+
+uint8_t DeviceSimulator::handleSetting(uint8_t packet_id, uint8_t const* payload, size_t payload_size)
+{
+    if (payload_size != mPermanentSettings[packet_id].size())
+        return ACK_FAILED_PACKET_VALIDATION_SIZE;
+
+    if (packet_id == protocol::PacketTimerPeriod::ID)
+    {
+        auto timer = protocol::PacketTimerPeriod::unmarshal(payload, payload + payload_size);
+        if (timer.period == 0)
+            return ACK_FAILED_OUT_OF_RANGE;
+    }
+    else if (packet_id == protocol::BaudRates::ID)
+    {
+        auto rates = protocol::BaudRates::unmarshal(payload, payload + payload_size);
+        if (rates.primary_port == 0)
+            return ACK_FAILED_OUT_OF_RANGE;
+    }
+
+    // All the settings packets start with the 'permanent' flag, which is
+    // not part of the setting itself
+    vector<uint8_t> value(payload, payload + payload_size);
+    bool permanent = value[0] != 0;
+    value[0] = 0;
+    mSettings[packet_id] = value;
+    if (permanent)
+        mPermanentSettings[packet_id] = value;
+    return ACK_SUCCESS;
+}
+
+static void applyPacketPeriods(map<uint8_t, uint32_t>& target,
+                               map<uint8_t, uint32_t> const& periods, bool clear_existing)
+{
+    if (clear_existing)
+        target.clear();
+    for (auto const& period : periods)
+    {
+        if (period.second == 0)
+            target.erase(period.first);
+        else
+            target[period.first] = period.second;
+    }
+}
+
+uint8_t DeviceSimulator::handlePacketPeriods(uint8_t const* payload, size_t payload_size)
+{
+    if (payload_size < static_cast<size_t>(protocol::PacketPeriods::MIN_SIZE) ||
+        (payload_size - protocol::PacketPeriods::MIN_SIZE) % protocol::PacketPeriods::PERIOD_SIZE != 0)
+        return ACK_FAILED_PACKET_VALIDATION_SIZE;
+
+    auto periods = protocol::PacketPeriods::unmarshal(payload, payload + payload_size);
+    for (auto const& period : periods)
+    {
+        if (!isTelemetryPacket(period.first))
+            return ACK_FAILED_OUT_OF_RANGE;
+    }
+
+    bool permanent = payload[0] != 0;
+    bool clear_existing = payload[1] != 0;
+    applyPacketPeriods(mPeriods, periods, clear_existing);
+    if (permanent)
+        applyPacketPeriods(mPermanentPeriods, periods, clear_existing);
+    return ACK_SUCCESS;
+}
+
+void DeviceSimulator::acknowledge(uint8_t const* packet, uint8_t result)
+{
+    Header const& header = reinterpret_cast<Header const&>(*packet);
+    protocol::Acknowledge ack { header.packet_id,
+        header.payload_checksum_lsb, header.payload_checksum_msb, result };
+    mTrain.clear();
+    appendPacket(mTrain, ack);
+    send(mTrain);
+}
+
+void DeviceSimulator::respond(uint8_t packet_id)
+{
+    mTrain.clear();
+    if (packet_id == protocol::DeviceInformation::ID)
+    {
+        protocol::DeviceInformation info;
+        static_cast<DeviceInformation&>(info) = mDeviceInformation;
+        appendPacket(mTrain, info);
+    }
+    else if (packet_id == protocol::PacketPeriods::ID)
+    {
+        uint8_t payload[protocol::MAX_PACKET_SIZE];
+        uint8_t* payload_end = protocol::PacketPeriods { 0, 0 }.marshal(
+            payload, mPeriods.begin(), mPeriods.end());
+        appendPacket(mTrain, packet_id, payload, payload_end);
+    }
+    else if (packet_id == protocol::MagneticCalibrationStatus::ID)
+        appendPacket(mTrain, protocol::MagneticCalibrationStatus { 0, 0, 0 });
+    else if (mSettings.count(packet_id))
+    {
+        vector<uint8_t> const& payload = mSettings[packet_id];
+        appendPacket(mTrain, packet_id, payload.data(), payload.data() + payload.size());
+    }
+    else if (isTelemetryPacket(packet_id))
+    {
+        mTelemetry.update(mTime.isNull() ? base::Time::now() : mTime);
+        marshalTelemetry(packet_id, mTrain);
+        if (packet_id == protocol::Status::ID)
+            mOutputOverflow = false;
+    }
+    send(mTrain);
+}
+
+void DeviceSimulator::update(base::Time const& time)
+{
+    mTime = time;
+    if (mNextTick.isNull())
+        mNextTick = time;
+
+    if (mOptions.saturate)
+    {
+        // Bound the number of ticks in case the configured trains are too
+        // sparse or too big to ever fill the buffer
+        for (int i = 0; i < 65536 && !mPeriods.empty(); ++i)
+        {
+            if (getOutputSize() >= mOptions.output_buffer_size / 2)
+                break;
+            tick();
+        }
+        return;
+    }
+
+    // After a stall, skip the missed trains instead of sending them in a
+    // burst
+    if (time - mNextTick > base::Time::fromSeconds(1))
+        mNextTick = time;
+    while (mNextTick <= time)
+        tick();
+}
+
+void DeviceSimulator::tick()
+{
+    mTelemetry.update(mNextTick);
+
+    // std::map is sorted by packet ID, which is the order in which the
+    // device sends the packets of a train
+    mTrain.clear();
+    int packet_count = 0;
+    bool has_status = false;
+    for (auto const& period : mPeriods)
+    {
+        if (mTick % period.second != 0)
+            continue;
+        if (marshalTelemetry(period.first, mTrain))
+        {
+            packet_count++;
+            has_status = has_status || (period.first == protocol::Status::ID);
+        }
+    }
+
+    if (getOutputSize() + mTrain.size() > mOptions.output_buffer_size)
+    {
+        mStatistics.dropped_packets += packet_count;
+        mOutputOverflow = true;
+    }
+    else
+    {
+        send(mTrain);
+        if (has_status)
+            mOutputOverflow = false;
+    }
+
+    mTick++;
+    mNextTick = mNextTick + getPacketTimerPeriod();
+}
+
+bool DeviceSimulator::marshalTelemetry(uint8_t packet_id, vector<uint8_t>& out)
+{
+    mTelemetry.setSystemStatus(mOutputOverflow ? SYSTEM_DATA_OUTPUT_OVERFLOW_ALARM : 0);
+    return mTelemetry.append(packet_id, out);
+}
+
+void DeviceSimulator::send(vector<uint8_t> const& packets)
+{
+    size_t start = mOutput.size();
+    mOutput.insert(mOutput.end(), packets.begin(), packets.end());
+
+    uniform_real_distribution<double> uniform(0, 1);
+    while (start < mOutput.size())
+    {
+        size_t length = reinterpret_cast<Header const&>(mOutput[start]).getPacketLength();
+        mStatistics.sent_packets++;
+        if (mOptions.corruption_rate > 0 && uniform(mRandom) < mOptions.corruption_rate)
+        {
+            uniform_int_distribution<size_t> bit(0, length * 8 - 1);
+            size_t corrupted_bit = bit(mRandom);
+            mOutput[start + corrupted_bit / 8] ^= 1 << (corrupted_bit % 8);
+            mStatistics.corrupted_packets++;
+        }
+        start += length;
+    }
+}
+
+size_t DeviceSimulator::readOutput(uint8_t* buffer, size_t buffer_size, base::Time const& time)
+{
+    size_t available = getOutputSize();
+    uint32_t baudrate = getBaudrate();
+    if (baudrate != 0)
+    {
+        // Allow bursts of up to 10ms worth of data, so that the pacing does
+        // not depend too much on how often this is called
+        double max_credit = max<double>(protocol::MAX_PACKET_SIZE, baudrate / 10 * 0.01);
+        if (mLastOutputTime.isNull())
+            mOutputCredit = max_credit;
+        else
+            mOutputCredit += (time - mLastOutputTime).toSeconds() * baudrate / 10;
+        mOutputCredit = min(mOutputCredit, max_credit);
+        mLastOutputTime = time;
+        available = min<size_t>(available, mOutputCredit);
+    }
+
+    size_t count = min(available, buffer_size);
+    copy_n(mOutput.begin() + mOutputStart, count, buffer);
+    mOutputStart += count;
+    mOutputCredit -= count;
+    mStatistics.sent_bytes += count;
+
+    if (mOutputStart == mOutput.size())
+    {
+        mOutput.clear();
+        mOutputStart = 0;
+    }
+    else if (mOutputStart > mOutput.size() / 2)
+    {
+        mOutput.erase(mOutput.begin(), mOutput.begin() + mOutputStart);
+        mOutputStart = 0;
+    }
+    return count;
+}
+
+size_t DeviceSimulator::getOutputSize() const
+{
+    return mOutput.size() - mOutputStart;
+}
+
+base::Time DeviceSimulator::getNextTick() const
+{
+    return mNextTick;
+}
+
+uint32_t DeviceSimulator::getBaudrate() const
+{
+    auto const& payload = mSettings.at(protocol::BaudRates::ID);
+    return protocol::BaudRates::unmarshal(payload.begin(), payload.end()).primary_port;
+}
+
+base::Time DeviceSimulator::getPacketTimerPeriod() const
+{
+    auto const& payload = mSettings.at(protocol::PacketTimerPeriod::ID);
+    return base::Time::fromMicroseconds(
+        protocol::PacketTimerPeriod::unmarshal(payload.begin(), payload.end()).period);
+}
+
+map<uint8_t, uint32_t> const& DeviceSimulator::getPacketPeriods() const
+{
+    return mPeriods;
+}
+
+DeviceInformation const& DeviceSimulator::getDeviceInformation() const
+{
+    return mDeviceInformation;
+}
+
+DeviceSimulator::Statistics const& DeviceSimulator::getStatistics() const
+{
+    return mStatistics;
+}
@@ -0,0 +1,164 @@
+#ifndef ADVANCED_NAVIGATION_ANPP_DEVICE_SIMULATOR_HPP
+#define ADVANCED_NAVIGATION_ANPP_DEVICE_SIMULATOR_HPP
+
+#include <map>
+#include <random>
+#include <vector>
+#include <base/Time.hpp>
+#include <imu_advanced_navigation_anpp/DeviceInformation.hpp>
+#include <imu_advanced_navigation_anpp/SimulatedTelemetry.hpp>
+
+namespace imu_advanced_navigation_anpp
+{
+    /** Device side of the ANPP protocol, to test the driver without hardware
+     *
+     * The simulator answers Request packets, acknowledges the configuration
+     * packets (packet timer period, packet periods, baud rates, alignment,
+     * filter options, magnetic calibration), handles resets and emits the
+     * periodic packet trains at the configured rates. Settings that are
+     * written as permanent survive a reset, the others do not.
+     *
+     * It is not tied to any I/O channel: the bytes received from the host
+     * are given to receive(), time is advanced with update() and the bytes
+     * that the device sends are read with readOutput(). The
+     * imu_advanced_navigation_anpp_simulator executable serves it on a
+     * pseudo-terminal.
+     *
+     * The output is paced by the simulated baud rate. As on the device, a
+     * packet train that does not fit in the output buffer is dropped
+     * entirely, and SYSTEM_DATA_OUTPUT_OVERFLOW_ALARM is set in the next
+     * Status packet.
+     *
+     * The periodic packets are generated by SimulatedTelemetry.
+     */
+    class DeviceSimulator
+    {
+    public:
+        struct Options
+        {
+            /** Baud rate of the simulated line, zero for no limit
+             *
+             * This is the initial primary port rate. It is changed by a
+             * BaudRates packet
+             */
+            uint32_t baudrate = 115200;
+            /** Size of the device's output buffer, in bytes */
+            size_t output_buffer_size = 4096;
+            /** Scale of the noise added to the signals
+             *
+             * 1 is roughly the noise level of the device's own sensors, 0
+             * disables the noise
+             */
+            double noise = 0;
+            /** Probability for each emitted packet to get one bit flipped */
+            double corruption_rate = 0;
+            /** Drive the packet timer by the output line instead of the clock
+             *
+             * A new packet train is generated whenever the output buffer is
+             * half empty, which keeps the line saturated regardless of the
+             * baud rate. The device time still advances by one packet timer
+             * period per train, and therefore runs faster than the clock
+             */
+            bool saturate = false;
+            /** Seed of the noise and corruption generator */
+            uint32_t seed = 0;
+        };
+
+        struct Statistics
+        {
+            /** Valid packets received from the host */
+            uint64_t received_packets = 0;
+            /** Received bytes that were not part of a valid packet */
+            uint64_t rejected_bytes = 0;
+            /** Packets queued for output, corrupted ones included */
+            uint64_t sent_packets = 0;
+            /** Bytes returned by readOutput() */
+            uint64_t sent_bytes = 0;
+            /** Periodic packets dropped because the output buffer was full */
+            uint64_t dropped_packets = 0;
+            uint64_t corrupted_packets = 0;
+            uint64_t resets = 0;
+        };
+
+    private:
+        Options mOptions;
+        Statistics mStatistics;
+        DeviceInformation mDeviceInformation;
+        std::mt19937 mRandom;
+        SimulatedTelemetry mTelemetry;
+
+        /** Current and permanent settings, as payloads of the corresponding
+         * packets, indexed by packet ID
+         */
+        std::map<uint8_t, std::vector<uint8_t>> mSettings;
+        std::map<uint8_t, std::vector<uint8_t>> mPermanentSettings;
+        std::map<uint8_t, uint32_t> mPeriods;
+        std::map<uint8_t, uint32_t> mPermanentPeriods;
+
+        /** Time of the last call to update() */
+        base::Time mTime;
+        base::Time mNextTick;
+        uint64_t mTick = 0;
+        bool mOutputOverflow = false;
+
+        std::vector<uint8_t> mInput;
+        std::vector<uint8_t> mOutput;
+        size_t mOutputStart = 0;
+        std::vector<uint8_t> mTrain;
+        base::Time mLastOutputTime;
+        double mOutputCredit = 0;
+
+        void restoreFactorySettings();
+        void reset();
+        void handlePacket(uint8_t const* packet, size_t packet_size);
+        uint8_t handleSetting(uint8_t packet_id, uint8_t const* payload, size_t payload_size);
+        uint8_t handlePacketPeriods(uint8_t const* payload, size_t payload_size);
+        void acknowledge(uint8_t const* packet, uint8_t result);
+        void respond(uint8_t packet_id);
+        void send(std::vector<uint8_t> const& packets);
+
+        void tick();
+        bool marshalTelemetry(uint8_t packet_id, std::vector<uint8_t>& out);
+
+    public:
+        DeviceSimulator();
+        explicit DeviceSimulator(Options const& options);
+
+        /** Whether the simulator can generate the given packet periodically */
+        static bool isTelemetryPacket(uint8_t packet_id);
+
+        /** Process bytes received from the host
+         *
+         * The answers are queued for output
+         */
+        void receive(uint8_t const* data, size_t size);
+
+        /** Generate the packet trains that are due at the given time */
+        void update(base::Time const& time);
+
+        /** Get the bytes sent by the device up to the given time
+         *
+         * @return the number of bytes copied into buffer
+         */
+        size_t readOutput(uint8_t* buffer, size_t buffer_size, base::Time const& time);
+
+        /** Bytes queued for output */
+        size_t getOutputSize() const;
+
+        /** Time at which the next packet train is due */
+        base::Time getNextTick() const;
+
+        /** Current primary port baud rate, zero if the output is not limited */
+        uint32_t getBaudrate() const;
+
+        base::Time getPacketTimerPeriod() const;
+
+        std::map<uint8_t, uint32_t> const& getPacketPeriods() const;
+
+        DeviceInformation const& getDeviceInformation() const;
+
+        Statistics const& getStatistics() const;
+    };
+}
+
+#endif
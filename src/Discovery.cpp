@@ -0,0 +1,75 @@
+#include <imu_advanced_navigation_anpp/Discovery.hpp>
+#include <imu_advanced_navigation_anpp/Driver.hpp>
+#include <glob.h>
+#include <thread>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+using namespace imu_advanced_navigation_anpp::discovery;
+
+vector<string> discovery::listCandidatePorts()
+{
+    vector<string> result;
+    for (char const* pattern : { "/dev/ttyUSB*", "/dev/ttyACM*", "/dev/ttyS*" })
+    {
+        glob_t matches;
+        if (glob(pattern, 0, NULL, &matches) == 0)
+            result.insert(result.end(), matches.gl_pathv, matches.gl_pathv + matches.gl_pathc);
+        globfree(&matches);
+    }
+    return result;
+}
+
+static bool probe(string const& port, DiscoveredDevice& device)
+{
+    string uri = "serial://" + port;
+    try
+    {
+        Driver driver;
+        device.port = port;
+        device.baudrate = driver.detectBaudrate(uri);
+        if (!device.baudrate)
+            return false;
+
+        // Driver::openURI would change the device's packet periods
+        driver.iodrivers_base::Driver::openURI(uri + ":" + to_string(device.baudrate));
+        try
+        {
+            device.device_information = driver.readDeviceInformation();
+            device.has_device_information = true;
+        }
+        catch(iodrivers_base::TimeoutError const&) {}
+        return true;
+    }
+    catch(std::exception const&)
+    {
+        // Ports that are not connected to anything fail to open or to be
+        // configured
+        return false;
+    }
+}
+
+vector<DiscoveredDevice> discovery::discover(vector<string> const& ports)
+{
+    vector<DiscoveredDevice> devices(ports.size());
+    // vector<bool> is not safe to write from multiple threads
+    vector<char> found(ports.size(), 0);
+
+    vector<thread> workers;
+    for (size_t i = 0; i < ports.size(); ++i)
+    {
+        workers.emplace_back([&ports, &devices, &found, i]() {
+            found[i] = probe(ports[i], devices[i]);
+        });
+    }
+    for (auto& worker : workers)
+        worker.join();
+
+    vector<DiscoveredDevice> result;
+    for (size_t i = 0; i < ports.size(); ++i)
+    {
+        if (found[i])
+            result.push_back(devices[i]);
+    }
+    return result;
+}
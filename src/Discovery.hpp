@@ -0,0 +1,54 @@
+#ifndef ADVANCED_NAVIGATION_ANPP_DISCOVERY_HPP
+#define ADVANCED_NAVIGATION_ANPP_DISCOVERY_HPP
+
+#include <string>
+#include <vector>
+#include <imu_advanced_navigation_anpp/DeviceInformation.hpp>
+
+namespace imu_advanced_navigation_anpp
+{
+    /** Discovery of ANPP devices on serial ports
+     *
+     * Each port is probed by its own thread with Driver::detectBaudrate,
+     * which listens for ANPP traffic before trying a DeviceInformation
+     * request at each rate. The discovery therefore takes as long as the
+     * slowest port, i.e. a few seconds at most.
+     *
+     * The devices are not configured in any way. A device that streams
+     * packets is not disturbed, except for the DeviceInformation request
+     * that is sent once its rate is known.
+     */
+    namespace discovery
+    {
+        /** A device that has been found on a port */
+        struct DiscoveredDevice
+        {
+            /** The port path, e.g. /dev/ttyUSB0 */
+            std::string port;
+            uint32_t baudrate = 0;
+            /** Whether the device replied to the DeviceInformation request */
+            bool has_device_information = false;
+            /** The device information, zeroed if has_device_information is
+             * false */
+            DeviceInformation device_information = DeviceInformation();
+        };
+
+        /** The serial ports an ANPP device may be connected to
+         *
+         * These are the /dev/ttyUSB*, /dev/ttyACM* and /dev/ttyS* devices
+         */
+        std::vector<std::string> listCandidatePorts();
+
+        /** Probe the given ports concurrently
+         *
+         * Ports that cannot be opened, or on which no device is found, are
+         * not reported.
+         *
+         * @return the devices that have been found, in the order of the
+         *   given ports
+         */
+        std::vector<DiscoveredDevice> discover(std::vector<std::string> const& ports);
+    }
+}
+
+#endif
@@ -1,7 +1,9 @@
 #include <imu_advanced_navigation_anpp/Driver.hpp>
 #include <imu_advanced_navigation_anpp/Protocol.hpp>
+#include <imu_advanced_navigation_anpp/Probes.hpp>
 #include <base/Timeout.hpp>
 #include <base-logging/Logging.hpp>
+#include <chrono>
 
 using namespace std;
 using namespace imu_advanced_navigation_anpp;
@@ -10,18 +12,64 @@ using imu_advanced_navigation_anpp::protocol::Header;
 using Eigen::Map;
 using Eigen::Unaligned;
 
+/** Current time for the latency histograms, in nanoseconds */
+static int64_t latencyClock()
+{
+    return chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 Driver::Driver()
-    : iodrivers_base::Driver(protocol::MAX_PACKET_SIZE * 10)
+    : iodrivers_base::Driver(protocol::DRIVER_BUFFER_SIZE)
     , ned2nwu(Eigen::AngleAxisd(M_PI, Eigen::Vector3d::UnitX()))
 {
     // Set some sensible default read timeout
     setReadTimeout(base::Time::fromSeconds(1));
     mLastPackets.resize(protocol::PACKET_ID_COUNT, 0);
     mPacketPeriods.resize(protocol::PACKET_ID_COUNT, make_pair(0, 0));
+    mLastTrains.resize(protocol::PACKET_ID_COUNT, 0);
+    mStatistics.packets.resize(protocol::PACKET_ID_COUNT, 0);
+    mDecodedTimes.resize(protocol::PACKET_ID_COUNT, 0);
+    mJitter.resize(protocol::PACKET_ID_COUNT);
+    mLastArrivals.resize(protocol::PACKET_ID_COUNT);
+}
+
+template<typename Packet>
+Packet Driver::query()
+{
+    StartupRoundTripScope round_trip(mStartupProfiler);
+    return protocol::query<Packet>(*this);
+}
+
+void Driver::validateAck(Header const& header)
+{
+    StartupRoundTripScope round_trip(mStartupProfiler);
+    ACK_RESULTS result = protocol::waitForAck(*this, header, getReadTimeout());
+    ANPP_PROBE2(command_ack, static_cast<int>(header.packet_id), static_cast<int>(result));
+    if (result != ACK_SUCCESS)
+        throw AcknowledgeFailure(header.packet_id, result);
+}
+
+void Driver::validateAcks(vector<Header> const& headers)
+{
+    StartupRoundTripScope round_trip(mStartupProfiler);
+    protocol::validateAcks(*this, headers, getReadTimeout(),
+        [](Header const& header, ACK_RESULTS result) {
+            ANPP_PROBE2(command_ack, static_cast<int>(header.packet_id),
+                        static_cast<int>(result));
+        });
+}
+
+bool Driver::writePacket(uint8_t const* buffer, int buffer_size)
+{
+    bool result = iodrivers_base::Driver::writePacket(buffer, buffer_size);
+    ANPP_PROBE2(command_send, static_cast<int>(buffer[1]), buffer_size);
+    return result;
 }
 
 void Driver::openURI(std::string const& uri)
 {
+    StartupStepScope step(mStartupProfiler, "openURI");
     iodrivers_base::Driver::openURI(uri);
 
     resetPollSynchronization();
@@ -31,13 +79,107 @@ void Driver::openURI(std::string const& uri)
 
 void Driver::setDeviceBaudrate(uint32_t rate)
 {
+    TraceSpan span(mTraceRecorder.get(), TRACE_COMMAND, protocol::BaudRates::ID);
     // First read the current configuration to not change the GPIO and
     // secondary rates
-    auto current = protocol::query<protocol::BaudRates>(*this);
+    auto current = query<protocol::BaudRates>();
     current.permanent = 1;
     current.primary_port = rate;
     auto header = protocol::writePacket(*this, current);
-    protocol::validateAck(*this, header, getReadTimeout());
+    validateAck(header);
+}
+
+/** The rates supported by the device's primary port */
+static const uint32_t DEVICE_BAUDRATES[] = {
+    115200, 921600, 1152000, 576000, 460800, 230400,
+    57600, 38400, 19200, 9600, 4800, 2400, 1200 };
+
+/** Time needed to transmit the given number of bytes at the given rate, with
+ * 10 bits per byte (8N1) */
+static base::Time transmissionTime(size_t bytes, uint32_t rate)
+{
+    return base::Time::fromMicroseconds(bytes * 10 * 1000000ull / rate);
+}
+
+uint32_t Driver::detectBaudrate(string const& uri)
+{
+    // Listen long enough to get a few packets at low rates. At high rates,
+    // the minimum duration accounts for the device's packet period
+    static const base::Time MIN_LISTEN_DURATION = base::Time::fromMilliseconds(50);
+    static const size_t LISTEN_BYTES = 48;
+    // Consider the rate right if most of the bytes form valid packets. Some
+    // bytes are always lost as the port is opened in the middle of a packet
+    static const double MIN_VALID_BYTE_RATIO = 0.8;
+
+    double best_ratio = 0;
+    uint32_t best_rate = 0;
+    for (uint32_t rate : DEVICE_BAUDRATES)
+    {
+        iodrivers_base::Driver::openURI(uri + ":" + to_string(rate));
+        base::Time duration = std::max(MIN_LISTEN_DURATION, transmissionTime(LISTEN_BYTES, rate));
+        double ratio = measureValidByteRatio(duration);
+        if (ratio > best_ratio)
+        {
+            best_ratio = ratio;
+            best_rate = rate;
+        }
+        if (ratio >= MIN_VALID_BYTE_RATIO)
+            break;
+    }
+    if (best_rate)
+    {
+        close();
+        return best_rate;
+    }
+
+    // The device is silent, ask for the device information at each rate
+    static const base::Time MIN_PROBE_TIMEOUT = base::Time::fromMilliseconds(30);
+    static const size_t PROBE_BYTES = 2 * Header::SIZE + 1 + protocol::DeviceInformation::SIZE;
+    base::Time read_timeout = getReadTimeout();
+    for (uint32_t rate : DEVICE_BAUDRATES)
+    {
+        iodrivers_base::Driver::openURI(uri + ":" + to_string(rate));
+        setReadTimeout(MIN_PROBE_TIMEOUT + transmissionTime(PROBE_BYTES * 3 / 2, rate));
+        try
+        {
+            readDeviceInformation();
+            setReadTimeout(read_timeout);
+            close();
+            return rate;
+        }
+        catch(iodrivers_base::TimeoutError const&) {}
+    }
+    setReadTimeout(read_timeout);
+    close();
+    return 0;
+}
+
+double Driver::measureValidByteRatio(base::Time const& duration, size_t min_packets)
+{
+    iodrivers_base::Status start = getStatus();
+    size_t packet_count = 0;
+
+    uint8_t packet[MAX_PACKET_SIZE];
+    base::Timeout timeout(duration);
+    while (!timeout.elapsed())
+    {
+        base::Time left = timeout.timeLeft();
+        if (left.toMicroseconds() < 0)
+            left = base::Time();
+        try
+        {
+            readPacket(packet, MAX_PACKET_SIZE, left);
+            ++packet_count;
+        }
+        catch(iodrivers_base::TimeoutError const&) {}
+    }
+
+    iodrivers_base::Status end = getStatus();
+    size_t good = end.good_rx - start.good_rx;
+    size_t bad = end.bad_rx - start.bad_rx;
+    if (packet_count < min_packets)
+        return 0;
+    return static_cast<double>(good) / (good + bad);
 }
 
 void Driver::setUseDeviceTime(bool enable)
@@ -54,8 +196,14 @@ bool Driver::getUseDeviceTime() const
 
 void Driver::clearPeriodicPackets()
 {
+    StartupStepScope step(mStartupProfiler, "clearPeriodicPackets");
     int period = mUseDeviceTime;
     setPacketPeriod(protocol::UnixTime::ID, period, true);
+    resetSamples();
+}
+
+void Driver::resetSamples()
+{
     mWorld = base::samples::RigidBodyState();
     mBody  = base::samples::RigidBodyState();
     mAcceleration.acceleration = base::unknown<double>() * Eigen::Vector3d::Ones();
@@ -84,12 +232,14 @@ void Driver::reset(RESET_MODE mode)
 
 DeviceInformation Driver::readDeviceInformation()
 {
-    return protocol::query<protocol::DeviceInformation>(*this);
+    TraceSpan span(mTraceRecorder.get(), TRACE_COMMAND, protocol::DeviceInformation::ID);
+    return query<protocol::DeviceInformation>();
 }
 
 base::Time Driver::readTime()
 {
-    auto raw_time = protocol::query<protocol::UnixTime>(*this);
+    TraceSpan span(mTraceRecorder.get(), TRACE_COMMAND, protocol::UnixTime::ID);
+    auto raw_time = query<protocol::UnixTime>();
     return base::Time::fromMicroseconds(
             static_cast<uint64_t>(raw_time.seconds) * base::Time::UsecPerSec +
             static_cast<uint64_t>(raw_time.microseconds));
@@ -106,7 +256,8 @@ void protocol2public(Status& status, protocol::Status const& raw_status, base::T
 
 Status Driver::readStatus()
 {
-    auto raw_status = protocol::query<protocol::Status>(*this);
+    TraceSpan span(mTraceRecorder.get(), TRACE_COMMAND, protocol::Status::ID);
+    auto raw_status = query<protocol::Status>();
     Status result;
     protocol2public(result, raw_status, base::Time::now());
     return result;
@@ -114,20 +265,23 @@ Status Driver::readStatus()
 
 CurrentConfiguration Driver::readConfiguration()
 {
+    TraceSpan span(mTraceRecorder.get(), TRACE_COMMAND, protocol::Request::ID);
+    StartupStepScope step(mStartupProfiler, "readConfiguration");
     protocol::PacketTimerPeriod packet_timer_period =
-        protocol::query<protocol::PacketTimerPeriod>(*this);
+        query<protocol::PacketTimerPeriod>();
     protocol::Alignment alignment =
-        protocol::query<protocol::Alignment>(*this);
+        query<protocol::Alignment>();
     protocol::FilterOptions filter_options =
-        protocol::query<protocol::FilterOptions>(*this);
+        query<protocol::FilterOptions>();
     protocol::MagneticCalibrationValues magnetic_calibration =
-        protocol::query<protocol::MagneticCalibrationValues>(*this);
+        query<protocol::MagneticCalibrationValues>();
     protocol::MagneticCalibrationStatus magnetic_calibration_status =
-        protocol::query<protocol::MagneticCalibrationStatus>(*this);
+        query<protocol::MagneticCalibrationStatus>();
 
     CurrentConfiguration result;
     result.utc_synchronization = packet_timer_period.utc_synchronization != 0;
     result.packet_timer_period = base::Time::fromMicroseconds(packet_timer_period.period);
+    mPacketTimerPeriod = result.packet_timer_period;
     result.gnss_antenna_offset = Map< Eigen::Vector3f, Unaligned >(alignment.gnss_antenna_offset_xyz).cast<double>();
 
     result.vehicle_type                 = static_cast<VEHICLE_TYPES>(filter_options.vehicle_type);
@@ -147,17 +301,53 @@ CurrentConfiguration Driver::readConfiguration()
     return result;
 }
 
-void Driver::setConfiguration(Configuration const& conf)
+/** The packets that write the settings of a Configuration, shared by
+ * setConfiguration() and applyProfile() */
+static protocol::PacketTimerPeriod makePacketTimerPeriod(Configuration const& conf, bool permanent)
 {
-    Header header;
-
     protocol::PacketTimerPeriod packet_timer_period;
     memset(&packet_timer_period, 0, sizeof(packet_timer_period));
-    packet_timer_period.permanent = 0;
+    packet_timer_period.permanent = permanent ? 1 : 0;
     packet_timer_period.utc_synchronization = conf.utc_synchronization ? 1 : 0;
     packet_timer_period.period = conf.packet_timer_period.toMicroseconds();
-    header = protocol::writePacket(*this, packet_timer_period);
-    protocol::validateAck(*this, header, getReadTimeout());
+    return packet_timer_period;
+}
+
+static protocol::Alignment makeAlignment(Configuration const& conf, bool permanent)
+{
+    protocol::Alignment alignment;
+    memset(&alignment, 0, sizeof(alignment));
+    alignment.permanent = permanent ? 1 : 0;
+    alignment.dcm[0] = 1;
+    alignment.dcm[4] = 1;
+    alignment.dcm[8] = 1;
+    std::copy_n(conf.gnss_antenna_offset.data(), 3, alignment.gnss_antenna_offset_xyz);
+    return alignment;
+}
+
+static protocol::FilterOptions makeFilterOptions(Configuration const& conf, bool permanent)
+{
+    protocol::FilterOptions filter_options;
+    memset(&filter_options, 0, sizeof(filter_options));
+    filter_options.permanent = permanent ? 1 : 0;
+    filter_options.vehicle_type                 = static_cast<VEHICLE_TYPES>(conf.vehicle_type);
+    filter_options.enabled_internal_gnss        = conf.enabled_internal_gnss ? 1 : 0;
+    filter_options.enabled_atmospheric_altitude = conf.enabled_atmospheric_altitude ? 1 : 0;
+    filter_options.enabled_velocity_heading     = conf.enabled_velocity_heading ? 1 : 0;
+    filter_options.enabled_reversing_detection  = conf.enabled_reversing_detection ? 1 : 0;
+    filter_options.enabled_motion_analysis      = conf.enabled_motion_analysis ? 1 : 0;
+    return filter_options;
+}
+
+void Driver::setConfiguration(Configuration const& conf)
+{
+    TraceSpan span(mTraceRecorder.get(), TRACE_COMMAND, protocol::PacketTimerPeriod::ID);
+    StartupStepScope step(mStartupProfiler, "setConfiguration");
+    Header header;
+
+    header = protocol::writePacket(*this, makePacketTimerPeriod(conf, false));
+    validateAck(header);
+    mPacketTimerPeriod = conf.packet_timer_period;
 
     if (conf.gnss_antenna_offset != Eigen::Vector3d::Zero())
     {
@@ -168,28 +358,151 @@ void Driver::setConfiguration(Configuration const& conf)
         LOG_WARN_S << "There's a bug at least in some Motus firmwares, that disables heading estimation" << endl;
         LOG_WARN_S << "if the alignment feature is used (in this case, because you gave a non-zero GNSS antenna offset" << endl;
         LOG_WARN_S << "Make sure you have a usable firmware, or set the GNSS antenna offset to zero" << endl;
-        protocol::Alignment alignment;
-        memset(&alignment, 0, sizeof(alignment));
-        alignment.permanent = 0;
-        alignment.dcm[0] = 1;
-        alignment.dcm[4] = 1;
-        alignment.dcm[8] = 1;
-        std::copy_n(conf.gnss_antenna_offset.data(), 3, alignment.gnss_antenna_offset_xyz);
-        header = protocol::writePacket(*this, alignment);
-        protocol::validateAck(*this, header, getReadTimeout());
+        header = protocol::writePacket(*this, makeAlignment(conf, false));
+        validateAck(header);
     }
 
-    protocol::FilterOptions filter_options;
-    memset(&filter_options, 0, sizeof(filter_options));
-    filter_options.permanent = 0;
-    filter_options.vehicle_type                 = static_cast<VEHICLE_TYPES>(conf.vehicle_type);
-    filter_options.enabled_internal_gnss        = conf.enabled_internal_gnss ? 1 : 0;
-    filter_options.enabled_atmospheric_altitude = conf.enabled_atmospheric_altitude ? 1 : 0;
-    filter_options.enabled_velocity_heading     = conf.enabled_velocity_heading ? 1 : 0;
-    filter_options.enabled_reversing_detection  = conf.enabled_reversing_detection ? 1 : 0;
-    filter_options.enabled_motion_analysis      = conf.enabled_motion_analysis ? 1 : 0;
-    header = protocol::writePacket(*this, filter_options);
-    protocol::validateAck(*this, header, getReadTimeout());
+    header = protocol::writePacket(*this, makeFilterOptions(conf, false));
+    validateAck(header);
+}
+
+static const std::vector<uint8_t> PROFILE_PACKET_IDS = {
+    protocol::PacketTimerPeriod::ID,
+    protocol::PacketPeriods::ID,
+    protocol::BaudRates::ID,
+    protocol::Alignment::ID,
+    protocol::FilterOptions::ID
+};
+
+int Driver::applyProfile(Profile const& profile)
+{
+    TraceSpan span(mTraceRecorder.get(), TRACE_COMMAND);
+    StartupStepScope step(mStartupProfiler, "applyProfile");
+    int round_trips = 0;
+    Configuration const& conf = profile.configuration;
+
+    protocol::BaudRates baudrates;
+    if (profile.baudrate)
+    {
+        baudrates = query<protocol::BaudRates>();
+        baudrates.permanent = profile.permanent ? 1 : 0;
+        baudrates.primary_port = profile.baudrate;
+        ++round_trips;
+    }
+
+    vector<Header> headers;
+    if (profile.has_packet_timer_period)
+    {
+        headers.push_back(protocol::writePacket(*this,
+            makePacketTimerPeriod(conf, profile.permanent)));
+    }
+    if (profile.has_alignment)
+    {
+        headers.push_back(protocol::writePacket(*this, makeAlignment(conf, profile.permanent)));
+    }
+    if (profile.has_filter_options)
+    {
+        headers.push_back(protocol::writePacket(*this,
+            makeFilterOptions(conf, profile.permanent)));
+    }
+
+    map<uint8_t, uint32_t> periods = profile.packet_periods;
+    if (profile.has_packet_periods)
+    {
+        periods.insert(make_pair(protocol::UnixTime::ID, mUseDeviceTime ? 1 : 0));
+        headers.push_back(protocol::writePacketPeriods(*this, periods, true, profile.permanent));
+    }
+
+    // The baud rate change must be last, as the device switches rate
+    // right after having acknowledged it
+    if (profile.baudrate)
+        headers.push_back(protocol::writePacket(*this, baudrates));
+
+    if (!headers.empty())
+    {
+        validateAcks(headers);
+        ++round_trips;
+    }
+
+    if (profile.has_packet_timer_period)
+        mPacketTimerPeriod = conf.packet_timer_period;
+
+    if (profile.has_packet_periods)
+    {
+        resetSamples();
+        updatePacketPeriod(protocol::UnixTime::ID, 0, true);
+        for (auto const& id_and_period : periods)
+            updatePacketPeriod(id_and_period.first, id_and_period.second);
+    }
+    return round_trips;
+}
+
+Profile Driver::readProfile()
+{
+    TraceSpan span(mTraceRecorder.get(), TRACE_COMMAND, protocol::Request::ID);
+    StartupStepScope step(mStartupProfiler, "readProfile");
+    StartupRoundTripScope round_trip(mStartupProfiler);
+    protocol::writeRequest(*this, PROFILE_PACKET_IDS);
+    resetPollSynchronization();
+
+    Profile profile;
+    profile.has_packet_timer_period = true;
+    profile.has_filter_options = true;
+    profile.has_alignment = true;
+    profile.has_packet_periods = true;
+    Configuration& conf = profile.configuration;
+
+    uint8_t packet[MAX_PACKET_SIZE];
+    size_t received = 0;
+    base::Timeout timeout(getReadTimeout());
+    while (received < PROFILE_PACKET_IDS.size())
+    {
+        base::Time left = timeout.timeLeft();
+        if (left.toMicroseconds() < 0)
+            left = base::Time();
+        int packet_size = readPacket(packet, MAX_PACKET_SIZE, left);
+
+        uint8_t const* payload = packet + Header::SIZE;
+        uint8_t const* payload_end = packet + packet_size;
+        switch(packet[1])
+        {
+            case protocol::PacketTimerPeriod::ID:
+            {
+                auto packet_timer_period = protocol::PacketTimerPeriod::unmarshal(payload, payload_end);
+                conf.utc_synchronization = packet_timer_period.utc_synchronization != 0;
+                conf.packet_timer_period = base::Time::fromMicroseconds(packet_timer_period.period);
+                break;
+            }
+            case protocol::PacketPeriods::ID:
+                profile.packet_periods = protocol::PacketPeriods::unmarshal(payload, payload_end);
+                break;
+            case protocol::BaudRates::ID:
+                profile.baudrate = protocol::BaudRates::unmarshal(payload, payload_end).primary_port;
+                break;
+            case protocol::Alignment::ID:
+            {
+                auto alignment = protocol::Alignment::unmarshal(payload, payload_end);
+                conf.gnss_antenna_offset =
+                    Map< Eigen::Vector3f, Unaligned >(alignment.gnss_antenna_offset_xyz).cast<double>();
+                break;
+            }
+            case protocol::FilterOptions::ID:
+            {
+                auto filter_options = protocol::FilterOptions::unmarshal(payload, payload_end);
+                conf.vehicle_type                 = static_cast<VEHICLE_TYPES>(filter_options.vehicle_type);
+                conf.enabled_internal_gnss        = filter_options.enabled_internal_gnss != 0;
+                conf.enabled_atmospheric_altitude = filter_options.enabled_atmospheric_altitude != 0;
+                conf.enabled_velocity_heading     = filter_options.enabled_velocity_heading != 0;
+                conf.enabled_reversing_detection  = filter_options.enabled_reversing_detection != 0;
+                conf.enabled_motion_analysis      = filter_options.enabled_motion_analysis != 0;
+                break;
+            }
+            default:
+                continue;
+        }
+        ++received;
+    }
+    return profile;
 }
 
 Status Driver::getIMUStatus() const
@@ -234,9 +547,35 @@ gps_base::SatelliteInfo Driver::getGNSSSatelliteInfo() const
 
 void Driver::setPacketPeriod(uint8_t packet_id, uint32_t period, bool clear_existing)
 {
+    TraceSpan span(mTraceRecorder.get(), TRACE_COMMAND, protocol::PacketPeriods::ID);
+    StartupStepScope step(mStartupProfiler, "setPacketPeriod", packet_id);
     Header header = protocol::writePacketPeriod(*this, packet_id, period, clear_existing);
-    protocol::validateAck(*this, header, getReadTimeout());
+    validateAck(header);
+    updatePacketPeriod(packet_id, period, clear_existing);
+}
+
+void Driver::setPacketPeriods(map<uint8_t, uint32_t> const& periods, bool clear_existing)
+{
+    TraceSpan span(mTraceRecorder.get(), TRACE_COMMAND, protocol::PacketPeriods::ID);
+    StartupStepScope step(mStartupProfiler, "setPacketPeriods");
+    auto all_periods = periods;
+    if (clear_existing)
+        all_periods.insert(make_pair(protocol::UnixTime::ID, mUseDeviceTime ? 1 : 0));
+
+    Header header = protocol::writePacketPeriods(*this, all_periods, clear_existing);
+    validateAck(header);
+
+    if (clear_existing)
+    {
+        resetSamples();
+        updatePacketPeriod(protocol::UnixTime::ID, 0, true);
+    }
+    for (auto const& id_and_period : all_periods)
+        updatePacketPeriod(id_and_period.first, id_and_period.second);
+}
 
+void Driver::updatePacketPeriod(uint8_t packet_id, uint32_t period, bool clear_existing)
+{
     if (clear_existing)
         std::fill(mPacketPeriods.begin(), mPacketPeriods.end(), make_pair(0, 0));
 
@@ -257,6 +596,30 @@ void Driver::setPacketPeriod(uint8_t packet_id, uint32_t period, bool clear_exis
         last = period_and_id;
     }
     mLastPackets[last.second] = last.first;
+
+    mPeriodicPackets.clear();
+    for (int id = 0; id < protocol::PACKET_ID_COUNT; ++id)
+    {
+        if (mPacketPeriods[id].first != 0)
+            mPeriodicPackets.push_back(make_pair(id, mPacketPeriods[id].first));
+    }
+    std::fill(mLastTrains.begin(), mLastTrains.end(), 0);
+    std::fill(mLastArrivals.begin(), mLastArrivals.end(), make_pair(base::Time(), base::Time()));
+    if (mLatencyEnabled)
+        allocateLatencyHistograms();
+}
+
+void Driver::setReplayConfiguration(map<uint8_t, uint32_t> const& periods, bool use_device_time,
+                                    base::Time const& packet_timer_period)
+{
+    mUseDeviceTime = use_device_time;
+    mPacketTimerPeriod = packet_timer_period;
+    resetSamples();
+    resetPollSynchronization();
+
+    updatePacketPeriod(protocol::UnixTime::ID, 0, true);
+    for (auto const& id_and_period : periods)
+        updatePacketPeriod(id_and_period.first, id_and_period.second);
 }
 
 void Driver::setStatusPeriod(int period)
@@ -408,6 +771,7 @@ T may_invalidate(T const& value)
 
 void Driver::updateWorldFromGeodetic()
 {
+    TraceSpan span(mTraceRecorder.get(), TRACE_UTM_CONVERSION);
     base::samples::RigidBodyState rbs =
         mUTMConverter.convertToNWU(mGeodeticPosition);
     mWorld.position     = rbs.position;
@@ -607,11 +971,15 @@ void Driver::processDetailedSatellites(uint8_t const* packet, uint8_t const* pac
     mGNSSSatelliteInfo.time = mCurrentTimestamp;
     mGNSSSatelliteInfo.knownSatellites.clear();
 
-    std::vector<protocol::SatelliteInfo> satellite_info;
-    protocol::DetailedSatellites::unmarshal(packet + Header::SIZE, packet_end, satellite_info);
+    // Unmarshal in place instead of through DetailedSatellites::unmarshal,
+    // so that poll() does not allocate once knownSatellites has grown
+    uint8_t const* payload = packet + Header::SIZE;
+    if ((packet_end - payload) % protocol::SatelliteInfo::SIZE != 0)
+        throw std::length_error("DetailedSatellites::unmarshal buffer is not a multiple of the SatelliteInfo size");
 
-    for (auto satellite : satellite_info)
+    for (; payload != packet_end; payload += protocol::SatelliteInfo::SIZE)
     {
+        auto satellite = protocol::SatelliteInfo::unmarshal(payload, payload + protocol::SatelliteInfo::SIZE);
         gps_base::Satellite info;
         info.PRN       = satellite.prn;
         info.elevation = satellite.elevation;
@@ -640,15 +1008,126 @@ void Driver::resetPollSynchronization()
 int Driver::poll()
 {
     uint8_t packet[MAX_PACKET_SIZE];
-    size_t packet_size = readPacket(packet, MAX_PACKET_SIZE);
+    size_t packet_size;
+    {
+        TraceSpan span(mTraceRecorder.get(), TRACE_READ);
+        packet_size = readPacket(packet, MAX_PACKET_SIZE);
+        span.setPacketID(packet[1]);
+    }
+    ANPP_PROBE2(packet_read, static_cast<int>(packet[1]), packet_size);
+    return processPacket(packet, packet_size);
+}
+
+int Driver::processPacket(uint8_t const* packet, size_t packet_size)
+{
+    // Only packets framed by extractPacket have a framing time. The others,
+    // e.g. packets given directly to processPacket, are not timed
+    int64_t framed_time = mFramedTime;
+    mFramedTime = 0;
+
+    ANPP_PROBE2(dispatch_entry, static_cast<int>(packet[1]), packet_size);
+    int result;
+    {
+        TraceSpan span(mTraceRecorder.get(), TRACE_PROCESS, packet[1]);
+        result = decodePacket(packet, packet_size);
+    }
+    ANPP_PROBE2(dispatch_exit, static_cast<int>(packet[1]), result);
+    if (mLatencyEnabled && framed_time != 0)
+        recordLatencies(packet[1], framed_time, result);
+    if (mJitterEnabled)
+        updateJitter(packet[1]);
+    return result;
+}
+
+void Driver::updateJitter(uint8_t packet_id)
+{
+    // UnixTime's period is not in mPacketPeriods, as it is not exposed
+    uint32_t period = (packet_id == protocol::UnixTime::ID) ?
+        mUseDeviceTime : mPacketPeriods[packet_id].first;
+    if (period == 0)
+        return;
+
+    PacketJitter& jitter = mJitter[packet_id];
+    jitter.expected_interval =
+        base::Time::fromMicroseconds(mPacketTimerPeriod.toMicroseconds() * period);
+
+    base::Time host = base::Time::now();
+    base::Time device = mUseDeviceTime ? mCurrentTimestamp : base::Time();
+    auto& last = mLastArrivals[packet_id];
+    if (!last.first.isNull())
+    {
+        double expected = jitter.expected_interval.toSeconds();
+        double host_interval = (host - last.first).toSeconds();
+        bool has_device = !device.isNull() && !last.second.isNull();
+        double device_interval = has_device ? (device - last.second).toSeconds() : 0;
+
+        double interval = has_device ? device_interval : host_interval;
+        if (interval < 0)
+        {
+            // The clock jumped backwards (e.g. UTC resynchronization or GNSS
+            // time correction). This is a discontinuity, not missed packets:
+            // restart the analysis from this packet
+            (has_device ? jitter.device : jitter.host).outliers++;
+        }
+        else
+        {
+            int64_t periods = llround(interval / expected);
+            if (periods == 0)
+                jitter.doubled++;
+            else
+                jitter.missed += periods - 1;
+
+            if (periods == 1)
+            {
+                jitter.host.add(host_interval, expected);
+                if (has_device)
+                    jitter.device.add(device_interval, expected);
+            }
+        }
+    }
+    last = make_pair(host, device);
+}
+
+void Driver::recordLatencies(uint8_t packet_id, int64_t framed_time, int result)
+{
+    int64_t now = latencyClock();
+    mLatency.record(LATENCY_FRAMED_TO_DECODED, packet_id, now - framed_time);
+    mDecodedTimes[packet_id] = now;
+
+    if (mLatencyTrainIndex != mTrainIndex)
+    {
+        if (mTrainStartTime != 0)
+            mLatency.recordTrain(mTrainEndTime - mTrainStartTime);
+        mLatencyTrainIndex = mTrainIndex;
+        mTrainStartTime = framed_time;
+    }
+    mTrainEndTime = now;
 
+    // The decoding of the packet completed a period, the samples of all the
+    // packets of this period are therefore published now
+    if (result > 0)
+    {
+        for (auto const& id_and_period : mPeriodicPackets)
+        {
+            uint8_t id = id_and_period.first;
+            if (id_and_period.second == static_cast<uint32_t>(result) &&
+                mLastTrains[id] == mTrainIndex && mDecodedTimes[id] != 0)
+                mLatency.record(LATENCY_DECODED_TO_PUBLISHED, id, now - mDecodedTimes[id]);
+        }
+    }
+}
+
+int Driver::decodePacket(uint8_t const* packet, size_t packet_size)
+{
     Header const& header(reinterpret_cast<Header const&>(*packet));
     if (mLastPacketID >= header.packet_id)
     {
         if (!mUseDeviceTime)
             mCurrentTimestamp = base::Time::now();
+        finishTrain();
     }
     mLastPacketID = header.packet_id;
+    mLastTrains[header.packet_id] = mTrainIndex;
 
     if (header.packet_id == protocol::UnixTime::ID)
     {
@@ -664,58 +1143,204 @@ int Driver::poll()
         case packet_name::ID: \
             dispatch<packet_name>(packet, packet + packet_size); \
             break;
-    switch(header.packet_id)
-    {
-        POLL_DISPATCH_CASE(protocol::Status);
-        POLL_DISPATCH_CASE(protocol::QuaternionOrientation);
-        POLL_DISPATCH_CASE(protocol::EulerOrientationStandardDeviation);
-        POLL_DISPATCH_CASE(protocol::NEDVelocity);
-        POLL_DISPATCH_CASE(protocol::NEDVelocityStandardDeviation);
-        POLL_DISPATCH_CASE(protocol::BodyAcceleration);
-        POLL_DISPATCH_CASE(protocol::BodyVelocity);
-        POLL_DISPATCH_CASE(protocol::AngularVelocity);
-        POLL_DISPATCH_CASE(protocol::AngularAcceleration);
-        POLL_DISPATCH_CASE(protocol::RawSensors);
-        POLL_DISPATCH_CASE(protocol::RawGNSS);
-        POLL_DISPATCH_CASE(protocol::Satellites);
-        POLL_DISPATCH_CASE(protocol::GeodeticPosition);
-        POLL_DISPATCH_CASE(protocol::GeodeticPositionStandardDeviation);
-        POLL_DISPATCH_CASE(protocol::NorthSeekingInitializationStatus);
-        case protocol::DetailedSatellites::ID:
-            processDetailedSatellites(packet, packet + packet_size);
-            break;
-        default:
-            LOG_ERROR_S << "Ignored message of ID " << static_cast<int>(header.packet_id) << std::endl;
+    try
+    {
+        switch(header.packet_id)
+        {
+            POLL_DISPATCH_CASE(protocol::Status);
+            POLL_DISPATCH_CASE(protocol::QuaternionOrientation);
+            POLL_DISPATCH_CASE(protocol::EulerOrientationStandardDeviation);
+            POLL_DISPATCH_CASE(protocol::NEDVelocity);
+            POLL_DISPATCH_CASE(protocol::NEDVelocityStandardDeviation);
+            POLL_DISPATCH_CASE(protocol::BodyAcceleration);
+            POLL_DISPATCH_CASE(protocol::BodyVelocity);
+            POLL_DISPATCH_CASE(protocol::AngularVelocity);
+            POLL_DISPATCH_CASE(protocol::AngularAcceleration);
+            POLL_DISPATCH_CASE(protocol::RawSensors);
+            POLL_DISPATCH_CASE(protocol::RawGNSS);
+            POLL_DISPATCH_CASE(protocol::Satellites);
+            POLL_DISPATCH_CASE(protocol::GeodeticPosition);
+            POLL_DISPATCH_CASE(protocol::GeodeticPositionStandardDeviation);
+            POLL_DISPATCH_CASE(protocol::NorthSeekingInitializationStatus);
+            case protocol::DetailedSatellites::ID:
+                processDetailedSatellites(packet, packet + packet_size);
+                break;
+            default:
+                mStatistics.unknown_packets++;
+                LOG_ERROR_S << "Ignored message of ID " << static_cast<int>(header.packet_id) << std::endl;
+        }
+    }
+    catch(std::length_error const&)
+    {
+        mStatistics.length_errors++;
+        throw;
     }
 
     return mLastPackets[header.packet_id];
 }
 
-int Driver::extractPacket(uint8_t const* buffer, size_t buffer_length) const
+void Driver::finishTrain()
 {
-    if (buffer_length < 4)
-        return 0;
+    mStatistics.trains++;
+    bool complete = true;
+    for (auto const& id_and_period : mPeriodicPackets)
+    {
+        uint64_t last = mLastTrains[id_and_period.first];
+        if (last != 0 && last != mTrainIndex && (mTrainIndex - last) % id_and_period.second == 0)
+        {
+            mStatistics.incomplete_trains++;
+            complete = false;
+            break;
+        }
+    }
+    ANPP_PROBE2(train_complete, mTrainIndex, complete);
+    mTrainIndex++;
+}
 
-    Header const& header = reinterpret_cast<Header const&>(*buffer);
-    if (header.isValid())
+int Driver::extractPacket(uint8_t const* buffer, size_t buffer_length) const
+{
+    int64_t trace_start = mTraceRecorder ? TraceRecorder::now() : 0;
+    int result = protocol::extractPacket(buffer, buffer_length);
+    if (mTraceRecorder && result != 0)
     {
-        size_t expected_packet_length = header.getPacketLength();
-        if (buffer_length < expected_packet_length)
-            return 0;
-        else if (header.isPacketValid(buffer + Header::SIZE, buffer + expected_packet_length))
-            return expected_packet_length;
+        if (result > 0)
+            mTraceRecorder->record(TRACE_FRAMING, buffer[1], trace_start);
         else
-            return -1;
+            mTraceRecorder->record(TRACE_RESYNC, -1, trace_start);
     }
-
-    auto buffer_end = buffer + buffer_length;
-    for (auto packet_start = buffer + 1; packet_start + 4 < buffer_end; packet_start++)
+    if (result > 0)
+        ANPP_PROBE2(extract_accept, static_cast<int>(buffer[1]), result);
+    else if (result < 0)
+        ANPP_PROBE2(extract_reject, -result, buffer_length);
+    if (mLatencyEnabled)
     {
-        Header const& header = reinterpret_cast<Header const&>(*packet_start);
-        if (header.isValid())
-            return buffer - packet_start;
+        int64_t now = latencyClock();
+        if (buffer_length > mUnframedBytes)
+            mReadTime = now;
+        if (result > 0)
+        {
+            mLatency.record(LATENCY_READ_TO_FRAMED, buffer[1], now - mReadTime);
+            mFramedTime = now;
+        }
+        mUnframedBytes = buffer_length - abs(result);
     }
-    return -static_cast<int>(buffer_length - 3);
+    mStatistics.update(buffer, result);
+    mStatistics.received_bytes += abs(result);
+    if (result > 0)
+        mStatistics.packets[buffer[1]]++;
+    return result;
 }
 
+Driver::Statistics const& Driver::getStatistics() const
+{
+    return mStatistics;
+}
+
+void Driver::resetStatistics()
+{
+    mStatistics = Statistics();
+    mStatistics.packets.resize(protocol::PACKET_ID_COUNT, 0);
+}
 
+void Driver::setLatencyHistogramsEnabled(bool enable)
+{
+    mLatencyEnabled = enable;
+    mReadTime = 0;
+    mFramedTime = 0;
+    mUnframedBytes = 0;
+    mLatencyTrainIndex = 0;
+    mTrainStartTime = 0;
+    std::fill(mDecodedTimes.begin(), mDecodedTimes.end(), 0);
+    if (enable)
+        allocateLatencyHistograms();
+}
+
+void Driver::allocateLatencyHistograms()
+{
+    // UnixTime is removed from the periodic packets, but still timed
+    mLatency.allocate(protocol::UnixTime::ID);
+    for (auto const& id_and_period : mPeriodicPackets)
+        mLatency.allocate(id_and_period.first);
+}
+
+bool Driver::isLatencyHistogramsEnabled() const
+{
+    return mLatencyEnabled;
+}
+
+LatencyHistograms const& Driver::getLatencyHistograms() const
+{
+    return mLatency;
+}
+
+void Driver::resetLatencyHistograms()
+{
+    mLatency.reset();
+}
+
+void Driver::setJitterAnalysisEnabled(bool enable)
+{
+    mJitterEnabled = enable;
+    std::fill(mLastArrivals.begin(), mLastArrivals.end(), make_pair(base::Time(), base::Time()));
+}
+
+bool Driver::isJitterAnalysisEnabled() const
+{
+    return mJitterEnabled;
+}
+
+PacketJitter const& Driver::getPacketJitter(uint8_t packet_id) const
+{
+    return mJitter[packet_id];
+}
+
+void Driver::resetJitter()
+{
+    std::fill(mJitter.begin(), mJitter.end(), PacketJitter());
+}
+
+base::Time Driver::getPacketTimerPeriod() const
+{
+    return mPacketTimerPeriod;
+}
+
+void Driver::enableTracing(size_t capacity)
+{
+    mTraceRecorder.reset(new TraceRecorder(capacity));
+}
+
+void Driver::disableTracing()
+{
+    mTraceRecorder.reset();
+}
+
+TraceRecorder const* Driver::getTraceRecorder() const
+{
+    return mTraceRecorder.get();
+}
+
+void Driver::flushTrace(std::ostream& out)
+{
+    if (mTraceRecorder)
+        mTraceRecorder->flush(out);
+}
+
+void Driver::setStartupProfilingEnabled(bool enable)
+{
+    mStartupProfiler.setEnabled(enable);
+}
+
+bool Driver::isStartupProfilingEnabled() const
+{
+    return mStartupProfiler.isEnabled();
+}
+
+StartupProfile const& Driver::getStartupProfile() const
+{
+    return mStartupProfiler.getProfile();
+}
+
+void Driver::resetStartupProfile()
+{
+    mStartupProfiler.reset();
+}
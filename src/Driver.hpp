@@ -1,10 +1,17 @@
 #ifndef ADVANCED_NAVIGATION_ANPP_DRIVER_HPP
 #define ADVANCED_NAVIGATION_ANPP_DRIVER_HPP
 
+#include <map>
 #include <imu_advanced_navigation_anpp/DeviceInformation.hpp>
+#include <imu_advanced_navigation_anpp/Protocol.hpp>
 #include <imu_advanced_navigation_anpp/Status.hpp>
 #include <imu_advanced_navigation_anpp/Configuration.hpp>
 #include <imu_advanced_navigation_anpp/CurrentConfiguration.hpp>
+#include <imu_advanced_navigation_anpp/Profile.hpp>
+#include <imu_advanced_navigation_anpp/LatencyHistogram.hpp>
+#include <imu_advanced_navigation_anpp/Jitter.hpp>
+#include <imu_advanced_navigation_anpp/TraceRecorder.hpp>
+#include <imu_advanced_navigation_anpp/StartupProfile.hpp>
 #include <iodrivers_base/Driver.hpp>
 #include <base/samples/RigidBodyState.hpp>
 #include <base/samples/RigidBodyAcceleration.hpp>
@@ -48,9 +55,82 @@ namespace imu_advanced_navigation_anpp
 
     class Driver : public iodrivers_base::Driver
     {
+    public:
+        /** Link and decoding counters, see getStatistics() */
+        struct Statistics : protocol::FramingStatistics
+        {
+            /** Bytes framed from the stream, whether they were part of a
+             * valid packet or not
+             */
+            uint64_t received_bytes = 0;
+            /** Valid packets received, indexed by packet ID
+             *
+             * This includes the packets read outside of poll(), such as
+             * acknowledgments
+             */
+            std::vector<uint64_t> packets;
+            /** Packets given to poll() that the driver does not process */
+            uint64_t unknown_packets = 0;
+            /** Packets given to poll() whose payload did not have the size
+             * expected for their ID
+             */
+            uint64_t length_errors = 0;
+            /** Packet trains whose end has been received */
+            uint64_t trains = 0;
+            /** Packet trains that lacked at least one of the packets due
+             * according to the configured periods
+             *
+             * Packets are expected again one period after they were last
+             * received. A train that is lost entirely is therefore not
+             * accounted for, but makes the packets of the following trains
+             * look late
+             */
+            uint64_t incomplete_trains = 0;
+        };
+
     private:
         static constexpr int PACKET_ID_COUNT = 256;
 
+        mutable Statistics mStatistics;
+        /** Index of the current packet train, starting at 1 */
+        uint64_t mTrainIndex = 1;
+        /** Index of the train in which each packet was last received, 0 if
+         * it has not been received since the periods were last changed
+         */
+        std::vector<uint64_t> mLastTrains;
+        /** The packets that have a non-zero period, as packet ID and period */
+        std::vector<std::pair<uint8_t, uint32_t>> mPeriodicPackets;
+
+        bool mLatencyEnabled = false;
+        mutable LatencyHistograms mLatency;
+        /** Times used by the latency histograms, in nanoseconds on the
+         * steady clock. Zero means unknown
+         */
+        mutable int64_t mReadTime = 0;
+        mutable int64_t mFramedTime = 0;
+        /** Bytes left in the buffer by the last call to extractPacket, to
+         * detect new reads
+         */
+        mutable size_t mUnframedBytes = 0;
+        std::vector<int64_t> mDecodedTimes;
+        uint64_t mLatencyTrainIndex = 0;
+        int64_t mTrainStartTime = 0;
+        int64_t mTrainEndTime = 0;
+
+        bool mJitterEnabled = false;
+        /** The device's packet timer period, as last read or written */
+        base::Time mPacketTimerPeriod = base::Time::fromMilliseconds(1);
+        std::vector<PacketJitter> mJitter;
+        /** Host and device time of the last packet of each ID, null if it
+         * has not been received since the periods were last changed
+         */
+        std::vector<std::pair<base::Time, base::Time>> mLastArrivals;
+
+        /** The span recorder, null if tracing is disabled */
+        std::unique_ptr<TraceRecorder> mTraceRecorder;
+
+        StartupProfiler mStartupProfiler;
+
         bool mUseDeviceTime = false;
         uint8_t mLastPacketID = 0;
         base::Time mCurrentTimestamp;
@@ -74,6 +154,16 @@ namespace imu_advanced_navigation_anpp
 
         int extractPacket(uint8_t const* buffer, size_t buffer_size) const;
         void setPacketPeriod(uint8_t packet_id, uint32_t period, bool clear_existing = false);
+        void updatePacketPeriod(uint8_t packet_id, uint32_t period, bool clear_existing = false);
+        void resetSamples();
+
+        /** Wrappers around the protocol functions of the same name, that
+         * account for the round trip in the startup profile
+         */
+        template<typename Packet>
+        Packet query();
+        void validateAck(protocol::Header const& header);
+        void validateAcks(std::vector<protocol::Header> const& headers);
 
         template<typename Packet>
         void dispatch(uint8_t const* packet, uint8_t const* packet_end);
@@ -94,12 +184,28 @@ namespace imu_advanced_navigation_anpp
         void process(protocol::GeodeticPosition const& payload);
         void process(protocol::NorthSeekingInitializationStatus const& payload);
         void processDetailedSatellites(uint8_t const* packet, uint8_t const* packet_end);
+        void finishTrain();
+        int decodePacket(uint8_t const* packet, size_t packet_size);
+        void recordLatencies(uint8_t packet_id, int64_t framed_time, int result);
+        /** Allocate the latency histograms of the periodic packets, so that
+         * poll() does not have to
+         */
+        void allocateLatencyHistograms();
+        void updateJitter(uint8_t packet_id);
 
     public:
         Driver();
 
         void openURI(std::string const& uri);
 
+        /** Write a packet to the device
+         *
+         * This hides iodrivers_base::Driver::writePacket, so that the
+         * packets sent through the protocol functions fire the command_send
+         * USDT probe when the library is built with USDT_PROBES
+         */
+        bool writePacket(uint8_t const* buffer, int buffer_size);
+
         /** Change the device's baudrate
          *
          * After this call, the driver is effectively unusable. You must close
@@ -107,6 +213,38 @@ namespace imu_advanced_navigation_anpp
          */
         void setDeviceBaudrate(uint32_t rate);
 
+        /** Find the baud rate the device is configured with
+         *
+         * The port is first opened at each of the rates supported by the
+         * device and listened to, without writing anything, to find a rate at
+         * which the received bytes form valid packets. This finds the rate
+         * without a single round-trip if the device is already streaming.
+         * Otherwise, a DeviceInformation packet is requested at each rate,
+         * with a timeout adapted to the rate. The whole detection takes at
+         * most a few seconds.
+         *
+         * The driver is closed on return. It must be re-opened with the
+         * detected rate.
+         *
+         * @param uri the device URI without the baud rate (e.g.
+         *   serial:///dev/ttyUSB0)
+         * @return the detected rate, or zero if the device could not be
+         *   found at any rate
+         */
+        uint32_t detectBaudrate(std::string const& uri);
+
+        /** Listen to the already opened link, and return the fraction of the
+         * received bytes that were part of valid packets
+         *
+         * Nothing is written to the device. This is used by detectBaudrate()
+         * to check whether the link is opened at the right rate.
+         *
+         * @param min_packets the minimum number of packets that must be
+         *   received for the link to be considered valid. The ratio is
+         *   zero if fewer packets are received
+         */
+        double measureValidByteRatio(base::Time const& duration, size_t min_packets = 2);
+
         /** Whether timestamping is using the device's time
          *
          * Use this if the device is synchronized with UTC (e.g. using a
@@ -152,6 +290,30 @@ namespace imu_advanced_navigation_anpp
         /** Read the current configuration */
         void setConfiguration(Configuration const& conf);
 
+        /** Apply a configuration profile
+         *
+         * All the configuration packets are sent back-to-back, and the
+         * acknowledgments are collected afterwards, which makes the whole
+         * profile a single round-trip. An additional round-trip is needed
+         * to read the secondary baud rates if the profile changes the
+         * primary one.
+         *
+         * If the baud rate is changed, the device switches rate after it
+         * acknowledged the change. The driver must be re-opened at the new
+         * rate afterwards.
+         *
+         * @return the number of round-trips
+         * @throw AcknowledgeFailure if the device rejected part of the profile
+         */
+        int applyProfile(Profile const& profile);
+
+        /** Read the settings that can be set by a profile with a single
+         * request
+         *
+         * All groups are marked as present in the returned profile
+         */
+        Profile readProfile();
+
         /** The current system+filter status */
         Status getIMUStatus() const;
 
@@ -180,6 +342,122 @@ namespace imu_advanced_navigation_anpp
         /** GNSS satellite information */
         gps_base::SatelliteInfo getGNSSSatelliteInfo() const;
 
+        /** Counters of the link and of the decoding
+         *
+         * They are updated by every packet read, and are kept until
+         * resetStatistics() is called
+         */
+        Statistics const& getStatistics() const;
+
+        /** Reset all the counters returned by getStatistics() */
+        void resetStatistics();
+
+        /** Enable or disable the latency histograms
+         *
+         * They are disabled by default. When enabled, each stage of the
+         * processing of the packets read by poll() costs one clock read and
+         * one histogram update. See LATENCY_STAGES for the stages
+         *
+         * The histograms of the periodic packets are allocated here and when
+         * the packet periods change, so that poll() does not allocate. The
+         * latencies of the other packets are only in the merged histograms
+         */
+        void setLatencyHistogramsEnabled(bool enable);
+
+        /** Whether the latency histograms are enabled */
+        bool isLatencyHistogramsEnabled() const;
+
+        /** The latency histograms, by stage and packet ID */
+        LatencyHistograms const& getLatencyHistograms() const;
+
+        /** Clear the latency histograms */
+        void resetLatencyHistograms();
+
+        /** Enable or disable the inter-arrival analysis
+         *
+         * It is disabled by default. When enabled, the interval between two
+         * consecutive packets of the same ID is compared with the interval
+         * expected from the packet timer period and the packet's period.
+         * See PacketJitter
+         */
+        void setJitterAnalysisEnabled(bool enable);
+
+        /** Whether the inter-arrival analysis is enabled */
+        bool isJitterAnalysisEnabled() const;
+
+        /** The inter-arrival analysis of a packet ID */
+        PacketJitter const& getPacketJitter(uint8_t packet_id) const;
+
+        /** Clear the inter-arrival analysis of all packet IDs */
+        void resetJitter();
+
+        /** The packet timer period used to compute the expected intervals
+         *
+         * It is updated by readConfiguration(), setConfiguration(),
+         * applyProfile() and setReplayConfiguration(). It defaults to the
+         * device's default of 1ms
+         */
+        base::Time getPacketTimerPeriod() const;
+
+        /** Start recording timestamped spans of the driver's activity
+         *
+         * This allocates a ring of the given number of events, which is
+         * then filled without allocation. See TRACE_SPANS for the spans. If
+         * tracing was already enabled, the recorded events are lost
+         */
+        void enableTracing(size_t capacity = TraceRecorder::DEFAULT_CAPACITY);
+
+        /** Stop recording spans and release the ring */
+        void disableTracing();
+
+        /** The span recorder, null if tracing is disabled */
+        TraceRecorder const* getTraceRecorder() const;
+
+        /** Write the recorded spans as a Chrome trace and clear the ring
+         *
+         * Does nothing if tracing is disabled
+         */
+        void flushTrace(std::ostream& out);
+
+        /** Enable or disable the recording of the startup profile
+         *
+         * It is disabled by default. When enabled, the methods that
+         * configure the device (openURI(), clearPeriodicPackets(), the
+         * set*Period methods, readConfiguration(), setConfiguration(),
+         * applyProfile() and readProfile()) are recorded as steps of the
+         * profile, along with their round trips to the device and the time
+         * spent waiting for its responses. Enable before openURI() to get
+         * the complete startup sequence
+         */
+        void setStartupProfilingEnabled(bool enable);
+
+        /** Whether the startup profile is being recorded */
+        bool isStartupProfilingEnabled() const;
+
+        /** The steps recorded since profiling was enabled or last reset */
+        StartupProfile const& getStartupProfile() const;
+
+        /** Clear the startup profile */
+        void resetStartupProfile();
+
+        /** Set the period of several packets at once
+         *
+         * Unlike the set*Period methods, this sends a single configuration
+         * packet to the device, and is therefore the preferred way to
+         * configure many outputs at once.
+         *
+         * @param periods the packet periods as packet ID to period, in
+         *   multiples of the base packet period. At most
+         *   protocol::PacketPeriods::MAX_PERIODS can be set at once,
+         *   UnixTime included.
+         * @param clear_existing if true, the periods of all the packets that
+         *   are not in the list are set to zero, except for the UnixTime
+         *   packet which remains as configured by setUseDeviceTime(). The
+         *   samples are reset as with clearPeriodicPackets()
+         */
+        void setPacketPeriods(std::map<uint8_t, uint32_t> const& periods,
+                              bool clear_existing = true);
+
         /** Set the period at which the status should be updated
          *
          * Periodic messages are processed by poll().
@@ -369,6 +647,34 @@ namespace imu_advanced_navigation_anpp
          */
         int poll();
 
+        /** Process a packet that has been received outside of poll()
+         *
+         * This is what poll() does after it read a packet. It is meant to
+         * process packets from an offline source, such as a log file, with
+         * the same results than poll(). Use setReplayConfiguration() to
+         * configure the driver in this case.
+         *
+         * @param packet the full packet, header included, as returned by
+         *   extractPacket
+         * @return the same value than poll()
+         */
+        int processPacket(uint8_t const* packet, size_t packet_size);
+
+        /** Configure the driver to process packets from an offline source
+         *
+         * This does the same than clearPeriodicPackets(), setUseDeviceTime()
+         * and the set*Period methods, but without communicating with the
+         * device.
+         *
+         * @param periods the packet periods, as packet ID to period
+         * @param use_device_time see setUseDeviceTime()
+         * @param packet_timer_period the device's packet timer period, used
+         *   by the inter-arrival analysis
+         */
+        void setReplayConfiguration(std::map<uint8_t, uint32_t> const& periods,
+                                    bool use_device_time,
+                                    base::Time const& packet_timer_period = base::Time::fromMilliseconds(1));
+
         /** Force poll() to re-synchronize to a full period
          */
         void resetPollSynchronization();
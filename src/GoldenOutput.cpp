@@ -0,0 +1,450 @@
+#include <imu_advanced_navigation_anpp/GoldenOutput.hpp>
+#include <imu_advanced_navigation_anpp/Driver.hpp>
+#include <imu_advanced_navigation_anpp/LogReplay.hpp>
+#include <imu_advanced_navigation_anpp/Protocol.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+using namespace imu_advanced_navigation_anpp::golden;
+
+static const uint64_t CANONICAL_NAN = 0x7ff8000000000000ull;
+
+namespace
+{
+    /** Gathers either the values or the names of the fields
+     *
+     * The names are only built when requested, so that snapshotting does
+     * not allocate them
+     */
+    struct Fields
+    {
+        vector<double>* values = nullptr;
+        vector<string>* names = nullptr;
+
+        void add(char const* prefix, char const* name, double value)
+        {
+            if (values)
+                values->push_back(value);
+            else
+                names->push_back(string(prefix) + "." + name);
+        }
+
+        void add(char const* prefix, char const* name, char const* suffix, double value)
+        {
+            if (values)
+                values->push_back(value);
+            else
+                names->push_back(string(prefix) + "." + name + "." + suffix);
+        }
+
+        void add(char const* prefix, char const* name, base::Time const& time)
+        {
+            add(prefix, name, static_cast<double>(time.toMicroseconds()));
+        }
+
+        void add(char const* prefix, char const* name, Eigen::Vector3d const& v)
+        {
+            static char const* AXES[3] = { "x", "y", "z" };
+            for (int i = 0; i < 3; ++i)
+                add(prefix, name, AXES[i], v[i]);
+        }
+
+        void add(char const* prefix, char const* name, Eigen::Matrix3d const& m)
+        {
+            for (int row = 0; row < 3; ++row)
+            {
+                for (int col = 0; col < 3; ++col)
+                {
+                    if (values)
+                        values->push_back(m(row, col));
+                    else
+                        names->push_back(string(prefix) + "." + name + "." +
+                                         to_string(row) + to_string(col));
+                }
+            }
+        }
+
+        void add(char const* prefix, char const* name, Eigen::Quaterniond const& q)
+        {
+            add(prefix, name, "w", q.w());
+            add(prefix, name, Eigen::Vector3d(q.vec()));
+        }
+    };
+}
+
+static void addRigidBodyState(Fields& fields, char const* prefix,
+                              base::samples::RigidBodyState const& rbs)
+{
+    fields.add(prefix, "time", rbs.time);
+    fields.add(prefix, "position", rbs.position);
+    fields.add(prefix, "cov_position", rbs.cov_position);
+    fields.add(prefix, "orientation", rbs.orientation);
+    fields.add(prefix, "cov_orientation", rbs.cov_orientation);
+    fields.add(prefix, "velocity", rbs.velocity);
+    fields.add(prefix, "cov_velocity", rbs.cov_velocity);
+    fields.add(prefix, "angular_velocity", rbs.angular_velocity);
+}
+
+static void addOutputs(Fields& fields, Driver const& driver)
+{
+    addRigidBodyState(fields, "world", driver.getWorldRigidBodyState());
+    addRigidBodyState(fields, "body", driver.getBodyRigidBodyState());
+
+    auto acceleration = driver.getAcceleration();
+    fields.add("acceleration", "time", acceleration.time);
+    fields.add("acceleration", "acceleration", acceleration.acceleration);
+    fields.add("acceleration", "angular_acceleration", acceleration.angular_acceleration);
+
+    auto imu = driver.getIMUSensors();
+    fields.add("imu", "time", imu.time);
+    fields.add("imu", "acc", imu.acc);
+    fields.add("imu", "gyro", imu.gyro);
+    fields.add("imu", "mag", imu.mag);
+
+    auto gnss = driver.getGNSSSolution();
+    fields.add("gnss", "time", gnss.time);
+    fields.add("gnss", "latitude", gnss.latitude);
+    fields.add("gnss", "longitude", gnss.longitude);
+    fields.add("gnss", "altitude", gnss.altitude);
+    fields.add("gnss", "deviation_latitude", gnss.deviationLatitude);
+    fields.add("gnss", "deviation_longitude", gnss.deviationLongitude);
+    fields.add("gnss", "deviation_altitude", gnss.deviationAltitude);
+    fields.add("gnss", "position_type", static_cast<double>(gnss.positionType));
+    fields.add("gnss", "satellites", static_cast<double>(gnss.noOfSatellites));
+
+    auto quality = driver.getGNSSSolutionQuality();
+    fields.add("gnss_quality", "time", quality.time);
+    fields.add("gnss_quality", "hdop", quality.hdop);
+    fields.add("gnss_quality", "vdop", quality.vdop);
+
+    auto satellites = driver.getGNSSSatelliteInfo();
+    fields.add("satellite_info", "time", satellites.time);
+    fields.add("satellite_info", "count", static_cast<double>(satellites.knownSatellites.size()));
+
+    Status status = driver.getIMUStatus();
+    fields.add("status", "time", status.time);
+    fields.add("status", "system_status", static_cast<double>(status.system_status));
+    fields.add("status", "filter_status", static_cast<double>(status.filter_status));
+    fields.add("status", "gnss_solution_status", static_cast<double>(status.gnss_solution_status));
+    fields.add("status", "gnss_extra_status", static_cast<double>(status.gnss_extra_status));
+    fields.add("status", "north_seeking.flags", static_cast<double>(status.north_seeking.flags));
+    static char const* PROGRESS_NAMES[4] = {
+        "north_seeking.progress0", "north_seeking.progress1",
+        "north_seeking.progress2", "north_seeking.progress3"
+    };
+    for (int i = 0; i < 4; ++i)
+        fields.add("status", PROGRESS_NAMES[i], static_cast<double>(status.north_seeking.progress[i]));
+}
+
+vector<string> const& golden::getFieldNames()
+{
+    static const vector<string> names = [] {
+        vector<string> result;
+        Fields fields;
+        fields.names = &result;
+        addOutputs(fields, Driver());
+        return result;
+    }();
+    return names;
+}
+
+static void snapshot(Driver const& driver, int period, Record& record)
+{
+    record.period = period;
+    record.values.clear();
+    Fields fields;
+    fields.values = &record.values;
+    addOutputs(fields, driver);
+}
+
+Record golden::snapshot(Driver const& driver, int period)
+{
+    Record record;
+    ::snapshot(driver, period, record);
+    return record;
+}
+
+uint64_t golden::replay(string const& log_path, function<void(Record const&)> const& callback)
+{
+    Driver driver;
+    driver.setReplayConfiguration(LogReplay::inferPacketPeriods(log_path), true);
+    LogReplay log(driver, log_path);
+
+    Record record;
+    uint64_t count = 0;
+    int result;
+    while (log.next(result))
+    {
+        if (result == 0)
+            continue;
+        ::snapshot(driver, result, record);
+        callback(record);
+        ++count;
+    }
+    return count;
+}
+
+static void writeUInt16(ostream& out, uint16_t value)
+{
+    uint8_t bytes[2];
+    protocol::write16(bytes, value);
+    out.write(reinterpret_cast<char const*>(bytes), sizeof(bytes));
+}
+
+static void writeUInt32(ostream& out, uint32_t value)
+{
+    uint8_t bytes[4];
+    protocol::write32(bytes, value);
+    out.write(reinterpret_cast<char const*>(bytes), sizeof(bytes));
+}
+
+static void writeUInt64(ostream& out, uint64_t value)
+{
+    uint8_t bytes[8];
+    protocol::write64(bytes, value);
+    out.write(reinterpret_cast<char const*>(bytes), sizeof(bytes));
+}
+
+/** Read bytes from a stream
+ *
+ * @return the number of bytes actually read
+ */
+static size_t readBytes(istream& in, uint8_t* bytes, size_t size)
+{
+    in.read(reinterpret_cast<char*>(bytes), size);
+    return in.gcount();
+}
+
+static bool readUInt16(istream& in, uint16_t& value)
+{
+    uint8_t bytes[2];
+    if (readBytes(in, bytes, sizeof(bytes)) != sizeof(bytes))
+        return false;
+    value = protocol::read16<uint16_t>(bytes);
+    return true;
+}
+
+static bool readUInt32(istream& in, uint32_t& value)
+{
+    uint8_t bytes[4];
+    if (readBytes(in, bytes, sizeof(bytes)) != sizeof(bytes))
+        return false;
+    value = protocol::read32<uint32_t>(bytes);
+    return true;
+}
+
+static bool readUInt64(istream& in, uint64_t& value)
+{
+    uint8_t bytes[8];
+    if (readBytes(in, bytes, sizeof(bytes)) != sizeof(bytes))
+        return false;
+    value = protocol::read64<uint64_t>(bytes);
+    return true;
+}
+
+static uint64_t canonicalBits(double value)
+{
+    if (std::isnan(value))
+        return CANONICAL_NAN;
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+Writer::Writer(ostream& out)
+    : mOut(out)
+{
+    auto const& names = golden::getFieldNames();
+    mOut.write(GOLDEN_MAGIC, sizeof(GOLDEN_MAGIC));
+    writeUInt32(mOut, names.size());
+    for (auto const& name : names)
+    {
+        writeUInt16(mOut, name.size());
+        mOut.write(name.data(), name.size());
+    }
+}
+
+void Writer::write(Record const& record)
+{
+    writeUInt32(mOut, static_cast<uint32_t>(record.period));
+    for (double value : record.values)
+        writeUInt64(mOut, canonicalBits(value));
+}
+
+Reader::Reader(istream& in)
+    : mIn(in)
+{
+    char magic[sizeof(GOLDEN_MAGIC)];
+    in.read(magic, sizeof(magic));
+    if (in.gcount() != sizeof(magic) || !equal(magic, magic + sizeof(magic), GOLDEN_MAGIC))
+        throw std::runtime_error("not a golden output file");
+
+    uint32_t field_count;
+    if (!readUInt32(in, field_count))
+        throw std::runtime_error("truncated golden output header");
+    for (uint32_t i = 0; i < field_count; ++i)
+    {
+        uint16_t size;
+        if (!readUInt16(in, size))
+            throw std::runtime_error("truncated golden output header");
+        string name(size, '\0');
+        in.read(&name[0], size);
+        if (in.gcount() != size)
+            throw std::runtime_error("truncated golden output header");
+        mFieldNames.push_back(name);
+    }
+}
+
+vector<string> const& Reader::getFieldNames() const
+{
+    return mFieldNames;
+}
+
+bool Reader::next(Record& record)
+{
+    uint8_t period[4];
+    size_t size = readBytes(mIn, period, sizeof(period));
+    if (size == 0)
+        return false;
+    else if (size != sizeof(period))
+        throw std::runtime_error("truncated golden output record");
+
+    record.period = protocol::read32<int32_t>(period);
+    record.values.resize(mFieldNames.size());
+    for (double& value : record.values)
+    {
+        uint64_t bits;
+        if (!readUInt64(mIn, bits))
+            throw std::runtime_error("truncated golden output record");
+        memcpy(&value, &bits, sizeof(value));
+    }
+    return true;
+}
+
+Comparison::Comparison(double tolerance, size_t max_differences)
+    : mTolerance(tolerance)
+    , mMaxDifferences(max_differences)
+{
+}
+
+bool Comparison::isEqual(double expected, double actual) const
+{
+    if (mTolerance == 0)
+        return canonicalBits(expected) == canonicalBits(actual);
+
+    bool expected_nan = std::isnan(expected);
+    bool actual_nan = std::isnan(actual);
+    if (expected_nan || actual_nan)
+        return expected_nan && actual_nan;
+    else if (expected == actual)
+        return true;
+    else if (std::isinf(expected) || std::isinf(actual))
+        return false;
+
+    double scale = max(1.0, max(fabs(expected), fabs(actual)));
+    return fabs(expected - actual) <= mTolerance * scale;
+}
+
+void Comparison::addDifference(int field, double expected, double actual)
+{
+    ++mDifferingValues;
+    if (mDifferences.size() >= mMaxDifferences)
+        return;
+
+    Difference difference;
+    difference.record = mRecords;
+    difference.field = field;
+    difference.expected = expected;
+    difference.actual = actual;
+    mDifferences.push_back(difference);
+}
+
+void Comparison::add(Record const& expected, Record const& actual)
+{
+    if (expected.values.size() != actual.values.size())
+        throw std::invalid_argument("comparing records with different fields");
+
+    uint64_t differing_values = mDifferingValues;
+    if (expected.period != actual.period)
+        addDifference(-1, expected.period, actual.period);
+    for (size_t i = 0; i < expected.values.size(); ++i)
+    {
+        if (!isEqual(expected.values[i], actual.values[i]))
+            addDifference(i, expected.values[i], actual.values[i]);
+    }
+    if (mDifferingValues != differing_values)
+        ++mDifferingRecords;
+    ++mRecords;
+}
+
+void Comparison::addMissing()
+{
+    ++mMissingRecords;
+}
+
+void Comparison::addExtra()
+{
+    ++mExtraRecords;
+}
+
+bool Comparison::isMatching() const
+{
+    return !mDifferingRecords && !mMissingRecords && !mExtraRecords;
+}
+
+uint64_t Comparison::getRecordCount() const
+{
+    return mRecords;
+}
+
+uint64_t Comparison::getDifferingRecordCount() const
+{
+    return mDifferingRecords;
+}
+
+uint64_t Comparison::getDifferingValueCount() const
+{
+    return mDifferingValues;
+}
+
+uint64_t Comparison::getMissingRecordCount() const
+{
+    return mMissingRecords;
+}
+
+uint64_t Comparison::getExtraRecordCount() const
+{
+    return mExtraRecords;
+}
+
+vector<Difference> const& Comparison::getDifferences() const
+{
+    return mDifferences;
+}
+
+void golden::compare(Reader& expected, Reader& actual, Comparison& comparison)
+{
+    if (expected.getFieldNames() != actual.getFieldNames())
+        throw std::runtime_error("the golden output files do not have the same fields");
+
+    Record expected_record, actual_record;
+    while (true)
+    {
+        bool has_expected = expected.next(expected_record);
+        bool has_actual = actual.next(actual_record);
+        if (has_expected && has_actual)
+            comparison.add(expected_record, actual_record);
+        else if (has_expected)
+            comparison.addMissing();
+        else if (has_actual)
+            comparison.addExtra();
+        else
+            break;
+    }
+}
@@ -0,0 +1,164 @@
+#ifndef ADVANCED_NAVIGATION_ANPP_GOLDEN_OUTPUT_HPP
+#define ADVANCED_NAVIGATION_ANPP_GOLDEN_OUTPUT_HPP
+
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace imu_advanced_navigation_anpp
+{
+    class Driver;
+
+    /** Record and comparison of the driver's outputs over a log
+     *
+     * Each time processing a packet returns a non-zero value (a completed
+     * period, or -1 while resynchronizing with the period train), the
+     * driver's outputs are snapshotted into a Record: the world and body
+     * states, the accelerations, the IMU sensors, the GNSS solution and its
+     * quality, the satellite info and the status. The values are in the
+     * order of getFieldNames(), times being in microseconds.
+     *
+     * A golden file starts with GOLDEN_MAGIC, followed by the number of
+     * fields as a uint32 and the field names, each as a uint16 length and
+     * the characters. Each record is then the period as an int32 followed
+     * by one float64 per field. All values are little-endian, and NaNs are
+     * written as the canonical quiet NaN so that files recorded from the
+     * same outputs are identical.
+     *
+     * Comparing the records of a log with a golden file recorded before a
+     * change of the decoding, framing or UTM code shows whether the change
+     * altered the driver's outputs.
+     */
+    namespace golden
+    {
+        static const char GOLDEN_MAGIC[8] = { 'A', 'N', 'P', 'P', 'G', 'L', 'D', '1' };
+
+        /** Names of the values of a record, in order */
+        std::vector<std::string> const& getFieldNames();
+
+        struct Record
+        {
+            /** Value returned by Driver::processPacket */
+            int32_t period = 0;
+            /** The driver's outputs, in the order of getFieldNames() */
+            std::vector<double> values;
+        };
+
+        /** Snapshot the outputs of a driver */
+        Record snapshot(Driver const& driver, int period);
+
+        /** Replay a log through a driver configured with the packet periods
+         * inferred from the log and the device time, and call the callback
+         * with each record
+         *
+         * @return the number of records
+         */
+        uint64_t replay(std::string const& log_path,
+                        std::function<void(Record const&)> const& callback);
+
+        /** Writes records in the golden file format */
+        class Writer
+        {
+            std::ostream& mOut;
+
+        public:
+            /** Write the file header */
+            explicit Writer(std::ostream& out);
+
+            void write(Record const& record);
+        };
+
+        /** Reads records written by Writer */
+        class Reader
+        {
+            std::istream& mIn;
+            std::vector<std::string> mFieldNames;
+
+        public:
+            /** Read the file header
+             *
+             * @throw std::runtime_error if the stream is not a golden file
+             */
+            explicit Reader(std::istream& in);
+
+            /** The field names stored in the file */
+            std::vector<std::string> const& getFieldNames() const;
+
+            /** Read the next record
+             *
+             * @return false at the end of the file
+             * @throw std::runtime_error if the file is truncated
+             */
+            bool next(Record& record);
+        };
+
+        /** A value that differs between two records */
+        struct Difference
+        {
+            /** Index of the record in the files */
+            uint64_t record = 0;
+            /** Index of the field in getFieldNames(), -1 for the period */
+            int field = -1;
+            double expected = 0;
+            double actual = 0;
+        };
+
+        /** Accumulated comparison of two sequences of records */
+        class Comparison
+        {
+            double mTolerance;
+            size_t mMaxDifferences;
+            uint64_t mRecords = 0;
+            uint64_t mDifferingRecords = 0;
+            uint64_t mDifferingValues = 0;
+            uint64_t mMissingRecords = 0;
+            uint64_t mExtraRecords = 0;
+            std::vector<Difference> mDifferences;
+
+            void addDifference(int field, double expected, double actual);
+
+        public:
+            /**
+             * @param tolerance zero to require bit-exact values. Otherwise,
+             *   two values are equal if they differ by at most the tolerance
+             *   times the largest of 1 and their magnitudes, i.e. the
+             *   tolerance is absolute for small values and relative for
+             *   large ones. NaNs are equal to NaNs in both cases
+             * @param max_differences the maximum number of differences kept
+             *   by getDifferences(). They are all counted regardless
+             */
+            explicit Comparison(double tolerance = 0, size_t max_differences = 100);
+
+            bool isEqual(double expected, double actual) const;
+
+            /** Compare two records that are at the same index */
+            void add(Record const& expected, Record const& actual);
+            /** Count a record that is in the golden file only */
+            void addMissing();
+            /** Count a record that is not in the golden file */
+            void addExtra();
+
+            /** Whether all records matched */
+            bool isMatching() const;
+
+            uint64_t getRecordCount() const;
+            uint64_t getDifferingRecordCount() const;
+            uint64_t getDifferingValueCount() const;
+            uint64_t getMissingRecordCount() const;
+            uint64_t getExtraRecordCount() const;
+
+            /** The first differences */
+            std::vector<Difference> const& getDifferences() const;
+        };
+
+        /** Compare the records of two golden files
+         *
+         * @throw std::runtime_error if the files do not have the same fields
+         */
+        void compare(Reader& expected, Reader& actual, Comparison& comparison);
+    }
+}
+
+#endif
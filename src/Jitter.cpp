@@ -0,0 +1,34 @@
+#include <imu_advanced_navigation_anpp/Jitter.hpp>
+#include <cmath>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+
+constexpr double IntervalStatistics::OUTLIER_FRACTION;
+
+void IntervalStatistics::add(double interval, double expected)
+{
+    if (count == 0 || interval < min)
+        min = interval;
+    if (count == 0 || interval > max)
+        max = interval;
+    if (abs(interval - expected) > OUTLIER_FRACTION * expected)
+        outliers++;
+
+    count++;
+    double delta = interval - mean;
+    mean += delta / count;
+    m2 += delta * (interval - mean);
+}
+
+double IntervalStatistics::getVariance() const
+{
+    if (count < 2)
+        return 0;
+    return m2 / (count - 1);
+}
+
+double IntervalStatistics::getStandardDeviation() const
+{
+    return sqrt(getVariance());
+}
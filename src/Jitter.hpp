@@ -0,0 +1,79 @@
+#ifndef ADVANCED_NAVIGATION_ANPP_JITTER_HPP
+#define ADVANCED_NAVIGATION_ANPP_JITTER_HPP
+
+#include <base/Time.hpp>
+#include <cstdint>
+
+namespace imu_advanced_navigation_anpp
+{
+    /** Running statistics of the intervals between two packets of the same
+     * ID, in seconds
+     *
+     * The mean and variance are updated with Welford's algorithm, so that
+     * they stay accurate over long runs without storing the intervals
+     */
+    struct IntervalStatistics
+    {
+        /** Intervals deviating from the expected interval by more than this
+         * fraction of it are counted as outliers
+         */
+        static constexpr double OUTLIER_FRACTION = 0.25;
+
+        uint64_t count = 0;
+        double mean = 0;
+        /** Sum of the squared differences to the mean */
+        double m2 = 0;
+        double min = 0;
+        double max = 0;
+        /** Intervals that deviated from the expected one by more than
+         * OUTLIER_FRACTION
+         *
+         * PacketJitter also counts here the times the clock went backwards
+         * between two packets. These intervals are not added to the
+         * statistics
+         */
+        uint64_t outliers = 0;
+
+        /** Add an interval
+         *
+         * @param interval the measured interval
+         * @param expected the interval expected from the configuration
+         */
+        void add(double interval, double expected);
+
+        double getVariance() const;
+        double getStandardDeviation() const;
+    };
+
+    /** Inter-arrival analysis of the packets of one ID
+     *
+     * Intervals are measured both on the host clock, when the driver
+     * processes the packets, and on the device clock, from the UnixTime
+     * packet that starts their train. The device intervals are therefore
+     * only available when the driver uses the device time.
+     *
+     * The missed and doubled packets are detected on the device time if it
+     * is available, on the host time otherwise. Only the intervals that
+     * match one expected period are added to the interval statistics.
+     */
+    struct PacketJitter
+    {
+        /** Packet timer period times the packet's configured period. Zero
+         * if the packet is not periodic
+         */
+        base::Time expected_interval;
+        IntervalStatistics host;
+        IntervalStatistics device;
+        /** Packets that should have been received between two consecutive
+         * packets, i.e. intervals of N expected periods count N-1 missed
+         * packets
+         */
+        uint64_t missed = 0;
+        /** Packets received less than half of an expected period after the
+         * previous one
+         */
+        uint64_t doubled = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,153 @@
+#include <imu_advanced_navigation_anpp/LatencyHistogram.hpp>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+
+const int LatencyHistogram::SUB_BUCKET_BITS;
+const int LatencyHistogram::SUB_BUCKET_COUNT;
+const int LatencyHistogram::MAX_VALUE_BITS;
+const int64_t LatencyHistogram::MAX_VALUE;
+const int LatencyHistogram::BUCKET_COUNT;
+
+LatencyHistogram::LatencyHistogram()
+{
+    fill_n(mBuckets, BUCKET_COUNT, 0);
+}
+
+int64_t LatencyHistogram::getBucketLowerBound(int index)
+{
+    if (index < SUB_BUCKET_COUNT)
+        return index;
+
+    int exponent = index / SUB_BUCKET_COUNT - 1;
+    int64_t sub_bucket = index % SUB_BUCKET_COUNT + SUB_BUCKET_COUNT;
+    return sub_bucket << exponent;
+}
+
+int64_t LatencyHistogram::getBucketUpperBound(int index)
+{
+    if (index + 1 == BUCKET_COUNT)
+        return MAX_VALUE;
+    return getBucketLowerBound(index + 1) - 1;
+}
+
+void LatencyHistogram::merge(LatencyHistogram const& other)
+{
+    if (other.mCount == 0)
+        return;
+
+    for (int i = 0; i < BUCKET_COUNT; ++i)
+        mBuckets[i] += other.mBuckets[i];
+    if (mCount == 0 || other.mMin < mMin)
+        mMin = other.mMin;
+    mMax = max(mMax, other.mMax);
+    mSum += other.mSum;
+    mCount += other.mCount;
+}
+
+void LatencyHistogram::reset()
+{
+    *this = LatencyHistogram();
+}
+
+uint64_t LatencyHistogram::getCount() const
+{
+    return mCount;
+}
+
+uint64_t LatencyHistogram::getBucketCount(int index) const
+{
+    return mBuckets[index];
+}
+
+int64_t LatencyHistogram::getMin() const
+{
+    return mMin;
+}
+
+int64_t LatencyHistogram::getMax() const
+{
+    return mMax;
+}
+
+double LatencyHistogram::getMean() const
+{
+    return mCount ? mSum / mCount : 0;
+}
+
+int64_t LatencyHistogram::getPercentile(double fraction) const
+{
+    if (mCount == 0)
+        return 0;
+
+    uint64_t rank = max<uint64_t>(1, ceil(fraction * mCount));
+    uint64_t cumulated = 0;
+    for (int i = 0; i < BUCKET_COUNT; ++i)
+    {
+        cumulated += mBuckets[i];
+        if (cumulated >= rank)
+            return min(getBucketUpperBound(i), mMax);
+    }
+    return mMax;
+}
+
+LatencyHistograms::LatencyHistograms()
+{
+    for (auto& stage : mStages)
+        stage.resize(256);
+}
+
+void LatencyHistograms::allocate(uint8_t packet_id)
+{
+    for (auto& stage : mStages)
+    {
+        if (!stage[packet_id])
+            stage[packet_id].reset(new LatencyHistogram);
+    }
+}
+
+LatencyHistogram const* LatencyHistograms::get(LATENCY_STAGES stage, uint8_t packet_id) const
+{
+    LatencyHistogram const* histogram = mStages[stage][packet_id].get();
+    if (histogram && histogram->getCount() == 0)
+        return nullptr;
+    return histogram;
+}
+
+LatencyHistogram const& LatencyHistograms::getMerged(LATENCY_STAGES stage) const
+{
+    return mMerged[stage];
+}
+
+vector<uint8_t> LatencyHistograms::getPacketIDs(LATENCY_STAGES stage) const
+{
+    vector<uint8_t> result;
+    for (size_t id = 0; id < mStages[stage].size(); ++id)
+    {
+        if (get(stage, id))
+            result.push_back(id);
+    }
+    return result;
+}
+
+LatencyHistogram const& LatencyHistograms::getTrains() const
+{
+    return mTrains;
+}
+
+void LatencyHistograms::reset()
+{
+    for (auto& stage : mStages)
+    {
+        for (auto& histogram : stage)
+        {
+            if (histogram)
+                histogram->reset();
+        }
+    }
+    for (auto& merged : mMerged)
+        merged.reset();
+    mTrains.reset();
+}
@@ -0,0 +1,188 @@
+#ifndef ADVANCED_NAVIGATION_ANPP_LATENCY_HISTOGRAM_HPP
+#define ADVANCED_NAVIGATION_ANPP_LATENCY_HISTOGRAM_HPP
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+namespace imu_advanced_navigation_anpp
+{
+    /** Histogram of latencies with a bounded relative error
+     *
+     * The buckets are log-linear, as in HDR histograms: each power of two
+     * is split into 16 buckets of equal width, which bounds the relative
+     * error of a value to 1/16. Values under 16ns get one bucket each.
+     * Latencies are in nanoseconds, negative values are counted as zero
+     * and values above MAX_VALUE (about 68s) as MAX_VALUE.
+     *
+     * The storage is fixed, so that record() does not allocate and costs
+     * one bit scan and one increment.
+     */
+    class LatencyHistogram
+    {
+    public:
+        static const int SUB_BUCKET_BITS = 4;
+        static const int SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+        static const int MAX_VALUE_BITS = 36;
+        static const int64_t MAX_VALUE = (int64_t(1) << MAX_VALUE_BITS) - 1;
+        static const int BUCKET_COUNT =
+            (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+    private:
+        uint64_t mBuckets[BUCKET_COUNT];
+        uint64_t mCount = 0;
+        int64_t mMin = 0;
+        int64_t mMax = 0;
+        /** Sum of the recorded values, for the mean */
+        double mSum = 0;
+
+    public:
+        LatencyHistogram();
+
+        /** Index of the bucket of a value */
+        static int getBucketIndex(int64_t value);
+
+        /** Smallest value counted in a bucket */
+        static int64_t getBucketLowerBound(int index);
+
+        /** Largest value counted in a bucket */
+        static int64_t getBucketUpperBound(int index);
+
+        /** Record a latency, in nanoseconds */
+        void record(int64_t value)
+        {
+            if (value < 0)
+                value = 0;
+            else if (value > MAX_VALUE)
+                value = MAX_VALUE;
+
+            mBuckets[getBucketIndex(value)]++;
+            if (mCount == 0 || value < mMin)
+                mMin = value;
+            if (value > mMax)
+                mMax = value;
+            mSum += value;
+            mCount++;
+        }
+
+        /** Add the counts of another histogram to this one */
+        void merge(LatencyHistogram const& other);
+
+        void reset();
+
+        uint64_t getCount() const;
+
+        /** Number of values recorded in the given bucket */
+        uint64_t getBucketCount(int index) const;
+
+        /** Smallest recorded value, exact */
+        int64_t getMin() const;
+
+        /** Largest recorded value, exact */
+        int64_t getMax() const;
+
+        double getMean() const;
+
+        /** Value under which the given fraction of the recorded values lie
+         *
+         * The result is the upper bound of the bucket that contains the
+         * percentile, capped by getMax(). It is therefore never lower
+         * than the true percentile.
+         *
+         * @param fraction the percentile, between 0 and 1
+         * @return the percentile, 0 if the histogram is empty
+         */
+        int64_t getPercentile(double fraction) const;
+    };
+
+    inline int LatencyHistogram::getBucketIndex(int64_t value)
+    {
+        if (value < SUB_BUCKET_COUNT)
+            return value;
+
+        int msb = 63 - __builtin_clzll(value);
+        int exponent = msb - SUB_BUCKET_BITS;
+        return (exponent + 1) * SUB_BUCKET_COUNT +
+            static_cast<int>((value >> exponent) - SUB_BUCKET_COUNT);
+    }
+
+    /** The pipeline stages timed by Driver's latency histograms */
+    enum LATENCY_STAGES
+    {
+        /** From the read that completed a packet to its framing
+         *
+         * iodrivers_base does not report when it reads, but it tries to
+         * frame packets right after each read. The read time is therefore
+         * taken as the first framing attempt that sees new bytes
+         */
+        LATENCY_READ_TO_FRAMED,
+        /** From the framing of a packet to the end of its decoding */
+        LATENCY_FRAMED_TO_DECODED,
+        /** From the decoding of a packet to the completion of its period,
+         * that is the poll() call that reports the updated samples
+         */
+        LATENCY_DECODED_TO_PUBLISHED,
+        LATENCY_STAGE_COUNT
+    };
+
+    /** The latency histograms of the pipeline stages, by packet ID, and
+     * of the packet trains
+     *
+     * The histograms of a packet ID are allocated by allocate(), so that
+     * record() never allocates. The latencies of the packet IDs that have
+     * not been allocated are only counted in the histogram of all packet
+     * IDs of the stage, which record() updates so that getMerged() is a
+     * plain accessor
+     */
+    class LatencyHistograms
+    {
+        std::vector<std::unique_ptr<LatencyHistogram>> mStages[LATENCY_STAGE_COUNT];
+        LatencyHistogram mMerged[LATENCY_STAGE_COUNT];
+        LatencyHistogram mTrains;
+
+    public:
+        LatencyHistograms();
+
+        /** Allocate the histograms of all stages for a packet ID
+         *
+         * Does nothing if they are already allocated
+         */
+        void allocate(uint8_t packet_id);
+
+        void record(LATENCY_STAGES stage, uint8_t packet_id, int64_t value)
+        {
+            if (LatencyHistogram* histogram = mStages[stage][packet_id].get())
+                histogram->record(value);
+            mMerged[stage].record(value);
+        }
+
+        /** Record the time from the framing of the first packet of a train
+         * to the decoding of its last packet
+         */
+        void recordTrain(int64_t value)
+        {
+            mTrains.record(value);
+        }
+
+        /** The histogram of a stage for a packet ID
+         *
+         * @return the histogram, or null if nothing has been recorded for
+         *   this packet ID since the last reset()
+         */
+        LatencyHistogram const* get(LATENCY_STAGES stage, uint8_t packet_id) const;
+
+        /** The histogram of a stage, all packet IDs merged */
+        LatencyHistogram const& getMerged(LATENCY_STAGES stage) const;
+
+        /** The IDs of the packets for which a stage has latencies */
+        std::vector<uint8_t> getPacketIDs(LATENCY_STAGES stage) const;
+
+        /** The train start to train completion latencies */
+        LatencyHistogram const& getTrains() const;
+
+        /** Clear all histograms, keeping the allocated ones */
+        void reset();
+    };
+}
+
+#endif
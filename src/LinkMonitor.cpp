@@ -0,0 +1,76 @@
+#include <imu_advanced_navigation_anpp/LinkMonitor.hpp>
+#include <imu_advanced_navigation_anpp/Protocol.hpp>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+using protocol::Header;
+
+LinkMonitor::LinkMonitor()
+    : iodrivers_base::Driver(protocol::DRIVER_BUFFER_SIZE)
+{
+    setReadTimeout(base::Time::fromSeconds(1));
+    mStatistics.packets.resize(protocol::PACKET_ID_COUNT);
+}
+
+int LinkMonitor::extractPacket(uint8_t const* buffer, size_t buffer_size) const
+{
+    int result = protocol::extractPacket(buffer, buffer_size);
+    mStatistics.update(buffer, result);
+    return result;
+}
+
+void LinkMonitor::requestStatus()
+{
+    uint8_t marshalled[protocol::MAX_PACKET_SIZE];
+    uint8_t* marshalled_end = protocol::Request().marshal(
+        marshalled + Header::SIZE, protocol::Status::ID);
+    new(marshalled) Header(protocol::Request::ID, marshalled + Header::SIZE, marshalled_end);
+    writePacket(marshalled, marshalled_end - marshalled);
+}
+
+uint8_t LinkMonitor::poll()
+{
+    uint8_t packet[MAX_PACKET_SIZE];
+    size_t packet_size = readPacket(packet, MAX_PACKET_SIZE);
+    process(packet, packet_size, base::Time::now());
+    return packet[1];
+}
+
+void LinkMonitor::process(uint8_t const* packet, size_t packet_size, base::Time const& time)
+{
+    uint8_t packet_id = packet[1];
+    PacketStatistics& stats = mStatistics.packets[packet_id];
+    stats.count++;
+    stats.bytes += packet_size;
+    if (!stats.last.isNull())
+        stats.intervals.push_back((time - stats.last).toMicroseconds());
+    stats.last = time;
+    mStatistics.good_bytes += packet_size;
+
+    if (packet_id == protocol::Status::ID)
+    {
+        try
+        {
+            auto status = protocol::Status::unmarshal(packet + Header::SIZE, packet + packet_size);
+            mStatistics.has_status = true;
+            mStatistics.system_status = status.system_status;
+        }
+        catch(std::length_error const&) {}
+    }
+}
+
+LinkMonitor::Statistics const& LinkMonitor::getStatistics() const
+{
+    return mStatistics;
+}
+
+void LinkMonitor::resetStatistics()
+{
+    Statistics reset;
+    reset.has_status = mStatistics.has_status;
+    reset.system_status = mStatistics.system_status;
+    reset.packets.resize(protocol::PACKET_ID_COUNT);
+    for (int i = 0; i < protocol::PACKET_ID_COUNT; ++i)
+        reset.packets[i].last = mStatistics.packets[i].last;
+    mStatistics = reset;
+}
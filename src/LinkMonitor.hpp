@@ -0,0 +1,82 @@
+#ifndef ADVANCED_NAVIGATION_ANPP_LINK_MONITOR_HPP
+#define ADVANCED_NAVIGATION_ANPP_LINK_MONITOR_HPP
+
+#include <vector>
+#include <iodrivers_base/Driver.hpp>
+#include <imu_advanced_navigation_anpp/Protocol.hpp>
+
+namespace imu_advanced_navigation_anpp
+{
+    /** Link-level monitoring of an ANPP stream
+     *
+     * Unlike Driver, this does not configure the device in any way: opening
+     * the URI does not write anything, which makes it usable on a link
+     * that is already being configured and used by another process (e.g.
+     * on a tee'd serial line). The only packet it can send is the Status
+     * request from requestStatus().
+     */
+    class LinkMonitor : public iodrivers_base::Driver
+    {
+    public:
+        /** Statistics for one packet ID */
+        struct PacketStatistics
+        {
+            uint64_t count = 0;
+            /** Received bytes, headers included */
+            uint64_t bytes = 0;
+            /** Time of reception of the last packet */
+            base::Time last;
+            /** Time between two consecutive packets, in microseconds */
+            std::vector<int64_t> intervals;
+        };
+
+        struct Statistics : protocol::FramingStatistics
+        {
+            /** Bytes that were part of a valid packet */
+            uint64_t good_bytes = 0;
+            /** Whether at least one Status packet has been received */
+            bool has_status = false;
+            /** Bitfield of SYSTEM_STATUS from the last Status packet */
+            uint16_t system_status = 0;
+            /** Per packet ID statistics, indexed by packet ID */
+            std::vector<PacketStatistics> packets;
+        };
+
+    private:
+        mutable Statistics mStatistics;
+
+        int extractPacket(uint8_t const* buffer, size_t buffer_size) const;
+
+    public:
+        LinkMonitor();
+
+        /** Ask the device for a Status packet
+         *
+         * The Status packet is received asynchronously by poll()
+         */
+        void requestStatus();
+
+        /** Read and account for the next packet
+         *
+         * @return the ID of the packet that has been read
+         */
+        uint8_t poll();
+
+        /** Account for a packet received at the given time
+         *
+         * This is what poll() does after it read a packet
+         */
+        void process(uint8_t const* packet, size_t packet_size, base::Time const& time);
+
+        Statistics const& getStatistics() const;
+
+        /** Reset the statistics
+         *
+         * The time of the last packet of each ID is kept, so that the first
+         * intervals after the reset are still valid
+         */
+        void resetStatistics();
+    };
+}
+
+#endif
@@ -0,0 +1,77 @@
+#include <imu_advanced_navigation_anpp/LogReplay.hpp>
+#include <imu_advanced_navigation_anpp/Driver.hpp>
+#include <imu_advanced_navigation_anpp/Protocol.hpp>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+
+constexpr size_t LogReplay::DEFAULT_INFERENCE_PACKETS;
+
+LogReplay::LogReplay(Driver& driver, string const& path)
+    : mDriver(driver)
+    , mReader(path)
+{
+}
+
+bool LogReplay::next(int& result)
+{
+    size_t size;
+    uint8_t const* packet = mReader.next(size);
+    if (!packet)
+        return false;
+
+    ++mPacketCount;
+    result = mDriver.processPacket(packet, size);
+    return true;
+}
+
+size_t LogReplay::getPacketCount() const
+{
+    return mPacketCount;
+}
+
+size_t LogReplay::getDiscardedBytes() const
+{
+    return mReader.getDiscardedBytes();
+}
+
+/** Count the packets of each ID at the start of a log */
+static void countPackets(string const& path, size_t max_packets,
+                         size_t (&counts)[protocol::PACKET_ID_COUNT])
+{
+    fill(counts, counts + protocol::PACKET_ID_COUNT, 0);
+    CaptureStreamReader reader(path);
+    size_t size;
+    for (size_t i = 0; i < max_packets; ++i)
+    {
+        uint8_t const* packet = reader.next(size);
+        if (!packet)
+            break;
+        counts[packet[1]]++;
+    }
+}
+
+map<uint8_t, uint32_t> LogReplay::inferPacketPeriods(string const& path, size_t max_packets)
+{
+    size_t counts[protocol::PACKET_ID_COUNT];
+    countPackets(path, max_packets, counts);
+    counts[protocol::UnixTime::ID] = 0;
+
+    size_t max_count = *max_element(counts, counts + protocol::PACKET_ID_COUNT);
+    map<uint8_t, uint32_t> periods;
+    for (int id = 0; id < protocol::PACKET_ID_COUNT; ++id)
+    {
+        if (counts[id])
+            periods[id] = max<uint32_t>(1, lround(static_cast<double>(max_count) / counts[id]));
+    }
+    return periods;
+}
+
+bool LogReplay::hasDeviceTime(string const& path, size_t max_packets)
+{
+    size_t counts[protocol::PACKET_ID_COUNT];
+    countPackets(path, max_packets, counts);
+    return counts[protocol::UnixTime::ID] != 0;
+}
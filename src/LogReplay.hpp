@@ -0,0 +1,81 @@
+#ifndef ADVANCED_NAVIGATION_ANPP_LOG_REPLAY_HPP
+#define ADVANCED_NAVIGATION_ANPP_LOG_REPLAY_HPP
+
+#include <map>
+#include <string>
+#include <imu_advanced_navigation_anpp/CaptureStreamReader.hpp>
+
+namespace imu_advanced_navigation_anpp
+{
+    class Driver;
+
+    /** Feeds the packets of a raw ANPP log to a Driver
+     *
+     * This is meant to decode the logs generated by Advanced Navigation's
+     * own tools, or captures made by this package, with the same results
+     * than if the packets were read by Driver::poll(). The file is read
+     * sequentially with a fixed-size buffer, and no I/O timeouts are
+     * involved.
+     *
+     * The driver must be configured with Driver::setReplayConfiguration()
+     * beforehand. Use inferPacketPeriods() if the periods the log has been
+     * recorded with are not known.
+     */
+    class LogReplay
+    {
+    public:
+        /** Default number of packets used by inferPacketPeriods() */
+        static constexpr size_t DEFAULT_INFERENCE_PACKETS = 10000;
+
+    private:
+        Driver& mDriver;
+        CaptureStreamReader mReader;
+        size_t mPacketCount = 0;
+
+    public:
+        /** Open the given log
+         *
+         * @throw iodrivers_base::UnixError if the file cannot be opened
+         */
+        LogReplay(Driver& driver, std::string const& path);
+
+        /** Process the next packet in the log
+         *
+         * @param result set to the value that Driver::poll() would have
+         *   returned for this packet
+         * @return false at the end of the log
+         */
+        bool next(int& result);
+
+        /** The number of packets processed so far */
+        size_t getPacketCount() const;
+
+        /** The number of bytes skipped so far because they were not part of
+         * a valid packet */
+        size_t getDiscardedBytes() const;
+
+        /** Guess the packet periods from the start of a log
+         *
+         * The periods are relative to the most frequent packet, which is
+         * given a period of 1. UnixTime is not included, as it is managed
+         * by Driver::setReplayConfiguration()
+         *
+         * @param max_packets the number of packets to look at
+         */
+        static std::map<uint8_t, uint32_t> inferPacketPeriods(
+            std::string const& path, size_t max_packets = DEFAULT_INFERENCE_PACKETS);
+
+        /** Whether the start of a log contains UnixTime packets
+         *
+         * Logs recorded without UnixTime must be replayed without device
+         * time (see Driver::setUseDeviceTime()), as the driver otherwise
+         * never timestamps the samples and outputs nothing.
+         *
+         * @param max_packets the number of packets to look at
+         */
+        static bool hasDeviceTime(
+            std::string const& path, size_t max_packets = DEFAULT_INFERENCE_PACKETS);
+    };
+}
+
+#endif
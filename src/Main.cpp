@@ -1,6 +1,28 @@
 #include <iostream>
 #include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <cerrno>
 #include <imu_advanced_navigation_anpp/Driver.hpp>
+#include <imu_advanced_navigation_anpp/Protocol.hpp>
+#include <imu_advanced_navigation_anpp/CaptureReader.hpp>
+#include <imu_advanced_navigation_anpp/LogReplay.hpp>
+#include <imu_advanced_navigation_anpp/LinkMonitor.hpp>
+#include <imu_advanced_navigation_anpp/Discovery.hpp>
+#include <imu_advanced_navigation_anpp/MetricsExporter.hpp>
+#include <imu_advanced_navigation_anpp/AllocationCounter.hpp>
+#include <algorithm>
+#include <unistd.h>
+#include <poll.h>
+#include <fcntl.h>
 
 using namespace std;
 using namespace imu_advanced_navigation_anpp;
@@ -96,19 +118,1226 @@ string enumToString(MAGNETIC_CALIBRATION_STATUS status)
     }
 }
 
+/** Outputs that can be enabled by the stream command */
+enum STREAM_OUTPUTS
+{
+    STREAM_STATUS,
+    STREAM_POSITION,
+    STREAM_ORIENTATION,
+    STREAM_VELOCITY,
+    STREAM_ACCELERATION,
+    STREAM_BODY_VELOCITY,
+    STREAM_ANGULAR_VELOCITY,
+    STREAM_ANGULAR_ACCELERATION,
+    STREAM_RAW_SENSORS,
+    STREAM_GNSS,
+    STREAM_SATELLITES,
+    STREAM_NORTH_SEEKING,
+    STREAM_OUTPUT_COUNT
+};
+
+struct StreamOutput
+{
+    char const* name;
+    std::vector<uint8_t> packet_ids;
+};
+
+static const StreamOutput STREAM_OUTPUT_DEFINITIONS[STREAM_OUTPUT_COUNT] = {
+    { "status", { protocol::Status::ID } },
+    { "position", { protocol::GeodeticPosition::ID, protocol::GeodeticPositionStandardDeviation::ID } },
+    { "orientation", { protocol::QuaternionOrientation::ID, protocol::EulerOrientationStandardDeviation::ID } },
+    { "velocity", { protocol::NEDVelocity::ID, protocol::NEDVelocityStandardDeviation::ID } },
+    { "acceleration", { protocol::BodyAcceleration::ID } },
+    { "body-velocity", { protocol::BodyVelocity::ID } },
+    { "angular-velocity", { protocol::AngularVelocity::ID } },
+    { "angular-acceleration", { protocol::AngularAcceleration::ID } },
+    { "raw-sensors", { protocol::RawSensors::ID } },
+    { "gnss", { protocol::RawGNSS::ID } },
+    { "satellites", { protocol::Satellites::ID } },
+    { "north-seeking", { protocol::NorthSeekingInitializationStatus::ID } }
+};
+
+enum STREAM_FORMATS
+{
+    STREAM_FORMAT_TEXT,
+    STREAM_FORMAT_NDJSON,
+    STREAM_FORMAT_BINARY
+};
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void handleInterrupt(int)
+{
+    interrupted = 1;
+}
+
+static void installInterruptHandler()
+{
+    // No SA_RESTART, so that a blocked read is interrupted on Ctrl+C
+    struct sigaction action = {};
+    action.sa_handler = handleInterrupt;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+}
+
+static void writeStreamValues(FILE* out, STREAM_FORMATS format,
+                              char const* name, double const* values, int count)
+{
+    if (format == STREAM_FORMAT_NDJSON)
+    {
+        fprintf(out, ",\"%s\":[", name);
+        for (int i = 0; i < count; ++i)
+        {
+            char const* separator = (i == 0) ? "" : ",";
+            if (std::isnan(values[i]))
+                fprintf(out, "%snull", separator);
+            else
+                fprintf(out, "%s%.9g", separator, values[i]);
+        }
+        fputc(']', out);
+    }
+    else
+    {
+        fprintf(out, " %s=", name);
+        for (int i = 0; i < count; ++i)
+            fprintf(out, (i == 0) ? "%.9g" : ",%.9g", values[i]);
+    }
+}
+
+static void copyVector(double* out, base::Vector3d const& v)
+{
+    out[0] = v.x();
+    out[1] = v.y();
+    out[2] = v.z();
+}
+
+static void writeStreamOutput(FILE* out, STREAM_FORMATS format,
+                              Driver const& driver, int output)
+{
+    double v[9];
+    char const* name = STREAM_OUTPUT_DEFINITIONS[output].name;
+    switch(output)
+    {
+        case STREAM_STATUS:
+        {
+            Status status = driver.getIMUStatus();
+            v[0] = status.system_status;
+            v[1] = status.filter_status;
+            return writeStreamValues(out, format, name, v, 2);
+        }
+        case STREAM_POSITION:
+        {
+            auto rbs = driver.getWorldRigidBodyState();
+            copyVector(v, rbs.position);
+            return writeStreamValues(out, format, name, v, 3);
+        }
+        case STREAM_ORIENTATION:
+        {
+            auto rbs = driver.getWorldRigidBodyState();
+            v[0] = rbs.orientation.w();
+            v[1] = rbs.orientation.x();
+            v[2] = rbs.orientation.y();
+            v[3] = rbs.orientation.z();
+            return writeStreamValues(out, format, name, v, 4);
+        }
+        case STREAM_VELOCITY:
+        {
+            copyVector(v, driver.getWorldRigidBodyState().velocity);
+            return writeStreamValues(out, format, name, v, 3);
+        }
+        case STREAM_ACCELERATION:
+        {
+            copyVector(v, driver.getAcceleration().acceleration);
+            return writeStreamValues(out, format, name, v, 3);
+        }
+        case STREAM_BODY_VELOCITY:
+        {
+            copyVector(v, driver.getBodyRigidBodyState().velocity);
+            return writeStreamValues(out, format, name, v, 3);
+        }
+        case STREAM_ANGULAR_VELOCITY:
+        {
+            copyVector(v, driver.getBodyRigidBodyState().angular_velocity);
+            return writeStreamValues(out, format, name, v, 3);
+        }
+        case STREAM_ANGULAR_ACCELERATION:
+        {
+            copyVector(v, driver.getAcceleration().angular_acceleration);
+            return writeStreamValues(out, format, name, v, 3);
+        }
+        case STREAM_RAW_SENSORS:
+        {
+            auto sensors = driver.getIMUSensors();
+            copyVector(v, sensors.acc);
+            copyVector(v + 3, sensors.gyro);
+            copyVector(v + 6, sensors.mag);
+            return writeStreamValues(out, format, name, v, 9);
+        }
+        case STREAM_GNSS:
+        {
+            auto solution = driver.getGNSSSolution();
+            v[0] = solution.latitude;
+            v[1] = solution.longitude;
+            v[2] = solution.altitude;
+            v[3] = solution.positionType;
+            return writeStreamValues(out, format, name, v, 4);
+        }
+        case STREAM_SATELLITES:
+        {
+            auto quality = driver.getGNSSSolutionQuality();
+            v[0] = driver.getGNSSSolution().noOfSatellites;
+            v[1] = quality.hdop;
+            v[2] = quality.vdop;
+            return writeStreamValues(out, format, name, v, 3);
+        }
+        case STREAM_NORTH_SEEKING:
+        {
+            auto const& status = driver.getIMUStatus().north_seeking;
+            v[0] = status.flags;
+            for (int i = 0; i < 4; ++i)
+                v[1 + i] = status.progress[i];
+            return writeStreamValues(out, format, name, v, 5);
+        }
+    }
+}
+
+/** Parse a OUTPUT=PERIOD argument
+ *
+ * @return false if the argument is not a valid output
+ */
+static bool parseStreamOutput(string const& arg,
+                              uint32_t* output_periods,
+                              map<uint8_t, uint32_t>& packet_periods)
+{
+    size_t equal = arg.find('=');
+    string name = arg.substr(0, equal);
+    int output = 0;
+    for (; output < STREAM_OUTPUT_COUNT; ++output)
+    {
+        if (name == STREAM_OUTPUT_DEFINITIONS[output].name)
+            break;
+    }
+    if (equal == string::npos || output == STREAM_OUTPUT_COUNT)
+        return false;
+
+    uint32_t period = stoi(arg.substr(equal + 1));
+    output_periods[output] = period;
+    for (uint8_t id : STREAM_OUTPUT_DEFINITIONS[output].packet_ids)
+        packet_periods[id] = period;
+    return true;
+}
+
+static int stream(Driver& driver, string const& uri, int argc, char** argv)
+{
+    STREAM_FORMATS format = STREAM_FORMAT_TEXT;
+    bool use_device_time = false;
+    uint32_t output_periods[STREAM_OUTPUT_COUNT] = { 0 };
+    map<uint8_t, uint32_t> packet_periods;
+    string metrics_shm, metrics_file;
+    base::Time metrics_interval = base::Time::fromSeconds(1);
+
+    for (int i = 0; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg.find("--metrics-shm=") == 0)
+            metrics_shm = arg.substr(14);
+        else if (arg.find("--metrics-file=") == 0)
+            metrics_file = arg.substr(15);
+        else if (arg.find("--metrics-interval=") == 0)
+            metrics_interval = base::Time::fromSeconds(stod(arg.substr(19)));
+        else if (arg == "--format=text")
+            format = STREAM_FORMAT_TEXT;
+        else if (arg == "--format=ndjson")
+            format = STREAM_FORMAT_NDJSON;
+        else if (arg == "--format=binary")
+            format = STREAM_FORMAT_BINARY;
+        else if (arg == "--device-time")
+            use_device_time = true;
+        else if (!parseStreamOutput(arg, output_periods, packet_periods))
+        {
+            cerr << "invalid stream argument '" << arg << "'\n";
+            return 1;
+        }
+    }
+    if (packet_periods.empty())
+    {
+        cerr << "no outputs given to the stream command\n";
+        return 1;
+    }
+
+    // Full output rates generate a lot of small lines, make sure they are
+    // not written one by one
+    static char stdout_buffer[1 << 20];
+    setvbuf(stdout, stdout_buffer, _IOFBF, sizeof(stdout_buffer));
+
+    installInterruptHandler();
+
+    driver.openURI(uri);
+    driver.setUseDeviceTime(use_device_time);
+    driver.setPacketPeriods(packet_periods);
+
+    unique_ptr<MetricsExporter> metrics;
+    if (!metrics_shm.empty() || !metrics_file.empty())
+    {
+        metrics.reset(new MetricsExporter(metrics_interval));
+        if (!metrics_shm.empty())
+            metrics->openSharedMemory(metrics_shm);
+        if (!metrics_file.empty())
+            metrics->openTextFile(metrics_file);
+    }
+
+    // iodrivers_base requires the buffer to be as big as the driver's
+    // internal buffer
+    vector<uint8_t> packet(driver.getMaxPacketSize());
+    while (!interrupted)
+    {
+        if (metrics)
+            metrics->update(driver);
+
+        try
+        {
+            if (format == STREAM_FORMAT_BINARY)
+            {
+                size_t packet_size = driver.readPacket(packet.data(), packet.size());
+                fwrite(packet.data(), 1, packet_size, stdout);
+                continue;
+            }
+
+            int period = driver.poll();
+            if (period <= 0)
+                continue;
+
+            int64_t time = driver.getCurrentTimestamp().toMicroseconds();
+            if (format == STREAM_FORMAT_NDJSON)
+                printf("{\"time\":%lld,\"period\":%d", static_cast<long long>(time), period);
+            else
+                printf("%lld %d", static_cast<long long>(time), period);
+
+            for (int output = 0; output < STREAM_OUTPUT_COUNT; ++output)
+            {
+                if (output_periods[output] == static_cast<uint32_t>(period))
+                    writeStreamOutput(stdout, format, driver, output);
+            }
+            fputs((format == STREAM_FORMAT_NDJSON) ? "}\n" : "\n", stdout);
+        }
+        catch(iodrivers_base::TimeoutError const&) {}
+        catch(iodrivers_base::UnixError const&)
+        {
+            if (!interrupted)
+                throw;
+        }
+    }
+    fflush(stdout);
+
+    driver.clearPeriodicPackets();
+    auto status = driver.getStatus();
+    cerr << "received " << status.good_rx << " bytes, "
+        << status.bad_rx << " bytes discarded\n";
+    return 0;
+}
+
+struct BenchResult
+{
+    size_t packets = 0;
+    size_t bytes = 0;
+    size_t discarded = 0;
+    size_t errors = 0;
+    size_t allocations = 0;
+    double seconds = 0;
+};
+
+/** The valid packets of a capture, in the order Driver::poll() returns them */
+struct CapturePackets
+{
+    vector<uint8_t> ids;
+    size_t bytes = 0;
+    size_t discarded = 0;
+};
+
+static CapturePackets scanCapture(CaptureReader const& capture)
+{
+    CapturePackets result;
+    uint8_t const* data = capture.getData();
+    size_t size = capture.getSize();
+    for (size_t offset = 0; offset < size; )
+    {
+        int packet_size = protocol::extractPacket(data + offset, size - offset);
+        if (packet_size == 0)
+        {
+            result.discarded += size - offset;
+            break;
+        }
+        else if (packet_size < 0)
+        {
+            result.discarded += -packet_size;
+            offset += -packet_size;
+            continue;
+        }
+
+        result.ids.push_back(data[offset + 1]);
+        result.bytes += packet_size;
+        offset += packet_size;
+    }
+    return result;
+}
+
+/** Write a whole buffer to a blocking file descriptor */
+static void writeAll(int fd, uint8_t const* data, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw iodrivers_base::UnixError("failed to write the capture to the driver");
+        }
+        data += written;
+        size -= written;
+    }
+}
+
+/** Run a whole capture through Driver::poll(), i.e. reading, framing, CRC
+ * check, unmarshalling, processing and the driver's bookkeeping
+ *
+ * The driver reads from a pipe, to which a separate thread writes the
+ * capture
+ *
+ * @param per_packet if non-null, time each poll() and accumulate the time
+ *   and count per packet ID in this array of protocol::PACKET_ID_COUNT
+ *   elements
+ */
+static BenchResult benchCapture(Driver& driver, int pipe_fd, CaptureReader const& capture,
+                                CapturePackets const& packets,
+                                pair<uint64_t, uint64_t>* per_packet)
+{
+    typedef chrono::steady_clock clock;
+
+    BenchResult result;
+    atomic<bool> written(false);
+    thread writer([pipe_fd, &capture, &written]() {
+        writeAll(pipe_fd, capture.getData(), capture.getSize());
+        written = true;
+    });
+
+    size_t allocations = getAllocationCount();
+    auto start = clock::now();
+    for (uint8_t packet_id : packets.ids)
+    {
+        auto packet_start = per_packet ? clock::now() : clock::time_point();
+        try { driver.poll(); }
+        catch(std::length_error const&) { ++result.errors; }
+        if (per_packet)
+        {
+            auto& stats = per_packet[packet_id];
+            stats.first += chrono::duration_cast<chrono::nanoseconds>(clock::now() - packet_start).count();
+            stats.second++;
+        }
+    }
+    result.seconds = chrono::duration<double>(clock::now() - start).count();
+    result.allocations = getAllocationCount() - allocations;
+
+    // Discard the end of the capture that did not form packets, and the
+    // incomplete packet the driver may hold, so that they neither block the
+    // writer nor corrupt the start of the next run. The read side is
+    // non-blocking
+    int read_fd = driver.getFileDescriptor();
+    uint8_t discarded[4096];
+    while (true)
+    {
+        bool done = written;
+        while (::read(read_fd, discarded, sizeof(discarded)) > 0);
+        if (done)
+            break;
+        this_thread::yield();
+    }
+    writer.join();
+    driver.clear();
+
+    result.packets = packets.ids.size();
+    result.bytes = packets.bytes;
+    result.discarded = packets.discarded;
+    return result;
+}
+
+static int bench(string const& path, int argc, char** argv)
+{
+    int repeat = 10;
+    for (int i = 0; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg.compare(0, 9, "--repeat=") == 0)
+            repeat = max(1, stoi(arg.substr(9)));
+        else
+        {
+            cerr << "invalid bench argument '" << arg << "'\n";
+            return 1;
+        }
+    }
+
+    CaptureReader capture(path);
+    CapturePackets packets = scanCapture(capture);
+
+    int pipe_fds[2];
+    if (pipe(pipe_fds) != 0)
+        throw iodrivers_base::UnixError("cannot create a pipe");
+    fcntl(pipe_fds[0], F_SETFL, fcntl(pipe_fds[0], F_GETFL) | O_NONBLOCK);
+    // Fewer context switches between the writer and the driver. This is
+    // only a hint, the bench works with the default size as well
+    fcntl(pipe_fds[1], F_SETPIPE_SZ, 1 << 20);
+
+    Driver driver;
+    // Driver::openURI would try to configure a device
+    driver.setFileDescriptor(pipe_fds[0]);
+    driver.setReplayConfiguration(LogReplay::inferPacketPeriods(path), false);
+
+    // Warm up the caches and the driver's internal buffers
+    benchCapture(driver, pipe_fds[1], capture, packets, nullptr);
+
+    BenchResult total;
+    for (int i = 0; i < repeat; ++i)
+    {
+        BenchResult run = benchCapture(driver, pipe_fds[1], capture, packets, nullptr);
+        total.packets += run.packets;
+        total.bytes += run.bytes;
+        total.allocations += run.allocations;
+        total.seconds += run.seconds;
+        total.discarded = run.discarded;
+        total.errors = run.errors;
+    }
+
+    pair<uint64_t, uint64_t> per_packet[protocol::PACKET_ID_COUNT] = {};
+    for (int i = 0; i < repeat; ++i)
+        benchCapture(driver, pipe_fds[1], capture, packets, per_packet);
+    driver.close();
+    ::close(pipe_fds[1]);
+
+    printf("capture: %zu bytes, %zu packets, %zu bytes discarded, %zu invalid packets\n",
+           capture.getSize(), total.packets / repeat, total.discarded, total.errors);
+    printf("%d runs: %.0f packets/s, %.2f MB/s, %.1f ns/packet, %.3f allocations/packet\n",
+           repeat, total.packets / total.seconds, total.bytes / total.seconds / 1e6,
+           total.seconds * 1e9 / total.packets,
+           static_cast<double>(total.allocations) / total.packets);
+    printf("\n%4s %10s %12s\n", "ID", "packets", "ns/packet");
+    for (int id = 0; id < protocol::PACKET_ID_COUNT; ++id)
+    {
+        if (per_packet[id].second)
+        {
+            printf("%4d %10llu %12.1f\n", id,
+                   static_cast<unsigned long long>(per_packet[id].second / repeat),
+                   static_cast<double>(per_packet[id].first) / per_packet[id].second);
+        }
+    }
+    printf("(per-packet times include the clock overhead, and the reads of the poll() calls\n"
+           " that refilled the driver's buffer)\n");
+    return 0;
+}
+
+static int64_t percentile(vector<int64_t>& values, double p)
+{
+    auto nth = values.begin() + static_cast<size_t>(p * (values.size() - 1));
+    nth_element(values.begin(), nth, values.end());
+    return *nth;
+}
+
+/** Guess the baud rate from a serial URI, i.e. serial:///dev/ttyUSB0:115200 */
+static int baudrateFromURI(string const& uri)
+{
+    size_t colon = uri.rfind(':');
+    if (colon == string::npos || colon + 1 == uri.size())
+        return 0;
+    string rate = uri.substr(colon + 1);
+    if (rate.find_first_not_of("0123456789") != string::npos)
+        return 0;
+    return stoi(rate);
+}
+
+/** Change or add the baud rate of a serial URI */
+static string setBaudrateInURI(string const& uri, int baudrate)
+{
+    string base = baudrateFromURI(uri) ? uri.substr(0, uri.rfind(':')) : uri;
+    return base + ":" + to_string(baudrate);
+}
+
+static void writeLinkStatistics(LinkMonitor::Statistics& stats, double duration, int baudrate)
+{
+    double rate = stats.good_bytes / duration;
+    printf("link: %.0f B/s", rate);
+    if (baudrate)
+        printf(" (%.1f%% of %d baud)", rate * 10 / baudrate * 100, baudrate);
+    printf(", %llu CRC failures, %llu bytes discarded\n",
+           static_cast<unsigned long long>(stats.crc_failures),
+           static_cast<unsigned long long>(stats.resync_bytes));
+    printf("system status: %s\n",
+           stats.has_status ? systemStateToString(stats.system_status).c_str() : "unknown");
+
+    printf("%4s %9s %9s %9s %9s %9s %9s\n",
+           "ID", "rate/s", "B/s", "p50(us)", "p90(us)", "p99(us)", "max(us)");
+    for (int id = 0; id < protocol::PACKET_ID_COUNT; ++id)
+    {
+        auto& packet = stats.packets[id];
+        if (!packet.count)
+            continue;
+
+        printf("%4d %9.1f %9.0f", id, packet.count / duration, packet.bytes / duration);
+        if (packet.intervals.empty())
+        {
+            printf("\n");
+            continue;
+        }
+        printf(" %9lld %9lld %9lld %9lld\n",
+               static_cast<long long>(percentile(packet.intervals, 0.5)),
+               static_cast<long long>(percentile(packet.intervals, 0.9)),
+               static_cast<long long>(percentile(packet.intervals, 0.99)),
+               static_cast<long long>(*max_element(packet.intervals.begin(), packet.intervals.end())));
+    }
+}
+
+static int stats(string const& uri, int argc, char** argv)
+{
+    bool passive = false;
+    double interval = 1;
+    int baudrate = baudrateFromURI(uri);
+    for (int i = 0; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg == "--passive")
+            passive = true;
+        else if (arg.compare(0, 11, "--interval=") == 0)
+            interval = stod(arg.substr(11));
+        else if (arg.compare(0, 11, "--baudrate=") == 0)
+            baudrate = stoi(arg.substr(11));
+        else
+        {
+            cerr << "invalid stats argument '" << arg << "'\n";
+            return 1;
+        }
+    }
+
+    installInterruptHandler();
+
+    LinkMonitor monitor;
+    monitor.openURI(uri);
+    bool clear_screen = isatty(STDOUT_FILENO);
+
+    base::Time start = base::Time::now();
+    if (!passive)
+        monitor.requestStatus();
+    while (!interrupted)
+    {
+        try { monitor.poll(); }
+        catch(iodrivers_base::TimeoutError const&) {}
+        catch(iodrivers_base::UnixError const&)
+        {
+            if (!interrupted)
+                throw;
+        }
+
+        base::Time now = base::Time::now();
+        double duration = (now - start).toSeconds();
+        if (duration < interval)
+            continue;
+
+        LinkMonitor::Statistics stats = monitor.getStatistics();
+        monitor.resetStatistics();
+        start = now;
+        if (!passive)
+            monitor.requestStatus();
+
+        if (clear_screen)
+            printf("\033[H\033[J");
+        writeLinkStatistics(stats, duration, baudrate);
+        printf("\n");
+        fflush(stdout);
+    }
+    return 0;
+}
+
+static int configure(Driver& driver, string const& uri, int argc, char** argv)
+{
+    if (argc < 1)
+    {
+        cerr << "usage: imu_advanced_navigation_anpp_ctl URI configure PROFILE [--permanent] [--no-verify]\n";
+        return 1;
+    }
+
+    Profile profile = Profile::load(argv[0]);
+    bool verify = true;
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg == "--permanent")
+            profile.permanent = true;
+        else if (arg == "--no-verify")
+            verify = false;
+        else
+        {
+            cerr << "invalid configure argument '" << arg << "'\n";
+            return 1;
+        }
+    }
+
+    // The link must follow the device to its new rate, which is only
+    // possible on a serial port
+    if (profile.baudrate && uri.compare(0, 9, "serial://") != 0)
+    {
+        cerr << "the profile changes the device baud rate, which requires a serial:// URI\n";
+        return 1;
+    }
+
+    driver.openURI(uri);
+
+    base::Time start = base::Time::now();
+    int round_trips = driver.applyProfile(profile);
+    if (profile.baudrate)
+    {
+        // Re-open at the new rate. Driver::openURI would clear the packet
+        // periods that have just been set, bypass it
+        driver.iodrivers_base::Driver::openURI(setBaudrateInURI(uri, profile.baudrate));
+    }
+
+    vector<string> differences;
+    if (verify)
+    {
+        differences = profile.compare(driver.readProfile());
+        ++round_trips;
+    }
+    base::Time duration = base::Time::now() - start;
+
+    for (auto const& difference : differences)
+        cerr << "mismatch: " << difference << "\n";
+    cout << "applied" << (profile.permanent ? " permanently" : "")
+        << (verify ? " and verified" : "")
+        << " in " << duration.toMilliseconds() << "ms, "
+        << round_trips << " round-trips" << endl;
+    return differences.empty() ? 0 : 1;
+}
+
+struct LatencyStage
+{
+    char const* name;
+    vector<int64_t> latencies;
+};
+
+static void writeLatencyStatistics(char const* name, vector<int64_t>& latencies)
+{
+    printf("%-22s %9lld %9lld %9lld %9lld\n", name,
+           static_cast<long long>(*min_element(latencies.begin(), latencies.end())),
+           static_cast<long long>(percentile(latencies, 0.5)),
+           static_cast<long long>(percentile(latencies, 0.99)),
+           static_cast<long long>(*max_element(latencies.begin(), latencies.end())));
+}
+
+static void writeLatencyHistogram(string const& name, LatencyHistogram const& histogram)
+{
+    printf("%-24s %9llu %9.1f %9.1f %9.1f %9.1f %9.1f\n", name.c_str(),
+           static_cast<unsigned long long>(histogram.getCount()),
+           histogram.getMin() / 1e3,
+           histogram.getPercentile(0.5) / 1e3,
+           histogram.getPercentile(0.99) / 1e3,
+           histogram.getPercentile(0.999) / 1e3,
+           histogram.getMax() / 1e3);
+}
+
+static void writeLatencyHistograms(LatencyHistograms const& histograms)
+{
+    static char const* STAGE_NAMES[LATENCY_STAGE_COUNT] = {
+        "read to framed", "framed to decoded", "decoded to published"
+    };
+
+    printf("%-24s %9s %9s %9s %9s %9s %9s\n",
+           "stage", "count", "min(us)", "p50(us)", "p99(us)", "p99.9(us)", "max(us)");
+    for (int stage = 0; stage < LATENCY_STAGE_COUNT; ++stage)
+    {
+        auto stage_id = static_cast<LATENCY_STAGES>(stage);
+        writeLatencyHistogram(STAGE_NAMES[stage], histograms.getMerged(stage_id));
+        for (uint8_t id : histograms.getPacketIDs(stage_id))
+            writeLatencyHistogram("  ID " + to_string(id), *histograms.get(stage_id, id));
+    }
+    writeLatencyHistogram("train start to complete", histograms.getTrains());
+}
+
+/** Open and configure the device with startup profiling enabled, and report
+ * the time spent in each step until the first output is published
+ */
+static int startup(Driver& driver, string const& uri, int argc, char** argv)
+{
+    bool use_device_time = false;
+    string profile_path;
+    uint32_t output_periods[STREAM_OUTPUT_COUNT] = { 0 };
+    map<uint8_t, uint32_t> packet_periods;
+    for (int i = 0; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg == "--device-time")
+            use_device_time = true;
+        else if (arg.compare(0, 10, "--profile=") == 0)
+            profile_path = arg.substr(10);
+        else if (!parseStreamOutput(arg, output_periods, packet_periods))
+        {
+            cerr << "invalid startup argument '" << arg << "'\n";
+            return 1;
+        }
+    }
+    if (packet_periods.empty() && profile_path.empty())
+    {
+        cerr << "no outputs or profile given to the startup command\n";
+        return 1;
+    }
+    Profile profile;
+    if (!profile_path.empty())
+        profile = Profile::load(profile_path);
+
+    installInterruptHandler();
+
+    driver.setStartupProfilingEnabled(true);
+    base::Time start = base::Time::now();
+    driver.openURI(uri);
+    if (use_device_time)
+        driver.setUseDeviceTime(true);
+    driver.readConfiguration();
+    if (!profile_path.empty())
+        driver.applyProfile(profile);
+    if (!packet_periods.empty())
+        driver.setPacketPeriods(packet_periods);
+    driver.setStartupProfilingEnabled(false);
+    base::Time configured = base::Time::now();
+
+    // The startup is complete once the first output is published
+    base::Time first_output;
+    while (!interrupted)
+    {
+        try
+        {
+            if (driver.poll() > 0)
+            {
+                first_output = base::Time::now();
+                break;
+            }
+        }
+        catch(iodrivers_base::TimeoutError const&)
+        {
+            break;
+        }
+        catch(iodrivers_base::UnixError const&)
+        {
+            if (!interrupted)
+                throw;
+        }
+    }
+    driver.clearPeriodicPackets();
+
+    driver.getStartupProfile().write(cout);
+    cout << fixed << setprecision(3)
+        << "\nconfigured in " << (configured - start).toMicroseconds() / 1000.0 << "ms";
+    if (first_output.isNull())
+    {
+        cout << ", no output received within the read timeout" << endl;
+        return 1;
+    }
+    cout << ", first output after " << (first_output - start).toMicroseconds() / 1000.0
+        << "ms" << endl;
+    return 0;
+}
+
+/** Run the driver's own poll() loop with its latency histograms enabled */
+static int latencyHistograms(Driver& driver, size_t count)
+{
+    driver.setLatencyHistogramsEnabled(true);
+    size_t packets = 0;
+    while (packets < count && !interrupted)
+    {
+        try
+        {
+            driver.poll();
+            packets++;
+        }
+        catch(iodrivers_base::TimeoutError const&) {}
+        catch(iodrivers_base::UnixError const&)
+        {
+            if (!interrupted)
+                throw;
+        }
+    }
+    driver.setLatencyHistogramsEnabled(false);
+    driver.clearPeriodicPackets();
+
+    printf("latency histograms of Driver::poll() over %zu packets\n", packets);
+    writeLatencyHistograms(driver.getLatencyHistograms());
+    return 0;
+}
+
+static int latency(Driver& driver, string const& uri, int argc, char** argv)
+{
+    size_t count = 1000;
+    bool histograms = false;
+    int baudrate = baudrateFromURI(uri);
+    uint32_t output_periods[STREAM_OUTPUT_COUNT] = { 0 };
+    map<uint8_t, uint32_t> packet_periods;
+    for (int i = 0; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg.compare(0, 8, "--count=") == 0)
+            count = stoul(arg.substr(8));
+        else if (arg.compare(0, 11, "--baudrate=") == 0)
+            baudrate = stoi(arg.substr(11));
+        else if (arg == "--histograms")
+            histograms = true;
+        else if (!parseStreamOutput(arg, output_periods, packet_periods))
+        {
+            cerr << "invalid latency argument '" << arg << "'\n";
+            return 1;
+        }
+    }
+    if (packet_periods.empty())
+    {
+        cerr << "no outputs given to the latency command\n";
+        return 1;
+    }
+
+    installInterruptHandler();
+
+    driver.openURI(uri);
+    driver.setUseDeviceTime(true);
+    driver.setPacketPeriods(packet_periods);
+    if (histograms)
+        return latencyHistograms(driver, count);
+
+    // The stages are timestamped here instead of going through
+    // Driver::poll(), as iodrivers_base does not tell when the bytes of a
+    // given packet have been read
+    //
+    // The bytes that iodrivers_base read while the device was being
+    // configured are in its internal buffer, out of reach of ::read. Process
+    // the packets it holds without timing them. The sampling starts at the
+    // first UnixTime packet read below, i.e. with a train read entirely
+    // from the file descriptor
+    vector<uint8_t> queued_packet(driver.getMaxPacketSize());
+    while (driver.getStatus().queued_bytes > 0)
+    {
+        try
+        {
+            size_t packet_size = driver.readPacket(queued_packet.data(), queued_packet.size(),
+                                                   base::Time());
+            driver.processPacket(queued_packet.data(), packet_size);
+        }
+        catch(iodrivers_base::TimeoutError const&)
+        {
+            break;
+        }
+    }
+
+    int fd = driver.getFileDescriptor();
+    enum { STAGE_READ, STAGE_FRAMED, STAGE_PROCESSED, STAGE_COUNT };
+    LatencyStage stages[STAGE_COUNT] = {
+        { "kernel read", {} }, { "end of framing", {} }, { "end of process()", {} }
+    };
+    vector<int64_t> serialization_times;
+
+    vector<uint8_t> buffer;
+    uint8_t read_buffer[4096];
+    int64_t device_time = 0;
+    size_t train_bytes = 0;
+    while (stages[STAGE_PROCESSED].latencies.size() < count && !interrupted)
+    {
+        pollfd poll_fd = { fd, POLLIN, 0 };
+        if (::poll(&poll_fd, 1, 1000) <= 0)
+            continue;
+        ssize_t read_size = ::read(fd, read_buffer, sizeof(read_buffer));
+        if (read_size <= 0)
+            continue;
+        int64_t read_time = base::Time::now().toMicroseconds();
+        buffer.insert(buffer.end(), read_buffer, read_buffer + read_size);
+
+        size_t offset = 0;
+        while (true)
+        {
+            int packet_size = protocol::extractPacket(buffer.data() + offset, buffer.size() - offset);
+            if (packet_size == 0)
+                break;
+            else if (packet_size < 0)
+            {
+                offset += -packet_size;
+                continue;
+            }
+
+            uint8_t const* packet = buffer.data() + offset;
+            offset += packet_size;
+            int64_t framed_time = base::Time::now().toMicroseconds();
+            driver.processPacket(packet, packet_size);
+            int64_t processed_time = base::Time::now().toMicroseconds();
+
+            if (packet[1] == protocol::UnixTime::ID)
+            {
+                auto time = protocol::UnixTime::unmarshal(packet + protocol::Header::SIZE, packet + packet_size);
+                device_time = static_cast<int64_t>(time.seconds) * 1000000 + time.microseconds;
+                train_bytes = 0;
+            }
+            train_bytes += packet_size;
+            if (!device_time)
+                continue;
+
+            stages[STAGE_READ].latencies.push_back(read_time - device_time);
+            stages[STAGE_FRAMED].latencies.push_back(framed_time - device_time);
+            stages[STAGE_PROCESSED].latencies.push_back(processed_time - device_time);
+            // 10 bits per byte (8N1)
+            if (baudrate)
+                serialization_times.push_back(train_bytes * 10 * 1000000 / baudrate);
+        }
+        buffer.erase(buffer.begin(), buffer.begin() + offset);
+    }
+    driver.clearPeriodicPackets();
+
+    if (stages[STAGE_PROCESSED].latencies.empty())
+    {
+        cerr << "did not receive any timestamped packet\n";
+        return 1;
+    }
+
+    printf("latency from device time, in microseconds, over %zu packets\n",
+           stages[STAGE_PROCESSED].latencies.size());
+    printf("%-22s %9s %9s %9s %9s\n", "stage", "min", "median", "p99", "max");
+    for (auto& stage : stages)
+        writeLatencyStatistics(stage.name, stage.latencies);
+    if (!serialization_times.empty())
+    {
+        writeLatencyStatistics("serialization", serialization_times);
+
+        int64_t serialization = percentile(serialization_times, 0.5);
+        int64_t read = percentile(stages[STAGE_READ].latencies, 0.5);
+        printf("\nimplied transport delay (median read - serialization at %d baud): %lldus\n",
+               baudrate, static_cast<long long>(read - serialization));
+    }
+    printf("the host clock must be synchronized with the device's (e.g. through GNSS or PTP)\n");
+    return 0;
+}
+
+static void writeIntervalStatistics(IntervalStatistics const& stats)
+{
+    if (!stats.count)
+    {
+        printf(" %9s %9s %9s %9s", "-", "-", "-", "-");
+        return;
+    }
+    printf(" %9.1f %9.1f %9.1f %9llu",
+           stats.mean * 1e6, stats.getStandardDeviation() * 1e6, stats.max * 1e6,
+           static_cast<unsigned long long>(stats.outliers));
+}
+
+static int jitter(Driver& driver, string const& uri, int argc, char** argv)
+{
+    size_t count = 1000;
+    bool use_device_time = false;
+    uint32_t output_periods[STREAM_OUTPUT_COUNT] = { 0 };
+    map<uint8_t, uint32_t> packet_periods;
+    for (int i = 0; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg.compare(0, 8, "--count=") == 0)
+            count = stoul(arg.substr(8));
+        else if (arg == "--device-time")
+            use_device_time = true;
+        else if (!parseStreamOutput(arg, output_periods, packet_periods))
+        {
+            cerr << "invalid jitter argument '" << arg << "'\n";
+            return 1;
+        }
+    }
+    if (packet_periods.empty())
+    {
+        cerr << "no outputs given to the jitter command\n";
+        return 1;
+    }
+
+    installInterruptHandler();
+
+    driver.openURI(uri);
+    // Updates the packet timer period the expected intervals are based on
+    driver.readConfiguration();
+    driver.setUseDeviceTime(use_device_time);
+    driver.setPacketPeriods(packet_periods);
+    driver.setJitterAnalysisEnabled(true);
+
+    size_t packets = 0;
+    while (packets < count && !interrupted)
+    {
+        try
+        {
+            driver.poll();
+            packets++;
+        }
+        catch(iodrivers_base::TimeoutError const&) {}
+        catch(iodrivers_base::UnixError const&)
+        {
+            if (!interrupted)
+                throw;
+        }
+    }
+    driver.setJitterAnalysisEnabled(false);
+    driver.clearPeriodicPackets();
+
+    printf("inter-arrival intervals over %zu packets, in microseconds\n", packets);
+    printf("%4s %9s %9s %9s %9s %9s %9s %9s %9s %9s %9s %9s\n",
+           "ID", "expected",
+           "host.mean", "host.std", "host.max", "host.out",
+           "dev.mean", "dev.std", "dev.max", "dev.out",
+           "missed", "doubled");
+    for (int id = 0; id < protocol::PACKET_ID_COUNT; ++id)
+    {
+        PacketJitter const& jitter = driver.getPacketJitter(id);
+        if (jitter.expected_interval.isNull())
+            continue;
+
+        printf("%4d %9lld", id, static_cast<long long>(jitter.expected_interval.toMicroseconds()));
+        writeIntervalStatistics(jitter.host);
+        writeIntervalStatistics(jitter.device);
+        printf(" %9llu %9llu\n",
+               static_cast<unsigned long long>(jitter.missed),
+               static_cast<unsigned long long>(jitter.doubled));
+    }
+    return 0;
+}
+
+static int trace(Driver& driver, string const& uri, int argc, char** argv)
+{
+    if (argc < 1)
+    {
+        cerr << "no output file given to the trace command\n";
+        return 1;
+    }
+    string path = argv[0];
+
+    size_t count = 1000;
+    size_t capacity = TraceRecorder::DEFAULT_CAPACITY;
+    uint32_t output_periods[STREAM_OUTPUT_COUNT] = { 0 };
+    map<uint8_t, uint32_t> packet_periods;
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg.compare(0, 8, "--count=") == 0)
+            count = stoul(arg.substr(8));
+        else if (arg.compare(0, 11, "--capacity=") == 0)
+            capacity = stoul(arg.substr(11));
+        else if (!parseStreamOutput(arg, output_periods, packet_periods))
+        {
+            cerr << "invalid trace argument '" << arg << "'\n";
+            return 1;
+        }
+    }
+    if (packet_periods.empty())
+    {
+        cerr << "no outputs given to the trace command\n";
+        return 1;
+    }
+
+    ofstream out(path);
+    if (!out)
+    {
+        cerr << "cannot open " << path << "\n";
+        return 1;
+    }
+
+    installInterruptHandler();
+
+    // Enabled before openURI to get the startup commands as well
+    driver.enableTracing(capacity);
+    driver.openURI(uri);
+    driver.setPacketPeriods(packet_periods);
+
+    size_t packets = 0;
+    while (packets < count && !interrupted)
+    {
+        try
+        {
+            driver.poll();
+            packets++;
+        }
+        catch(iodrivers_base::TimeoutError const&) {}
+        catch(iodrivers_base::UnixError const&)
+        {
+            if (!interrupted)
+                throw;
+        }
+    }
+    driver.clearPeriodicPackets();
+
+    TraceRecorder const& recorder = *driver.getTraceRecorder();
+    size_t events = recorder.size();
+    uint64_t overwritten = recorder.getOverwrittenCount();
+    driver.flushTrace(out);
+    cerr << "wrote " << events << " events over " << packets << " packets to " << path;
+    if (overwritten)
+        cerr << ", " << overwritten << " older events were overwritten (see --capacity)";
+    cerr << "\n";
+    return 0;
+}
+
+static int discover(int argc, char** argv)
+{
+    vector<string> ports(argv, argv + argc);
+    if (ports.empty())
+        ports = discovery::listCandidatePorts();
+
+    base::Time start = base::Time::now();
+    auto devices = discovery::discover(ports);
+    base::Time duration = base::Time::now() - start;
+
+    printf("%-16s %8s %10s %8s %-26s\n", "port", "baud", "device ID", "firmware", "serial");
+    for (auto const& device : devices)
+    {
+        printf("%-16s %8u", device.port.c_str(), device.baudrate);
+        if (device.has_device_information)
+        {
+            DeviceInformation const& info = device.device_information;
+            printf(" %10u %8u %08u%08u%08u\n",
+                   info.device_id, info.software_version,
+                   info.serial_number_part0, info.serial_number_part1, info.serial_number_part2);
+        }
+        else
+            printf(" %10s %8s %s\n", "?", "?", "? (no reply to the information request)");
+    }
+    cerr << "probed " << ports.size() << " ports in "
+        << duration.toMilliseconds() << "ms, found " << devices.size() << " devices" << endl;
+    return devices.empty() ? 1 : 0;
+}
+
 int main(int argc, char** argv)
 {
+    if (argc >= 2 && string(argv[1]) == "discover")
+        return discover(argc - 2, argv + 2);
+    if (argc == 3 && string(argv[1]) == "metrics")
+    {
+        cout << MetricsExporter::formatPrometheus(MetricsExporter::readSharedMemory(argv[2]));
+        return 0;
+    }
+
     if (argc < 3)
     {
         cerr
             << "Usage: imu_advanced_navigation_anpp_ctl URI COMMAND [args]\n"
+            << "       imu_advanced_navigation_anpp_ctl discover [PORT...]\n"
+            << "       imu_advanced_navigation_anpp_ctl metrics SHM_NAME\n"
             << "Known commands:\n"
             << "  info\n"
             << "  reset-cold\n"
             << "  reset-hot\n"
             << "  reset-factory\n"
             << "  baudrate-detect\n"
-            << "  baudrate-set\n";
+            << "  baudrate-set\n"
+            << "  bench [--repeat=N] (with a capture file as URI)\n"
+            << "  configure PROFILE [--permanent] [--no-verify]\n"
+            << "  jitter [--count=N] [--device-time] OUTPUT=PERIOD...\n"
+            << "  latency [--count=N] [--baudrate=RATE] [--histograms] OUTPUT=PERIOD...\n"
+            << "  startup [--device-time] [--profile=FILE] [OUTPUT=PERIOD...]\n"
+            << "  stats [--passive] [--interval=SECONDS] [--baudrate=RATE]\n"
+            << "  trace FILE [--count=N] [--capacity=EVENTS] OUTPUT=PERIOD...\n"
+            << "  stream [--format=text|ndjson|binary] [--device-time] OUTPUT=PERIOD...\n"
+            << "         [--metrics-shm=NAME] [--metrics-file=PATH] [--metrics-interval=SECONDS]\n"
+            << "    available outputs:";
+        for (auto const& output : STREAM_OUTPUT_DEFINITIONS)
+            cerr << " " << output.name;
+        cerr << "\n";
         return 1;
     }
 
@@ -181,15 +1410,11 @@ int main(int argc, char** argv)
     }
     else if (cmd == "baudrate-detect")
     {
-        for (auto rate: BAUDRATES)
+        uint32_t rate = driver.detectBaudrate(uri);
+        if (rate)
         {
-            try
-            {
-                driver.openURI(uri + ":" + rate);
-                cout << rate << endl;
-                return 0;
-            }
-            catch(iodrivers_base::TimeoutError) {}
+            cout << rate << endl;
+            return 0;
         }
         cerr << "Could not find a rate at which the device can be contacted" << endl;
         return 1;
@@ -215,6 +1440,38 @@ int main(int argc, char** argv)
         driver.openURI(uri);
         driver.setDeviceBaudrate(stoi(argv[3]));
     }
+    else if (cmd == "bench")
+    {
+        return bench(uri, argc - 3, argv + 3);
+    }
+    else if (cmd == "configure")
+    {
+        return configure(driver, uri, argc - 3, argv + 3);
+    }
+    else if (cmd == "jitter")
+    {
+        return jitter(driver, uri, argc - 3, argv + 3);
+    }
+    else if (cmd == "latency")
+    {
+        return latency(driver, uri, argc - 3, argv + 3);
+    }
+    else if (cmd == "startup")
+    {
+        return startup(driver, uri, argc - 3, argv + 3);
+    }
+    else if (cmd == "stats")
+    {
+        return stats(uri, argc - 3, argv + 3);
+    }
+    else if (cmd == "trace")
+    {
+        return trace(driver, uri, argc - 3, argv + 3);
+    }
+    else if (cmd == "stream")
+    {
+        return stream(driver, uri, argc - 3, argv + 3);
+    }
     else
     {
         cerr << "Unknown command '" << cmd << "'\n";
@@ -0,0 +1,384 @@
+#include <imu_advanced_navigation_anpp/MetricsExporter.hpp>
+#include <imu_advanced_navigation_anpp/Driver.hpp>
+#include <iodrivers_base/Exceptions.hpp>
+#include <cstdio>
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <type_traits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+
+static_assert(std::is_trivially_copyable<Metrics>::value,
+              "Metrics is shared as raw memory, it must be trivially copyable");
+
+constexpr uint32_t SharedMetrics::MAGIC;
+constexpr uint32_t SharedMetrics::VERSION;
+
+static char const* LATENCY_STAGE_NAMES[LATENCY_STAGE_COUNT] = {
+    "read_to_framed", "framed_to_decoded", "decoded_to_published"
+};
+
+MetricsExporter::MetricsExporter(base::Time const& interval)
+    : mInterval(interval)
+    , mPrivateBlock(new SharedMetrics())
+{
+    memset(&mLast, 0, sizeof(mLast));
+    mBlock = mPrivateBlock.get();
+    mBlock->magic = SharedMetrics::MAGIC;
+    mBlock->version = SharedMetrics::VERSION;
+    mBlock->sequence = 0;
+    mBlock->metrics = mLast;
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    if (mTextFileThread.joinable())
+    {
+        {
+            lock_guard<mutex> lock(mTextFileMutex);
+            mTextFileQuit = true;
+        }
+        mTextFileSignal.notify_one();
+        mTextFileThread.join();
+    }
+
+    if (!mSharedMemoryName.empty())
+    {
+        munmap(mBlock, sizeof(SharedMetrics));
+        shm_unlink(mSharedMemoryName.c_str());
+    }
+}
+
+void MetricsExporter::openSharedMemory(string const& name)
+{
+    if (!mSharedMemoryName.empty())
+        throw std::logic_error("MetricsExporter: shared memory already open");
+
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd == -1)
+        throw iodrivers_base::UnixError("cannot open shared memory object " + name);
+    if (ftruncate(fd, sizeof(SharedMetrics)) == -1)
+    {
+        ::close(fd);
+        throw iodrivers_base::UnixError("cannot resize shared memory object " + name);
+    }
+    void* data = mmap(nullptr, sizeof(SharedMetrics),
+                      PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+        throw iodrivers_base::UnixError("cannot map shared memory object " + name);
+
+    SharedMetrics* block = static_cast<SharedMetrics*>(data);
+    block->sequence = 1;
+    block->magic = SharedMetrics::MAGIC;
+    block->version = SharedMetrics::VERSION;
+    block->metrics = mLast;
+    block->sequence = 2;
+
+    lock_guard<mutex> lock(mTextFileMutex);
+    mBlock = block;
+    mSharedMemoryName = name;
+}
+
+void MetricsExporter::openTextFile(string const& path)
+{
+    if (mTextFileThread.joinable())
+        throw std::logic_error("MetricsExporter: text file already open");
+
+    mTextFilePath = path;
+    mTextFileThread = thread(&MetricsExporter::writeTextFiles, this);
+}
+
+bool MetricsExporter::update(Driver const& driver)
+{
+    base::Time now = base::Time::now();
+    if (!mLastUpdate.isNull() && now - mLastUpdate < mInterval)
+        return false;
+
+    publish(driver);
+    return true;
+}
+
+void MetricsExporter::publish(Driver const& driver)
+{
+    Metrics metrics = collect(driver);
+    base::Time now = base::Time::fromMicroseconds(metrics.time);
+    if (!mLastUpdate.isNull())
+    {
+        double dt = (now - mLastUpdate).toSeconds();
+        if (dt > 0)
+        {
+            uint64_t packets = 0, last_packets = 0;
+            for (int i = 0; i < 256; ++i)
+            {
+                packets += metrics.packets[i];
+                last_packets += mLast.packets[i];
+            }
+            uint64_t errors = metrics.lrc_failures + metrics.crc_failures;
+            uint64_t last_errors = mLast.lrc_failures + mLast.crc_failures;
+
+            metrics.received_bytes_per_second =
+                (metrics.received_bytes - mLast.received_bytes) / dt;
+            metrics.packets_per_second = (packets - last_packets) / dt;
+            metrics.errors_per_second = (errors - last_errors) / dt;
+        }
+    }
+    mLastUpdate = now;
+    mLast = metrics;
+    writeBlock(metrics);
+
+    if (mTextFileThread.joinable())
+    {
+        {
+            lock_guard<mutex> lock(mTextFileMutex);
+            mTextFilePending++;
+        }
+        mTextFileSignal.notify_one();
+    }
+}
+
+void MetricsExporter::writeBlock(Metrics const& metrics)
+{
+    uint32_t sequence = mBlock->sequence.load(memory_order_relaxed);
+    mBlock->sequence.store(sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(&mBlock->metrics, &metrics, sizeof(Metrics));
+    mBlock->sequence.store(sequence + 2, memory_order_release);
+}
+
+/** Copy the metrics out of a block written by writeBlock */
+static bool readBlock(SharedMetrics const& block, Metrics& metrics, uint32_t& sequence)
+{
+    for (int attempt = 0; attempt < 1000; ++attempt)
+    {
+        uint32_t before = block.sequence.load(memory_order_acquire);
+        if (before & 1)
+            continue;
+        memcpy(&metrics, &block.metrics, sizeof(Metrics));
+        atomic_thread_fence(memory_order_acquire);
+        if (block.sequence.load(memory_order_relaxed) == before)
+        {
+            sequence = before;
+            return true;
+        }
+    }
+    return false;
+}
+
+Metrics MetricsExporter::getMetrics() const
+{
+    return mLast;
+}
+
+void MetricsExporter::flushTextFile()
+{
+    unique_lock<mutex> lock(mTextFileMutex);
+    mTextFileWrittenSignal.wait(lock, [this] {
+        return mTextFileWritten == mTextFilePending;
+    });
+}
+
+/** Write a file by writing a temporary file next to it and renaming it */
+static void replaceFile(string const& path, string const& text)
+{
+    string tmp_path = path + ".tmp";
+    FILE* file = fopen(tmp_path.c_str(), "w");
+    if (!file)
+        return;
+
+    bool success = fwrite(text.data(), 1, text.size(), file) == text.size();
+    success = (fclose(file) == 0) && success;
+    if (success)
+        rename(tmp_path.c_str(), path.c_str());
+    else
+        unlink(tmp_path.c_str());
+}
+
+void MetricsExporter::writeTextFiles()
+{
+    unique_lock<mutex> lock(mTextFileMutex);
+    while (true)
+    {
+        // The snapshots published before quitting are still written
+        mTextFileSignal.wait(lock, [this] {
+            return mTextFileQuit || mTextFilePending != mTextFileWritten;
+        });
+        if (mTextFilePending == mTextFileWritten)
+            return;
+
+        uint64_t pending = mTextFilePending;
+        SharedMetrics const* block = mBlock;
+        lock.unlock();
+
+        // publish() updates the block before signalling, so this snapshot
+        // is at least as recent as 'pending'
+        Metrics metrics;
+        uint32_t sequence;
+        if (readBlock(*block, metrics, sequence))
+            replaceFile(mTextFilePath, formatPrometheus(metrics));
+
+        lock.lock();
+        mTextFileWritten = pending;
+        mTextFileWrittenSignal.notify_all();
+    }
+}
+
+Metrics MetricsExporter::collect(Driver const& driver)
+{
+    Metrics metrics;
+    memset(&metrics, 0, sizeof(metrics));
+    metrics.time = base::Time::now().toMicroseconds();
+
+    Driver::Statistics const& stats = driver.getStatistics();
+    metrics.received_bytes = stats.received_bytes;
+    size_t packet_ids = min<size_t>(stats.packets.size(), 256);
+    copy(stats.packets.begin(), stats.packets.begin() + packet_ids, metrics.packets);
+    metrics.lrc_failures = stats.lrc_failures;
+    metrics.crc_failures = stats.crc_failures;
+    metrics.resync_bytes = stats.resync_bytes;
+    metrics.unknown_packets = stats.unknown_packets;
+    metrics.length_errors = stats.length_errors;
+    metrics.trains = stats.trains;
+    metrics.incomplete_trains = stats.incomplete_trains;
+
+    metrics.queued_bytes = driver.getStatus().queued_bytes;
+    int kernel_queued_bytes;
+    int fd = driver.getFileDescriptor();
+    if (fd != -1 && ioctl(fd, FIONREAD, &kernel_queued_bytes) == 0)
+        metrics.kernel_queued_bytes = kernel_queued_bytes;
+    else
+        metrics.kernel_queued_bytes = -1;
+
+    Status status = driver.getIMUStatus();
+    metrics.system_status = status.system_status;
+    metrics.filter_status = status.filter_status;
+
+    if (driver.isLatencyHistogramsEnabled())
+    {
+        metrics.has_latencies = 1;
+        LatencyHistograms const& histograms = driver.getLatencyHistograms();
+        for (int stage = 0; stage < LATENCY_STAGE_COUNT; ++stage)
+        {
+            LatencyHistogram const& merged =
+                histograms.getMerged(static_cast<LATENCY_STAGES>(stage));
+            metrics.latency_p50[stage] = merged.getPercentile(0.5);
+            metrics.latency_p99[stage] = merged.getPercentile(0.99);
+            metrics.latency_max[stage] = merged.getMax();
+        }
+    }
+    return metrics;
+}
+
+Metrics MetricsExporter::readSharedMemory(string const& name)
+{
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd == -1)
+        throw iodrivers_base::UnixError("cannot open shared memory object " + name);
+    void* data = mmap(nullptr, sizeof(SharedMetrics), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+        throw iodrivers_base::UnixError("cannot map shared memory object " + name);
+
+    SharedMetrics const& block = *static_cast<SharedMetrics const*>(data);
+    Metrics metrics;
+    uint32_t sequence;
+    bool valid = block.magic == SharedMetrics::MAGIC &&
+        block.version == SharedMetrics::VERSION;
+    bool consistent = valid && readBlock(block, metrics, sequence);
+    munmap(data, sizeof(SharedMetrics));
+
+    if (!valid)
+        throw std::runtime_error(name + " is not a metrics block of a compatible version");
+    else if (!consistent)
+        throw std::runtime_error("could not get a consistent copy of " + name);
+    return metrics;
+}
+
+static void writeMetricHeader(ostream& out, char const* name, char const* type, char const* help)
+{
+    out << "# HELP " << name << " " << help << "\n"
+        << "# TYPE " << name << " " << type << "\n";
+}
+
+template<typename T>
+static void writeMetric(ostream& out, char const* name, char const* type, char const* help, T value)
+{
+    writeMetricHeader(out, name, type, help);
+    out << name << " " << value << "\n";
+}
+
+string MetricsExporter::formatPrometheus(Metrics const& metrics)
+{
+    ostringstream out;
+    out.precision(9);
+
+    writeMetricHeader(out, "anpp_snapshot_timestamp_seconds", "gauge",
+                      "Host time of the snapshot");
+    out << "anpp_snapshot_timestamp_seconds " << metrics.time / 1000000 << "."
+        << setfill('0') << setw(6) << metrics.time % 1000000 << setfill(' ') << "\n";
+    writeMetric(out, "anpp_received_bytes_total", "counter",
+                "Bytes received from the device", metrics.received_bytes);
+    writeMetricHeader(out, "anpp_packets_total", "counter",
+                      "Valid packets received, by packet ID");
+    for (int id = 0; id < 256; ++id)
+    {
+        if (metrics.packets[id])
+            out << "anpp_packets_total{id=\"" << id << "\"} " << metrics.packets[id] << "\n";
+    }
+    writeMetric(out, "anpp_lrc_failures_total", "counter",
+                "Invalid packet headers", metrics.lrc_failures);
+    writeMetric(out, "anpp_crc_failures_total", "counter",
+                "Packets whose payload failed the CRC check", metrics.crc_failures);
+    writeMetric(out, "anpp_resync_bytes_total", "counter",
+                "Bytes discarded while looking for a valid packet", metrics.resync_bytes);
+    writeMetric(out, "anpp_unknown_packets_total", "counter",
+                "Packets the driver does not process", metrics.unknown_packets);
+    writeMetric(out, "anpp_length_errors_total", "counter",
+                "Packets whose payload size did not match their ID", metrics.length_errors);
+    writeMetric(out, "anpp_trains_total", "counter",
+                "Packet trains received", metrics.trains);
+    writeMetric(out, "anpp_incomplete_trains_total", "counter",
+                "Packet trains that lacked expected packets", metrics.incomplete_trains);
+    writeMetric(out, "anpp_received_bytes_per_second", "gauge",
+                "Byte rate since the previous snapshot", metrics.received_bytes_per_second);
+    writeMetric(out, "anpp_packets_per_second", "gauge",
+                "Packet rate since the previous snapshot", metrics.packets_per_second);
+    writeMetric(out, "anpp_errors_per_second", "gauge",
+                "LRC and CRC failure rate since the previous snapshot", metrics.errors_per_second);
+    writeMetric(out, "anpp_queued_bytes", "gauge",
+                "Bytes read from the device but not yet framed", metrics.queued_bytes);
+    if (metrics.kernel_queued_bytes >= 0)
+    {
+        writeMetric(out, "anpp_kernel_queued_bytes", "gauge",
+                    "Bytes waiting in the kernel receive buffer", metrics.kernel_queued_bytes);
+    }
+    writeMetric(out, "anpp_system_status", "gauge",
+                "Device system status bitfield", metrics.system_status);
+    writeMetric(out, "anpp_filter_status", "gauge",
+                "Device filter status bitfield", metrics.filter_status);
+
+    if (metrics.has_latencies)
+    {
+        writeMetricHeader(out, "anpp_latency_seconds", "summary",
+                          "Latency of the processing stages, all packets merged");
+        for (int stage = 0; stage < LATENCY_STAGE_COUNT; ++stage)
+        {
+            string labels = string("stage=\"") + LATENCY_STAGE_NAMES[stage] + "\"";
+            out << "anpp_latency_seconds{" << labels << ",quantile=\"0.5\"} "
+                << metrics.latency_p50[stage] / 1e9 << "\n"
+                << "anpp_latency_seconds{" << labels << ",quantile=\"0.99\"} "
+                << metrics.latency_p99[stage] / 1e9 << "\n"
+                << "anpp_latency_seconds{" << labels << ",quantile=\"1\"} "
+                << metrics.latency_max[stage] / 1e9 << "\n";
+        }
+    }
+    return out.str();
+}
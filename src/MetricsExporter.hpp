@@ -0,0 +1,186 @@
+#ifndef ADVANCED_NAVIGATION_ANPP_METRICS_EXPORTER_HPP
+#define ADVANCED_NAVIGATION_ANPP_METRICS_EXPORTER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <base/Time.hpp>
+#include <imu_advanced_navigation_anpp/LatencyHistogram.hpp>
+
+namespace imu_advanced_navigation_anpp
+{
+    class Driver;
+
+    /** Snapshot of the driver's counters, as exported by MetricsExporter
+     *
+     * The structure is trivially copyable, as it is shared as-is with other
+     * processes through shared memory
+     */
+    struct Metrics
+    {
+        /** Host time of the snapshot, in microseconds since the epoch */
+        int64_t time;
+
+        /** @see Driver::Statistics */
+        uint64_t received_bytes;
+        uint64_t packets[256];
+        uint64_t lrc_failures;
+        uint64_t crc_failures;
+        uint64_t resync_bytes;
+        uint64_t unknown_packets;
+        uint64_t length_errors;
+        uint64_t trains;
+        uint64_t incomplete_trains;
+
+        /** Rates since the previous snapshot, zero in the first one */
+        double received_bytes_per_second;
+        double packets_per_second;
+        double errors_per_second;
+
+        /** Bytes read from the device, but not yet framed */
+        uint32_t queued_bytes;
+        /** Bytes waiting in the kernel's receive buffer, -1 if unknown */
+        int32_t kernel_queued_bytes;
+
+        /** The device's system and filter status bitfields, from the
+         * last Status packet
+         */
+        uint16_t system_status;
+        uint16_t filter_status;
+
+        /** Whether the latency fields are set, i.e. whether the driver's
+         * latency histograms are enabled
+         */
+        uint8_t has_latencies;
+        /** Median, 99th percentile and max latency of each stage of
+         * LATENCY_STAGES, all packet IDs merged, in nanoseconds
+         */
+        int64_t latency_p50[LATENCY_STAGE_COUNT];
+        int64_t latency_p99[LATENCY_STAGE_COUNT];
+        int64_t latency_max[LATENCY_STAGE_COUNT];
+    };
+
+    /** Layout of the shared memory block
+     *
+     * Readers must use the sequence number as a seqlock: it is odd while the
+     * metrics are being written, and changes at each update. A copy of the
+     * metrics is consistent if the sequence was even and did not change
+     * during the copy. MetricsExporter::readSharedMemory does this.
+     */
+    struct SharedMetrics
+    {
+        static constexpr uint32_t MAGIC = 0x50504e41; // "ANPP", little-endian
+        static constexpr uint32_t VERSION = 1;
+
+        uint32_t magic;
+        uint32_t version;
+        std::atomic<uint32_t> sequence;
+        Metrics metrics;
+    };
+
+    /** Periodic export of the driver's counters for external collectors
+     *
+     * update() is meant to be called in the loop that polls the driver. At
+     * the configured interval, it copies the driver's counters into a
+     * SharedMetrics block. This costs a copy of a few kilobytes, a FIONREAD
+     * ioctl on the driver's file descriptor, and, if the latency histograms
+     * are enabled, a scan of the driver's merged histogram of each stage for
+     * the percentiles. None of this allocates or blocks. The block is either
+     * a POSIX shared memory object, that other processes map (see
+     * openSharedMemory()), or private memory. A text file in the Prometheus
+     * exposition format can be written as well (see openTextFile()). It is
+     * formatted and written by a separate thread, so that the file system
+     * does not delay the polling loop, which only takes a mutex to signal it.
+     */
+    class MetricsExporter
+    {
+        base::Time mInterval;
+        base::Time mLastUpdate;
+        Metrics mLast;
+
+        SharedMetrics* mBlock = nullptr;
+        std::unique_ptr<SharedMetrics> mPrivateBlock;
+        std::string mSharedMemoryName;
+
+        std::string mTextFilePath;
+        std::thread mTextFileThread;
+        std::mutex mTextFileMutex;
+        std::condition_variable mTextFileSignal;
+        std::condition_variable mTextFileWrittenSignal;
+        bool mTextFileQuit = false;
+        /** Number of snapshots published since openTextFile(), and the
+         * value it had when the text file was last written. Both are
+         * guarded by mTextFileMutex
+         */
+        uint64_t mTextFilePending = 0;
+        uint64_t mTextFileWritten = 0;
+
+        void writeBlock(Metrics const& metrics);
+        void writeTextFiles();
+
+    public:
+        /**
+         * @param interval the minimum time between two snapshots
+         */
+        explicit MetricsExporter(base::Time const& interval = base::Time::fromSeconds(1));
+        ~MetricsExporter();
+
+        /** Publish the metrics in a POSIX shared memory object
+         *
+         * The object is created if needed, and removed when the exporter is
+         * destroyed. Must be called before the first update()
+         *
+         * @param name the object name, as given to shm_open (e.g.
+         *   /imu_advanced_navigation_anpp)
+         */
+        void openSharedMemory(std::string const& name);
+
+        /** Write the metrics in the Prometheus text format to a file at each
+         * update
+         *
+         * The file is written next to the target and renamed, so that
+         * readers never see a partial file. Must be called before the first
+         * update()
+         */
+        void openTextFile(std::string const& path);
+
+        /** Wait until the text file has been written with the last
+         * published snapshot
+         *
+         * Returns immediately if there is no text file
+         */
+        void flushTextFile();
+
+        /** Publish a snapshot of the driver's counters if the interval
+         * elapsed since the last one
+         *
+         * @return true if a snapshot has been published
+         */
+        bool update(Driver const& driver);
+
+        /** Publish a snapshot of the driver's counters now */
+        void publish(Driver const& driver);
+
+        /** The last published snapshot */
+        Metrics getMetrics() const;
+
+        /** Gather the current counters of a driver
+         *
+         * The rates are left to zero
+         */
+        static Metrics collect(Driver const& driver);
+
+        /** Read a consistent snapshot from a shared memory object created
+         * by openSharedMemory()
+         */
+        static Metrics readSharedMemory(std::string const& name);
+
+        /** Format the metrics in the Prometheus text exposition format */
+        static std::string formatPrometheus(Metrics const& metrics);
+    };
+}
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef ADVANCED_NAVIGATION_ANPP_PROBES_HPP
+#define ADVANCED_NAVIGATION_ANPP_PROBES_HPP
+
+/** Static tracepoints on the packet processing path
+ *
+ * When the library is built with the USDT_PROBES CMake option, the
+ * ANPP_PROBE macros define USDT (SystemTap SDT) probes of the
+ * imu_advanced_navigation_anpp provider, which bpftrace, perf and SystemTap
+ * can attach to at runtime. A probe that is not attached to costs a single
+ * nop. Otherwise, the macros expand to nothing.
+ *
+ * This header is private to the library, and is not installed: the probes
+ * must only be used in its translation units, which are all built with the
+ * same IMU_ADVANCED_NAVIGATION_ANPP_USDT definition. It must not be included
+ * from a public header, nor used in inline code.
+ */
+
+#ifdef IMU_ADVANCED_NAVIGATION_ANPP_USDT
+#include <sys/sdt.h>
+
+#define ANPP_PROBE1(name, arg1) \
+    DTRACE_PROBE1(imu_advanced_navigation_anpp, name, arg1)
+#define ANPP_PROBE2(name, arg1, arg2) \
+    DTRACE_PROBE2(imu_advanced_navigation_anpp, name, arg1, arg2)
+#define ANPP_PROBE3(name, arg1, arg2, arg3) \
+    DTRACE_PROBE3(imu_advanced_navigation_anpp, name, arg1, arg2, arg3)
+#else
+#define ANPP_PROBE1(name, arg1) do {} while (0)
+#define ANPP_PROBE2(name, arg1, arg2) do {} while (0)
+#define ANPP_PROBE3(name, arg1, arg2, arg3) do {} while (0)
+#endif
+
+#endif
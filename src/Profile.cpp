@@ -0,0 +1,246 @@
+#include <imu_advanced_navigation_anpp/Profile.hpp>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+
+static const char* VEHICLE_TYPE_NAMES[] = {
+    "UNCONSTRAINED",
+    "BICYCLE_OR_MOTORCYCLE",
+    "CAR",
+    "HOVERCRAFT",
+    "SUBMARINE",
+    "3D_UNDERWATER",
+    "FIXED_WING_PLANE",
+    "3D_AIRCRAFT",
+    "HUMAN",
+    "BOAT",
+    "LARGE_SHIP",
+    "STATIONARY",
+    "STUNT_PLANE",
+    "RACE_CAR"
+};
+static const int VEHICLE_TYPE_COUNT = sizeof(VEHICLE_TYPE_NAMES) / sizeof(VEHICLE_TYPE_NAMES[0]);
+
+static string trim(string const& str)
+{
+    size_t begin = str.find_first_not_of(" \t\r");
+    if (begin == string::npos)
+        return string();
+    size_t end = str.find_last_not_of(" \t\r");
+    return str.substr(begin, end - begin + 1);
+}
+
+static bool parseBool(string const& value)
+{
+    if (value == "true" || value == "yes" || value == "1")
+        return true;
+    else if (value == "false" || value == "no" || value == "0")
+        return false;
+    throw invalid_argument("expected true or false, got '" + value + "'");
+}
+
+static uint32_t parseUnsigned(string const& value)
+{
+    size_t end;
+    unsigned long result = stoul(value, &end);
+    if (end != value.size())
+        throw invalid_argument("expected an integer, got '" + value + "'");
+    return result;
+}
+
+static VEHICLE_TYPES parseVehicleType(string const& value)
+{
+    for (int i = 0; i < VEHICLE_TYPE_COUNT; ++i)
+    {
+        if (value == VEHICLE_TYPE_NAMES[i])
+            return static_cast<VEHICLE_TYPES>(i);
+    }
+
+    uint32_t type = parseUnsigned(value);
+    if (type >= static_cast<uint32_t>(VEHICLE_TYPE_COUNT))
+        throw invalid_argument("unknown vehicle type '" + value + "'");
+    return static_cast<VEHICLE_TYPES>(type);
+}
+
+Profile::Profile()
+{
+    configuration.utc_synchronization = true;
+    configuration.packet_timer_period = base::Time::fromMilliseconds(1);
+    configuration.gnss_antenna_offset = base::Vector3d::Zero();
+    configuration.vehicle_type = VEHICLE_UNCONSTRAINED;
+    configuration.enabled_internal_gnss = false;
+    configuration.enabled_atmospheric_altitude = false;
+    configuration.enabled_velocity_heading = false;
+    configuration.enabled_reversing_detection = false;
+    configuration.enabled_motion_analysis = false;
+}
+
+Profile Profile::load(string const& path)
+{
+    ifstream in(path);
+    if (!in)
+        throw invalid_argument("cannot open " + path);
+    return parse(in);
+}
+
+Profile Profile::parse(istream& in)
+{
+    Profile profile;
+    Configuration& conf = profile.configuration;
+
+    string line;
+    for (int line_number = 1; getline(in, line); ++line_number)
+    {
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty())
+            continue;
+
+        size_t equal = line.find('=');
+        string key = trim(line.substr(0, equal));
+        string value = (equal == string::npos) ? string() : trim(line.substr(equal + 1));
+        try
+        {
+            if (equal == string::npos || value.empty())
+                throw invalid_argument("expected 'key = value'");
+
+            if (key == "permanent")
+                profile.permanent = parseBool(value);
+            else if (key == "packet_timer_period")
+            {
+                conf.packet_timer_period = base::Time::fromMicroseconds(parseUnsigned(value));
+                profile.has_packet_timer_period = true;
+            }
+            else if (key == "utc_synchronization")
+            {
+                conf.utc_synchronization = parseBool(value);
+                profile.has_packet_timer_period = true;
+            }
+            else if (key == "vehicle_type")
+            {
+                conf.vehicle_type = parseVehicleType(value);
+                profile.has_filter_options = true;
+            }
+            else if (key == "internal_gnss")
+            {
+                conf.enabled_internal_gnss = parseBool(value);
+                profile.has_filter_options = true;
+            }
+            else if (key == "atmospheric_altitude")
+            {
+                conf.enabled_atmospheric_altitude = parseBool(value);
+                profile.has_filter_options = true;
+            }
+            else if (key == "velocity_heading")
+            {
+                conf.enabled_velocity_heading = parseBool(value);
+                profile.has_filter_options = true;
+            }
+            else if (key == "reversing_detection")
+            {
+                conf.enabled_reversing_detection = parseBool(value);
+                profile.has_filter_options = true;
+            }
+            else if (key == "motion_analysis")
+            {
+                conf.enabled_motion_analysis = parseBool(value);
+                profile.has_filter_options = true;
+            }
+            else if (key == "gnss_antenna_offset")
+            {
+                istringstream values(value);
+                base::Vector3d& offset = conf.gnss_antenna_offset;
+                if (!(values >> offset.x() >> offset.y() >> offset.z()) || !(values >> ws).eof())
+                    throw invalid_argument("expected three values, got '" + value + "'");
+                profile.has_alignment = true;
+            }
+            else if (key.compare(0, 7, "period.") == 0)
+            {
+                uint32_t id = parseUnsigned(key.substr(7));
+                if (id > 255)
+                    throw invalid_argument("invalid packet ID " + key.substr(7));
+                profile.packet_periods[id] = parseUnsigned(value);
+                profile.has_packet_periods = true;
+            }
+            else if (key == "baudrate")
+                profile.baudrate = parseUnsigned(value);
+            else
+                throw invalid_argument("unknown key '" + key + "'");
+        }
+        catch(std::logic_error const& e)
+        {
+            throw invalid_argument("line " + to_string(line_number) + ": " + e.what());
+        }
+    }
+    return profile;
+}
+
+template<typename T>
+static void compareValue(vector<string>& result, char const* name, T expected, T actual)
+{
+    if (expected == actual)
+        return;
+
+    ostringstream message;
+    message << name << ": expected " << expected << ", got " << actual;
+    result.push_back(message.str());
+}
+
+vector<string> Profile::compare(Profile const& actual) const
+{
+    vector<string> result;
+    Configuration const& expected_conf = configuration;
+    Configuration const& actual_conf = actual.configuration;
+
+    if (has_packet_timer_period)
+    {
+        compareValue(result, "packet_timer_period",
+            expected_conf.packet_timer_period.toMicroseconds(),
+            actual_conf.packet_timer_period.toMicroseconds());
+        compareValue(result, "utc_synchronization",
+            expected_conf.utc_synchronization, actual_conf.utc_synchronization);
+    }
+    if (has_filter_options)
+    {
+        compareValue(result, "vehicle_type",
+            static_cast<int>(expected_conf.vehicle_type), static_cast<int>(actual_conf.vehicle_type));
+        compareValue(result, "internal_gnss",
+            expected_conf.enabled_internal_gnss, actual_conf.enabled_internal_gnss);
+        compareValue(result, "atmospheric_altitude",
+            expected_conf.enabled_atmospheric_altitude, actual_conf.enabled_atmospheric_altitude);
+        compareValue(result, "velocity_heading",
+            expected_conf.enabled_velocity_heading, actual_conf.enabled_velocity_heading);
+        compareValue(result, "reversing_detection",
+            expected_conf.enabled_reversing_detection, actual_conf.enabled_reversing_detection);
+        compareValue(result, "motion_analysis",
+            expected_conf.enabled_motion_analysis, actual_conf.enabled_motion_analysis);
+    }
+    if (has_alignment)
+    {
+        // The offset is transmitted as single-precision floats
+        base::Vector3d error = expected_conf.gnss_antenna_offset - actual_conf.gnss_antenna_offset;
+        if (error.cwiseAbs().maxCoeff() > 1e-6 * (1 + expected_conf.gnss_antenna_offset.cwiseAbs().maxCoeff()))
+        {
+            ostringstream message;
+            message << "gnss_antenna_offset: expected " << expected_conf.gnss_antenna_offset.transpose()
+                << ", got " << actual_conf.gnss_antenna_offset.transpose();
+            result.push_back(message.str());
+        }
+    }
+    if (has_packet_periods)
+    {
+        for (int id = 0; id < 256; ++id)
+        {
+            auto expected_it = packet_periods.find(id);
+            auto actual_it = actual.packet_periods.find(id);
+            uint32_t expected_period = (expected_it == packet_periods.end()) ? 0 : expected_it->second;
+            uint32_t actual_period = (actual_it == actual.packet_periods.end()) ? 0 : actual_it->second;
+            string name = "period." + to_string(id);
+            compareValue(result, name.c_str(), expected_period, actual_period);
+        }
+    }
+    if (baudrate)
+        compareValue(result, "baudrate", baudrate, actual.baudrate);
+    return result;
+}
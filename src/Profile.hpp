@@ -0,0 +1,87 @@
+#ifndef ADVANCED_NAVIGATION_ANPP_PROFILE_HPP
+#define ADVANCED_NAVIGATION_ANPP_PROFILE_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+#include <iosfwd>
+#include <imu_advanced_navigation_anpp/Configuration.hpp>
+
+namespace imu_advanced_navigation_anpp
+{
+    /** A set of device settings, to be applied with Driver::applyProfile()
+     *
+     * The settings are grouped by the configuration packet they are sent
+     * with. Only the groups that are marked as present are applied, but a
+     * group is always written as a whole: the settings of a present group
+     * that are not explicitly set keep their default values.
+     *
+     * Profiles are usually loaded from a text file with one
+     * <tt>key = value</tt> pair per line. Empty lines and everything after
+     * a # are ignored. The known keys are:
+     *
+     * <ul>
+     * <li>permanent: whether the settings should be stored in the device's
+     *   flash (true/false)
+     * <li>packet_timer_period: the base packet period in microseconds
+     * <li>utc_synchronization: true/false
+     * <li>vehicle_type: a VEHICLE_TYPES name without the VEHICLE_ prefix
+     *   (e.g. CAR), or its numerical value
+     * <li>internal_gnss, atmospheric_altitude, velocity_heading,
+     *   reversing_detection, motion_analysis: true/false
+     * <li>gnss_antenna_offset: three space-separated values, in meters
+     * <li>period.ID: the period of the packet with the given numerical ID,
+     *   in multiples of the packet timer period. The periods of the packets
+     *   that are not listed are set to zero
+     * <li>baudrate: the baud rate of the primary port
+     * </ul>
+     */
+    struct Profile
+    {
+        bool permanent = false;
+
+        /** Whether packet_timer_period and utc_synchronization are set */
+        bool has_packet_timer_period = false;
+        /** Whether the vehicle type and the enabled_* flags are set */
+        bool has_filter_options = false;
+        /** Whether gnss_antenna_offset is set */
+        bool has_alignment = false;
+        /** The packet timer, filter options and alignment settings */
+        Configuration configuration;
+
+        /** Whether packet_periods is set */
+        bool has_packet_periods = false;
+        /** The packet periods, as packet ID to period */
+        std::map<uint8_t, uint32_t> packet_periods;
+
+        /** The primary port baud rate, zero if it should not be changed */
+        uint32_t baudrate = 0;
+
+        Profile();
+
+        /** Load a profile from a file
+         *
+         * @throw std::invalid_argument if the file cannot be read or is
+         *   invalid
+         */
+        static Profile load(std::string const& path);
+
+        /** Parse a profile from a stream
+         *
+         * @throw std::invalid_argument if the profile is invalid. The error
+         *   message contains the line number
+         */
+        static Profile parse(std::istream& in);
+
+        /** Compare the settings of this profile to the ones of another
+         *
+         * Only the groups present in this profile are compared.
+         *
+         * @return a human-readable description of the differences, empty if
+         *   the settings match
+         */
+        std::vector<std::string> compare(Profile const& actual) const;
+    };
+}
+
+#endif
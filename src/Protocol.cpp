@@ -1,6 +1,7 @@
 #include <imu_advanced_navigation_anpp/Protocol.hpp>
 #include <boost/crc.hpp>
 #include <cstddef>
+#include <new>
 #include <stdexcept>
 
 using namespace std;
@@ -90,6 +91,72 @@ bool Header::isPacketValid(uint8_t const* begin, uint8_t const* end) const
     return (payload_checksum_lsb == (checksum & 0xFF)) && (payload_checksum_msb == ((checksum >> 8) & 0xFF));
 }
 
+int protocol::extractPacket(uint8_t const* buffer, size_t buffer_length)
+{
+    if (buffer_length < static_cast<size_t>(Header::SIZE))
+        return 0;
+
+    Header const& header = reinterpret_cast<Header const&>(*buffer);
+    if (header.isValid())
+    {
+        size_t expected_packet_length = header.getPacketLength();
+        if (buffer_length < expected_packet_length)
+            return 0;
+        else if (header.isPacketValid(buffer + Header::SIZE, buffer + expected_packet_length))
+            return expected_packet_length;
+        else
+            return -1;
+    }
+
+    // Keep the last Header::SIZE - 1 bytes, they might be the beginning of
+    // a header whose end has not been received yet
+    auto buffer_end = buffer + buffer_length;
+    for (auto packet_start = buffer + 1; packet_start + Header::SIZE <= buffer_end; packet_start++)
+    {
+        Header const& header = reinterpret_cast<Header const&>(*packet_start);
+        if (header.isValid())
+            return buffer - packet_start;
+    }
+    return -static_cast<int>(buffer_length - (Header::SIZE - 1));
+}
+
+void FramingStatistics::update(uint8_t const* buffer, int result)
+{
+    if (result > 0)
+    {
+        // A valid packet ends the resynchronization, even if a corrupted
+        // header claimed a length that goes beyond it
+        mCorruptedBytesLeft = 0;
+        return;
+    }
+    else if (result == 0)
+        return;
+
+    if (mCorruptedBytesLeft == 0)
+    {
+        Header const& header = reinterpret_cast<Header const&>(*buffer);
+        if (header.isValid())
+        {
+            crc_failures++;
+            mCorruptedBytesLeft = header.getPacketLength();
+        }
+        else
+            lrc_failures++;
+    }
+    mCorruptedBytesLeft -= min<size_t>(mCorruptedBytesLeft, -result);
+    resync_bytes += -result;
+}
+
+void protocol::appendPacket(vector<uint8_t>& out, uint8_t packet_id,
+                            uint8_t const* payload, uint8_t const* payload_end)
+{
+    size_t start = out.size();
+    out.resize(start + Header::SIZE + (payload_end - payload));
+    uint8_t* packet = &out[start];
+    copy(payload, payload_end, packet + Header::SIZE);
+    new(packet) Header(packet_id, packet + Header::SIZE, packet + out.size() - start);
+}
+
 bool Acknowledge::isMatching(Header const& header) const
 {
     return acked_packet_id == header.packet_id &&
@@ -26,7 +26,9 @@ namespace imu_advanced_navigation_anpp
      * variable sizes. Structs that are meant to be sent to the device have a
      * marshal() method that returns the packet payload as a set of bytes.
      * Structs that are meant to be received have an unmarshal() static method
-     * that return the struct from the payload data.
+     * that return the struct from the payload data. The packets that the
+     * device sends also have a marshal() method, for the benefit of
+     * DeviceSimulator.
      */
     namespace protocol
     {
@@ -99,6 +101,7 @@ namespace imu_advanced_navigation_anpp
         {
             static_assert(sizeof(T) == 8, "sample is not a 8-byte data type");
             uint64_t value = reinterpret_cast<uint64_t&>(sample);
+            out[0] = (value >> 0) & 0xFF;
             out[1] = (value >> 8) & 0xFF;
             out[2] = (value >> 16) & 0xFF;
             out[3] = (value >> 24) & 0xFF;
@@ -167,10 +170,78 @@ namespace imu_advanced_navigation_anpp
          */
         static constexpr int MAX_PACKET_SIZE = 256 + sizeof(Header);
 
+        /** Size of the internal buffer of the iodrivers_base drivers of this
+         * package, i.e. their MAX_PACKET_SIZE
+         *
+         * iodrivers_base requires the buffers given to readPacket to be at
+         * least that big
+         */
+        static constexpr int DRIVER_BUFFER_SIZE = MAX_PACKET_SIZE * 10;
+
         /** Compute the CRC as expected by the protocol
          */
         uint16_t crc(uint8_t const* begin, uint8_t const* end);
 
+        /** Find the first packet in a byte stream
+         *
+         * This follows the iodrivers_base extractPacket convention: it returns
+         * the packet length if a packet that validates both the header LRC and
+         * the payload CRC starts at the beginning of the buffer, 0 if more
+         * data is needed and minus the number of bytes that should be
+         * discarded otherwise.
+         */
+        int extractPacket(uint8_t const* buffer, size_t buffer_length);
+
+        /** Framing error counters of a byte stream, from the results of
+         * extractPacket
+         *
+         * extractPacket only discards the first byte of a valid header once
+         * the full packet is available and its CRC check failed. The bytes
+         * of the corrupted packet are then scanned for a header, and may
+         * contain things that look like one: these are not counted as
+         * separate failures.
+         */
+        struct FramingStatistics
+        {
+            /** Number of times the stream did not start with a header that
+             * validates the LRC, outside of a packet that failed its CRC
+             */
+            uint64_t lrc_failures = 0;
+            /** Packets whose header was valid, but the payload CRC was not */
+            uint64_t crc_failures = 0;
+            /** Bytes discarded while looking for a valid packet */
+            uint64_t resync_bytes = 0;
+
+            /** Account for the result of extractPacket
+             *
+             * @param buffer the buffer given to extractPacket
+             * @param result the value it returned
+             */
+            void update(uint8_t const* buffer, int result);
+
+        private:
+            /** Bytes of the last packet that failed its CRC that have not
+             * been discarded yet */
+            size_t mCorruptedBytesLeft = 0;
+        };
+
+        /** Append a complete packet, header included, to a byte buffer */
+        void appendPacket(std::vector<uint8_t>& out, uint8_t packet_id,
+                          uint8_t const* payload, uint8_t const* payload_end);
+
+        /** Marshal a packet and append it, header included, to a byte buffer
+         *
+         * This works with all the packet structures that have a
+         * marshal(out) method returning the end of the payload
+         */
+        template<typename Packet>
+        void appendPacket(std::vector<uint8_t>& out, Packet const& packet)
+        {
+            uint8_t payload[MAX_PACKET_SIZE];
+            uint8_t* payload_end = packet.marshal(payload);
+            appendPacket(out, Packet::ID, payload, payload_end);
+        }
+
         /** Acknowledgment packet */
         struct Acknowledge
         {
@@ -211,6 +282,16 @@ namespace imu_advanced_navigation_anpp
             /** True if this ack indicates that the system is not ready */
             bool isNotReady() const;
 
+            template<typename OutputIterator>
+            OutputIterator marshal(OutputIterator out) const
+            {
+                out[0] = acked_packet_id;
+                out[1] = acked_payload_checksum_lsb;
+                out[2] = acked_payload_checksum_msb;
+                out[3] = result;
+                return out + SIZE;
+            }
+
             /** Initializes an Acknowledge from raw data
              */
             template<typename RandomInputIterator>
@@ -282,6 +363,18 @@ namespace imu_advanced_navigation_anpp
             static constexpr uint8_t ID = 3;
             static constexpr int SIZE = 24;
 
+            template<typename OutputIterator>
+            OutputIterator marshal(OutputIterator out) const
+            {
+                write32(out, software_version);
+                write32(out + 4, device_id);
+                write32(out + 8, hardware_revision);
+                write32(out + 12, serial_number_part0);
+                write32(out + 16, serial_number_part1);
+                write32(out + 20, serial_number_part2);
+                return out + SIZE;
+            }
+
             template<typename RandomInputIterator>
             static DeviceInformation unmarshal(RandomInputIterator begin, RandomInputIterator end)
             {
@@ -363,6 +456,26 @@ namespace imu_advanced_navigation_anpp
             float   angular_velocity[3];
             float   lat_lon_z_stddev[3];
 
+            template<typename OutputIterator>
+            OutputIterator marshal(OutputIterator out) const
+            {
+                write16(out, system_status);
+                write16(out + 2, filter_status);
+                write32(out + 4, unix_time_seconds);
+                write32(out + 8, unix_time_microseconds);
+                write32(out + 60, g);
+                for (int i = 0; i < 3; ++i)
+                {
+                    write64(out + 12 + 8 * i, lat_lon_z[i]);
+                    write32(out + 36 + 4 * i, velocity_ned[i]);
+                    write32(out + 48 + 4 * i, body_acceleration_xyz[i]);
+                    write32(out + 64 + 4 * i, rpy[i]);
+                    write32(out + 76 + 4 * i, angular_velocity[i]);
+                    write32(out + 88 + 4 * i, lat_lon_z_stddev[i]);
+                }
+                return out + SIZE;
+            }
+
             template<typename InputIterator>
             static SystemState unmarshal(InputIterator begin, InputIterator end)
             {
@@ -398,6 +511,14 @@ namespace imu_advanced_navigation_anpp
             uint32_t seconds;
             uint32_t microseconds;
 
+            template<typename OutputIterator>
+            OutputIterator marshal(OutputIterator out) const
+            {
+                write32(out, seconds);
+                write32(out + 4, microseconds);
+                return out + SIZE;
+            }
+
             template<typename InputIterator>
             static UnixTime unmarshal(InputIterator begin, InputIterator end)
             {
@@ -417,6 +538,14 @@ namespace imu_advanced_navigation_anpp
             /** Bitfield of FILTER_STATUS */
             uint16_t filter_status;
 
+            template<typename OutputIterator>
+            OutputIterator marshal(OutputIterator out) const
+            {
+                write16(out, system_status);
+                write16(out + 2, filter_status);
+                return out + SIZE;
+            }
+
             template<typename InputIterator>
             static Status unmarshal(InputIterator begin, InputIterator end)
             {
@@ -433,6 +562,14 @@ namespace imu_advanced_navigation_anpp
 
             float   lat_lon_z_stddev[3];
 
+            template<typename OutputIterator>
+            OutputIterator marshal(OutputIterator out) const
+            {
+                for (int i = 0; i < 3; ++i)
+                    write32(out + 4 * i, lat_lon_z_stddev[i]);
+                return out + SIZE;
+            }
+
             template<typename InputIterator>
             static GeodeticPositionStandardDeviation unmarshal(InputIterator begin, InputIterator end)
             {
@@ -453,6 +590,14 @@ namespace imu_advanced_navigation_anpp
 
             float ned[3];
 
+            template<typename OutputIterator>
+            OutputIterator marshal(OutputIterator out) const
+            {
+                for (int i = 0; i < 3; ++i)
+                    write32(out + 4 * i, ned[i]);
+                return out + SIZE;
+            }
+
             template<typename InputIterator>
             static NEDVelocityStandardDeviation unmarshal(InputIterator begin, InputIterator end)
             {
@@ -473,6 +618,14 @@ namespace imu_advanced_navigation_anpp
 
             float rpy[3];
 
+            template<typename OutputIterator>
+            OutputIterator marshal(OutputIterator out) const
+            {
+                for (int i = 0; i < 3; ++i)
+                    write32(out + 4 * i, rpy[i]);
+                return out + SIZE;
+            }
+
             template<typename InputIterator>
             static EulerOrientationStandardDeviation unmarshal(InputIterator begin, InputIterator end)
             {
@@ -498,6 +651,21 @@ namespace imu_advanced_navigation_anpp
             float pressure;
             float pressure_temperature_C;
 
+            template<typename OutputIterator>
+            OutputIterator marshal(OutputIterator out) const
+            {
+                for (int i = 0; i < 3; ++i)
+                {
+                    write32(out + 0 + 4 * i, accelerometers_xyz[i]);
+                    write32(out + 12 + 4 * i, gyroscopes_xyz[i]);
+                    write32(out + 24 + 4 * i, magnetometers_xyz[i]);
+                }
+                write32(out + 36, imu_temperature_C);
+                write32(out + 40, pressure);
+                write32(out + 44, pressure_temperature_C);
+                return out + SIZE;
+            }
+
             template<typename InputIterator>
             static RawSensors unmarshal(InputIterator begin, InputIterator end)
             {
@@ -536,6 +704,25 @@ namespace imu_advanced_navigation_anpp
             /** Bitfield described by RAW_GNSS_STATUS */
             uint16_t status;
 
+            template<typename OutputIterator>
+            OutputIterator marshal(OutputIterator out) const
+            {
+                write32(out + 0, unix_time_seconds);
+                write32(out + 4, unix_time_microseconds);
+                for (int i = 0; i < 3; ++i)
+                {
+                    write64(out + 8 + 8 * i, lat_lon_z[i]);
+                    write32(out + 32 + 4 * i, velocity_ned[i]);
+                    write32(out + 44 + 4 * i, lat_lon_z_stddev[i]);
+                }
+                write32(out + 56, pitch);
+                write32(out + 60, yaw);
+                write32(out + 64, pitch_stddev);
+                write32(out + 68, yaw_stddev);
+                write16(out + 72, status);
+                return out + SIZE;
+            }
+
             template<typename InputIterator>
             static RawGNSS unmarshal(InputIterator begin, InputIterator end)
             {
@@ -594,6 +781,19 @@ namespace imu_advanced_navigation_anpp
             uint8_t galileo_satellite_count;
             uint8_t sbas_satellite_count;
 
+            template<typename OutputIterator>
+            OutputIterator marshal(OutputIterator out) const
+            {
+                write32(out + 0, hdop);
+                write32(out + 4, vdop);
+                out[8] = gps_satellite_count;
+                out[9] = glonass_satellite_count;
+                out[10] = beidou_satellite_count;
+                out[11] = galileo_satellite_count;
+                out[12] = sbas_satellite_count;
+                return out + SIZE;
+            }
+
             template<typename InputIterator>
             static Satellites unmarshal(InputIterator begin, InputIterator end)
             {
@@ -659,6 +859,18 @@ namespace imu_advanced_navigation_anpp
             /** Signal to noise ratio in dB */
             uint8_t snr;
 
+            template<typename OutputIterator>
+            OutputIterator marshal(OutputIterator out) const
+            {
+                out[0] = system;
+                out[1] = prn;
+                out[2] = frequencies;
+                out[3] = elevation;
+                write16(out + 4, azimuth);
+                out[6] = snr;
+                return out + SIZE;
+            }
+
             template<typename InputIterator>
             static SatelliteInfo unmarshal(InputIterator begin, InputIterator end)
             {
@@ -694,6 +906,14 @@ namespace imu_advanced_navigation_anpp
 
             double lat_lon_z[3];
 
+            template<typename OutputIterator>
+            OutputIterator marshal(OutputIterator out) const
+            {
+                for (int i = 0; i < 3; ++i)
+                    write64(out + 8 * i, lat_lon_z[i]);
+                return out + SIZE;
+            }
+
             template<typename InputIterator>
             static GeodeticPosition unmarshal(InputIterator begin, InputIterator end)
             {
@@ -714,6 +934,14 @@ namespace imu_advanced_navigation_anpp
 
             float ned[3];
 
+            template<typename OutputIterator>
+            OutputIterator marshal(OutputIterator out) const
+            {
+                for (int i = 0; i < 3; ++i)
+                    write32(out + 4 * i, ned[i]);
+                return out + SIZE;
+            }
+
             template<typename InputIterator>
             static NEDVelocity unmarshal(InputIterator begin, InputIterator end)
             {
@@ -734,6 +962,14 @@ namespace imu_advanced_navigation_anpp
 
             float xyz[3];
 
+            template<typename OutputIterator>
+            OutputIterator marshal(OutputIterator out) const
+            {
+                for (int i = 0; i < 3; ++i)
+                    write32(out + 4 * i, xyz[i]);
+                return out + SIZE;
+            }
+
             template<typename InputIterator>
             static BodyVelocity unmarshal(InputIterator begin, InputIterator end)
             {
@@ -755,6 +991,14 @@ namespace imu_advanced_navigation_anpp
 
             float xyz[3];
 
+            template<typename OutputIterator>
+            OutputIterator marshal(OutputIterator out) const
+            {
+                for (int i = 0; i < 3; ++i)
+                    write32(out + 4 * i, xyz[i]);
+                return out + SIZE;
+            }
+
             template<typename InputIterator>
             static Acceleration unmarshal(InputIterator begin, InputIterator end)
             {
@@ -776,6 +1020,15 @@ namespace imu_advanced_navigation_anpp
             float xyz[3];
             float g;
 
+            template<typename OutputIterator>
+            OutputIterator marshal(OutputIterator out) const
+            {
+                for (int i = 0; i < 3; ++i)
+                    write32(out + 4 * i, xyz[i]);
+                write32(out + 12, g);
+                return out + SIZE;
+            }
+
             template<typename InputIterator>
             static BodyAcceleration unmarshal(InputIterator begin, InputIterator end)
             {
@@ -801,6 +1054,15 @@ namespace imu_advanced_navigation_anpp
             float im;
             float xyz[3];
 
+            template<typename OutputIterator>
+            OutputIterator marshal(OutputIterator out) const
+            {
+                write32(out, im);
+                for (int i = 0; i < 3; ++i)
+                    write32(out + 4 + 4 * i, xyz[i]);
+                return out + SIZE;
+            }
+
             template<typename InputIterator>
             static QuaternionOrientation unmarshal(InputIterator begin, InputIterator end)
             {
@@ -825,6 +1087,14 @@ namespace imu_advanced_navigation_anpp
 
             float xyz[3];
 
+            template<typename OutputIterator>
+            OutputIterator marshal(OutputIterator out) const
+            {
+                for (int i = 0; i < 3; ++i)
+                    write32(out + 4 * i, xyz[i]);
+                return out + SIZE;
+            }
+
             template<typename InputIterator>
             static AngularVelocity unmarshal(InputIterator begin, InputIterator end)
             {
@@ -845,6 +1115,14 @@ namespace imu_advanced_navigation_anpp
 
             float xyz[3];
 
+            template<typename OutputIterator>
+            OutputIterator marshal(OutputIterator out) const
+            {
+                for (int i = 0; i < 3; ++i)
+                    write32(out + 4 * i, xyz[i]);
+                return out + SIZE;
+            }
+
             template<typename InputIterator>
             static AngularAcceleration unmarshal(InputIterator begin, InputIterator end)
             {
@@ -865,6 +1143,14 @@ namespace imu_advanced_navigation_anpp
 
             float xyz[3];
 
+            template<typename OutputIterator>
+            OutputIterator marshal(OutputIterator out) const
+            {
+                for (int i = 0; i < 3; ++i)
+                    write32(out + 4 * i, xyz[i]);
+                return out + SIZE;
+            }
+
             template<typename InputIterator>
             static LocalMagneticField unmarshal(InputIterator begin, InputIterator end)
             {
@@ -891,6 +1177,19 @@ namespace imu_advanced_navigation_anpp
             float   gyroscope_bias_solution_xyz[3];
             float   gyroscope_bias_solution_error;
 
+            template<typename OutputIterator>
+            OutputIterator marshal(OutputIterator out) const
+            {
+                write16(out, flags);
+                write16(out + 2, reserved);
+                std::copy_n(progress, 4, out + 4);
+                write32(out + 8, current_rotation_angle);
+                for (int i = 0; i < 3; ++i)
+                    write32(out + 12 + 4 * i, gyroscope_bias_solution_xyz[i]);
+                write32(out + 24, gyroscope_bias_solution_error);
+                return out + SIZE;
+            }
+
             template<typename InputIterator>
             static NorthSeekingInitializationStatus unmarshal(InputIterator begin, InputIterator end)
             {
@@ -945,6 +1244,8 @@ namespace imu_advanced_navigation_anpp
             static constexpr uint8_t ID = 181;
             static constexpr int MIN_SIZE = 2;
             static constexpr int PERIOD_SIZE = 5;
+            /** Maximum number of periods that fit in a single packet */
+            static constexpr int MAX_PERIODS = (255 - MIN_SIZE) / PERIOD_SIZE;
 
             typedef std::map<uint8_t, uint32_t> Periods;
 
@@ -1188,6 +1489,15 @@ namespace imu_advanced_navigation_anpp
             uint8_t progress;
             uint8_t error;
 
+            template<typename OutputIterator>
+            OutputIterator marshal(OutputIterator out) const
+            {
+                out[0] = status;
+                out[1] = progress;
+                out[2] = error;
+                return out + SIZE;
+            }
+
             template<typename InputIterator>
             static MagneticCalibrationStatus unmarshal(InputIterator begin, InputIterator end)
             {
@@ -1215,7 +1525,7 @@ namespace imu_advanced_navigation_anpp
         template<typename Packet, typename Driver>
         inline Packet waitForPacket(Driver& driver, base::Time const& _timeout)
         {
-            uint8_t marshalled[MAX_PACKET_SIZE * 10];
+            uint8_t marshalled[DRIVER_BUFFER_SIZE];
             driver.resetPollSynchronization();
 
             base::Timeout timeout(_timeout);
@@ -1264,6 +1574,58 @@ namespace imu_advanced_navigation_anpp
                 throw AcknowledgeFailure(header.packet_id, result);
         }
 
+        /** Wait for the acknowledgments of several packets that have been
+         * sent back-to-back
+         *
+         * The acknowledgments can be received in any order
+         *
+         * @param on_ack called with the header and result of each
+         *   acknowledgment that matches one of the headers, before a failure
+         *   is reported
+         */
+        template<typename Driver, typename Callback>
+        inline void validateAcks(Driver& driver, std::vector<Header> headers, base::Time const& _timeout,
+                                 Callback on_ack)
+        {
+            base::Timeout timeout(_timeout);
+            while (!headers.empty())
+            {
+                base::Time left = timeout.timeLeft();
+                if (left.toMicroseconds() < 0)
+                    left = base::Time();
+                Acknowledge ack = waitForPacket<Acknowledge>(driver, left);
+
+                auto matching = std::find_if(headers.begin(), headers.end(),
+                    [&ack](Header const& header) { return ack.isMatching(header); });
+                if (matching == headers.end())
+                    continue;
+                on_ack(*matching, static_cast<ACK_RESULTS>(ack.result));
+                if (!ack.isSuccess())
+                    throw AcknowledgeFailure(matching->packet_id, static_cast<ACK_RESULTS>(ack.result));
+                headers.erase(matching);
+            }
+        }
+
+        template<typename Driver>
+        inline void validateAcks(Driver& driver, std::vector<Header> const& headers, base::Time const& timeout)
+        {
+            validateAcks(driver, headers, timeout, [](Header const&, ACK_RESULTS) {});
+        }
+
+        /** Request several packets with a single Request packet
+         *
+         * The device sends the packets in the order of the IDs
+         */
+        template<typename Driver>
+        inline void writeRequest(Driver& driver, std::vector<uint8_t> const& packet_ids)
+        {
+            uint8_t marshalled[MAX_PACKET_SIZE];
+            uint8_t* marshalled_end = Request().marshal(
+                marshalled + Header::SIZE, packet_ids.begin(), packet_ids.end());
+            new(marshalled) Header(Request::ID, marshalled + Header::SIZE, marshalled_end);
+            driver.writePacket(marshalled, marshalled_end - marshalled);
+        }
+
         template<typename Packet, typename Driver>
         inline Packet query(Driver& driver)
         {
@@ -1288,6 +1650,26 @@ namespace imu_advanced_navigation_anpp
             driver.writePacket(marshalled, marshalled_end - marshalled);
             return *header;
         }
+
+        /** Set the period of several packets with a single PacketPeriods
+         * packet
+         */
+        template<typename Driver>
+        inline Header writePacketPeriods(Driver& driver, PacketPeriods::Periods const& periods, bool clear_existing, bool permanent = false)
+        {
+            if (periods.size() > static_cast<size_t>(PacketPeriods::MAX_PERIODS))
+                throw std::invalid_argument("too many packet periods to fit in a single packet");
+
+            uint8_t marshalled[MAX_PACKET_SIZE];
+            PacketPeriods packet;
+            packet.permanent = permanent ? 1 : 0;
+            packet.clear_existing = clear_existing ? 1 : 0;
+            uint8_t* marshalled_end = packet.marshal(marshalled + Header::SIZE, periods.begin(), periods.end());
+            Header const* header =
+                new(marshalled) Header(PacketPeriods::ID, marshalled + Header::SIZE, marshalled_end);
+            driver.writePacket(marshalled, marshalled_end - marshalled);
+            return *header;
+        }
     }
 }
 
@@ -0,0 +1,136 @@
+#include <imu_advanced_navigation_anpp/PseudoTerminalSimulator.hpp>
+#include <iodrivers_base/Exceptions.hpp>
+#include <algorithm>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+
+/** Baud rate of a termios speed, zero if it is not a device rate */
+static uint32_t toBaudrate(speed_t speed)
+{
+    switch (speed)
+    {
+        case B1200: return 1200;
+        case B2400: return 2400;
+        case B4800: return 4800;
+        case B9600: return 9600;
+        case B19200: return 19200;
+        case B38400: return 38400;
+        case B57600: return 57600;
+        case B115200: return 115200;
+        case B230400: return 230400;
+        case B460800: return 460800;
+        case B576000: return 576000;
+        case B921600: return 921600;
+        case B1152000: return 1152000;
+        default: return 0;
+    }
+}
+
+PseudoTerminalSimulator::PseudoTerminalSimulator(DeviceSimulator::Options const& options)
+    : mSimulator(options)
+{
+    mMasterFD = posix_openpt(O_RDWR | O_NOCTTY);
+    if (mMasterFD < 0)
+        throw iodrivers_base::UnixError("cannot open a pseudo-terminal");
+    if (grantpt(mMasterFD) != 0 || unlockpt(mMasterFD) != 0)
+    {
+        close(mMasterFD);
+        throw iodrivers_base::UnixError("cannot unlock the pseudo-terminal");
+    }
+    mPath = ptsname(mMasterFD);
+
+    // The slave side is opened as well and kept open, in raw mode. This
+    // prevents the line discipline from echoing what the simulator writes
+    // before the host opened the terminal, keeps the master usable when the
+    // host closes it, and gives access to the speed set by the host
+    mSlaveFD = open(mPath.c_str(), O_RDWR | O_NOCTTY);
+    if (mSlaveFD < 0)
+    {
+        close(mMasterFD);
+        throw iodrivers_base::UnixError("cannot open " + mPath);
+    }
+    struct termios tio;
+    tcgetattr(mSlaveFD, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(mSlaveFD, TCSANOW, &tio);
+
+    fcntl(mMasterFD, F_SETFL, fcntl(mMasterFD, F_GETFL) | O_NONBLOCK);
+}
+
+PseudoTerminalSimulator::~PseudoTerminalSimulator()
+{
+    close(mSlaveFD);
+    close(mMasterFD);
+}
+
+string PseudoTerminalSimulator::getPath() const
+{
+    return mPath;
+}
+
+void PseudoTerminalSimulator::setBaudrateMatching(bool enable)
+{
+    mBaudrateMatching = enable;
+}
+
+bool PseudoTerminalSimulator::isBaudrateMatching() const
+{
+    uint32_t baudrate = mSimulator.getBaudrate();
+    if (!mBaudrateMatching || baudrate == 0)
+        return true;
+
+    struct termios tio;
+    if (tcgetattr(mSlaveFD, &tio) != 0)
+        return false;
+    return toBaudrate(cfgetospeed(&tio)) == baudrate;
+}
+
+void PseudoTerminalSimulator::update()
+{
+    base::Time now = base::Time::now();
+    int timeout_ms = 1;
+    if (mPendingStart == mPendingEnd && mSimulator.getOutputSize() == 0 &&
+        !mSimulator.getNextTick().isNull())
+    {
+        timeout_ms = max<int64_t>(0, (mSimulator.getNextTick() - now).toMilliseconds());
+        timeout_ms = min(timeout_ms, 100);
+    }
+
+    pollfd fd = { mMasterFD, POLLIN, 0 };
+    if (poll(&fd, 1, timeout_ms) > 0 && (fd.revents & POLLIN))
+    {
+        uint8_t input[1024];
+        ssize_t count = read(mMasterFD, input, sizeof(input));
+        if (count > 0 && isBaudrateMatching())
+            mSimulator.receive(input, count);
+    }
+
+    now = base::Time::now();
+    mSimulator.update(now);
+    if (mPendingStart == mPendingEnd)
+    {
+        mPendingStart = 0;
+        mPendingEnd = mSimulator.readOutput(mPending, sizeof(mPending), now);
+        if (!isBaudrateMatching())
+            mPendingEnd = 0;
+    }
+    if (mPendingStart != mPendingEnd)
+    {
+        // Nobody reading the terminal makes write() fail with EAGAIN.
+        // The data then accumulates in the simulator, which drops
+        // packets as the device would
+        ssize_t written = write(mMasterFD, mPending + mPendingStart, mPendingEnd - mPendingStart);
+        if (written > 0)
+            mPendingStart += written;
+    }
+}
+
+DeviceSimulator const& PseudoTerminalSimulator::getSimulator() const
+{
+    return mSimulator;
+}
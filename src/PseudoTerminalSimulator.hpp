@@ -0,0 +1,60 @@
+#ifndef ADVANCED_NAVIGATION_ANPP_PSEUDO_TERMINAL_SIMULATOR_HPP
+#define ADVANCED_NAVIGATION_ANPP_PSEUDO_TERMINAL_SIMULATOR_HPP
+
+#include <string>
+#include <imu_advanced_navigation_anpp/DeviceSimulator.hpp>
+
+namespace imu_advanced_navigation_anpp
+{
+    /** Serves a DeviceSimulator on a pseudo-terminal
+     *
+     * The host opens the slave side, whose path is given by getPath(), as it
+     * would open the serial port of a device.
+     *
+     * A pseudo-terminal transfers the bytes regardless of its configured
+     * speed. To behave like a serial line, the bytes are discarded in both
+     * directions while the terminal speed set by the host differs from the
+     * simulated baud rate, as a UART at the wrong rate only receives framing
+     * errors. This can be disabled with setBaudrateMatching().
+     */
+    class PseudoTerminalSimulator
+    {
+        DeviceSimulator mSimulator;
+        std::string mPath;
+        int mMasterFD = -1;
+        int mSlaveFD = -1;
+        bool mBaudrateMatching = true;
+
+        uint8_t mPending[4096];
+        size_t mPendingStart = 0;
+        size_t mPendingEnd = 0;
+
+        bool isBaudrateMatching() const;
+
+    public:
+        explicit PseudoTerminalSimulator(DeviceSimulator::Options const& options);
+        ~PseudoTerminalSimulator();
+
+        PseudoTerminalSimulator(PseudoTerminalSimulator const&) = delete;
+        PseudoTerminalSimulator& operator=(PseudoTerminalSimulator const&) = delete;
+
+        /** Path of the slave side of the pseudo-terminal */
+        std::string getPath() const;
+
+        /** Whether the bytes are discarded while the terminal speed does not
+         * match the simulated baud rate. It is enabled by default */
+        void setBaudrateMatching(bool enable);
+
+        /** Exchange the bytes with the host and advance the simulator
+         *
+         * It waits for at most 100ms for bytes from the host, and at most
+         * 1ms while there is something to send, so that the output follows
+         * the simulated baud rate. Call it in a loop.
+         */
+        void update();
+
+        DeviceSimulator const& getSimulator() const;
+    };
+}
+
+#endif
@@ -0,0 +1,333 @@
+#include <imu_advanced_navigation_anpp/SimulatedTelemetry.hpp>
+#include <imu_advanced_navigation_anpp/Protocol.hpp>
+#include <cstring>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+using protocol::appendPacket;
+
+static const uint8_t SUPPORTED_PACKET_IDS[] = {
+    protocol::SystemState::ID,
+    protocol::UnixTime::ID,
+    protocol::Status::ID,
+    protocol::GeodeticPositionStandardDeviation::ID,
+    protocol::NEDVelocityStandardDeviation::ID,
+    protocol::EulerOrientationStandardDeviation::ID,
+    protocol::RawSensors::ID,
+    protocol::RawGNSS::ID,
+    protocol::Satellites::ID,
+    protocol::DetailedSatellites::ID,
+    protocol::GeodeticPosition::ID,
+    protocol::NEDVelocity::ID,
+    protocol::BodyVelocity::ID,
+    protocol::Acceleration::ID,
+    protocol::BodyAcceleration::ID,
+    protocol::QuaternionOrientation::ID,
+    protocol::AngularVelocity::ID,
+    protocol::AngularAcceleration::ID,
+    protocol::LocalMagneticField::ID,
+    protocol::NorthSeekingInitializationStatus::ID
+};
+
+static const double EARTH_RADIUS = 6378137;
+static const double GRAVITY = 9.81;
+static const double ORIGIN_LATITUDE = 53.1 * M_PI / 180;
+static const double ORIGIN_LONGITUDE = 8.85 * M_PI / 180;
+static const double ORIGIN_ALTITUDE = 10;
+static const double CIRCLE_RADIUS = 20;
+static const double TURN_RATE = 2 * M_PI / 60;
+static const double ROLL_AMPLITUDE = 0.05;
+static const double ROLL_FREQUENCY = 2 * M_PI * 0.2;
+static const double PITCH_AMPLITUDE = 0.03;
+static const double PITCH_FREQUENCY = 2 * M_PI * 0.13;
+/** Earth magnetic field in the NED frame, in mG */
+static const Eigen::Vector3d MAGNETIC_FIELD(190, 0, 450);
+
+static const uint16_t SIMULATED_FILTER_STATUS =
+    FILTER_ORIENTATION_INITIALIZED | FILTER_NAVIGATION_INITIALIZED |
+    FILTER_HEADING_INITIALIZED | FILTER_UTC_INITIALIZED |
+    (GNSS_3D << 4) | FILTER_INTERNAL_GNSS_ENABLED;
+
+/** Copy a vector into a float[3] field of a packed packet struct */
+static void copyVector(void* out, Eigen::Vector3d const& in)
+{
+    float values[3] = { static_cast<float>(in.x()), static_cast<float>(in.y()), static_cast<float>(in.z()) };
+    memcpy(out, values, sizeof(values));
+}
+
+SimulatedTelemetry::SimulatedTelemetry(uint32_t seed)
+    : mRandom(seed)
+{
+}
+
+bool SimulatedTelemetry::isSupported(uint8_t packet_id)
+{
+    return find(begin(SUPPORTED_PACKET_IDS), end(SUPPORTED_PACKET_IDS), packet_id) !=
+        end(SUPPORTED_PACKET_IDS);
+}
+
+void SimulatedTelemetry::setNoise(double scale)
+{
+    mNoise = scale;
+}
+
+void SimulatedTelemetry::setSystemStatus(uint16_t status)
+{
+    mSystemStatus = status;
+}
+
+void SimulatedTelemetry::update(base::Time const& time)
+{
+    if (mStartTime.isNull())
+        mStartTime = time;
+
+    State& state = mState;
+    state.time = time;
+
+    double t = (time - mStartTime).toSeconds();
+    double heading = TURN_RATE * t;
+    double roll = ROLL_AMPLITUDE * sin(ROLL_FREQUENCY * t);
+    double pitch = PITCH_AMPLITUDE * sin(PITCH_FREQUENCY * t);
+    double speed = CIRCLE_RADIUS * TURN_RATE;
+
+    state.position = Eigen::Vector3d(
+        CIRCLE_RADIUS * sin(heading), CIRCLE_RADIUS * (1 - cos(heading)), 0);
+    state.velocity_ned = Eigen::Vector3d(speed * cos(heading), speed * sin(heading), 0);
+    state.body_velocity = Eigen::Vector3d(speed, 0, 0);
+    state.body_acceleration = Eigen::Vector3d(0, speed * TURN_RATE, 0);
+    state.rpy = Eigen::Vector3d(roll, pitch, atan2(sin(heading), cos(heading)));
+    state.angular_velocity = Eigen::Vector3d(
+        ROLL_AMPLITUDE * ROLL_FREQUENCY * cos(ROLL_FREQUENCY * t),
+        PITCH_AMPLITUDE * PITCH_FREQUENCY * cos(PITCH_FREQUENCY * t),
+        TURN_RATE);
+    state.angular_acceleration = Eigen::Vector3d(
+        -ROLL_AMPLITUDE * ROLL_FREQUENCY * ROLL_FREQUENCY * sin(ROLL_FREQUENCY * t),
+        -PITCH_AMPLITUDE * PITCH_FREQUENCY * PITCH_FREQUENCY * sin(PITCH_FREQUENCY * t),
+        0);
+
+    Eigen::Vector3d gravity_in_body(
+        -GRAVITY * sin(pitch),
+        GRAVITY * sin(roll) * cos(pitch),
+        GRAVITY * cos(roll) * cos(pitch));
+    Eigen::Matrix3d body2ned =
+        (Eigen::AngleAxisd(heading, Eigen::Vector3d::UnitZ()) *
+         Eigen::AngleAxisd(pitch, Eigen::Vector3d::UnitY()) *
+         Eigen::AngleAxisd(roll, Eigen::Vector3d::UnitX())).toRotationMatrix();
+    state.accelerometers = state.body_acceleration - gravity_in_body;
+    state.gyroscopes = state.angular_velocity;
+    state.magnetometers = body2ned.transpose() * MAGNETIC_FIELD;
+
+    if (mNoise > 0)
+    {
+        normal_distribution<double> normal(0, mNoise);
+        auto noise = [&](double stddev) -> Eigen::Vector3d {
+            return stddev * Eigen::Vector3d(normal(mRandom), normal(mRandom), normal(mRandom));
+        };
+        state.position += noise(0.3);
+        state.velocity_ned += noise(0.05);
+        state.rpy += noise(0.002);
+        state.accelerometers += noise(0.02);
+        state.gyroscopes += noise(0.001);
+        state.magnetometers += noise(2);
+    }
+
+    state.latitude = ORIGIN_LATITUDE + state.position.x() / EARTH_RADIUS;
+    state.longitude = ORIGIN_LONGITUDE + state.position.y() / (EARTH_RADIUS * cos(ORIGIN_LATITUDE));
+    state.altitude = ORIGIN_ALTITUDE - state.position.z();
+}
+
+bool SimulatedTelemetry::append(uint8_t packet_id, vector<uint8_t>& out) const
+{
+    State const& state = mState;
+    uint64_t time_us = state.time.toMicroseconds();
+    uint16_t system_status = mSystemStatus;
+    Eigen::Vector3d position_stddev(0.5, 0.5, 0.8);
+    Eigen::Vector3d velocity_stddev(0.05, 0.05, 0.08);
+    Eigen::Vector3d orientation_stddev(0.005, 0.005, 0.01);
+    Eigen::Quaterniond orientation =
+        Eigen::AngleAxisd(state.rpy.z(), Eigen::Vector3d::UnitZ()) *
+        Eigen::AngleAxisd(state.rpy.y(), Eigen::Vector3d::UnitY()) *
+        Eigen::AngleAxisd(state.rpy.x(), Eigen::Vector3d::UnitX());
+
+    switch (packet_id)
+    {
+        case protocol::SystemState::ID:
+        {
+            protocol::SystemState packet;
+            packet.system_status = system_status;
+            packet.filter_status = SIMULATED_FILTER_STATUS;
+            packet.unix_time_seconds = time_us / 1000000;
+            packet.unix_time_microseconds = time_us % 1000000;
+            packet.lat_lon_z[0] = state.latitude;
+            packet.lat_lon_z[1] = state.longitude;
+            packet.lat_lon_z[2] = state.altitude;
+            copyVector(packet.velocity_ned, state.velocity_ned);
+            copyVector(packet.body_acceleration_xyz, state.body_acceleration);
+            packet.g = GRAVITY;
+            copyVector(packet.rpy, state.rpy);
+            copyVector(packet.angular_velocity, state.angular_velocity);
+            copyVector(packet.lat_lon_z_stddev, position_stddev);
+            appendPacket(out, packet);
+            return true;
+        }
+        case protocol::UnixTime::ID:
+            appendPacket(out, protocol::UnixTime {
+                static_cast<uint32_t>(time_us / 1000000),
+                static_cast<uint32_t>(time_us % 1000000) });
+            return true;
+        case protocol::Status::ID:
+            appendPacket(out, protocol::Status { system_status, SIMULATED_FILTER_STATUS });
+            return true;
+        case protocol::GeodeticPositionStandardDeviation::ID:
+        {
+            protocol::GeodeticPositionStandardDeviation packet;
+            copyVector(packet.lat_lon_z_stddev, position_stddev);
+            appendPacket(out, packet);
+            return true;
+        }
+        case protocol::NEDVelocityStandardDeviation::ID:
+        {
+            protocol::NEDVelocityStandardDeviation packet;
+            copyVector(packet.ned, velocity_stddev);
+            appendPacket(out, packet);
+            return true;
+        }
+        case protocol::EulerOrientationStandardDeviation::ID:
+        {
+            protocol::EulerOrientationStandardDeviation packet;
+            copyVector(packet.rpy, orientation_stddev);
+            appendPacket(out, packet);
+            return true;
+        }
+        case protocol::RawSensors::ID:
+        {
+            protocol::RawSensors packet;
+            copyVector(packet.accelerometers_xyz, state.accelerometers);
+            copyVector(packet.gyroscopes_xyz, state.gyroscopes);
+            copyVector(packet.magnetometers_xyz, state.magnetometers);
+            packet.imu_temperature_C = 25;
+            packet.pressure = 101325 - 12 * state.altitude;
+            packet.pressure_temperature_C = 25;
+            appendPacket(out, packet);
+            return true;
+        }
+        case protocol::RawGNSS::ID:
+        {
+            protocol::RawGNSS packet;
+            packet.unix_time_seconds = time_us / 1000000;
+            packet.unix_time_microseconds = time_us % 1000000;
+            packet.lat_lon_z[0] = state.latitude;
+            packet.lat_lon_z[1] = state.longitude;
+            packet.lat_lon_z[2] = state.altitude;
+            copyVector(packet.velocity_ned, state.velocity_ned);
+            copyVector(packet.lat_lon_z_stddev, position_stddev);
+            packet.pitch = 0;
+            packet.yaw = 0;
+            packet.pitch_stddev = 0;
+            packet.yaw_stddev = 0;
+            packet.status = protocol::RAW_GNSS_3D | protocol::RAW_GNSS_HAS_DOPPLER_VELOCITY |
+                protocol::RAW_GNSS_HAS_TIME;
+            appendPacket(out, packet);
+            return true;
+        }
+        case protocol::Satellites::ID:
+            appendPacket(out, protocol::Satellites { 0.9, 1.3, 9, 6, 0, 5, 1 });
+            return true;
+        case protocol::DetailedSatellites::ID:
+        {
+            uint8_t payload[protocol::MAX_PACKET_SIZE];
+            uint8_t* payload_end = payload;
+            double t = (state.time - mStartTime).toSeconds();
+            for (int i = 0; i < 10; ++i)
+            {
+                protocol::SatelliteInfo info;
+                info.system = (i < 6) ? protocol::SATELLITE_SYSTEM_GPS : protocol::SATELLITE_SYSTEM_GALILEO;
+                info.prn = i + 1;
+                info.frequencies = protocol::SATELLITE_FREQUENCY_L1CA | protocol::SATELLITE_FREQUENCY_L2C;
+                info.elevation = 15 + 7 * i;
+                info.azimuth = static_cast<uint16_t>(36 * i + t / 60) % 360;
+                info.snr = 35 + i;
+                payload_end = info.marshal(payload_end);
+            }
+            appendPacket(out, protocol::DetailedSatellites::ID, payload, payload_end);
+            return true;
+        }
+        case protocol::GeodeticPosition::ID:
+            appendPacket(out, protocol::GeodeticPosition {
+                { state.latitude, state.longitude, state.altitude } });
+            return true;
+        case protocol::NEDVelocity::ID:
+        {
+            protocol::NEDVelocity packet;
+            copyVector(packet.ned, state.velocity_ned);
+            appendPacket(out, packet);
+            return true;
+        }
+        case protocol::BodyVelocity::ID:
+        {
+            protocol::BodyVelocity packet;
+            copyVector(packet.xyz, state.body_velocity);
+            appendPacket(out, packet);
+            return true;
+        }
+        case protocol::Acceleration::ID:
+        {
+            protocol::Acceleration packet;
+            copyVector(packet.xyz, state.body_acceleration);
+            appendPacket(out, packet);
+            return true;
+        }
+        case protocol::BodyAcceleration::ID:
+        {
+            protocol::BodyAcceleration packet;
+            copyVector(packet.xyz, state.body_acceleration);
+            packet.g = GRAVITY;
+            appendPacket(out, packet);
+            return true;
+        }
+        case protocol::QuaternionOrientation::ID:
+        {
+            protocol::QuaternionOrientation packet;
+            packet.im = orientation.w();
+            packet.xyz[0] = orientation.x();
+            packet.xyz[1] = orientation.y();
+            packet.xyz[2] = orientation.z();
+            appendPacket(out, packet);
+            return true;
+        }
+        case protocol::AngularVelocity::ID:
+        {
+            protocol::AngularVelocity packet;
+            copyVector(packet.xyz, state.angular_velocity);
+            appendPacket(out, packet);
+            return true;
+        }
+        case protocol::AngularAcceleration::ID:
+        {
+            protocol::AngularAcceleration packet;
+            copyVector(packet.xyz, state.angular_acceleration);
+            appendPacket(out, packet);
+            return true;
+        }
+        case protocol::LocalMagneticField::ID:
+        {
+            protocol::LocalMagneticField packet;
+            copyVector(packet.xyz, MAGNETIC_FIELD);
+            appendPacket(out, packet);
+            return true;
+        }
+        case protocol::NorthSeekingInitializationStatus::ID:
+        {
+            protocol::NorthSeekingInitializationStatus packet;
+            packet.flags = NORTH_SEEKING_INITIALIZATION_COMPLETE;
+            fill_n(packet.progress, 4, 100);
+            packet.current_rotation_angle = 0;
+            copyVector(packet.gyroscope_bias_solution_xyz, Eigen::Vector3d::Zero());
+            packet.gyroscope_bias_solution_error = 0;
+            appendPacket(out, packet);
+            return true;
+        }
+        default:
+            return false;
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef ADVANCED_NAVIGATION_ANPP_SIMULATED_TELEMETRY_HPP
+#define ADVANCED_NAVIGATION_ANPP_SIMULATED_TELEMETRY_HPP
+
+#include <random>
+#include <vector>
+#include <base/Time.hpp>
+#include <base/Eigen.hpp>
+
+namespace imu_advanced_navigation_anpp
+{
+    /** Generates the periodic packets of a simulated device
+     *
+     * The simulated vehicle drives on a 20m radius circle at one turn per
+     * minute while rolling and pitching slightly, which gives non-trivial
+     * and mutually consistent values in all the packets.
+     *
+     * This is shared by DeviceSimulator and StreamGenerator
+     */
+    class SimulatedTelemetry
+    {
+        /** The state of the simulated vehicle at a given time */
+        struct State
+        {
+            base::Time time;
+            /** Position in the local NED frame, in meters */
+            Eigen::Vector3d position;
+            double latitude;
+            double longitude;
+            double altitude;
+            Eigen::Vector3d velocity_ned;
+            Eigen::Vector3d body_velocity;
+            /** Acceleration in the body frame, without gravity */
+            Eigen::Vector3d body_acceleration;
+            Eigen::Vector3d rpy;
+            Eigen::Vector3d angular_velocity;
+            Eigen::Vector3d angular_acceleration;
+            /** Accelerometer measurement, i.e. the specific force */
+            Eigen::Vector3d accelerometers;
+            Eigen::Vector3d gyroscopes;
+            Eigen::Vector3d magnetometers;
+        };
+
+        std::mt19937 mRandom;
+        double mNoise = 0;
+        uint16_t mSystemStatus = 0;
+        base::Time mStartTime;
+        State mState;
+
+    public:
+        explicit SimulatedTelemetry(uint32_t seed = 0);
+
+        /** Whether append() can generate the given packet */
+        static bool isSupported(uint8_t packet_id);
+
+        /** Scale of the noise added to the signals
+         *
+         * 1 is roughly the noise level of the device's own sensors, 0
+         * disables the noise (the default)
+         */
+        void setNoise(double scale);
+
+        /** The system status reported in the SystemState and Status packets */
+        void setSystemStatus(uint16_t status);
+
+        /** Compute the state of the vehicle at the given time
+         *
+         * The first call defines the start of the trajectory
+         */
+        void update(base::Time const& time);
+
+        /** Marshal a packet for the last updated state and append it,
+         * header included, to a buffer
+         *
+         * @return false if the packet is not supported, in which case
+         *   nothing is appended
+         */
+        bool append(uint8_t packet_id, std::vector<uint8_t>& out) const;
+    };
+}
+
+#endif
@@ -0,0 +1,103 @@
+#include <iostream>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <imu_advanced_navigation_anpp/PseudoTerminalSimulator.hpp>
+#include <iodrivers_base/Exceptions.hpp>
+#include <unistd.h>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+
+int usage()
+{
+    cerr
+        << "Usage: imu_advanced_navigation_anpp_simulator [OPTIONS]\n"
+        << "Simulates an ANPP device on a pseudo-terminal, whose path is printed\n"
+        << "on startup. Options:\n"
+        << "  --baudrate=RATE  baud rate of the simulated line, 0 for no limit (default 115200)\n"
+        << "  --buffer=SIZE    size of the device output buffer in bytes (default 4096)\n"
+        << "  --noise=SCALE    sensor noise, 1 being the typical device noise (default 0)\n"
+        << "  --corrupt=RATE   probability for a sent packet to be corrupted (default 0)\n"
+        << "  --saturate       generate packet trains as fast as the line allows\n"
+        << "  --seed=SEED      seed of the noise and corruption generator\n"
+        << "  --any-speed      exchange bytes whatever the terminal speed set by the host.\n"
+        << "                   By default, they are discarded if it does not match the baud rate\n"
+        << "  --link=PATH      create a symbolic link to the pseudo-terminal\n";
+    return 1;
+}
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void handleInterrupt(int)
+{
+    interrupted = 1;
+}
+
+static void installInterruptHandler()
+{
+    // No SA_RESTART, so that poll() is interrupted on Ctrl+C
+    struct sigaction action = {};
+    action.sa_handler = handleInterrupt;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+}
+
+int main(int argc, char** argv)
+{
+    DeviceSimulator::Options options;
+    string link;
+    bool baudrate_matching = true;
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg.compare(0, 11, "--baudrate=") == 0)
+            options.baudrate = stoul(arg.substr(11));
+        else if (arg.compare(0, 9, "--buffer=") == 0)
+            options.output_buffer_size = stoul(arg.substr(9));
+        else if (arg.compare(0, 8, "--noise=") == 0)
+            options.noise = stod(arg.substr(8));
+        else if (arg.compare(0, 10, "--corrupt=") == 0)
+            options.corruption_rate = stod(arg.substr(10));
+        else if (arg == "--saturate")
+            options.saturate = true;
+        else if (arg.compare(0, 7, "--seed=") == 0)
+            options.seed = stoul(arg.substr(7));
+        else if (arg == "--any-speed")
+            baudrate_matching = false;
+        else if (arg.compare(0, 7, "--link=") == 0)
+            link = arg.substr(7);
+        else
+        {
+            cerr << "invalid argument '" << arg << "'\n";
+            return usage();
+        }
+    }
+
+    PseudoTerminalSimulator terminal(options);
+    terminal.setBaudrateMatching(baudrate_matching);
+    if (!link.empty())
+    {
+        unlink(link.c_str());
+        if (symlink(terminal.getPath().c_str(), link.c_str()) != 0)
+            throw iodrivers_base::UnixError("cannot create " + link);
+    }
+    cout << terminal.getPath() << endl;
+
+    installInterruptHandler();
+    while (!interrupted)
+        terminal.update();
+
+    if (!link.empty())
+        unlink(link.c_str());
+
+    auto const& stats = terminal.getSimulator().getStatistics();
+    cout
+        << "received " << stats.received_packets << " packets"
+        << " (" << stats.rejected_bytes << " rejected bytes)\n"
+        << "sent " << stats.sent_packets << " packets, " << stats.sent_bytes << " bytes\n"
+        << "dropped " << stats.dropped_packets << " packets on output overflow\n"
+        << "corrupted " << stats.corrupted_packets << " packets\n"
+        << "handled " << stats.resets << " resets" << endl;
+    return 0;
+}
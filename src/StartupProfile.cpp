@@ -0,0 +1,137 @@
+#include <imu_advanced_navigation_anpp/StartupProfile.hpp>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+
+const size_t StartupProfiler::NO_STEP;
+
+base::Time StartupProfile::getDuration() const
+{
+    if (steps.empty())
+        return base::Time();
+
+    base::Time end;
+    for (auto const& step : steps)
+        end = max(end, step.start + step.duration);
+    return end - steps.front().start;
+}
+
+int StartupProfile::getRoundTrips() const
+{
+    int round_trips = 0;
+    for (auto const& step : steps)
+    {
+        if (step.depth == 0)
+            round_trips += step.round_trips;
+    }
+    return round_trips;
+}
+
+base::Time StartupProfile::getAckWait() const
+{
+    base::Time ack_wait;
+    for (auto const& step : steps)
+    {
+        if (step.depth == 0)
+            ack_wait = ack_wait + step.ack_wait;
+    }
+    return ack_wait;
+}
+
+static double toMilliseconds(base::Time const& time)
+{
+    return time.toMicroseconds() / 1000.0;
+}
+
+void StartupProfile::write(ostream& out) const
+{
+    ios::fmtflags flags = out.flags();
+    out << left << setw(36) << "step" << right
+        << setw(11) << "start(ms)" << setw(14) << "duration(ms)"
+        << setw(13) << "round-trips" << setw(14) << "ack-wait(ms)" << "\n";
+
+    out << fixed << setprecision(3);
+    base::Time origin = steps.empty() ? base::Time() : steps.front().start;
+    for (auto const& step : steps)
+    {
+        ostringstream name;
+        name << string(step.depth * 2, ' ') << step.name;
+        if (step.packet_id >= 0)
+            name << "(" << step.packet_id << ")";
+
+        out << left << setw(36) << name.str() << right
+            << setw(11) << toMilliseconds(step.start - origin)
+            << setw(14) << toMilliseconds(step.duration)
+            << setw(13) << step.round_trips
+            << setw(14) << toMilliseconds(step.ack_wait) << "\n";
+    }
+    out << left << setw(36) << "total" << right
+        << setw(11) << "" << setw(14) << toMilliseconds(getDuration())
+        << setw(13) << getRoundTrips()
+        << setw(14) << toMilliseconds(getAckWait()) << "\n";
+    out.flags(flags);
+}
+
+void StartupProfiler::setEnabled(bool enable)
+{
+    mEnabled = enable;
+}
+
+bool StartupProfiler::isEnabled() const
+{
+    return mEnabled;
+}
+
+size_t StartupProfiler::begin(char const* name, int packet_id)
+{
+    if (!mEnabled)
+        return NO_STEP;
+
+    StartupStep step;
+    step.name = name;
+    step.packet_id = packet_id;
+    step.depth = mOpenSteps.size();
+    step.start = base::Time::now();
+    mProfile.steps.push_back(step);
+    mOpenSteps.push_back(mProfile.steps.size() - 1);
+    return mOpenSteps.back();
+}
+
+void StartupProfiler::end(size_t step)
+{
+    // The profiler may have been reset or disabled within the step
+    if (step == NO_STEP || mOpenSteps.empty() || mOpenSteps.back() != step)
+        return;
+
+    StartupStep& ended = mProfile.steps[step];
+    ended.duration = base::Time::now() - ended.start;
+    mOpenSteps.pop_back();
+}
+
+bool StartupProfiler::isRecording() const
+{
+    return !mOpenSteps.empty();
+}
+
+void StartupProfiler::addRoundTrip(base::Time const& ack_wait)
+{
+    for (size_t step : mOpenSteps)
+    {
+        mProfile.steps[step].round_trips++;
+        mProfile.steps[step].ack_wait = mProfile.steps[step].ack_wait + ack_wait;
+    }
+}
+
+StartupProfile const& StartupProfiler::getProfile() const
+{
+    return mProfile;
+}
+
+void StartupProfiler::reset()
+{
+    mProfile.steps.clear();
+    mOpenSteps.clear();
+}
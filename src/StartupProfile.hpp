@@ -0,0 +1,134 @@
+#ifndef ADVANCED_NAVIGATION_ANPP_STARTUP_PROFILE_HPP
+#define ADVANCED_NAVIGATION_ANPP_STARTUP_PROFILE_HPP
+
+#include <iosfwd>
+#include <vector>
+#include <base/Time.hpp>
+
+namespace imu_advanced_navigation_anpp
+{
+    /** Timing of one of the driver methods that configure the device */
+    struct StartupStep
+    {
+        /** Name of the driver method, e.g. "setPacketPeriod" */
+        char const* name = nullptr;
+        /** Packet the step configures, -1 if not relevant */
+        int packet_id = -1;
+        /** Nesting level, e.g. the clearPeriodicPackets() step done by
+         * openURI() has a depth of 1
+         */
+        int depth = 0;
+        base::Time start;
+        base::Time duration;
+        /** Number of exchanges with the device (a request or group of
+         * commands and its responses) done during the step, nested steps
+         * included
+         */
+        int round_trips = 0;
+        /** Time spent waiting for the device's acknowledgments and
+         * responses, nested steps included
+         */
+        base::Time ack_wait;
+    };
+
+    /** Timing breakdown of the device configuration, as recorded by the
+     * driver. See Driver::setStartupProfilingEnabled
+     */
+    struct StartupProfile
+    {
+        /** The steps, in the order they started */
+        std::vector<StartupStep> steps;
+
+        /** Time between the start of the first step and the end of the
+         * last one
+         */
+        base::Time getDuration() const;
+
+        /** Round trips of the top-level steps */
+        int getRoundTrips() const;
+
+        /** Time waiting for the device in the top-level steps */
+        base::Time getAckWait() const;
+
+        /** Write the steps as an indented table */
+        void write(std::ostream& out) const;
+    };
+
+    /** Recording of a StartupProfile
+     *
+     * Recording is disabled by default. When disabled, all methods return
+     * right away
+     */
+    class StartupProfiler
+    {
+        bool mEnabled = false;
+        StartupProfile mProfile;
+        /** Indexes in mProfile.steps of the steps being recorded */
+        std::vector<size_t> mOpenSteps;
+
+    public:
+        static const size_t NO_STEP = static_cast<size_t>(-1);
+
+        void setEnabled(bool enable);
+        bool isEnabled() const;
+
+        /** Start a step, nested in the steps already started
+         *
+         * @return the step index to pass to end(), NO_STEP if disabled
+         */
+        size_t begin(char const* name, int packet_id = -1);
+
+        /** End a step started by begin() */
+        void end(size_t step);
+
+        /** Whether there is a step to attribute round trips to */
+        bool isRecording() const;
+
+        /** Add a round trip to all the steps being recorded */
+        void addRoundTrip(base::Time const& ack_wait);
+
+        StartupProfile const& getProfile() const;
+        void reset();
+    };
+
+    /** Records a startup step for the lifetime of the object */
+    class StartupStepScope
+    {
+        StartupProfiler& mProfiler;
+        size_t mStep;
+
+    public:
+        StartupStepScope(StartupProfiler& profiler, char const* name, int packet_id = -1)
+            : mProfiler(profiler)
+            , mStep(profiler.begin(name, packet_id)) {}
+        ~StartupStepScope() { mProfiler.end(mStep); }
+
+        StartupStepScope(StartupStepScope const&) = delete;
+        StartupStepScope& operator = (StartupStepScope const&) = delete;
+    };
+
+    /** Records a round trip to the device for the lifetime of the object */
+    class StartupRoundTripScope
+    {
+        StartupProfiler& mProfiler;
+        base::Time mStart;
+
+    public:
+        explicit StartupRoundTripScope(StartupProfiler& profiler)
+            : mProfiler(profiler)
+        {
+            if (profiler.isRecording())
+                mStart = base::Time::now();
+        }
+        ~StartupRoundTripScope()
+        {
+            if (!mStart.isNull())
+                mProfiler.addRoundTrip(base::Time::now() - mStart);
+        }
+
+        StartupRoundTripScope(StartupRoundTripScope const&) = delete;
+        StartupRoundTripScope& operator = (StartupRoundTripScope const&) = delete;
+    };
+}
+
+#endif
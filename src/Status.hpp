@@ -46,7 +46,10 @@ namespace imu_advanced_navigation_anpp
         NorthSeekingInitializationStatus north_seeking;
 
         Status()
-            : gnss_extra_status(0) {}
+            : system_status(0)
+            , filter_status(0)
+            , gnss_solution_status(GNSS_NO_FIX)
+            , gnss_extra_status(0) {}
 
         bool isOrientationInitialized() const
         {
@@ -0,0 +1,171 @@
+#include <imu_advanced_navigation_anpp/StreamGenerator.hpp>
+#include <imu_advanced_navigation_anpp/Protocol.hpp>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+using protocol::Header;
+
+static const size_t MAX_GARBAGE_SIZE = 32;
+static const size_t MAX_PAYLOAD_SIZE = protocol::MAX_PACKET_SIZE - Header::SIZE - 1;
+
+const size_t StreamGenerator::DEFAULT_RANDOM_PAYLOAD_SIZE;
+
+StreamGenerator::StreamGenerator(uint32_t seed)
+    : mRandom(seed)
+    , mTelemetry(seed)
+    , mPacketTimerPeriod(base::Time::fromMilliseconds(1))
+    , mTime(base::Time::fromSeconds(1577836800))
+{
+}
+
+void StreamGenerator::setPacketPeriods(map<uint8_t, uint32_t> const& periods)
+{
+    for (auto const& period : periods)
+    {
+        if (period.second == 0)
+            throw invalid_argument("packet periods must be strictly positive");
+    }
+    mPeriods = periods;
+}
+
+void StreamGenerator::setPacketTimerPeriod(base::Time const& period)
+{
+    if (period <= base::Time())
+        throw invalid_argument("the packet timer period must be strictly positive");
+    mPacketTimerPeriod = period;
+}
+
+void StreamGenerator::setRandomPayloadSize(uint8_t packet_id, size_t size)
+{
+    if (size > MAX_PAYLOAD_SIZE)
+        throw invalid_argument("ANPP payloads are limited to 255 bytes");
+    mRandomPayloadSizes[packet_id] = size;
+}
+
+void StreamGenerator::setCorruption(Corruption const& corruption)
+{
+    mCorruption = corruption;
+}
+
+void StreamGenerator::setNoise(double scale)
+{
+    mTelemetry.setNoise(scale);
+}
+
+bool StreamGenerator::randomEvent(double probability)
+{
+    return probability > 0 && uniform_real_distribution<double>(0, 1)(mRandom) < probability;
+}
+
+size_t StreamGenerator::generateTrain(vector<uint8_t>& out)
+{
+    size_t start = out.size();
+    mTelemetry.update(mTime);
+
+    // std::map is sorted by packet ID, which is the order in which the
+    // device sends the packets of a train
+    for (auto const& period : mPeriods)
+    {
+        if (mTick % period.second != 0)
+            continue;
+
+        if (randomEvent(mCorruption.garbage))
+            appendGarbage(out);
+        if (randomEvent(mCorruption.false_header))
+            appendFalseHeader(out);
+
+        mPacket.clear();
+        appendPacket(period.first, mPacket);
+
+        bool valid = true;
+        if (randomEvent(mCorruption.bit_flip))
+        {
+            size_t bit = uniform_int_distribution<size_t>(0, mPacket.size() * 8 - 1)(mRandom);
+            mPacket[bit / 8] ^= 1 << (bit % 8);
+            mStatistics.bit_flips++;
+            valid = false;
+        }
+        if (randomEvent(mCorruption.truncation))
+        {
+            size_t size = uniform_int_distribution<size_t>(1, mPacket.size() - 1)(mRandom);
+            mPacket.resize(size);
+            mStatistics.truncations++;
+            valid = false;
+        }
+        if (valid)
+        {
+            mStatistics.valid_packets++;
+            mStatistics.valid_packets_by_id[period.first]++;
+        }
+        out.insert(out.end(), mPacket.begin(), mPacket.end());
+    }
+
+    mStatistics.trains++;
+    mStatistics.bytes += out.size() - start;
+    mTick++;
+    mTime = mTime + mPacketTimerPeriod;
+    return out.size() - start;
+}
+
+size_t StreamGenerator::generate(vector<uint8_t>& out, size_t min_size)
+{
+    if (mPeriods.empty())
+        throw logic_error("StreamGenerator::generate called without any packet period");
+
+    size_t start = out.size();
+    while (out.size() - start < min_size)
+        generateTrain(out);
+    return out.size() - start;
+}
+
+void StreamGenerator::appendPacket(uint8_t packet_id, vector<uint8_t>& out)
+{
+    if (mTelemetry.append(packet_id, out))
+        return;
+
+    auto size_it = mRandomPayloadSizes.find(packet_id);
+    size_t size = (size_it == mRandomPayloadSizes.end()) ?
+        DEFAULT_RANDOM_PAYLOAD_SIZE : size_it->second;
+    uint8_t payload[MAX_PAYLOAD_SIZE];
+    uniform_int_distribution<int> byte(0, 255);
+    for (size_t i = 0; i < size; ++i)
+        payload[i] = byte(mRandom);
+    protocol::appendPacket(out, packet_id, payload, payload + size);
+}
+
+void StreamGenerator::appendGarbage(vector<uint8_t>& out)
+{
+    size_t size = uniform_int_distribution<size_t>(1, MAX_GARBAGE_SIZE)(mRandom);
+    uniform_int_distribution<int> byte(0, 255);
+    for (size_t i = 0; i < size; ++i)
+        out.push_back(byte(mRandom));
+    mStatistics.garbage_insertions++;
+    mStatistics.garbage_bytes += size;
+}
+
+void StreamGenerator::appendFalseHeader(vector<uint8_t>& out)
+{
+    uniform_int_distribution<int> byte(0, 255);
+    Header header;
+    header.packet_id = byte(mRandom);
+    // A non-empty payload, as the CRC of an empty one is known, and the
+    // header would then be a valid packet
+    header.payload_length = uniform_int_distribution<int>(1, 255)(mRandom);
+    header.payload_checksum_lsb = byte(mRandom);
+    header.payload_checksum_msb = byte(mRandom);
+    header.header_checksum = header.computeHeaderChecksum();
+
+    uint8_t const* bytes = reinterpret_cast<uint8_t const*>(&header);
+    out.insert(out.end(), bytes, bytes + Header::SIZE);
+    mStatistics.false_headers++;
+}
+
+base::Time StreamGenerator::getTime() const
+{
+    return mTime;
+}
+
+StreamGenerator::Statistics const& StreamGenerator::getStatistics() const
+{
+    return mStatistics;
+}
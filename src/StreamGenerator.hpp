@@ -0,0 +1,141 @@
+#ifndef ADVANCED_NAVIGATION_ANPP_STREAM_GENERATOR_HPP
+#define ADVANCED_NAVIGATION_ANPP_STREAM_GENERATOR_HPP
+
+#include <map>
+#include <random>
+#include <vector>
+#include <base/Time.hpp>
+#include <imu_advanced_navigation_anpp/SimulatedTelemetry.hpp>
+
+namespace imu_advanced_navigation_anpp
+{
+    /** Generates synthetic ANPP byte streams, for benchmarks and stress tests
+     *
+     * The stream is made of the packet trains a device would send with the
+     * configured packet periods. The packets that SimulatedTelemetry
+     * supports have realistic contents, the others get a random payload of
+     * a configurable size. All are valid, CRC included.
+     *
+     * The stream can then be corrupted in the ways a serial line does it.
+     * Each packet is independently subject to:
+     * <ul>
+     * <li>a bit flip anywhere in the packet</li>
+     * <li>a truncation, i.e. the loss of its end</li>
+     * <li>the insertion of 1 to 32 bytes of garbage before it</li>
+     * <li>the insertion of a false header before it, that is a random
+     *   header that validates the LRC, which the parser has to reject on
+     *   the CRC of the bytes that follow</li>
+     * </ul>
+     *
+     * The generator keeps track of the number of packets that are emitted
+     * intact, which is what a correct parser must find in the stream. A
+     * false header at the very end of a stream may claim the packets that
+     * follow it, though, so a parser only finds all the packets if it is
+     * given more data after them, or if the stream ends with at least
+     * protocol::MAX_PACKET_SIZE bytes without corruption.
+     *
+     * The output is fully determined by the seed and the configuration.
+     */
+    class StreamGenerator
+    {
+    public:
+        /** Per-packet probability of each kind of corruption */
+        struct Corruption
+        {
+            double bit_flip = 0;
+            double truncation = 0;
+            double garbage = 0;
+            double false_header = 0;
+        };
+
+        struct Statistics
+        {
+            uint64_t trains = 0;
+            /** Packets that are emitted intact */
+            uint64_t valid_packets = 0;
+            /** Intact packets, by packet ID */
+            std::map<uint8_t, uint64_t> valid_packets_by_id;
+            uint64_t bit_flips = 0;
+            uint64_t truncations = 0;
+            uint64_t garbage_insertions = 0;
+            uint64_t garbage_bytes = 0;
+            uint64_t false_headers = 0;
+            /** Total number of bytes generated */
+            uint64_t bytes = 0;
+        };
+
+        /** Size of the payload generated for the packets that
+         * SimulatedTelemetry does not support, unless overridden with
+         * setRandomPayloadSize()
+         */
+        static const size_t DEFAULT_RANDOM_PAYLOAD_SIZE = 16;
+
+    private:
+        std::mt19937 mRandom;
+        SimulatedTelemetry mTelemetry;
+        Statistics mStatistics;
+        Corruption mCorruption;
+
+        std::map<uint8_t, uint32_t> mPeriods;
+        std::map<uint8_t, size_t> mRandomPayloadSizes;
+        base::Time mPacketTimerPeriod;
+        base::Time mTime;
+        uint64_t mTick = 0;
+
+        std::vector<uint8_t> mPacket;
+
+        void appendPacket(uint8_t packet_id, std::vector<uint8_t>& out);
+        void appendGarbage(std::vector<uint8_t>& out);
+        void appendFalseHeader(std::vector<uint8_t>& out);
+        bool randomEvent(double probability);
+
+    public:
+        /** Create a generator
+         *
+         * It starts at 2020-01-01T00:00:00Z with a 1ms packet timer period,
+         * and no packets
+         */
+        explicit StreamGenerator(uint32_t seed = 0);
+
+        /** Set the period of the packets, as packet ID to period in
+         * number of packet timer periods
+         */
+        void setPacketPeriods(std::map<uint8_t, uint32_t> const& periods);
+
+        void setPacketTimerPeriod(base::Time const& period);
+
+        /** Set the size of the random payload of a packet that
+         * SimulatedTelemetry does not support
+         */
+        void setRandomPayloadSize(uint8_t packet_id, size_t size);
+
+        void setCorruption(Corruption const& corruption);
+
+        /** @see SimulatedTelemetry::setNoise */
+        void setNoise(double scale);
+
+        /** Append the next packet train to a buffer
+         *
+         * A train is the set of packets that are due at the current packet
+         * timer tick, in packet ID order. It may be empty.
+         *
+         * @return the number of bytes appended
+         */
+        size_t generateTrain(std::vector<uint8_t>& out);
+
+        /** Append packet trains to a buffer until at least min_size bytes
+         * have been appended
+         *
+         * @return the number of bytes appended
+         * @throws std::logic_error if no packet periods are set
+         */
+        size_t generate(std::vector<uint8_t>& out, size_t min_size);
+
+        /** Time of the next packet train */
+        base::Time getTime() const;
+
+        Statistics const& getStatistics() const;
+    };
+}
+
+#endif
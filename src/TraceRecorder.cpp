@@ -0,0 +1,101 @@
+#include <imu_advanced_navigation_anpp/TraceRecorder.hpp>
+#include <chrono>
+#include <iomanip>
+#include <ostream>
+#include <stdexcept>
+#include <unistd.h>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+
+const size_t TraceRecorder::DEFAULT_CAPACITY;
+
+char const* imu_advanced_navigation_anpp::traceSpanName(TRACE_SPANS span)
+{
+    switch (span)
+    {
+        case TRACE_READ: return "read";
+        case TRACE_FRAMING: return "framing";
+        case TRACE_RESYNC: return "resync";
+        case TRACE_PROCESS: return "process";
+        case TRACE_UTM_CONVERSION: return "utm_conversion";
+        case TRACE_COMMAND: return "command";
+        default: return "unknown";
+    }
+}
+
+TraceRecorder::TraceRecorder(size_t capacity)
+    : mEvents(capacity)
+{
+    if (capacity == 0)
+        throw std::invalid_argument("TraceRecorder: capacity must be strictly positive");
+}
+
+int64_t TraceRecorder::now()
+{
+    return chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+size_t TraceRecorder::getCapacity() const
+{
+    return mEvents.size();
+}
+
+size_t TraceRecorder::size() const
+{
+    return mSize;
+}
+
+uint64_t TraceRecorder::getOverwrittenCount() const
+{
+    return mOverwritten;
+}
+
+vector<TraceEvent> TraceRecorder::getEvents() const
+{
+    vector<TraceEvent> result;
+    result.reserve(mSize);
+    size_t first = (mNext + mEvents.size() - mSize) % mEvents.size();
+    for (size_t i = 0; i < mSize; ++i)
+        result.push_back(mEvents[(first + i) % mEvents.size()]);
+    return result;
+}
+
+void TraceRecorder::writeChromeTrace(ostream& out) const
+{
+    int pid = getpid();
+    ios::fmtflags flags = out.flags();
+    out << fixed << setprecision(3);
+
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+        << ",\"tid\":" << pid
+        << ",\"args\":{\"name\":\"imu_advanced_navigation_anpp\"}}";
+    for (auto const& event : getEvents())
+    {
+        out << ",\n{\"name\":\"" << traceSpanName(event.span) << "\""
+            << ",\"cat\":\"anpp\",\"ph\":\"X\""
+            << ",\"ts\":" << event.start / 1e3
+            << ",\"dur\":" << event.duration / 1e3
+            << ",\"pid\":" << pid << ",\"tid\":" << pid;
+        if (event.packet_id >= 0)
+            out << ",\"args\":{\"packet_id\":" << event.packet_id << "}";
+        out << "}";
+    }
+    out << "\n]}\n";
+    out.flags(flags);
+}
+
+void TraceRecorder::flush(ostream& out)
+{
+    writeChromeTrace(out);
+    clear();
+}
+
+void TraceRecorder::clear()
+{
+    mNext = 0;
+    mSize = 0;
+    mOverwritten = 0;
+}
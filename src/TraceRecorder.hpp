@@ -0,0 +1,150 @@
+#ifndef ADVANCED_NAVIGATION_ANPP_TRACE_RECORDER_HPP
+#define ADVANCED_NAVIGATION_ANPP_TRACE_RECORDER_HPP
+
+#include <iosfwd>
+#include <vector>
+#include <cstdint>
+
+namespace imu_advanced_navigation_anpp
+{
+    /** The spans Driver records when tracing is enabled */
+    enum TRACE_SPANS
+    {
+        /** readPacket() call of Driver::poll(), i.e. waiting for and reading
+         * the bytes of a packet, including their framing
+         */
+        TRACE_READ,
+        /** Framing of a valid packet by Driver::extractPacket */
+        TRACE_FRAMING,
+        /** Call of Driver::extractPacket that discarded bytes */
+        TRACE_RESYNC,
+        /** Decoding of a packet and update of the driver's samples */
+        TRACE_PROCESS,
+        /** Geodetic to UTM conversion of the world position */
+        TRACE_UTM_CONVERSION,
+        /** Driver method that sends commands and waits for the device's
+         * response, from the first packet sent to the last response received
+         */
+        TRACE_COMMAND,
+        TRACE_SPAN_COUNT
+    };
+
+    /** Name of a span in the trace */
+    char const* traceSpanName(TRACE_SPANS span);
+
+    struct TraceEvent
+    {
+        /** Start of the span, in nanoseconds on the steady clock */
+        int64_t start = 0;
+        int64_t duration = 0;
+        TRACE_SPANS span = TRACE_READ;
+        /** Packet the span is about, -1 if none */
+        int packet_id = -1;
+    };
+
+    /** In-memory ring of timestamped spans, that can be written as a Chrome
+     * trace
+     *
+     * The ring is allocated at construction, recording never allocates.
+     * Once full, the oldest events are overwritten. The timestamps come from
+     * std::chrono::steady_clock, i.e. CLOCK_MONOTONIC on Linux, so that the
+     * trace can be aligned with other traces from the same machine.
+     */
+    class TraceRecorder
+    {
+    public:
+        static const size_t DEFAULT_CAPACITY = 65536;
+
+    private:
+        std::vector<TraceEvent> mEvents;
+        size_t mNext = 0;
+        size_t mSize = 0;
+        uint64_t mOverwritten = 0;
+
+    public:
+        explicit TraceRecorder(size_t capacity = DEFAULT_CAPACITY);
+
+        /** Current time, in nanoseconds on the steady clock */
+        static int64_t now();
+
+        /** Record a span that started at the given time and ends now */
+        void record(TRACE_SPANS span, int packet_id, int64_t start)
+        {
+            record(span, packet_id, start, now());
+        }
+
+        void record(TRACE_SPANS span, int packet_id, int64_t start, int64_t end)
+        {
+            TraceEvent& event = mEvents[mNext];
+            event.start = start;
+            event.duration = end - start;
+            event.span = span;
+            event.packet_id = packet_id;
+
+            mNext = (mNext + 1) % mEvents.size();
+            if (mSize < mEvents.size())
+                mSize++;
+            else
+                mOverwritten++;
+        }
+
+        size_t getCapacity() const;
+
+        /** Number of events in the ring */
+        size_t size() const;
+
+        /** Number of events that have been overwritten because the ring
+         * was full
+         */
+        uint64_t getOverwrittenCount() const;
+
+        /** The events in the ring, oldest first */
+        std::vector<TraceEvent> getEvents() const;
+
+        /** Write the events in the Chrome trace event format
+         *
+         * The result can be loaded in chrome://tracing or in Perfetto's UI.
+         * Timestamps are in microseconds on the steady clock.
+         */
+        void writeChromeTrace(std::ostream& out) const;
+
+        /** Write the events in the Chrome trace event format and clear the
+         * ring
+         */
+        void flush(std::ostream& out);
+
+        void clear();
+    };
+
+    /** Records a span from its construction to its destruction, if a
+     * recorder is given
+     */
+    class TraceSpan
+    {
+        TraceRecorder* mRecorder;
+        TRACE_SPANS mSpan;
+        int mPacketID;
+        int64_t mStart;
+
+    public:
+        TraceSpan(TraceRecorder* recorder, TRACE_SPANS span, int packet_id = -1)
+            : mRecorder(recorder)
+            , mSpan(span)
+            , mPacketID(packet_id)
+            , mStart(recorder ? TraceRecorder::now() : 0) {}
+
+        ~TraceSpan()
+        {
+            if (mRecorder)
+                mRecorder->record(mSpan, mPacketID, mStart);
+        }
+
+        /** Set the packet, for spans where it is only known at the end */
+        void setPacketID(int packet_id)
+        {
+            mPacketID = packet_id;
+        }
+    };
+}
+
+#endif
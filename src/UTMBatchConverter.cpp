@@ -0,0 +1,245 @@
+#include <imu_advanced_navigation_anpp/UTMBatchConverter.hpp>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+
+static const double WGS84_A = 6378137.0;
+static const double WGS84_F = 1 / 298.257223563;
+static const double UTM_K0 = 0.9996;
+static const double UTM_FALSE_EASTING = 500000;
+static const double UTM_SOUTH_FALSE_NORTHING = 10000000;
+static const double DEG_TO_RAD = M_PI / 180;
+
+constexpr double UTMBatchConverter::ACCURACY;
+constexpr size_t UTMBatchConverter::PARALLEL_THRESHOLD;
+
+UTMBatchConverter::UTMBatchConverter(int zone, bool north, Eigen::Vector3d const& local_origin)
+    : mOrigin(local_origin)
+{
+    mCentralMeridian = ((zone - 1) * 6 - 180 + 3) * DEG_TO_RAD;
+    mFalseNorthing = north ? 0 : UTM_SOUTH_FALSE_NORTHING;
+
+    double n = WGS84_F / (2 - WGS84_F);
+    double n2 = n * n, n3 = n2 * n, n4 = n3 * n, n5 = n4 * n, n6 = n5 * n;
+    mScaledRadius = UTM_K0 * WGS84_A / (1 + n) * (1 + n2 / 4 + n4 / 64 + n6 / 256);
+    mEccentricity = sqrt(WGS84_F * (2 - WGS84_F));
+    mAlpha[0] = n / 2 - 2 * n2 / 3 + 5 * n3 / 16 + 41 * n4 / 180
+              - 127 * n5 / 288 + 7891 * n6 / 37800;
+    mAlpha[1] = 13 * n2 / 48 - 3 * n3 / 5 + 557 * n4 / 1440
+              + 281 * n5 / 630 - 1983433 * n6 / 1935360;
+    mAlpha[2] = 61 * n3 / 240 - 103 * n4 / 140 + 15061 * n5 / 26880
+              + 167603 * n6 / 181440;
+    mAlpha[3] = 49561 * n4 / 161280 - 179 * n5 / 168 + 6601661 * n6 / 7257600;
+    mAlpha[4] = 34729 * n5 / 80640 - 3418889 * n6 / 1995840;
+    mAlpha[5] = 212378941 * n6 / 319334400;
+}
+
+namespace
+{
+    /** Number of points converted together by convertRange
+     *
+     * The block temporaries live on the stack, 2kB each
+     */
+    const int BLOCK_SIZE = 256;
+    typedef Eigen::Array<double, Eigen::Dynamic, 1, 0, BLOCK_SIZE, 1> Block;
+    typedef Eigen::Map<Eigen::ArrayXd const> InputBlock;
+    typedef Eigen::Map<Eigen::ArrayXd> OutputBlock;
+}
+
+/** Evaluate a polynomial of x with Horner's scheme, the coefficients being
+ * given from the highest degree down */
+template<size_t N>
+static Block horner(Block const& x, double const (&coefficients)[N])
+{
+    Block result = Block::Constant(x.size(), coefficients[0]);
+    for (size_t i = 1; i < N; ++i)
+        result = result * x + coefficients[i];
+    return result;
+}
+
+/** Round to the nearest integer, ties to even
+ *
+ * Adding and removing 1.5 * 2^52 rounds values below 2^51 in magnitude in
+ * the current rounding mode. Unlike Eigen's round(), this is vectorized
+ * without SSE4.1
+ */
+static Block roundToInteger(Block const& x)
+{
+    static const double ROUNDING_SHIFT = 6755399441055744.0;
+    return (x + ROUNDING_SHIFT) - ROUNDING_SHIFT;
+}
+
+/** Sine and cosine of a block of angles
+ *
+ * libm's sin and cos are not vectorized. The angles are instead reduced to
+ * [-pi/4, pi/4] with a two-part pi/2 (exact for the angles of a UTM
+ * conversion) and the Taylor series are evaluated to the 16th degree,
+ * which bounds the error to a few ulps
+ */
+static void blockSinCos(Block const& angle, Block& sin_angle, Block& cos_angle)
+{
+    static const double PI_2_HI = 1.57079632673412561417e+00;
+    static const double PI_2_LO = 6.07710050650619224932e-11;
+    static const double SIN_COEFFICIENTS[] = {
+        -1 / 1307674368000.0, 1 / 6227020800.0, -1 / 39916800.0, 1 / 362880.0,
+        -1 / 5040.0, 1 / 120.0, -1 / 6.0, 1
+    };
+    static const double COS_COEFFICIENTS[] = {
+        1 / 20922789888000.0, -1 / 87178291200.0, 1 / 479001600.0, -1 / 3628800.0,
+        1 / 40320.0, -1 / 720.0, 1 / 24.0, -1 / 2.0, 1
+    };
+
+    Block k = roundToInteger(angle * M_2_PI);
+    Block r = angle - k * PI_2_HI - k * PI_2_LO;
+    Block r2 = r * r;
+    Block s = r * horner(r2, SIN_COEFFICIENTS);
+    Block c = horner(r2, COS_COEFFICIENTS);
+
+    // angle = r + quadrant * pi/2, with quadrant in [-2, 2]
+    Block quadrant = k - 4 * roundToInteger(k * 0.25);
+    auto odd = quadrant.abs() == 1;
+    auto negative_sin = quadrant == 2 || quadrant == -2 || quadrant == -1;
+    auto negative_cos = quadrant == 2 || quadrant == -2 || quadrant == 1;
+    Block sin_r = odd.select(c, s);
+    Block cos_r = odd.select(s, c);
+    sin_angle = negative_sin.select(-sin_r, sin_r);
+    cos_angle = negative_cos.select(-cos_r, cos_r);
+}
+
+/** Arc tangent of a block of values
+ *
+ * Values above 1 in magnitude are reduced with atan(t) = ±pi/2 - atan(1/t),
+ * and the argument is then halved twice with atan(u) = 2 atan(u / (1 +
+ * sqrt(1 + u²))), after which it is below tan(pi/16) and the Taylor series
+ * to the 23rd degree is exact to the double precision
+ */
+static Block blockAtan(Block const& t)
+{
+    static const double COEFFICIENTS[] = {
+        -1 / 23.0, 1 / 21.0, -1 / 19.0, 1 / 17.0, -1 / 15.0, 1 / 13.0,
+        -1 / 11.0, 1 / 9.0, -1 / 7.0, 1 / 5.0, -1 / 3.0, 1
+    };
+
+    auto large = t.abs() > 1;
+    Block u = large.select(t.inverse(), t);
+    Block v = u / (1 + (1 + u * u).sqrt());
+    Block w = v / (1 + (1 + v * v).sqrt());
+    Block atan_u = 4 * w * horner(w * w, COEFFICIENTS);
+    return large.select(M_PI_2 * t.sign() - atan_u, atan_u);
+}
+
+/** Four-quadrant arc tangent of y / x, as std::atan2 for x != 0 */
+static Block blockAtan2(Block const& y, Block const& x)
+{
+    Block result = blockAtan(y / x);
+    return (x < 0).select((y < 0).select(result - M_PI, result + M_PI), result);
+}
+
+void UTMBatchConverter::convertRange(double const* latitudes, double const* longitudes,
+                                     double const* altitudes, size_t count,
+                                     double* x, double* y, double* z) const
+{
+    // Series of atanh(u) / u in u², for |u| < e
+    static const double ATANH_COEFFICIENTS[] = {
+        1 / 15.0, 1 / 13.0, 1 / 11.0, 1 / 9.0, 1 / 7.0, 1 / 5.0, 1 / 3.0, 1
+    };
+
+    double const e = mEccentricity;
+    double const origin_y = 1000000 - UTM_FALSE_EASTING - mOrigin.y();
+    double const northing_offset = mFalseNorthing - mOrigin.x();
+
+    for (size_t begin = 0; begin < count; begin += BLOCK_SIZE)
+    {
+        int size = min<size_t>(BLOCK_SIZE, count - begin);
+        InputBlock phi_deg(latitudes + begin, size);
+        InputBlock lambda_deg(longitudes + begin, size);
+
+        Block sin_phi, cos_phi;
+        blockSinCos(phi_deg * DEG_TO_RAD, sin_phi, cos_phi);
+        Block sin_lambda, cos_lambda;
+        blockSinCos(lambda_deg * DEG_TO_RAD - mCentralMeridian, sin_lambda, cos_lambda);
+
+        // Tangent of the conformal latitude, tau = sinh(psi) with
+        // psi = atanh(sin_phi) - e atanh(e sin_phi). exp(atanh(u)) is
+        // sqrt((1 + u) / (1 - u)), and e sin_phi is small enough for the
+        // series of atanh to converge in a few terms
+        Block e_sin_phi = e * sin_phi;
+        Block exp_psi = ((1 + sin_phi) / (1 - sin_phi)).sqrt() *
+            (-e * e_sin_phi * horner(e_sin_phi.square(), ATANH_COEFFICIENTS)).exp();
+        Block tau = 0.5 * (exp_psi - exp_psi.inverse());
+
+        // Gauss-Schreiber coordinates. xi = atan2(tau, cos_lambda) and
+        // eta = asinh(q), whose sin(2 xi), cos(2 xi) and exp(2 eta) are
+        // derived without other transcendental functions
+        Block r2 = tau * tau + cos_lambda * cos_lambda;
+        Block xi = blockAtan2(tau, cos_lambda);
+        Block sin_2xi = 2 * tau * cos_lambda / r2;
+        Block cos_2xi = (cos_lambda * cos_lambda - tau * tau) / r2;
+        Block q = sin_lambda / r2.sqrt();
+        Block m = q.abs() + (q * q + 1).sqrt();
+        Block log_m = m.log();
+        Block eta = (q < 0).select(-log_m, log_m);
+        Block exp_2eta = (q < 0).select((m * m).inverse(), m * m);
+        Block sinh_2eta = 0.5 * (exp_2eta - exp_2eta.inverse());
+        Block cosh_2eta = 0.5 * (exp_2eta + exp_2eta.inverse());
+
+        // Evaluate zeta' + sum(alpha_j sin(2 j zeta')) with zeta' = xi + i eta
+        // using Clenshaw's recurrence on complex numbers
+        Block a_r = 2 * cos_2xi * cosh_2eta;
+        Block a_i = -2 * sin_2xi * sinh_2eta;
+        // y_j is stored in y[j % 3], which avoids copying the blocks at
+        // each step of the recurrence. The recurrence starts with y_6 and
+        // y_7 set to zero
+        Block y_r[3], y_i[3];
+        y_r[0].setZero(size); y_i[0].setZero(size);
+        y_r[1].setZero(size); y_i[1].setZero(size);
+        for (int j = 5; j >= 0; --j)
+        {
+            Block const& y1_r = y_r[(j + 1) % 3];
+            Block const& y1_i = y_i[(j + 1) % 3];
+            y_r[j % 3] = a_r * y1_r - a_i * y1_i - y_r[(j + 2) % 3] + mAlpha[j];
+            y_i[j % 3] = a_r * y1_i + a_i * y1_r - y_i[(j + 2) % 3];
+        }
+        Block const& y1_r = y_r[0];
+        Block const& y1_i = y_i[0];
+        Block sin_2zeta_r = sin_2xi * cosh_2eta;
+        Block sin_2zeta_i = cos_2xi * sinh_2eta;
+        Block northing = xi + sin_2zeta_r * y1_r - sin_2zeta_i * y1_i;
+        Block easting  = eta + sin_2zeta_r * y1_i + sin_2zeta_i * y1_r;
+
+        // Same mapping from UTM to NWU than gps_base::UTMConverter
+        OutputBlock(x + begin, size) = mScaledRadius * northing + northing_offset;
+        OutputBlock(y + begin, size) = origin_y - mScaledRadius * easting;
+        OutputBlock(z + begin, size) = InputBlock(altitudes + begin, size) - mOrigin.z();
+    }
+}
+
+void UTMBatchConverter::convertToNWU(double const* latitudes, double const* longitudes,
+                                     double const* altitudes, size_t count,
+                                     double* x, double* y, double* z,
+                                     size_t thread_count) const
+{
+    if (count < PARALLEL_THRESHOLD)
+        return convertRange(latitudes, longitudes, altitudes, count, x, y, z);
+
+    if (thread_count == 0)
+        thread_count = max(1u, std::thread::hardware_concurrency());
+    size_t range_size = (count + thread_count - 1) / thread_count;
+
+    vector<thread> threads;
+    for (size_t begin = range_size; begin < count; begin += range_size)
+    {
+        size_t size = min(range_size, count - begin);
+        threads.emplace_back([=]() {
+            convertRange(latitudes + begin, longitudes + begin, altitudes + begin, size,
+                         x + begin, y + begin, z + begin);
+        });
+    }
+    convertRange(latitudes, longitudes, altitudes, min(range_size, count), x, y, z);
+    for (auto& t : threads)
+        t.join();
+}
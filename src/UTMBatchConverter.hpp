@@ -0,0 +1,79 @@
+#ifndef ADVANCED_NAVIGATION_ANPP_UTM_BATCH_CONVERTER_HPP
+#define ADVANCED_NAVIGATION_ANPP_UTM_BATCH_CONVERTER_HPP
+
+#include <cstddef>
+#include <Eigen/Core>
+
+namespace imu_advanced_navigation_anpp
+{
+    /** Conversion of arrays of WGS84 geodetic positions into the NWU frame
+     * used by Driver (through gps_base::UTMConverter)
+     *
+     * It is meant for the offline reprocessing of GeodeticPosition
+     * histories. The transverse Mercator projection is computed with
+     * Krüger's series to the sixth order in the third flattening (as
+     * described in Karney, "Transverse Mercator with an accuracy of a few
+     * nanometers", 2011), which is accurate to well below a millimeter
+     * within a UTM zone. The results match gps_base::UTMConverter to within
+     * ACCURACY.
+     *
+     * The conversion works on structure-of-arrays inputs and outputs, and
+     * computes the projection constants once per converter instead of once
+     * per point. The points are converted in blocks, with Eigen array
+     * expressions that are vectorized: libm's sin, cos and atan2 are
+     * replaced by polynomial evaluations, and the remaining exp, log and
+     * sqrt are Eigen's vectorized versions. Large inputs are split among
+     * several threads.
+     */
+    class UTMBatchConverter
+    {
+    public:
+        /** Maximum difference, in meters, between the result of this class
+         * and of gps_base::UTMConverter, for points within the UTM zone */
+        static constexpr double ACCURACY = 1e-3;
+
+        /** Inputs smaller than this are converted in the calling thread */
+        static constexpr size_t PARALLEL_THRESHOLD = 65536;
+
+    private:
+        Eigen::Vector3d mOrigin;
+
+        double mCentralMeridian;
+        double mFalseNorthing;
+        double mScaledRadius;
+        double mEccentricity;
+        double mAlpha[6];
+
+        void convertRange(double const* latitudes, double const* longitudes,
+                          double const* altitudes, size_t count,
+                          double* x, double* y, double* z) const;
+
+    public:
+        /** Create a converter for the given UTM zone and NWU origin
+         *
+         * The parameters have the same meaning than in Driver::setUTM
+         */
+        UTMBatchConverter(int zone, bool north,
+                          Eigen::Vector3d const& local_origin = Eigen::Vector3d::Zero());
+
+        /** Convert geodetic positions into NWU coordinates
+         *
+         * NaN inputs give NaN outputs
+         *
+         * @param latitudes latitudes in degrees
+         * @param longitudes longitudes in degrees
+         * @param altitudes altitudes in meters
+         * @param count the number of positions
+         * @param x,y,z the output NWU coordinates, in meters
+         * @param thread_count the number of threads to use for inputs
+         *   bigger than PARALLEL_THRESHOLD. Zero means one thread per
+         *   available core.
+         */
+        void convertToNWU(double const* latitudes, double const* longitudes,
+                          double const* altitudes, size_t count,
+                          double* x, double* y, double* z,
+                          size_t thread_count = 0) const;
+    };
+}
+
+#endif
@@ -0,0 +1,101 @@
+#include "test_Helpers.hpp"
+#include <imu_advanced_navigation_anpp/CaptureCodec.hpp>
+#include <cmath>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+
+struct CaptureCodecTest : ::testing::Test
+{
+    void append(vector<uint8_t>& data, vector<uint8_t> const& packet)
+    {
+        data.insert(data.end(), packet.begin(), packet.end());
+    }
+
+    /** A capture with slowly varying floats and doubles, as generated by
+     * a device at rest */
+    vector<uint8_t> makeCapture(int count)
+    {
+        vector<uint8_t> data;
+        for (int i = 0; i < count; ++i)
+        {
+            vector<uint8_t> raw_sensors(protocol::RawSensors::SIZE);
+            for (int j = 0; j < 12; ++j)
+                protocol::write32(&raw_sensors[j * 4], static_cast<float>(j + 1.5 + 1e-4 * sin(i * 0.1 + j)));
+            append(data, makePacket<protocol::RawSensors>(raw_sensors));
+
+            vector<uint8_t> position(protocol::GeodeticPosition::SIZE);
+            for (int j = 0; j < 3; ++j)
+                protocol::write64(&position[j * 8], 0.7 + j + 1e-9 * i);
+            append(data, makePacket<protocol::GeodeticPosition>(position));
+
+            if (i % 10 == 0)
+            {
+                vector<uint8_t> satellites(protocol::SatelliteInfo::SIZE * (1 + i % 3), i);
+                append(data, makePacket<protocol::DetailedSatellites>(satellites));
+            }
+        }
+        return data;
+    }
+
+    vector<uint8_t> roundTrip(vector<uint8_t> const& data)
+    {
+        auto compressed = codec::compress(data.data(), data.size());
+        return codec::decompress(compressed.data(), compressed.size());
+    }
+};
+
+TEST_F(CaptureCodecTest, it_round_trips_an_empty_capture)
+{
+    ASSERT_EQ(vector<uint8_t>(), roundTrip(vector<uint8_t>()));
+}
+
+TEST_F(CaptureCodecTest, it_round_trips_a_capture_bit_exactly)
+{
+    auto data = makeCapture(1000);
+    ASSERT_EQ(data, roundTrip(data));
+}
+
+TEST_F(CaptureCodecTest, it_round_trips_garbage_and_truncated_packets)
+{
+    vector<uint8_t> data = { 0x10, 0x20, 0x30 };
+    auto capture = makeCapture(50);
+    data.insert(data.end(), capture.begin(), capture.begin() + 400);
+    data.insert(data.end(), { 0xFF, 0x00, 0xFF, 0x00, 0xFF });
+    data.insert(data.end(), capture.begin() + 400, capture.end() - 7);
+    ASSERT_EQ(data, roundTrip(data));
+}
+
+TEST_F(CaptureCodecTest, it_round_trips_random_payloads)
+{
+    vector<uint8_t> data;
+    uint32_t seed = 42;
+    for (int i = 0; i < 500; ++i)
+    {
+        vector<uint8_t> payload(protocol::RawGNSS::SIZE);
+        for (auto& byte : payload)
+        {
+            seed = seed * 1103515245 + 12345;
+            byte = seed >> 24;
+        }
+        append(data, makePacket<protocol::RawGNSS>(payload));
+    }
+    ASSERT_EQ(data, roundTrip(data));
+}
+
+TEST_F(CaptureCodecTest, it_compresses_slowly_varying_captures)
+{
+    auto data = makeCapture(1000);
+    auto compressed = codec::compress(data.data(), data.size());
+    ASSERT_LT(compressed.size() * 3, data.size());
+}
+
+TEST_F(CaptureCodecTest, decompress_throws_on_invalid_data)
+{
+    vector<uint8_t> data = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+    ASSERT_THROW(codec::decompress(data.data(), data.size()), std::runtime_error);
+
+    auto capture = makeCapture(10);
+    auto compressed = codec::compress(capture.data(), capture.size());
+    ASSERT_THROW(codec::decompress(compressed.data(), 30), std::runtime_error);
+}
@@ -0,0 +1,134 @@
+#include "test_Helpers.hpp"
+#include <imu_advanced_navigation_anpp/CaptureMerger.hpp>
+#include <cstdio>
+#include <deque>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+
+struct CaptureMergerTest : ::testing::Test
+{
+    deque<TempFile> files;
+    vector<string> paths;
+
+    string makeTempPath()
+    {
+        files.emplace_back();
+        paths.push_back(files.back().path);
+        return paths.back();
+    }
+
+    void addCapture(vector< vector<uint8_t> > const& packets)
+    {
+        vector<uint8_t> data;
+        for (auto const& packet : packets)
+            data.insert(data.end(), packet.begin(), packet.end());
+        makeTempPath();
+        files.back().write(data);
+    }
+
+    vector<uint8_t> makeUnixTime(uint32_t seconds)
+    {
+        vector<uint8_t> payload(8, 0);
+        protocol::write32(&payload[0], seconds);
+        return makePacket<protocol::UnixTime>(payload);
+    }
+
+    vector<uint8_t> makeDeviceInformation(uint32_t serial)
+    {
+        vector<uint8_t> payload(protocol::DeviceInformation::SIZE, 0);
+        protocol::write32(&payload[12], serial);
+        return makePacket<protocol::DeviceInformation>(payload);
+    }
+
+    void makeCaptures()
+    {
+        addCapture({ makeDeviceInformation(0x1234),
+                     makeUnixTime(1), makePacket<protocol::RawSensors>(),
+                     makeUnixTime(3), makePacket<protocol::RawSensors>() });
+        addCapture({ makeUnixTime(2), makePacket<protocol::Status>(),
+                     makeUnixTime(3), makePacket<protocol::Status>(),
+                     makeDeviceInformation(0x5678) });
+        addCapture({ makePacket<protocol::RawSensors>(), makeUnixTime(1) });
+    }
+};
+
+TEST_F(CaptureMergerTest, it_records_the_device_information_of_each_capture_during_the_merge)
+{
+    makeCaptures();
+    CaptureMerger merger(paths);
+    auto const& sources = merger.getSources();
+    ASSERT_EQ(3, sources.size());
+    ASSERT_FALSE(sources[1].has_device_information);
+
+    CaptureMerger::Record record;
+    while (merger.next(record));
+    ASSERT_TRUE(sources[0].has_device_information);
+    ASSERT_EQ(0x1234, sources[0].device_information.serial_number_part0);
+    ASSERT_TRUE(sources[1].has_device_information);
+    ASSERT_EQ(0x5678, sources[1].device_information.serial_number_part0);
+    ASSERT_FALSE(sources[2].has_device_information);
+}
+
+TEST_F(CaptureMergerTest, it_merges_the_packets_in_device_time_order)
+{
+    makeCaptures();
+    CaptureMerger merger(paths);
+
+    struct Expected { uint32_t source; uint8_t id; int64_t time; };
+    vector<Expected> expected = {
+        { 0, protocol::DeviceInformation::ID, 0 },
+        { 2, protocol::RawSensors::ID, 0 },
+        { 0, protocol::UnixTime::ID, 1000000 },
+        { 0, protocol::RawSensors::ID, 1000000 },
+        { 2, protocol::UnixTime::ID, 1000000 },
+        { 1, protocol::UnixTime::ID, 2000000 },
+        { 1, protocol::Status::ID, 2000000 },
+        { 0, protocol::UnixTime::ID, 3000000 },
+        { 0, protocol::RawSensors::ID, 3000000 },
+        { 1, protocol::UnixTime::ID, 3000000 },
+        { 1, protocol::Status::ID, 3000000 },
+        { 1, protocol::DeviceInformation::ID, 3000000 }
+    };
+
+    CaptureMerger::Record record;
+    for (auto const& e : expected)
+    {
+        ASSERT_TRUE(merger.next(record));
+        ASSERT_EQ(e.source, record.source);
+        ASSERT_EQ(e.id, record.packet[1]);
+        ASSERT_EQ(e.time, record.device_time);
+    }
+    ASSERT_FALSE(merger.next(record));
+}
+
+TEST_F(CaptureMergerTest, it_writes_the_source_table_and_the_records)
+{
+    makeCaptures();
+    CaptureMerger merger(paths);
+    string output = makeTempPath();
+    merger.write(output);
+
+    FILE* file = fopen(output.c_str(), "r");
+    vector<uint8_t> data(4096);
+    data.resize(fread(data.data(), 1, data.size(), file));
+    fclose(file);
+
+    ASSERT_TRUE(equal(data.begin(), data.begin() + 8, CaptureMerger::MERGE_MAGIC));
+    ASSERT_EQ(3, protocol::read32<uint32_t>(&data[8]));
+    ASSERT_EQ(0x1234, protocol::read32<uint32_t>(&data[12 + 12]));
+    // Found at the end of the capture, after the table has been reserved
+    ASSERT_EQ(0x5678, protocol::read32<uint32_t>(&data[12 + protocol::DeviceInformation::SIZE + 12]));
+    ASSERT_EQ(0, protocol::read32<uint32_t>(&data[12 + 2 * protocol::DeviceInformation::SIZE + 12]));
+
+    size_t record = 12 + 3 * protocol::DeviceInformation::SIZE;
+    ASSERT_EQ(0, protocol::read32<uint32_t>(&data[record]));
+    ASSERT_EQ(0, protocol::read64<int64_t>(&data[record + 4]));
+    auto first = makeDeviceInformation(0x1234);
+    ASSERT_TRUE(equal(first.begin(), first.end(), data.begin() + record + 12));
+
+    record += 12 + first.size();
+    ASSERT_EQ(2, protocol::read32<uint32_t>(&data[record]));
+    auto second = makePacket<protocol::RawSensors>();
+    ASSERT_TRUE(equal(second.begin(), second.end(), data.begin() + record + 12));
+}
@@ -0,0 +1,129 @@
+#include "test_Helpers.hpp"
+#include <imu_advanced_navigation_anpp/CaptureReader.hpp>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+
+struct CaptureReaderTest : ::testing::Test
+{
+    TempFile capture;
+    string const& path = capture.path;
+
+    void writeCapture(vector<uint8_t> const& data)
+    {
+        capture.write(data);
+    }
+
+    /** Reference result, i.e. sequential framing of the whole capture */
+    vector<size_t> frameSequentially(vector<uint8_t> const& data)
+    {
+        vector<size_t> offsets;
+        size_t pos = 0;
+        while (pos < data.size())
+        {
+            int result = protocol::extractPacket(&data[pos], data.size() - pos);
+            if (result > 0)
+                offsets.push_back(pos);
+            if (result == 0)
+                break;
+            pos += abs(result);
+        }
+        return offsets;
+    }
+
+    vector<size_t> getOffsets(CaptureReader const& reader)
+    {
+        vector<size_t> offsets;
+        for (auto const& packet : reader.getPackets())
+            offsets.push_back(packet.offset);
+        return offsets;
+    }
+
+    vector<uint8_t> makeStream(int count, bool with_garbage)
+    {
+        vector<uint8_t> data;
+        for (int i = 0; i < count; ++i)
+        {
+            vector<uint8_t> payload(protocol::RawSensors::SIZE);
+            for (size_t j = 0; j < payload.size(); ++j)
+                payload[j] = i * 7 + j;
+            auto packet = makePacket<protocol::RawSensors>(payload);
+            data.insert(data.end(), packet.begin(), packet.end());
+            if (with_garbage && i % 5 == 0)
+                data.insert(data.end(), { 0x10, 0x10, 0x10, static_cast<uint8_t>(i) });
+        }
+        return data;
+    }
+};
+
+TEST_F(CaptureReaderTest, it_frames_an_empty_file)
+{
+    writeCapture(vector<uint8_t>());
+    CaptureReader reader(path);
+    reader.index();
+    ASSERT_TRUE(reader.getPackets().empty());
+    ASSERT_EQ(0, reader.getDiscardedBytes());
+}
+
+TEST_F(CaptureReaderTest, it_finds_all_packets_of_a_clean_capture)
+{
+    auto data = makeStream(100, false);
+    writeCapture(data);
+    CaptureReader reader(path);
+    reader.index(4, 300);
+    ASSERT_EQ(100, reader.getPackets().size());
+    ASSERT_EQ(frameSequentially(data), getOffsets(reader));
+    ASSERT_EQ(0, reader.getDiscardedBytes());
+    for (auto const& packet : reader.getPackets())
+        ASSERT_EQ(protocol::RawSensors::ID, reader.getPacketID(packet));
+}
+
+TEST_F(CaptureReaderTest, it_resynchronizes_on_garbage_and_reports_it_as_discarded)
+{
+    auto data = makeStream(100, true);
+    writeCapture(data);
+    CaptureReader reader(path);
+    reader.index(3, 277);
+    ASSERT_EQ(100, reader.getPackets().size());
+    ASSERT_EQ(frameSequentially(data), getOffsets(reader));
+    ASSERT_EQ(20 * 4, reader.getDiscardedBytes());
+}
+
+TEST_F(CaptureReaderTest, it_gives_the_same_result_whatever_the_chunking)
+{
+    auto data = makeStream(250, true);
+    writeCapture(data);
+    CaptureReader reader(path);
+    auto expected = frameSequentially(data);
+    for (size_t chunk_size = protocol::MAX_PACKET_SIZE + 1; chunk_size < 2000; chunk_size += 97)
+    {
+        reader.index(4, chunk_size);
+        ASSERT_EQ(expected, getOffsets(reader)) << "chunk size " << chunk_size;
+    }
+}
+
+TEST_F(CaptureReaderTest, it_ignores_a_truncated_packet_at_the_end_of_the_file)
+{
+    auto data = makeStream(10, false);
+    data.resize(data.size() - 3);
+    writeCapture(data);
+    CaptureReader reader(path);
+    reader.index(2, 300);
+    ASSERT_EQ(9, reader.getPackets().size());
+    ASSERT_EQ(protocol::RawSensors::SIZE + protocol::Header::SIZE - 3, reader.getDiscardedBytes());
+}
+
+TEST_F(CaptureReaderTest, it_gives_access_to_the_packet_data)
+{
+    auto data = makeStream(3, false);
+    writeCapture(data);
+    CaptureReader reader(path);
+    reader.index();
+    auto const& packet = reader.getPackets()[1];
+    ASSERT_EQ(0, memcmp(&data[packet.offset], reader.getPacketData(packet), packet.size));
+}
+
+TEST_F(CaptureReaderTest, it_throws_if_the_file_does_not_exist)
+{
+    ASSERT_THROW(CaptureReader("/does/not/exist"), iodrivers_base::UnixError);
+}
@@ -0,0 +1,76 @@
+#include "test_Helpers.hpp"
+#include <imu_advanced_navigation_anpp/CaptureStreamReader.hpp>
+#include <imu_advanced_navigation_anpp/CaptureReader.hpp>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+
+struct CaptureStreamReaderTest : ::testing::Test
+{
+    TempFile capture;
+    string const& path = capture.path;
+
+    void writeCapture(vector<uint8_t> const& data)
+    {
+        capture.write(data);
+    }
+
+    vector<uint8_t> makeStream(int count)
+    {
+        vector<uint8_t> data;
+        for (int i = 0; i < count; ++i)
+        {
+            vector<uint8_t> payload(protocol::RawSensors::SIZE);
+            for (size_t j = 0; j < payload.size(); ++j)
+                payload[j] = i * 7 + j;
+            auto packet = makePacket<protocol::RawSensors>(payload);
+            data.insert(data.end(), packet.begin(), packet.end());
+            if (i % 3 == 0)
+                data.insert(data.end(), { 0x10, 0x10, 0x10, static_cast<uint8_t>(i) });
+        }
+        return data;
+    }
+};
+
+TEST_F(CaptureStreamReaderTest, it_returns_the_same_packets_than_CaptureReader)
+{
+    auto data = makeStream(200);
+    writeCapture(data);
+
+    CaptureReader reference(path);
+    reference.index();
+
+    CaptureStreamReader reader(path, 2 * protocol::MAX_PACKET_SIZE);
+    size_t size;
+    for (auto const& expected : reference.getPackets())
+    {
+        uint8_t const* packet = reader.next(size);
+        ASSERT_TRUE(packet);
+        ASSERT_EQ(expected.size, size);
+        ASSERT_EQ(0, memcmp(reference.getPacketData(expected), packet, size));
+    }
+    ASSERT_FALSE(reader.next(size));
+    ASSERT_EQ(reference.getDiscardedBytes(), reader.getDiscardedBytes());
+}
+
+TEST_F(CaptureStreamReaderTest, it_discards_a_truncated_packet_at_the_end_of_the_file)
+{
+    auto data = makeStream(1);
+    data.resize(data.size() - 6);
+    writeCapture(data);
+
+    CaptureStreamReader reader(path);
+    size_t size;
+    ASSERT_FALSE(reader.next(size));
+    ASSERT_EQ(data.size(), reader.getDiscardedBytes());
+}
+
+TEST_F(CaptureStreamReaderTest, it_rejects_buffers_that_cannot_hold_two_packets)
+{
+    ASSERT_THROW(CaptureStreamReader(path, protocol::MAX_PACKET_SIZE), std::invalid_argument);
+}
+
+TEST_F(CaptureStreamReaderTest, it_throws_if_the_file_does_not_exist)
+{
+    ASSERT_THROW(CaptureStreamReader("/does/not/exist"), iodrivers_base::UnixError);
+}
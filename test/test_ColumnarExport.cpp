@@ -0,0 +1,180 @@
+#include "test_Helpers.hpp"
+#include <imu_advanced_navigation_anpp/ColumnarExport.hpp>
+#include <dirent.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+using namespace imu_advanced_navigation_anpp::columnar;
+using testing::ElementsAre;
+
+struct ColumnarExportTest : ::testing::Test
+{
+    string directory;
+
+    ColumnarExportTest()
+    {
+        char path_template[] = "/tmp/anpp_columnar_XXXXXX";
+        directory = mkdtemp(path_template);
+    }
+
+    ~ColumnarExportTest()
+    {
+        DIR* dir = opendir(directory.c_str());
+        while (dirent* entry = readdir(dir))
+        {
+            string name = entry->d_name;
+            if (name != "." && name != "..")
+                unlink((directory + "/" + name).c_str());
+        }
+        closedir(dir);
+        rmdir(directory.c_str());
+    }
+
+    void add(ColumnarExporter& exporter, vector<uint8_t> const& packet)
+    {
+        exporter.add(packet.data(), packet.size());
+    }
+
+    vector<uint8_t> makeUnixTime(uint32_t seconds, uint32_t microseconds)
+    {
+        vector<uint8_t> payload(8);
+        protocol::write32(&payload[0], seconds);
+        protocol::write32(&payload[4], microseconds);
+        return makePacket<protocol::UnixTime>(payload);
+    }
+
+    vector<uint8_t> makeRawSensors(float gyro_z)
+    {
+        vector<uint8_t> payload(protocol::RawSensors::SIZE, 0);
+        protocol::write32(&payload[20], gyro_z);
+        return makePacket<protocol::RawSensors>(payload);
+    }
+};
+
+TEST_F(ColumnarExportTest, it_writes_one_typed_column_per_field)
+{
+    {
+        ColumnarExporter exporter(directory);
+        add(exporter, makeRawSensors(TEST_FP4[0].fp));
+        add(exporter, makeRawSensors(TEST_FP4[1].fp));
+        ASSERT_EQ(2, exporter.getExportedPacketCount());
+        exporter.flush();
+    }
+
+    ColumnReader column(directory + "/RawSensors.gyroscopes_z.col");
+    ASSERT_EQ(COLUMN_FLOAT, column.getType());
+    ASSERT_EQ(1, column.getBlocks().size());
+    auto values = column.readBlock(0);
+    ASSERT_THAT(values, ElementsAre(TEST_FP4[0].fp, TEST_FP4[1].fp));
+    ASSERT_EQ(TEST_FP4[0].fp, column.getBlocks()[0].header.min);
+    ASSERT_EQ(TEST_FP4[1].fp, column.getBlocks()[0].header.max);
+}
+
+TEST_F(ColumnarExportTest, it_stamps_rows_with_the_last_device_time)
+{
+    {
+        ColumnarExporter exporter(directory);
+        add(exporter, makeRawSensors(1));
+        add(exporter, makeUnixTime(10, 20));
+        add(exporter, makeRawSensors(2));
+        exporter.flush();
+    }
+
+    ColumnReader time(directory + "/RawSensors.device_time.col");
+    ASSERT_EQ(COLUMN_INT64, time.getType());
+    ASSERT_THAT(time.readBlock(0), ElementsAre(0, 10000020));
+    ColumnReader unix_time(directory + "/UnixTime.device_time.col");
+    ASSERT_THAT(unix_time.readBlock(0), ElementsAre(10000020));
+}
+
+TEST_F(ColumnarExportTest, selectTimeRange_returns_the_values_within_the_time_range)
+{
+    {
+        ColumnarExporter exporter(directory);
+        for (uint32_t i = 0; i < BLOCK_ROWS * 2 + 10; ++i)
+        {
+            add(exporter, makeUnixTime(i, 0));
+            add(exporter, makeRawSensors(i));
+        }
+        exporter.flush();
+    }
+
+    ColumnReader time(directory + "/RawSensors.device_time.col");
+    ASSERT_EQ(3, time.getBlocks().size());
+
+    auto values = selectTimeRange(directory, "RawSensors", "gyroscopes_z",
+            (BLOCK_ROWS - 2) * 1000000LL, (BLOCK_ROWS + 1) * 1000000LL);
+    ASSERT_THAT(values, ElementsAre(BLOCK_ROWS - 2, BLOCK_ROWS - 1, BLOCK_ROWS, BLOCK_ROWS + 1));
+}
+
+TEST_F(ColumnarExportTest, it_writes_one_row_per_satellite_for_DetailedSatellites)
+{
+    {
+        ColumnarExporter exporter(directory);
+        add(exporter, makePacket<protocol::DetailedSatellites>({
+            1, 2, 3, 4, 5, 6, 7,
+            8, 9, 10, 11, 12, 13, 14 }));
+        exporter.flush();
+    }
+
+    ColumnReader prn(directory + "/DetailedSatellites.prn.col");
+    ASSERT_THAT(prn.readBlock(0), ElementsAre(2, 9));
+    ColumnReader azimuth(directory + "/DetailedSatellites.azimuth.col");
+    ASSERT_EQ(COLUMN_UINT16, azimuth.getType());
+    ASSERT_THAT(azimuth.readBlock(0), ElementsAre(0x605, 0xD0C));
+}
+
+TEST_F(ColumnarExportTest, it_ignores_unsupported_and_malformed_packets)
+{
+    ColumnarExporter exporter(directory);
+    add(exporter, makePacket<protocol::DeviceInformation>());
+    add(exporter, makePacket<protocol::RawSensors>({ 1, 2, 3 }));
+    ASSERT_EQ(0, exporter.getExportedPacketCount());
+    ASSERT_EQ(2, exporter.getIgnoredPacketCount());
+}
+
+TEST_F(ColumnarExportTest, it_writes_the_block_headers_in_little_endian_byte_order)
+{
+    {
+        ColumnWriter writer(directory + "/test.col", COLUMN_UINT16);
+        writer.add(uint16_t(2));
+        writer.add(uint16_t(0x102));
+        writer.flush();
+    }
+
+    FILE* file = fopen((directory + "/test.col").c_str(), "r");
+    vector<uint8_t> data(sizeof(COLUMN_MAGIC) + 1 + BlockHeader::SIZE);
+    ASSERT_EQ(data.size(), fread(data.data(), 1, data.size(), file));
+    fclose(file);
+
+    uint8_t const* header = &data[sizeof(COLUMN_MAGIC) + 1];
+    ASSERT_THAT(vector<uint8_t>(header, header + 4), ElementsAre(2, 0, 0, 0));
+    vector<uint8_t> min(8), max(8);
+    protocol::write64(&min[0], 2.0);
+    protocol::write64(&max[0], 258.0);
+    ASSERT_EQ(min, vector<uint8_t>(header + 8, header + 16));
+    ASSERT_EQ(max, vector<uint8_t>(header + 16, header + 24));
+
+    ColumnReader reader(directory + "/test.col");
+    ASSERT_EQ(2u, reader.getBlocks()[0].header.row_count);
+    ASSERT_EQ(258, reader.getBlocks()[0].header.max);
+}
+
+TEST_F(ColumnarExportTest, flush_throws_if_the_block_cannot_be_written)
+{
+    ColumnWriter writer("/dev/full", COLUMN_UINT8);
+    writer.add(uint8_t(1));
+    ASSERT_THROW(writer.flush(), iodrivers_base::UnixError);
+}
+
+TEST_F(ColumnarExportTest, the_pending_values_are_dropped_without_flush)
+{
+    {
+        ColumnarExporter exporter(directory);
+        add(exporter, makeRawSensors(1));
+    }
+
+    ColumnReader column(directory + "/RawSensors.gyroscopes_z.col");
+    ASSERT_TRUE(column.getBlocks().empty());
+}
@@ -0,0 +1,250 @@
+#include "test_Helpers.hpp"
+#include <imu_advanced_navigation_anpp/DeviceSimulator.hpp>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+using protocol::Header;
+using testing::ElementsAre;
+
+struct DeviceSimulatorTest : ::testing::Test
+{
+    base::Time start = base::Time::fromSeconds(1000);
+
+    static DeviceSimulator::Options unlimited()
+    {
+        DeviceSimulator::Options options;
+        options.baudrate = 0;
+        return options;
+    }
+
+    vector<vector<uint8_t>> readPackets(DeviceSimulator& simulator, base::Time const& time)
+    {
+        uint8_t buffer[65536];
+        size_t size = simulator.readOutput(buffer, sizeof(buffer), time);
+
+        vector<vector<uint8_t>> packets;
+        for (size_t start = 0; start < size; )
+        {
+            int result = protocol::extractPacket(buffer + start, size - start);
+            EXPECT_GT(result, 0);
+            if (result <= 0)
+                break;
+            packets.push_back(vector<uint8_t>(buffer + start, buffer + start + result));
+            start += result;
+        }
+        return packets;
+    }
+
+    vector<uint8_t> readIDs(DeviceSimulator& simulator, base::Time const& time)
+    {
+        vector<uint8_t> ids;
+        for (auto const& packet : readPackets(simulator, time))
+            ids.push_back(packet[1]);
+        return ids;
+    }
+
+    void send(DeviceSimulator& simulator, vector<uint8_t> const& packet)
+    {
+        simulator.receive(packet.data(), packet.size());
+    }
+
+    vector<uint8_t> makePacketPeriods(map<uint8_t, uint32_t> const& periods, bool permanent = false)
+    {
+        uint8_t payload[protocol::MAX_PACKET_SIZE];
+        protocol::PacketPeriods packet { permanent, 1 };
+        uint8_t* payload_end = packet.marshal(payload, periods.begin(), periods.end());
+        return makePacket<protocol::PacketPeriods>(vector<uint8_t>(payload, payload_end));
+    }
+
+    protocol::Acknowledge readAck(DeviceSimulator& simulator, vector<uint8_t> const& sent)
+    {
+        auto packets = readPackets(simulator, start);
+        if (packets.size() != 1 || packets[0][1] != protocol::Acknowledge::ID)
+            throw std::runtime_error("expected a single ack");
+        auto ack = protocol::Acknowledge::unmarshal(
+            packets[0].begin() + Header::SIZE, packets[0].end());
+        EXPECT_TRUE(ack.isMatching(reinterpret_cast<Header const&>(sent[0])));
+        return ack;
+    }
+};
+
+TEST_F(DeviceSimulatorTest, it_answers_a_DeviceInformation_request)
+{
+    DeviceSimulator simulator(unlimited());
+    send(simulator, makeQuery<protocol::DeviceInformation>());
+    auto packets = readPackets(simulator, start);
+    ASSERT_EQ(1u, packets.size());
+    auto info = protocol::DeviceInformation::unmarshal(
+        packets[0].begin() + Header::SIZE, packets[0].end());
+    ASSERT_EQ(simulator.getDeviceInformation().serial_number_part2, info.serial_number_part2);
+}
+
+TEST_F(DeviceSimulatorTest, it_emits_the_packet_trains_at_the_configured_periods_in_ID_order)
+{
+    DeviceSimulator simulator(unlimited());
+    auto packet = makePacketPeriods({ { protocol::RawSensors::ID, 2 }, { protocol::UnixTime::ID, 1 } });
+    send(simulator, packet);
+    ASSERT_EQ(ACK_SUCCESS, readAck(simulator, packet).result);
+
+    simulator.update(start);
+    simulator.update(start + base::Time::fromMicroseconds(3500));
+    ASSERT_THAT(readIDs(simulator, start), ElementsAre(
+        protocol::UnixTime::ID, protocol::RawSensors::ID,
+        protocol::UnixTime::ID,
+        protocol::UnixTime::ID, protocol::RawSensors::ID,
+        protocol::UnixTime::ID));
+}
+
+TEST_F(DeviceSimulatorTest, it_follows_the_packet_timer_period)
+{
+    DeviceSimulator simulator(unlimited());
+    send(simulator, makePacketPeriods({ { protocol::UnixTime::ID, 1 } }));
+    auto packet = makePacket<protocol::PacketTimerPeriod>({ 0, 1, 0x10, 0x27 });
+    send(simulator, packet);
+    readPackets(simulator, start);
+
+    simulator.update(start);
+    simulator.update(start + base::Time::fromMilliseconds(25));
+    ASSERT_EQ(3u, readPackets(simulator, start).size());
+    ASSERT_EQ(base::Time::fromMilliseconds(10), simulator.getPacketTimerPeriod());
+}
+
+TEST_F(DeviceSimulatorTest, it_rejects_periods_for_packets_it_cannot_generate)
+{
+    DeviceSimulator simulator(unlimited());
+    auto packet = makePacketPeriods({ { protocol::FilterOptions::ID, 1 } });
+    send(simulator, packet);
+    ASSERT_EQ(ACK_FAILED_OUT_OF_RANGE, readAck(simulator, packet).result);
+}
+
+TEST_F(DeviceSimulatorTest, it_acknowledges_unknown_packets_with_an_error)
+{
+    DeviceSimulator simulator(unlimited());
+    vector<uint8_t> packet(Header::SIZE);
+    new(&packet[0]) Header(150, packet.data() + Header::SIZE, packet.data() + packet.size());
+    send(simulator, packet);
+    ASSERT_EQ(ACK_FAILED_UNKNOWN_PACKET, readAck(simulator, packet).result);
+}
+
+TEST_F(DeviceSimulatorTest, a_reset_restores_the_permanent_settings)
+{
+    DeviceSimulator simulator(unlimited());
+    send(simulator, makePacketPeriods({ { protocol::RawSensors::ID, 10 } }, true));
+    send(simulator, makePacketPeriods({ { protocol::UnixTime::ID, 1 } }, false));
+    readPackets(simulator, start);
+    ASSERT_EQ(1u, simulator.getPacketPeriods().count(protocol::UnixTime::ID));
+
+    vector<uint8_t> payload(4);
+    protocol::ColdStartReset().marshal(payload.begin());
+    auto packet = makePacket<protocol::ColdStartReset>(payload);
+    send(simulator, packet);
+    ASSERT_EQ(ACK_SUCCESS, readAck(simulator, packet).result);
+
+    map<uint8_t, uint32_t> expected { { protocol::RawSensors::ID, 10 } };
+    ASSERT_EQ(expected, simulator.getPacketPeriods());
+    ASSERT_EQ(1u, simulator.getStatistics().resets);
+}
+
+TEST_F(DeviceSimulatorTest, it_answers_a_request_for_a_setting_with_the_written_value)
+{
+    DeviceSimulator simulator(unlimited());
+    protocol::FilterOptions options;
+    options.permanent = 0;
+    options.vehicle_type = VEHICLE_BOAT;
+    options.enabled_internal_gnss = 0;
+    options.enabled_atmospheric_altitude = 0;
+    options.enabled_velocity_heading = 1;
+    options.enabled_reversing_detection = 0;
+    options.enabled_motion_analysis = 1;
+    vector<uint8_t> payload(protocol::FilterOptions::SIZE);
+    options.marshal(payload.begin());
+    send(simulator, makePacket<protocol::FilterOptions>(payload));
+    readPackets(simulator, start);
+
+    send(simulator, makeQuery<protocol::FilterOptions>());
+    auto packets = readPackets(simulator, start);
+    ASSERT_EQ(1u, packets.size());
+    ASSERT_EQ(payload, vector<uint8_t>(packets[0].begin() + Header::SIZE, packets[0].end()));
+}
+
+TEST_F(DeviceSimulatorTest, it_paces_the_output_by_the_baud_rate)
+{
+    DeviceSimulator::Options options;
+    options.baudrate = 9600;
+    options.output_buffer_size = 100000;
+    DeviceSimulator simulator(options);
+    send(simulator, makePacketPeriods({ { protocol::RawSensors::ID, 1 } }));
+    simulator.update(start);
+    simulator.update(start + base::Time::fromMilliseconds(100));
+
+    uint8_t buffer[65536];
+    // The initial burst is one maximum-size packet
+    ASSERT_EQ(static_cast<size_t>(protocol::MAX_PACKET_SIZE),
+              simulator.readOutput(buffer, sizeof(buffer), start));
+    ASSERT_EQ(96u, simulator.readOutput(buffer, sizeof(buffer), start + base::Time::fromMilliseconds(100)));
+}
+
+TEST_F(DeviceSimulatorTest, it_drops_trains_that_do_not_fit_and_reports_the_overflow)
+{
+    DeviceSimulator::Options options = unlimited();
+    options.output_buffer_size = 200;
+    DeviceSimulator simulator(options);
+    send(simulator, makePacketPeriods({ { protocol::RawSensors::ID, 1 }, { protocol::Status::ID, 1 } }));
+    simulator.update(start);
+    simulator.update(start + base::Time::fromMilliseconds(9));
+    ASSERT_GT(simulator.getStatistics().dropped_packets, 0u);
+
+    readPackets(simulator, start);
+    simulator.update(start + base::Time::fromMilliseconds(10));
+    auto packets = readPackets(simulator, start);
+    ASSERT_EQ(protocol::Status::ID, packets.at(0)[1]);
+    auto status = protocol::Status::unmarshal(packets[0].begin() + Header::SIZE, packets[0].end());
+    ASSERT_EQ(SYSTEM_DATA_OUTPUT_OVERFLOW_ALARM, status.system_status);
+
+    simulator.update(start + base::Time::fromMilliseconds(11));
+    packets = readPackets(simulator, start);
+    status = protocol::Status::unmarshal(packets.at(0).begin() + Header::SIZE, packets[0].end());
+    ASSERT_EQ(0, status.system_status);
+}
+
+TEST_F(DeviceSimulatorTest, it_corrupts_packets_at_the_requested_rate)
+{
+    DeviceSimulator::Options options = unlimited();
+    options.corruption_rate = 1;
+    DeviceSimulator simulator(options);
+    send(simulator, makePacketPeriods({ { protocol::RawSensors::ID, 1 } }));
+    simulator.update(start);
+    simulator.update(start + base::Time::fromMilliseconds(9));
+
+    uint8_t buffer[65536];
+    size_t size = simulator.readOutput(buffer, sizeof(buffer), start);
+    ASSERT_EQ(11u, simulator.getStatistics().corrupted_packets);
+    for (size_t i = 0; i < size; )
+    {
+        int result = protocol::extractPacket(buffer + i, size - i);
+        ASSERT_LE(result, 0);
+        i += (result == 0) ? size : -result;
+    }
+}
+
+TEST_F(DeviceSimulatorTest, it_generates_physically_consistent_sensor_values)
+{
+    DeviceSimulator::Options options = unlimited();
+    options.noise = 1;
+    DeviceSimulator simulator(options);
+    send(simulator, makePacketPeriods({
+        { protocol::RawSensors::ID, 1 }, { protocol::QuaternionOrientation::ID, 1 } }));
+    simulator.update(start);
+    readPackets(simulator, start);
+
+    // The simulator skips the trains it missed for more than a second
+    simulator.update(start + base::Time::fromSeconds(12.3));
+
+    auto packets = readPackets(simulator, start);
+    ASSERT_EQ(2u, packets.size());
+    auto raw = protocol::RawSensors::unmarshal(packets[0].begin() + Header::SIZE, packets[0].end());
+    Eigen::Vector3d acc(raw.accelerometers_xyz[0], raw.accelerometers_xyz[1], raw.accelerometers_xyz[2]);
+    ASSERT_NEAR(9.81, acc.norm(), 0.2);
+    auto q = protocol::QuaternionOrientation::unmarshal(packets[1].begin() + Header::SIZE, packets[1].end());
+    ASSERT_NEAR(1, Eigen::Quaterniond(q.im, q.xyz[0], q.xyz[1], q.xyz[2]).norm(), 1e-6);
+}
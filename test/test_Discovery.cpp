@@ -0,0 +1,59 @@
+#include "gtest/gtest.h"
+#include <imu_advanced_navigation_anpp/Discovery.hpp>
+#include <imu_advanced_navigation_anpp/PseudoTerminalSimulator.hpp>
+#include <atomic>
+#include <thread>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+
+TEST(DiscoveryTest, listCandidatePorts_only_returns_serial_devices)
+{
+    for (auto const& port : discovery::listCandidatePorts())
+    {
+        ASSERT_TRUE(port.find("/dev/ttyUSB") == 0 ||
+                    port.find("/dev/ttyACM") == 0 ||
+                    port.find("/dev/ttyS") == 0) << port;
+    }
+}
+
+TEST(DiscoveryTest, discover_ignores_ports_that_cannot_be_opened)
+{
+    auto devices = discovery::discover({ "/dev/does_not_exist_0", "/dev/does_not_exist_1" });
+    ASSERT_TRUE(devices.empty());
+}
+
+TEST(DiscoveryTest, discover_finds_the_rate_and_information_of_a_simulated_device)
+{
+    DeviceSimulator::Options options;
+    options.baudrate = 230400;
+    PseudoTerminalSimulator terminal(options);
+    std::atomic<bool> stop(false);
+    thread server([&terminal, &stop]() {
+        while (!stop)
+            terminal.update();
+    });
+
+    vector<discovery::DiscoveredDevice> devices;
+    try
+    {
+        devices = discovery::discover({ terminal.getPath() });
+    }
+    catch(...)
+    {
+        stop = true;
+        server.join();
+        throw;
+    }
+    stop = true;
+    server.join();
+
+    ASSERT_EQ(1u, devices.size());
+    ASSERT_EQ(terminal.getPath(), devices[0].port);
+    ASSERT_EQ(230400u, devices[0].baudrate);
+    ASSERT_TRUE(devices[0].has_device_information);
+    DeviceInformation const& expected = terminal.getSimulator().getDeviceInformation();
+    ASSERT_EQ(expected.software_version, devices[0].device_information.software_version);
+    ASSERT_EQ(expected.device_id, devices[0].device_information.device_id);
+    ASSERT_EQ(expected.serial_number_part2, devices[0].device_information.serial_number_part2);
+}
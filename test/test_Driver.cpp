@@ -40,7 +40,17 @@ TEST_F(DriverTest, extractPacket_ignores_starting_bytes_that_do_not_validate_on_
 {
     pushDataToDriver( { 0x10, 0x10, 0x10, 0, 1, 0, 0 } );
     ASSERT_THROW(readPacket(), iodrivers_base::TimeoutError);
-    ASSERT_EQ(3, getQueuedBytes());
+    ASSERT_EQ(4, getQueuedBytes());
+}
+
+TEST_F(DriverTest, extractPacket_keeps_a_header_split_across_two_reads)
+{
+    std::vector<uint8_t> expected { 0x00, 0, 1, 0x00, 0xFF, 0xFF };
+    pushDataToDriver( { 0x10, 0x10, 0x10, 0x00, 0, 1, 0 } );
+    ASSERT_THROW(readPacket(), iodrivers_base::TimeoutError);
+    pushDataToDriver( { 0xFF, 0xFF } );
+    auto packet = readPacket();
+    EXPECT_THAT(packet, ContainerEq(expected));
 }
 
 TEST_F(DriverTest, extractPacket_successfully_realigns_on_a_packet_header_towards_the_end_of_the_buffer)
@@ -51,6 +61,28 @@ TEST_F(DriverTest, extractPacket_successfully_realigns_on_a_packet_header_toward
     EXPECT_THAT(packet, ContainerEq(expected));
 }
 
+TEST_F(DriverTest, measureValidByteRatio_returns_the_fraction_of_bytes_in_valid_packets)
+{
+    pushDataToDriver( { 0x10, 0x10, 0x10, 0x10 } );
+    pushDataToDriver(makePacket<protocol::RawSensors>());
+    pushDataToDriver(makePacket<protocol::RawSensors>());
+    double packet_bytes = 2 * (protocol::Header::SIZE + protocol::RawSensors::SIZE);
+    ASSERT_DOUBLE_EQ(packet_bytes / (packet_bytes + 4),
+                     driver.measureValidByteRatio(base::Time::fromMilliseconds(10)));
+}
+
+TEST_F(DriverTest, measureValidByteRatio_returns_zero_if_too_few_packets_are_received)
+{
+    pushDataToDriver(makePacket<protocol::RawSensors>());
+    ASSERT_EQ(0, driver.measureValidByteRatio(base::Time::fromMilliseconds(10)));
+}
+
+TEST_F(DriverTest, measureValidByteRatio_does_not_write_anything)
+{ IODRIVERS_BASE_MOCK();
+    pushDataToDriver(makePacket<protocol::RawSensors>());
+    driver.measureValidByteRatio(base::Time::fromMilliseconds(10), 1);
+}
+
 TEST_F(DriverTest, UseDeviceTime_is_false_by_default)
 {
     ASSERT_FALSE(driver.getUseDeviceTime());
@@ -312,6 +344,39 @@ TEST_F(PollTest, poll_handles_formerly_enabled_packets)
     ASSERT_EQ(5, poll());
 }
 
+TEST_F(PollTest, setPacketPeriods_configures_all_periods_with_a_single_packet)
+{
+    { IODRIVERS_BASE_MOCK();
+        std::vector<uint8_t> packet = makePacket<protocol::PacketPeriods>({
+            0, 1,
+            protocol::UnixTime::ID, 0, 0, 0, 0,
+            protocol::RawSensors::ID, 2, 0, 0, 0,
+            protocol::QuaternionOrientation::ID, 1, 0, 0, 0 });
+        EXPECT_REPLY(packet, makeAcknowledge(packet, ACK_SUCCESS));
+        driver.setPacketPeriods({
+            { protocol::QuaternionOrientation::ID, 1 },
+            { protocol::RawSensors::ID, 2 } });
+    }
+
+    pushDataToDriver(makePacket<protocol::RawSensors>());
+    pushDataToDriver(makePacket<protocol::QuaternionOrientation>());
+    ASSERT_EQ(2, poll());
+    ASSERT_EQ(1, poll());
+}
+
+TEST_F(PollTest, setPacketPeriods_keeps_the_UnixTime_packet_if_UseDeviceTime_is_set)
+{ IODRIVERS_BASE_MOCK();
+    EXPECT_PACKET_PERIOD(protocol::UnixTime::ID, 1);
+    driver.setUseDeviceTime(true);
+
+    std::vector<uint8_t> packet = makePacket<protocol::PacketPeriods>({
+        0, 1,
+        protocol::UnixTime::ID, 1, 0, 0, 0,
+        protocol::RawSensors::ID, 2, 0, 0, 0 });
+    EXPECT_REPLY(packet, makeAcknowledge(packet, ACK_SUCCESS));
+    driver.setPacketPeriods({ { protocol::RawSensors::ID, 2 } });
+}
+
 TEST_F(PollTest, poll_handles_interleaved_periods)
 {
     { IODRIVERS_BASE_MOCK();
@@ -457,3 +522,130 @@ TEST_F(DriverTest, synchronous_reading_in_the_middle_of_a_train_does_not_lead_to
     // to process again
 }
 
+
+struct DriverStatisticsTest : DriverTest
+{
+    DriverStatisticsTest()
+    {
+        // Forget about the acknowledgment read by openTestURI()
+        driver.resetStatistics();
+    }
+
+    void process(std::vector<uint8_t> const& packet)
+    {
+        driver.processPacket(packet.data(), packet.size());
+    }
+};
+
+TEST_F(DriverStatisticsTest, it_counts_the_valid_packets_by_ID_and_the_received_bytes)
+{
+    pushDataToDriver(makePacket<protocol::RawSensors>());
+    pushDataToDriver(makePacket<protocol::RawSensors>());
+    pushDataToDriver(makePacket<protocol::Status>());
+    readPacket();
+    readPacket();
+    readPacket();
+
+    auto const& stats = driver.getStatistics();
+    ASSERT_EQ(2u, stats.packets[protocol::RawSensors::ID]);
+    ASSERT_EQ(1u, stats.packets[protocol::Status::ID]);
+    ASSERT_EQ(3 * Header::SIZE + 2 * protocol::RawSensors::SIZE + protocol::Status::SIZE,
+              stats.received_bytes);
+    ASSERT_EQ(0u, stats.resync_bytes);
+}
+
+TEST_F(DriverStatisticsTest, it_counts_LRC_failures_and_the_discarded_bytes)
+{
+    pushDataToDriver( { 0x10, 0x10, 0x10 } );
+    pushDataToDriver(makePacket<protocol::Status>());
+    readPacket();
+
+    auto const& stats = driver.getStatistics();
+    ASSERT_EQ(1u, stats.lrc_failures);
+    ASSERT_EQ(0u, stats.crc_failures);
+    ASSERT_EQ(3u, stats.resync_bytes);
+    ASSERT_EQ(3u + Header::SIZE + protocol::Status::SIZE, stats.received_bytes);
+}
+
+TEST_F(DriverStatisticsTest, it_counts_a_packet_that_fails_its_CRC_once)
+{
+    auto corrupted = makePacket<protocol::RawSensors>();
+    corrupted[Header::SIZE + 10] ^= 0x20;
+    pushDataToDriver(corrupted);
+    pushDataToDriver(makePacket<protocol::Status>());
+    readPacket();
+
+    auto const& stats = driver.getStatistics();
+    ASSERT_EQ(1u, stats.crc_failures);
+    ASSERT_EQ(0u, stats.lrc_failures);
+    ASSERT_EQ(corrupted.size(), stats.resync_bytes);
+    ASSERT_EQ(0u, stats.packets[protocol::RawSensors::ID]);
+    ASSERT_EQ(1u, stats.packets[protocol::Status::ID]);
+}
+
+TEST_F(DriverStatisticsTest, it_counts_a_CRC_failure_following_a_valid_packet_after_a_false_header)
+{
+    // A header that validates but claims a payload covering the packets
+    // that follow it
+    auto false_header = makePacket<protocol::RawSensors>(std::vector<uint8_t>(200, 0));
+    false_header.resize(Header::SIZE);
+    auto corrupted = makePacket<protocol::UnixTime>();
+    corrupted.back() ^= 0xFF;
+
+    pushDataToDriver(false_header);
+    pushDataToDriver(makePacket<protocol::Status>());
+    pushDataToDriver(corrupted);
+    pushDataToDriver(makePacket<protocol::Status>());
+    pushDataToDriver(std::vector<uint8_t>(200, 0x55));
+    readPacket();
+    readPacket();
+
+    auto const& stats = driver.getStatistics();
+    ASSERT_EQ(2u, stats.crc_failures);
+    ASSERT_EQ(2u, stats.packets[protocol::Status::ID]);
+    ASSERT_EQ(Header::SIZE + corrupted.size(), stats.resync_bytes);
+}
+
+TEST_F(DriverStatisticsTest, it_counts_unknown_packets_and_length_errors)
+{
+    driver.setReplayConfiguration({ { protocol::RawSensors::ID, 1 } }, false);
+    driver.setCurrentTimestamp(base::Time::now());
+    process(makePacket<protocol::FilterOptions>());
+    ASSERT_THROW(process(makePacket<protocol::RawSensors>({ 0, 0, 0 })), std::length_error);
+
+    auto const& stats = driver.getStatistics();
+    ASSERT_EQ(1u, stats.unknown_packets);
+    ASSERT_EQ(1u, stats.length_errors);
+}
+
+TEST_F(DriverStatisticsTest, it_counts_the_trains_that_lack_a_packet_due_according_to_the_periods)
+{
+    driver.setReplayConfiguration({
+        { protocol::RawSensors::ID, 1 }, { protocol::QuaternionOrientation::ID, 2 } }, false);
+    process(makePacket<protocol::RawSensors>());
+    process(makePacket<protocol::QuaternionOrientation>());
+    process(makePacket<protocol::RawSensors>());
+    // The orientation is missing from this train
+    process(makePacket<protocol::RawSensors>());
+    process(makePacket<protocol::RawSensors>());
+    process(makePacket<protocol::QuaternionOrientation>());
+    process(makePacket<protocol::RawSensors>());
+
+    auto const& stats = driver.getStatistics();
+    ASSERT_EQ(4u, stats.trains);
+    ASSERT_EQ(1u, stats.incomplete_trains);
+}
+
+TEST_F(DriverStatisticsTest, resetStatistics_zeroes_all_counters)
+{
+    pushDataToDriver( { 0x10 } );
+    pushDataToDriver(makePacket<protocol::Status>());
+    readPacket();
+    driver.resetStatistics();
+
+    auto const& stats = driver.getStatistics();
+    ASSERT_EQ(0u, stats.received_bytes);
+    ASSERT_EQ(0u, stats.lrc_failures);
+    ASSERT_EQ(0u, stats.packets[protocol::Status::ID]);
+    ASSERT_EQ(256u, stats.packets.size());
+}
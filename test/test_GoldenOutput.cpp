@@ -0,0 +1,246 @@
+#include "test_Helpers.hpp"
+#include <imu_advanced_navigation_anpp/GoldenOutput.hpp>
+#include <imu_advanced_navigation_anpp/StreamGenerator.hpp>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <set>
+#include <sstream>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+
+static golden::Record makeRecord(int period, double value)
+{
+    golden::Record record;
+    record.period = period;
+    record.values.resize(golden::getFieldNames().size(), value);
+    return record;
+}
+
+static uint64_t bitsOf(double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+TEST(GoldenOutputTest, the_field_names_are_unique)
+{
+    auto const& names = golden::getFieldNames();
+    set<string> unique(names.begin(), names.end());
+    ASSERT_EQ(names.size(), unique.size());
+    ASSERT_TRUE(unique.count("world.position.x"));
+    ASSERT_TRUE(unique.count("world.orientation.w"));
+    ASSERT_TRUE(unique.count("world.cov_velocity.22"));
+    ASSERT_TRUE(unique.count("imu.gyro.z"));
+    ASSERT_TRUE(unique.count("gnss.latitude"));
+    ASSERT_TRUE(unique.count("status.filter_status"));
+}
+
+TEST(GoldenOutputTest, a_snapshot_has_one_value_per_field)
+{
+    Driver driver;
+    golden::Record record = golden::snapshot(driver, 3);
+    ASSERT_EQ(3, record.period);
+    ASSERT_EQ(golden::getFieldNames().size(), record.values.size());
+}
+
+TEST(GoldenOutputTest, it_reads_back_the_written_records)
+{
+    stringstream stream;
+    golden::Writer writer(stream);
+    golden::Record first = makeRecord(1, 0.5);
+    first.values[1] = -0.0;
+    writer.write(first);
+    writer.write(makeRecord(-1, 2));
+
+    golden::Reader reader(stream);
+    ASSERT_EQ(golden::getFieldNames(), reader.getFieldNames());
+    golden::Record record;
+    ASSERT_TRUE(reader.next(record));
+    ASSERT_EQ(1, record.period);
+    ASSERT_EQ(first.values.size(), record.values.size());
+    ASSERT_EQ(0.5, record.values[0]);
+    ASSERT_EQ(bitsOf(-0.0), bitsOf(record.values[1]));
+    ASSERT_TRUE(reader.next(record));
+    ASSERT_EQ(-1, record.period);
+    ASSERT_FALSE(reader.next(record));
+}
+
+TEST(GoldenOutputTest, it_writes_the_header_and_records_in_little_endian_byte_order)
+{
+    stringstream stream;
+    golden::Writer writer(stream);
+    size_t header_size = stream.str().size();
+    writer.write(makeRecord(0x01020304, 1.0));
+    string data = stream.str();
+
+    uint32_t field_count = golden::getFieldNames().size();
+    string expected_count(4, '\0');
+    protocol::write32(&expected_count[0], field_count);
+    ASSERT_EQ(expected_count, data.substr(sizeof(golden::GOLDEN_MAGIC), 4));
+    ASSERT_EQ(string("\x04\x03\x02\x01", 4), data.substr(header_size, 4));
+    // 1.0 is 0x3ff0000000000000
+    ASSERT_EQ(string("\0\0\0\0\0\0\xf0\x3f", 8), data.substr(header_size + 4, 8));
+}
+
+TEST(GoldenOutputTest, it_writes_all_NaNs_as_the_canonical_quiet_NaN)
+{
+    double nan_with_payload;
+    uint64_t bits = 0x7ff8000000001234ull;
+    memcpy(&nan_with_payload, &bits, sizeof(bits));
+
+    stringstream stream;
+    golden::Writer writer(stream);
+    writer.write(makeRecord(1, nan_with_payload));
+    golden::Reader reader(stream);
+    golden::Record record;
+    reader.next(record);
+    ASSERT_EQ(0x7ff8000000000000ull, bitsOf(record.values[0]));
+}
+
+TEST(GoldenOutputTest, the_reader_rejects_other_files)
+{
+    stringstream stream("ANPPCOL1 something else");
+    ASSERT_THROW(golden::Reader reader(stream), std::runtime_error);
+}
+
+TEST(GoldenOutputTest, the_reader_throws_on_a_truncated_record)
+{
+    stringstream stream;
+    golden::Writer writer(stream);
+    writer.write(makeRecord(1, 0));
+    string data = stream.str();
+    stringstream truncated(data.substr(0, data.size() - 3));
+
+    golden::Reader reader(truncated);
+    golden::Record record;
+    ASSERT_THROW(reader.next(record), std::runtime_error);
+}
+
+TEST(GoldenComparisonTest, it_compares_bits_without_tolerance)
+{
+    golden::Comparison comparison;
+    ASSERT_TRUE(comparison.isEqual(1.5, 1.5));
+    ASSERT_FALSE(comparison.isEqual(0.0, -0.0));
+    ASSERT_FALSE(comparison.isEqual(1.0, nextafter(1.0, 2.0)));
+    ASSERT_TRUE(comparison.isEqual(base::unknown<double>(), -base::unknown<double>()));
+}
+
+TEST(GoldenComparisonTest, its_tolerance_is_absolute_below_one_and_relative_above)
+{
+    golden::Comparison comparison(1e-6);
+    ASSERT_TRUE(comparison.isEqual(0.1, 0.1 + 0.9e-6));
+    ASSERT_FALSE(comparison.isEqual(0.1, 0.1 + 1.1e-6));
+    ASSERT_TRUE(comparison.isEqual(5e6, 5e6 + 4));
+    ASSERT_FALSE(comparison.isEqual(5e6, 5e6 + 6));
+    ASSERT_TRUE(comparison.isEqual(base::unknown<double>(), base::unknown<double>()));
+    ASSERT_FALSE(comparison.isEqual(0, base::unknown<double>()));
+    double inf = numeric_limits<double>::infinity();
+    ASSERT_TRUE(comparison.isEqual(inf, inf));
+    ASSERT_FALSE(comparison.isEqual(inf, -inf));
+}
+
+TEST(GoldenComparisonTest, it_reports_the_differing_values)
+{
+    golden::Comparison comparison(0, 2);
+    comparison.add(makeRecord(1, 0), makeRecord(1, 0));
+
+    golden::Record actual = makeRecord(2, 0);
+    actual.values[4] = 1;
+    actual.values[5] = 2;
+    comparison.add(makeRecord(1, 0), actual);
+
+    ASSERT_FALSE(comparison.isMatching());
+    ASSERT_EQ(2u, comparison.getRecordCount());
+    ASSERT_EQ(1u, comparison.getDifferingRecordCount());
+    ASSERT_EQ(3u, comparison.getDifferingValueCount());
+    auto const& differences = comparison.getDifferences();
+    ASSERT_EQ(2u, differences.size());
+    ASSERT_EQ(1u, differences[0].record);
+    ASSERT_EQ(-1, differences[0].field);
+    ASSERT_EQ(1, differences[0].expected);
+    ASSERT_EQ(2, differences[0].actual);
+    ASSERT_EQ(4, differences[1].field);
+}
+
+TEST(GoldenComparisonTest, it_counts_the_missing_and_extra_records)
+{
+    stringstream expected_stream, actual_stream;
+    {
+        golden::Writer expected(expected_stream);
+        golden::Writer actual(actual_stream);
+        for (int i = 0; i < 3; ++i)
+            expected.write(makeRecord(1, i));
+        actual.write(makeRecord(1, 0));
+    }
+
+    golden::Reader expected(expected_stream);
+    golden::Reader actual(actual_stream);
+    golden::Comparison comparison;
+    golden::compare(expected, actual, comparison);
+    ASSERT_EQ(1u, comparison.getRecordCount());
+    ASSERT_EQ(2u, comparison.getMissingRecordCount());
+    ASSERT_EQ(0u, comparison.getExtraRecordCount());
+    ASSERT_FALSE(comparison.isMatching());
+}
+
+struct GoldenReplayTest : ::testing::Test
+{
+    TempFile log;
+    string const& path = log.path;
+
+    void writeLog(uint32_t seed)
+    {
+        StreamGenerator generator(seed);
+        generator.setPacketPeriods({
+            { protocol::UnixTime::ID, 1 },
+            { protocol::Status::ID, 2 },
+            { protocol::RawSensors::ID, 1 },
+            { protocol::GeodeticPosition::ID, 1 },
+            { protocol::QuaternionOrientation::ID, 1 }
+        });
+        generator.setNoise(1);
+        vector<uint8_t> data;
+        generator.generate(data, 20000);
+
+        log.write(data);
+    }
+
+    string record()
+    {
+        stringstream stream;
+        golden::Writer writer(stream);
+        golden::replay(path, [&writer](golden::Record const& record) { writer.write(record); });
+        return stream.str();
+    }
+};
+
+TEST_F(GoldenReplayTest, replaying_the_same_log_is_bit_exact)
+{
+    writeLog(42);
+    stringstream first(record()), second(record());
+
+    golden::Reader expected(first);
+    golden::Reader actual(second);
+    golden::Comparison comparison;
+    golden::compare(expected, actual, comparison);
+    ASSERT_LT(100u, comparison.getRecordCount());
+    ASSERT_TRUE(comparison.isMatching());
+}
+
+TEST_F(GoldenReplayTest, it_detects_a_different_log)
+{
+    writeLog(42);
+    stringstream first(record());
+    writeLog(43);
+    stringstream second(record());
+
+    golden::Reader expected(first);
+    golden::Reader actual(second);
+    golden::Comparison comparison;
+    golden::compare(expected, actual, comparison);
+    ASSERT_FALSE(comparison.isMatching());
+    ASSERT_LT(0u, comparison.getDifferingRecordCount());
+}
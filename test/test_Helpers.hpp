@@ -6,6 +6,11 @@
 #include <imu_advanced_navigation_anpp/Protocol.hpp>
 #include <imu_advanced_navigation_anpp/Driver.hpp>
 #include <iodrivers_base/FixtureGTest.hpp>
+#include <cerrno>
+#include <cstdio>
+#include <string>
+#include <system_error>
+#include <unistd.h>
 
 inline void RAW_SET(uint8_t* begin, std::vector<uint8_t> bytes)
 {
@@ -94,6 +99,40 @@ inline std::vector<uint8_t> makeAcknowledge(std::vector<uint8_t> const& packet,
             { packet[1], packet[3], packet[4], static_cast<uint8_t>(result) });
 }
 
+/** A file created with mkstemp and removed when the object is destroyed */
+struct TempFile
+{
+    std::string path;
+
+    TempFile()
+    {
+        char path_template[] = "/tmp/anpp_test_XXXXXX";
+        int fd = mkstemp(path_template);
+        if (fd == -1)
+            throw std::system_error(errno, std::system_category(), "mkstemp");
+        ::close(fd);
+        path = path_template;
+    }
+
+    ~TempFile()
+    {
+        unlink(path.c_str());
+    }
+
+    TempFile(TempFile const&) = delete;
+    TempFile& operator = (TempFile const&) = delete;
+
+    /** Replace the file's contents with the given bytes */
+    void write(std::vector<uint8_t> const& data) const
+    {
+        FILE* file = fopen(path.c_str(), "w");
+        if (!file)
+            throw std::system_error(errno, std::system_category(), "fopen");
+        fwrite(data.data(), 1, data.size(), file);
+        fclose(file);
+    }
+};
+
 struct DriverTestBase : ::testing::Test, iodrivers_base::Fixture<imu_advanced_navigation_anpp::Driver>
 {
     void openTestURI()
@@ -0,0 +1,166 @@
+#include "test_Helpers.hpp"
+#include <imu_advanced_navigation_anpp/Jitter.hpp>
+#include <imu_advanced_navigation_anpp/StreamGenerator.hpp>
+#include <set>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+
+TEST(IntervalStatisticsTest, it_computes_the_mean_and_standard_deviation)
+{
+    IntervalStatistics stats;
+    vector<double> intervals = { 0.009, 0.010, 0.011, 0.010, 0.012, 0.008 };
+    for (double interval : intervals)
+        stats.add(interval, 0.010);
+
+    double mean = 0;
+    for (double interval : intervals)
+        mean += interval / intervals.size();
+    double variance = 0;
+    for (double interval : intervals)
+        variance += (interval - mean) * (interval - mean) / (intervals.size() - 1);
+
+    ASSERT_EQ(6u, stats.count);
+    ASSERT_NEAR(mean, stats.mean, 1e-12);
+    ASSERT_NEAR(variance, stats.getVariance(), 1e-12);
+    ASSERT_NEAR(sqrt(variance), stats.getStandardDeviation(), 1e-12);
+    ASSERT_DOUBLE_EQ(0.008, stats.min);
+    ASSERT_DOUBLE_EQ(0.012, stats.max);
+    ASSERT_EQ(0u, stats.outliers);
+}
+
+TEST(IntervalStatisticsTest, it_counts_the_intervals_too_far_from_the_expected_one_as_outliers)
+{
+    IntervalStatistics stats;
+    stats.add(0.010, 0.010);
+    stats.add(0.007, 0.010);
+    stats.add(0.0124, 0.010);
+    stats.add(0.001, 0.010);
+    ASSERT_EQ(2u, stats.outliers);
+}
+
+TEST(IntervalStatisticsTest, it_has_a_zero_variance_with_less_than_two_intervals)
+{
+    IntervalStatistics stats;
+    ASSERT_EQ(0, stats.getVariance());
+    stats.add(0.010, 0.010);
+    ASSERT_EQ(0, stats.getVariance());
+}
+
+struct DriverJitterTest : DriverTestBase
+{
+    map<uint8_t, uint32_t> periods {
+        { protocol::UnixTime::ID, 1 },
+        { protocol::Status::ID, 2 },
+        { protocol::RawSensors::ID, 1 }
+    };
+    StreamGenerator generator;
+
+    DriverJitterTest()
+    {
+        openTestURI();
+        generator.setPacketPeriods(periods);
+        generator.setPacketTimerPeriod(base::Time::fromMilliseconds(2));
+        driver.setReplayConfiguration(periods, true, base::Time::fromMilliseconds(2));
+        driver.setJitterAnalysisEnabled(true);
+    }
+
+    /** Generate trains and poll their packets, skipping the given trains */
+    void pollTrains(int count, set<int> const& skipped = set<int>())
+    {
+        vector<uint8_t> stream;
+        for (int i = 0; i < count; ++i)
+        {
+            vector<uint8_t> train;
+            generator.generateTrain(train);
+            if (!skipped.count(i))
+                stream.insert(stream.end(), train.begin(), train.end());
+        }
+        pushDataToDriver(stream);
+        try
+        {
+            while (true)
+                driver.poll();
+        }
+        catch (iodrivers_base::TimeoutError const&) {}
+    }
+};
+
+TEST_F(DriverJitterTest, it_measures_the_intervals_against_the_configured_periods)
+{
+    pollTrains(11);
+
+    PacketJitter const& raw = driver.getPacketJitter(protocol::RawSensors::ID);
+    ASSERT_EQ(base::Time::fromMilliseconds(2), raw.expected_interval);
+    ASSERT_EQ(10u, raw.device.count);
+    ASSERT_NEAR(0.002, raw.device.mean, 1e-9);
+    ASSERT_NEAR(0, raw.device.getStandardDeviation(), 1e-9);
+    ASSERT_EQ(0u, raw.device.outliers);
+    ASSERT_EQ(10u, raw.host.count);
+    ASSERT_EQ(0u, raw.missed);
+    ASSERT_EQ(0u, raw.doubled);
+
+    PacketJitter const& status = driver.getPacketJitter(protocol::Status::ID);
+    ASSERT_EQ(base::Time::fromMilliseconds(4), status.expected_interval);
+    ASSERT_EQ(5u, status.device.count);
+    ASSERT_NEAR(0.004, status.device.mean, 1e-9);
+
+    ASSERT_EQ(10u, driver.getPacketJitter(protocol::UnixTime::ID).device.count);
+    ASSERT_TRUE(driver.getPacketJitter(protocol::GeodeticPosition::ID).expected_interval.isNull());
+}
+
+TEST_F(DriverJitterTest, it_reports_missed_packets)
+{
+    pollTrains(11, { 3, 4, 7 });
+
+    PacketJitter const& raw = driver.getPacketJitter(protocol::RawSensors::ID);
+    ASSERT_EQ(3u, raw.missed);
+    ASSERT_EQ(5u, raw.device.count);
+    // Only train 4 had a Status packet
+    ASSERT_EQ(1u, driver.getPacketJitter(protocol::Status::ID).missed);
+}
+
+TEST_F(DriverJitterTest, it_reports_doubled_packets)
+{
+    pollTrains(2);
+    auto packet = makePacket<protocol::RawSensors>();
+    pushDataToDriver(packet);
+    driver.poll();
+
+    PacketJitter const& raw = driver.getPacketJitter(protocol::RawSensors::ID);
+    ASSERT_EQ(1u, raw.doubled);
+    ASSERT_EQ(1u, raw.device.count);
+}
+
+TEST_F(DriverJitterTest, it_counts_a_backwards_device_time_as_an_outlier)
+{
+    pollTrains(3);
+    vector<uint8_t> time(8, 0);
+    protocol::write32(&time[0], 1000);
+    pushDataToDriver(makePacket<protocol::UnixTime>(time));
+    pushDataToDriver(makePacket<protocol::RawSensors>());
+    driver.poll();
+    driver.poll();
+
+    PacketJitter const& raw = driver.getPacketJitter(protocol::RawSensors::ID);
+    ASSERT_EQ(0u, raw.missed);
+    ASSERT_EQ(0u, raw.doubled);
+    ASSERT_EQ(1u, raw.device.outliers);
+    ASSERT_EQ(2u, raw.device.count);
+    ASSERT_EQ(1u, driver.getPacketJitter(protocol::UnixTime::ID).device.outliers);
+}
+
+TEST_F(DriverJitterTest, it_does_not_analyze_the_intervals_when_disabled)
+{
+    driver.setJitterAnalysisEnabled(false);
+    pollTrains(11);
+    ASSERT_EQ(0u, driver.getPacketJitter(protocol::RawSensors::ID).host.count);
+}
+
+TEST_F(DriverJitterTest, resetJitter_clears_the_analysis)
+{
+    pollTrains(11);
+    driver.resetJitter();
+    ASSERT_EQ(0u, driver.getPacketJitter(protocol::RawSensors::ID).device.count);
+    ASSERT_TRUE(driver.getPacketJitter(protocol::RawSensors::ID).expected_interval.isNull());
+}
@@ -0,0 +1,245 @@
+#include "test_Helpers.hpp"
+#include <imu_advanced_navigation_anpp/AllocationCounter.hpp>
+#include <imu_advanced_navigation_anpp/LatencyHistogram.hpp>
+#include <imu_advanced_navigation_anpp/StreamGenerator.hpp>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+
+struct LatencyHistogramTest : ::testing::Test
+{
+    LatencyHistogram histogram;
+};
+
+TEST_F(LatencyHistogramTest, it_has_one_bucket_per_value_below_the_sub_bucket_count)
+{
+    for (int i = 0; i < LatencyHistogram::SUB_BUCKET_COUNT; ++i)
+    {
+        ASSERT_EQ(i, LatencyHistogram::getBucketIndex(i));
+        ASSERT_EQ(i, LatencyHistogram::getBucketLowerBound(i));
+        ASSERT_EQ(i, LatencyHistogram::getBucketUpperBound(i));
+    }
+}
+
+TEST_F(LatencyHistogramTest, its_buckets_are_contiguous_and_cover_all_values)
+{
+    ASSERT_EQ(0, LatencyHistogram::getBucketLowerBound(0));
+    for (int i = 1; i < LatencyHistogram::BUCKET_COUNT; ++i)
+    {
+        ASSERT_EQ(LatencyHistogram::getBucketUpperBound(i - 1) + 1,
+                  LatencyHistogram::getBucketLowerBound(i));
+    }
+    ASSERT_EQ(LatencyHistogram::MAX_VALUE,
+              LatencyHistogram::getBucketUpperBound(LatencyHistogram::BUCKET_COUNT - 1));
+    ASSERT_EQ(LatencyHistogram::BUCKET_COUNT - 1,
+              LatencyHistogram::getBucketIndex(LatencyHistogram::MAX_VALUE));
+}
+
+TEST_F(LatencyHistogramTest, it_bounds_the_relative_error_of_the_buckets)
+{
+    for (int64_t value = 1; value < LatencyHistogram::MAX_VALUE; value = value * 3 + 1)
+    {
+        int index = LatencyHistogram::getBucketIndex(value);
+        int64_t lower = LatencyHistogram::getBucketLowerBound(index);
+        int64_t upper = LatencyHistogram::getBucketUpperBound(index);
+        ASSERT_LE(lower, value);
+        ASSERT_GE(upper, value);
+        ASSERT_LE(upper - lower, value / LatencyHistogram::SUB_BUCKET_COUNT);
+    }
+}
+
+TEST_F(LatencyHistogramTest, it_clamps_out_of_range_values)
+{
+    histogram.record(-10);
+    histogram.record(LatencyHistogram::MAX_VALUE * 2);
+    ASSERT_EQ(0, histogram.getMin());
+    ASSERT_EQ(LatencyHistogram::MAX_VALUE, histogram.getMax());
+    ASSERT_EQ(1u, histogram.getBucketCount(0));
+    ASSERT_EQ(1u, histogram.getBucketCount(LatencyHistogram::BUCKET_COUNT - 1));
+}
+
+TEST_F(LatencyHistogramTest, it_returns_zero_for_the_percentiles_of_an_empty_histogram)
+{
+    ASSERT_EQ(0u, histogram.getCount());
+    ASSERT_EQ(0, histogram.getPercentile(0.5));
+    ASSERT_EQ(0, histogram.getMean());
+}
+
+TEST_F(LatencyHistogramTest, it_computes_percentiles_within_the_bucket_resolution)
+{
+    for (int64_t value = 1000; value <= 100000; value += 1000)
+        histogram.record(value);
+
+    ASSERT_EQ(100u, histogram.getCount());
+    ASSERT_EQ(1000, histogram.getMin());
+    ASSERT_EQ(100000, histogram.getMax());
+    ASSERT_DOUBLE_EQ(50500, histogram.getMean());
+
+    int64_t median = histogram.getPercentile(0.5);
+    ASSERT_GE(median, 50000);
+    ASSERT_LE(median, 50000 + 50000 / LatencyHistogram::SUB_BUCKET_COUNT);
+    int64_t p99 = histogram.getPercentile(0.99);
+    ASSERT_GE(p99, 99000);
+    ASSERT_LE(p99, 100000);
+    ASSERT_EQ(100000, histogram.getPercentile(1));
+}
+
+TEST_F(LatencyHistogramTest, it_merges_another_histogram)
+{
+    histogram.record(100);
+    LatencyHistogram other;
+    other.record(10);
+    other.record(1000);
+    histogram.merge(other);
+    histogram.merge(LatencyHistogram());
+
+    ASSERT_EQ(3u, histogram.getCount());
+    ASSERT_EQ(10, histogram.getMin());
+    ASSERT_EQ(1000, histogram.getMax());
+    ASSERT_DOUBLE_EQ(370, histogram.getMean());
+    ASSERT_EQ(1u, histogram.getBucketCount(LatencyHistogram::getBucketIndex(100)));
+}
+
+TEST(LatencyHistogramsTest, it_keeps_per_ID_histograms_only_for_the_allocated_packet_IDs)
+{
+    LatencyHistograms histograms;
+    histograms.allocate(20);
+    histograms.allocate(28);
+    histograms.record(LATENCY_FRAMED_TO_DECODED, 28, 100);
+    histograms.record(LATENCY_FRAMED_TO_DECODED, 20, 200);
+    histograms.record(LATENCY_FRAMED_TO_DECODED, 20, 300);
+    histograms.record(LATENCY_FRAMED_TO_DECODED, 21, 400);
+
+    ASSERT_EQ(nullptr, histograms.get(LATENCY_READ_TO_FRAMED, 28));
+    ASSERT_EQ(nullptr, histograms.get(LATENCY_FRAMED_TO_DECODED, 21));
+    ASSERT_EQ(1u, histograms.get(LATENCY_FRAMED_TO_DECODED, 28)->getCount());
+    ASSERT_EQ(2u, histograms.get(LATENCY_FRAMED_TO_DECODED, 20)->getCount());
+    ASSERT_EQ(vector<uint8_t>({ 20, 28 }), histograms.getPacketIDs(LATENCY_FRAMED_TO_DECODED));
+    ASSERT_EQ(4u, histograms.getMerged(LATENCY_FRAMED_TO_DECODED).getCount());
+
+    histograms.reset();
+    ASSERT_TRUE(histograms.getPacketIDs(LATENCY_FRAMED_TO_DECODED).empty());
+    ASSERT_EQ(0u, histograms.getMerged(LATENCY_FRAMED_TO_DECODED).getCount());
+}
+
+TEST(LatencyHistogramsTest, it_does_not_allocate_when_recording)
+{
+    LatencyHistograms histograms;
+    histograms.allocate(20);
+
+    size_t allocations_before = getAllocationCount();
+    histograms.record(LATENCY_FRAMED_TO_DECODED, 20, 100);
+    histograms.record(LATENCY_FRAMED_TO_DECODED, 21, 100);
+    histograms.reset();
+    histograms.record(LATENCY_READ_TO_FRAMED, 20, 100);
+    ASSERT_EQ(0u, getAllocationCount() - allocations_before);
+    ASSERT_EQ(1u, histograms.get(LATENCY_READ_TO_FRAMED, 20)->getCount());
+}
+
+struct DriverLatencyTest : DriverTestBase
+{
+    map<uint8_t, uint32_t> periods {
+        { protocol::UnixTime::ID, 1 },
+        { protocol::Status::ID, 2 },
+        { protocol::RawSensors::ID, 1 },
+        { protocol::QuaternionOrientation::ID, 1 }
+    };
+
+    DriverLatencyTest()
+    {
+        openTestURI();
+        driver.setReplayConfiguration(periods, true);
+    }
+
+    /** Push the given number of trains and poll all their packets */
+    void pollTrains(int count)
+    {
+        StreamGenerator generator;
+        generator.setPacketPeriods(periods);
+        vector<uint8_t> stream;
+        for (int i = 0; i < count; ++i)
+            generator.generateTrain(stream);
+        pushDataToDriver(stream);
+
+        uint64_t packets = generator.getStatistics().valid_packets;
+        for (uint64_t i = 0; i < packets; ++i)
+            driver.poll();
+    }
+};
+
+TEST_F(DriverLatencyTest, it_does_not_record_latencies_by_default)
+{
+    pollTrains(10);
+    auto const& histograms = driver.getLatencyHistograms();
+    for (int stage = 0; stage < LATENCY_STAGE_COUNT; ++stage)
+        ASSERT_TRUE(histograms.getPacketIDs(static_cast<LATENCY_STAGES>(stage)).empty());
+    ASSERT_EQ(0u, histograms.getTrains().getCount());
+}
+
+TEST_F(DriverLatencyTest, it_records_the_stages_of_the_polled_packets_by_ID)
+{
+    driver.setLatencyHistogramsEnabled(true);
+    pollTrains(10);
+
+    auto const& histograms = driver.getLatencyHistograms();
+    ASSERT_EQ(10u, histograms.get(LATENCY_READ_TO_FRAMED, protocol::RawSensors::ID)->getCount());
+    ASSERT_EQ(5u, histograms.get(LATENCY_READ_TO_FRAMED, protocol::Status::ID)->getCount());
+    ASSERT_EQ(35u, histograms.getMerged(LATENCY_FRAMED_TO_DECODED).getCount());
+    ASSERT_EQ(10u, histograms.get(LATENCY_FRAMED_TO_DECODED, protocol::UnixTime::ID)->getCount());
+
+    // Only the periods that poll() reports are published, and the UnixTime
+    // packet does not have samples of its own
+    ASSERT_EQ(vector<uint8_t>({ protocol::Status::ID, protocol::RawSensors::ID,
+                                protocol::QuaternionOrientation::ID }),
+              histograms.getPacketIDs(LATENCY_DECODED_TO_PUBLISHED));
+    ASSERT_EQ(10u, histograms.get(LATENCY_DECODED_TO_PUBLISHED, protocol::RawSensors::ID)->getCount());
+    ASSERT_EQ(5u, histograms.get(LATENCY_DECODED_TO_PUBLISHED, protocol::Status::ID)->getCount());
+
+    // The last train is only known to be complete when the next one starts
+    ASSERT_EQ(9u, histograms.getTrains().getCount());
+
+    driver.resetLatencyHistograms();
+    ASSERT_TRUE(histograms.getPacketIDs(LATENCY_READ_TO_FRAMED).empty());
+}
+
+TEST_F(DriverLatencyTest, it_does_not_allocate_while_polling)
+{
+    // Warm the driver's buffers up before enabling the histograms, so that
+    // the histograms are allocated by setLatencyHistogramsEnabled
+    pollTrains(10);
+    driver.setLatencyHistogramsEnabled(true);
+
+    StreamGenerator generator;
+    generator.setPacketPeriods(periods);
+    vector<uint8_t> stream;
+    for (int i = 0; i < 10; ++i)
+        generator.generateTrain(stream);
+    pushDataToDriver(stream);
+
+    uint64_t packets = generator.getStatistics().valid_packets;
+    size_t allocations_before = getAllocationCount();
+    for (uint64_t i = 0; i < packets; ++i)
+        driver.poll();
+    ASSERT_EQ(0u, getAllocationCount() - allocations_before);
+    ASSERT_EQ(10u, driver.getLatencyHistograms()
+        .get(LATENCY_FRAMED_TO_DECODED, protocol::RawSensors::ID)->getCount());
+}
+
+TEST_F(DriverLatencyTest, it_allocates_the_histograms_of_the_packets_enabled_afterwards)
+{
+    driver.setLatencyHistogramsEnabled(true);
+    periods[protocol::EulerOrientationStandardDeviation::ID] = 1;
+    driver.setReplayConfiguration(periods, true);
+    pollTrains(1);
+
+    ASSERT_EQ(1u, driver.getLatencyHistograms()
+        .get(LATENCY_FRAMED_TO_DECODED, protocol::EulerOrientationStandardDeviation::ID)->getCount());
+}
+
+TEST_F(DriverLatencyTest, it_does_not_time_packets_given_directly_to_processPacket)
+{
+    driver.setLatencyHistogramsEnabled(true);
+    auto packet = makePacket<protocol::RawSensors>();
+    driver.processPacket(packet.data(), packet.size());
+    ASSERT_TRUE(driver.getLatencyHistograms().getPacketIDs(LATENCY_FRAMED_TO_DECODED).empty());
+}
@@ -0,0 +1,104 @@
+#include "test_Helpers.hpp"
+#include <imu_advanced_navigation_anpp/LinkMonitor.hpp>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+using testing::ElementsAre;
+
+struct LinkMonitorTest : ::testing::Test, iodrivers_base::Fixture<LinkMonitor>
+{
+    LinkMonitorTest()
+    {
+        driver.openURI("test://");
+    }
+};
+
+TEST_F(LinkMonitorTest, openURI_does_not_write_anything)
+{
+    ASSERT_TRUE(readDataFromDriver().empty());
+}
+
+TEST_F(LinkMonitorTest, requestStatus_sends_a_Status_request)
+{
+    driver.requestStatus();
+    ASSERT_EQ(makeQuery<protocol::Status>(), readDataFromDriver());
+}
+
+TEST_F(LinkMonitorTest, poll_counts_packets_and_bytes_per_ID)
+{
+    pushDataToDriver(makePacket<protocol::RawSensors>());
+    pushDataToDriver(makePacket<protocol::UnixTime>());
+    pushDataToDriver(makePacket<protocol::RawSensors>());
+    ASSERT_EQ(protocol::RawSensors::ID, driver.poll());
+    ASSERT_EQ(protocol::UnixTime::ID, driver.poll());
+    ASSERT_EQ(protocol::RawSensors::ID, driver.poll());
+
+    auto const& stats = driver.getStatistics();
+    ASSERT_EQ(2u, stats.packets[protocol::RawSensors::ID].count);
+    ASSERT_EQ(2u * (5 + protocol::RawSensors::SIZE), stats.packets[protocol::RawSensors::ID].bytes);
+    ASSERT_EQ(1u, stats.packets[protocol::UnixTime::ID].count);
+    ASSERT_EQ(2u * (5 + protocol::RawSensors::SIZE) + 5 + protocol::UnixTime::SIZE, stats.good_bytes);
+}
+
+TEST_F(LinkMonitorTest, poll_separates_CRC_failures_from_resynchronization)
+{
+    vector<uint8_t> corrupted = makePacket<protocol::UnixTime>();
+    corrupted.back() ^= 0xFF;
+    pushDataToDriver(vector<uint8_t>{ 0x55, 0x55, 0x55 });
+    pushDataToDriver(corrupted);
+    pushDataToDriver(makePacket<protocol::Status>());
+    ASSERT_EQ(protocol::Status::ID, driver.poll());
+
+    auto const& stats = driver.getStatistics();
+    ASSERT_EQ(1u, stats.crc_failures);
+    ASSERT_EQ(3u + corrupted.size(), stats.resync_bytes);
+}
+
+TEST_F(LinkMonitorTest, poll_counts_a_CRC_failure_following_a_valid_packet_after_a_false_header)
+{
+    // A header that validates but claims a payload covering the packets
+    // that follow it
+    vector<uint8_t> false_header = makePacket<protocol::RawSensors>(vector<uint8_t>(200, 0));
+    false_header.resize(protocol::Header::SIZE);
+    vector<uint8_t> corrupted = makePacket<protocol::UnixTime>();
+    corrupted.back() ^= 0xFF;
+
+    pushDataToDriver(false_header);
+    pushDataToDriver(makePacket<protocol::Status>());
+    pushDataToDriver(corrupted);
+    pushDataToDriver(makePacket<protocol::Status>());
+    pushDataToDriver(vector<uint8_t>(200, 0x55));
+    ASSERT_EQ(protocol::Status::ID, driver.poll());
+    ASSERT_EQ(protocol::Status::ID, driver.poll());
+    ASSERT_EQ(2u, driver.getStatistics().crc_failures);
+}
+
+TEST_F(LinkMonitorTest, process_records_inter_arrival_times)
+{
+    auto packet = makePacket<protocol::RawSensors>();
+    for (int64_t t : { 1000, 2000, 3500 })
+        driver.process(packet.data(), packet.size(), base::Time::fromMicroseconds(t));
+
+    ASSERT_THAT(driver.getStatistics().packets[protocol::RawSensors::ID].intervals,
+                ElementsAre(1000, 1500));
+}
+
+TEST_F(LinkMonitorTest, process_reports_the_system_status)
+{
+    auto packet = makePacket<protocol::Status>({ 0, 0x80, 0, 0 });
+    driver.process(packet.data(), packet.size(), base::Time::now());
+    auto const& stats = driver.getStatistics();
+    ASSERT_TRUE(stats.has_status);
+    ASSERT_EQ(SYSTEM_DATA_OUTPUT_OVERFLOW_ALARM, stats.system_status);
+}
+
+TEST_F(LinkMonitorTest, resetStatistics_keeps_the_last_reception_time)
+{
+    auto packet = makePacket<protocol::RawSensors>();
+    driver.process(packet.data(), packet.size(), base::Time::fromMicroseconds(1000));
+    driver.resetStatistics();
+    ASSERT_EQ(0u, driver.getStatistics().packets[protocol::RawSensors::ID].count);
+    driver.process(packet.data(), packet.size(), base::Time::fromMicroseconds(3000));
+    ASSERT_THAT(driver.getStatistics().packets[protocol::RawSensors::ID].intervals,
+                ElementsAre(2000));
+}
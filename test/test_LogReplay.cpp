@@ -0,0 +1,156 @@
+#include "test_Helpers.hpp"
+#include <imu_advanced_navigation_anpp/LogReplay.hpp>
+#include <imu_advanced_navigation_anpp/Driver.hpp>
+#include <cmath>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+
+struct LogReplayTest : DriverTestBase
+{
+    TempFile file;
+    string const& path = file.path;
+    vector<uint8_t> log;
+
+    LogReplayTest()
+    {
+        openTestURI();
+    }
+
+    void append(vector<uint8_t> const& packet)
+    {
+        log.insert(log.end(), packet.begin(), packet.end());
+    }
+
+    /** A log with UnixTime and RawSensors at every cycle and
+     * GeodeticPosition every other cycle */
+    void makeLog(int cycles, bool with_time = true)
+    {
+        for (int i = 0; i < cycles; ++i)
+        {
+            if (with_time)
+            {
+                vector<uint8_t> time(8, 0);
+                protocol::write32(&time[0], 1000 + i);
+                append(makePacket<protocol::UnixTime>(time));
+            }
+
+            vector<uint8_t> sensors(protocol::RawSensors::SIZE, 0);
+            protocol::write32(&sensors[0], static_cast<float>(i));
+            append(makePacket<protocol::RawSensors>(sensors));
+
+            if (i % 2 == 0)
+            {
+                vector<uint8_t> position(protocol::GeodeticPosition::SIZE, 0);
+                protocol::write64(&position[0], 0.8 + 1e-6 * i);
+                protocol::write64(&position[8], 0.15);
+                append(makePacket<protocol::GeodeticPosition>(position));
+            }
+        }
+
+        file.write(log);
+    }
+
+    struct Output
+    {
+        int result;
+        base::Time imu_time;
+        double acc_x;
+        Eigen::Vector3d position;
+
+        static bool same(double a, double b)
+        {
+            return a == b || (std::isnan(a) && std::isnan(b));
+        }
+
+        bool operator == (Output const& other) const
+        {
+            return result == other.result && imu_time == other.imu_time &&
+                same(acc_x, other.acc_x) &&
+                same(position.x(), other.position.x()) &&
+                same(position.y(), other.position.y()) &&
+                same(position.z(), other.position.z());
+        }
+    };
+
+    Output getOutput(Driver& driver, int result)
+    {
+        return Output { result, driver.getIMUSensors().time,
+                        driver.getIMUSensors().acc.x(),
+                        driver.getWorldRigidBodyState().position };
+    }
+};
+
+TEST_F(LogReplayTest, inferPacketPeriods_computes_the_periods_relative_to_the_most_frequent_packet)
+{
+    makeLog(100);
+    auto periods = LogReplay::inferPacketPeriods(path);
+    map<uint8_t, uint32_t> expected = {
+        { protocol::RawSensors::ID, 1 },
+        { protocol::GeodeticPosition::ID, 2 }
+    };
+    ASSERT_EQ(expected, periods);
+}
+
+TEST_F(LogReplayTest, hasDeviceTime_returns_true_if_the_log_contains_UnixTime)
+{
+    makeLog(10);
+    ASSERT_TRUE(LogReplay::hasDeviceTime(path));
+}
+
+TEST_F(LogReplayTest, hasDeviceTime_returns_false_if_the_log_has_no_UnixTime)
+{
+    makeLog(10, false);
+    ASSERT_FALSE(LogReplay::hasDeviceTime(path));
+}
+
+TEST_F(LogReplayTest, a_log_without_UnixTime_is_processed_with_the_host_time)
+{
+    makeLog(10, false);
+    Driver replay_driver;
+    replay_driver.setReplayConfiguration(LogReplay::inferPacketPeriods(path),
+                                         LogReplay::hasDeviceTime(path));
+    LogReplay replay(replay_driver, path);
+    int completed = 0;
+    int result;
+    while (replay.next(result))
+        completed += (result > 0);
+    ASSERT_LT(0, completed);
+    ASSERT_FALSE(replay_driver.getIMUSensors().time.isNull());
+}
+
+TEST_F(LogReplayTest, it_gives_the_same_results_than_poll)
+{
+    makeLog(20);
+
+    { IODRIVERS_BASE_MOCK();
+        EXPECT_PACKET_PERIOD(protocol::UnixTime::ID, 1);
+        EXPECT_PACKET_PERIOD(protocol::RawSensors::ID, 1);
+        EXPECT_PACKET_PERIOD(protocol::GeodeticPosition::ID, 2);
+        EXPECT_PACKET_PERIOD(protocol::GeodeticPositionStandardDeviation::ID, 0);
+        driver.setUseDeviceTime(true);
+        driver.setRawSensorsPeriod(1);
+        driver.setPositionPeriod(2, false);
+    }
+    pushDataToDriver(log);
+    vector<Output> expected;
+    for (size_t i = 0; i < 20 + 20 + 10; ++i)
+    {
+        int result = driver.poll();
+        expected.push_back(getOutput(driver, result));
+    }
+
+    Driver replay_driver;
+    replay_driver.setReplayConfiguration(LogReplay::inferPacketPeriods(path), true);
+    LogReplay replay(replay_driver, path);
+    vector<Output> actual;
+    int result;
+    while (replay.next(result))
+        actual.push_back(getOutput(replay_driver, result));
+
+    ASSERT_EQ(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); ++i)
+        ASSERT_TRUE(expected[i] == actual[i]) << "packet " << i;
+    ASSERT_EQ(50, replay.getPacketCount());
+    ASSERT_EQ(0, replay.getDiscardedBytes());
+}
@@ -0,0 +1,176 @@
+#include "test_Helpers.hpp"
+#include <imu_advanced_navigation_anpp/MetricsExporter.hpp>
+#include <imu_advanced_navigation_anpp/StreamGenerator.hpp>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+
+TEST(MetricsExporterTest, it_formats_the_metrics_in_the_prometheus_text_format)
+{
+    Metrics metrics;
+    memset(&metrics, 0, sizeof(metrics));
+    metrics.time = 1500000;
+    metrics.received_bytes = 1024;
+    metrics.packets[28] = 10;
+    metrics.crc_failures = 2;
+    metrics.kernel_queued_bytes = -1;
+    metrics.system_status = 0x4;
+
+    string text = MetricsExporter::formatPrometheus(metrics);
+    ASSERT_NE(string::npos, text.find(
+        "# HELP anpp_received_bytes_total Bytes received from the device\n"
+        "# TYPE anpp_received_bytes_total counter\n"
+        "anpp_received_bytes_total 1024\n"));
+    ASSERT_NE(string::npos, text.find("\nanpp_packets_total{id=\"28\"} 10\n"));
+    ASSERT_EQ(string::npos, text.find("anpp_packets_total{id=\"20\"}"));
+    ASSERT_NE(string::npos, text.find("\nanpp_crc_failures_total 2\n"));
+    ASSERT_NE(string::npos, text.find("\nanpp_system_status 4\n"));
+    ASSERT_NE(string::npos, text.find("\nanpp_snapshot_timestamp_seconds 1.500000\n"));
+    ASSERT_EQ(string::npos, text.find("anpp_kernel_queued_bytes"));
+    ASSERT_EQ(string::npos, text.find("anpp_latency_seconds"));
+}
+
+TEST(MetricsExporterTest, it_exports_the_latency_quantiles_if_present)
+{
+    Metrics metrics;
+    memset(&metrics, 0, sizeof(metrics));
+    metrics.has_latencies = 1;
+    metrics.latency_p99[LATENCY_FRAMED_TO_DECODED] = 25000;
+
+    string text = MetricsExporter::formatPrometheus(metrics);
+    ASSERT_NE(string::npos, text.find("# TYPE anpp_latency_seconds summary\n"));
+    ASSERT_NE(string::npos, text.find(
+        "\nanpp_latency_seconds{stage=\"framed_to_decoded\",quantile=\"0.99\"} 2.5e-05\n"));
+}
+
+struct DriverMetricsTest : DriverTestBase
+{
+    map<uint8_t, uint32_t> periods {
+        { protocol::UnixTime::ID, 1 },
+        { protocol::Status::ID, 1 },
+        { protocol::RawSensors::ID, 1 }
+    };
+    string shm_name = "/anpp_test_metrics_" + to_string(getpid());
+
+    DriverMetricsTest()
+    {
+        openTestURI();
+        driver.setReplayConfiguration(periods, true);
+    }
+
+    void pollTrains(int count)
+    {
+        StreamGenerator generator;
+        generator.setPacketPeriods(periods);
+        vector<uint8_t> stream;
+        for (int i = 0; i < count; ++i)
+            generator.generateTrain(stream);
+        pushDataToDriver(stream);
+        try
+        {
+            while (true)
+                driver.poll();
+        }
+        catch (iodrivers_base::TimeoutError const&) {}
+    }
+};
+
+TEST_F(DriverMetricsTest, it_collects_the_driver_counters)
+{
+    driver.setLatencyHistogramsEnabled(true);
+    pollTrains(5);
+
+    Metrics metrics = MetricsExporter::collect(driver);
+    auto const& stats = driver.getStatistics();
+    ASSERT_EQ(stats.received_bytes, metrics.received_bytes);
+    ASSERT_EQ(5u, metrics.packets[protocol::RawSensors::ID]);
+    ASSERT_EQ(stats.trains, metrics.trains);
+    ASSERT_EQ(driver.getIMUStatus().system_status, metrics.system_status);
+    ASSERT_EQ(driver.getIMUStatus().filter_status, metrics.filter_status);
+    ASSERT_EQ(1, metrics.has_latencies);
+    ASSERT_LE(metrics.latency_p50[LATENCY_FRAMED_TO_DECODED],
+              metrics.latency_max[LATENCY_FRAMED_TO_DECODED]);
+    ASSERT_EQ(0, metrics.received_bytes_per_second);
+}
+
+TEST_F(DriverMetricsTest, update_publishes_at_the_configured_interval)
+{
+    MetricsExporter exporter(base::Time::fromSeconds(3600));
+    ASSERT_TRUE(exporter.update(driver));
+    uint64_t received_bytes = driver.getStatistics().received_bytes;
+    pollTrains(2);
+    ASSERT_FALSE(exporter.update(driver));
+    ASSERT_EQ(received_bytes, exporter.getMetrics().received_bytes);
+
+    exporter.publish(driver);
+    ASSERT_EQ(driver.getStatistics().received_bytes, exporter.getMetrics().received_bytes);
+}
+
+TEST_F(DriverMetricsTest, it_computes_the_rates_from_the_previous_snapshot)
+{
+    MetricsExporter exporter;
+    exporter.publish(driver);
+    pollTrains(4);
+    // The rates need a non-zero interval between the snapshots
+    int64_t first = exporter.getMetrics().time;
+    while (base::Time::now().toMicroseconds() == first);
+    exporter.publish(driver);
+
+    Metrics metrics = exporter.getMetrics();
+    ASSERT_GT(metrics.received_bytes_per_second, 0);
+    ASSERT_GT(metrics.packets_per_second, 0);
+    ASSERT_EQ(0, metrics.errors_per_second);
+}
+
+TEST_F(DriverMetricsTest, it_publishes_the_metrics_in_shared_memory)
+{
+    {
+        MetricsExporter exporter;
+        exporter.openSharedMemory(shm_name);
+        pollTrains(3);
+        exporter.publish(driver);
+
+        Metrics metrics = MetricsExporter::readSharedMemory(shm_name);
+        ASSERT_EQ(driver.getStatistics().received_bytes, metrics.received_bytes);
+        ASSERT_EQ(3u, metrics.packets[protocol::RawSensors::ID]);
+    }
+    ASSERT_THROW(MetricsExporter::readSharedMemory(shm_name), iodrivers_base::UnixError);
+}
+
+TEST_F(DriverMetricsTest, it_replaces_the_text_file_at_each_update)
+{
+    TempFile file;
+    string const& path = file.path;
+    auto readFile = [&path] {
+        ifstream file(path);
+        return string(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+    };
+    auto packetCount = [](int count) {
+        return "\nanpp_packets_total{id=\"" + to_string(protocol::RawSensors::ID) +
+            "\"} " + to_string(count) + "\n";
+    };
+
+    {
+        MetricsExporter exporter;
+        exporter.openTextFile(path);
+        pollTrains(3);
+        exporter.publish(driver);
+        exporter.flushTextFile();
+        ASSERT_NE(string::npos, readFile().find(packetCount(3)));
+
+        pollTrains(2);
+        exporter.publish(driver);
+        exporter.flushTextFile();
+        ASSERT_NE(string::npos, readFile().find(packetCount(5)));
+
+        pollTrains(1);
+        exporter.publish(driver);
+    }
+    // The exporter writes the last snapshot before it quits
+    ASSERT_NE(string::npos, readFile().find(packetCount(6)));
+    ASSERT_NE(0, access((path + ".tmp").c_str(), F_OK));
+}
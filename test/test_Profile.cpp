@@ -0,0 +1,157 @@
+#include "test_Helpers.hpp"
+#include <imu_advanced_navigation_anpp/Profile.hpp>
+#include <sstream>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+using testing::ElementsAre;
+
+static Profile parse(string const& text)
+{
+    istringstream in(text);
+    return Profile::parse(in);
+}
+
+TEST(ProfileTest, parse_reads_all_known_keys)
+{
+    Profile profile = parse(
+        "# a comment\n"
+        "permanent = true\n"
+        "\n"
+        "packet_timer_period = 2000 # in microseconds\n"
+        "utc_synchronization = false\n"
+        "vehicle_type = CAR\n"
+        "internal_gnss = yes\n"
+        "motion_analysis = 1\n"
+        "gnss_antenna_offset = 0.1 -0.2 1.5\n"
+        "period.20 = 1\n"
+        "period.28 = 10\n"
+        "baudrate = 921600\n");
+
+    ASSERT_TRUE(profile.permanent);
+    ASSERT_TRUE(profile.has_packet_timer_period);
+    ASSERT_EQ(2000, profile.configuration.packet_timer_period.toMicroseconds());
+    ASSERT_FALSE(profile.configuration.utc_synchronization);
+    ASSERT_TRUE(profile.has_filter_options);
+    ASSERT_EQ(VEHICLE_CAR, profile.configuration.vehicle_type);
+    ASSERT_TRUE(profile.configuration.enabled_internal_gnss);
+    ASSERT_TRUE(profile.configuration.enabled_motion_analysis);
+    ASSERT_FALSE(profile.configuration.enabled_velocity_heading);
+    ASSERT_TRUE(profile.has_alignment);
+    ASSERT_EQ(base::Vector3d(0.1, -0.2, 1.5), profile.configuration.gnss_antenna_offset);
+    ASSERT_TRUE(profile.has_packet_periods);
+    ASSERT_THAT(profile.packet_periods, ElementsAre(make_pair(20, 1), make_pair(28, 10)));
+    ASSERT_EQ(921600u, profile.baudrate);
+}
+
+TEST(ProfileTest, parse_only_marks_the_groups_that_are_given)
+{
+    Profile profile = parse("vehicle_type = 9\n");
+    ASSERT_TRUE(profile.has_filter_options);
+    ASSERT_EQ(VEHICLE_BOAT, profile.configuration.vehicle_type);
+    ASSERT_FALSE(profile.has_packet_timer_period);
+    ASSERT_FALSE(profile.has_alignment);
+    ASSERT_FALSE(profile.has_packet_periods);
+    ASSERT_EQ(0u, profile.baudrate);
+}
+
+TEST(ProfileTest, parse_reports_the_line_of_an_invalid_entry)
+{
+    try
+    {
+        parse("permanent = true\n\nvehicle_type = SPACESHIP\n");
+        FAIL() << "expected invalid_argument";
+    }
+    catch(invalid_argument const& e)
+    {
+        ASSERT_EQ(0u, string(e.what()).find("line 3: "));
+    }
+}
+
+TEST(ProfileTest, parse_rejects_unknown_keys)
+{
+    ASSERT_THROW(parse("foo = bar\n"), invalid_argument);
+    ASSERT_THROW(parse("period.300 = 1\n"), invalid_argument);
+    ASSERT_THROW(parse("gnss_antenna_offset = 1 2\n"), invalid_argument);
+}
+
+TEST(ProfileTest, compare_only_checks_the_groups_present_in_the_reference)
+{
+    Profile expected = parse("period.20 = 1\n");
+    Profile actual;
+    actual.has_filter_options = true;
+    actual.configuration.vehicle_type = VEHICLE_CAR;
+    actual.packet_periods[20] = 1;
+    ASSERT_TRUE(expected.compare(actual).empty());
+
+    actual.packet_periods[28] = 1;
+    ASSERT_THAT(expected.compare(actual), ElementsAre("period.28: expected 0, got 1"));
+}
+
+struct ProfileDriverTest : DriverTestBase
+{
+    ProfileDriverTest()
+    {
+        openTestURI();
+    }
+};
+
+TEST_F(ProfileDriverTest, applyProfile_sends_all_packets_before_waiting_for_the_acks)
+{ IODRIVERS_BASE_MOCK();
+    Profile profile = parse(
+        "permanent = true\n"
+        "packet_timer_period = 1000\n"
+        "period.28 = 2\n");
+
+    vector<uint8_t> timer = makePacket<protocol::PacketTimerPeriod>({ 1, 1, 0xE8, 0x03 });
+    vector<uint8_t> periods = makePacket<protocol::PacketPeriods>(
+        { 1, 1, protocol::UnixTime::ID, 0, 0, 0, 0, protocol::RawSensors::ID, 2, 0, 0, 0 });
+    EXPECT_REPLY(timer, vector<uint8_t>());
+    // Acks may come out of order
+    EXPECT_REPLY(periods, makeAcknowledge(periods, ACK_SUCCESS));
+    pushDataToDriver(makeAcknowledge(timer, ACK_SUCCESS));
+    ASSERT_EQ(1, driver.applyProfile(profile));
+
+    pushDataToDriver(makePacket<protocol::RawSensors>());
+    driver.setCurrentTimestamp(base::Time::now());
+    ASSERT_EQ(2, driver.poll());
+}
+
+TEST_F(ProfileDriverTest, applyProfile_reports_a_rejected_packet)
+{ IODRIVERS_BASE_MOCK();
+    Profile profile = parse("vehicle_type = CAR\n");
+    vector<uint8_t> filter = makePacket<protocol::FilterOptions>(
+        { 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 });
+    EXPECT_REPLY(filter, makeAcknowledge(filter, ACK_FAILED_OUT_OF_RANGE));
+    ASSERT_THROW(driver.applyProfile(profile), AcknowledgeFailure);
+}
+
+TEST_F(ProfileDriverTest, readProfile_reads_all_settings_with_a_single_request)
+{ IODRIVERS_BASE_MOCK();
+    vector<uint8_t> ids {
+        protocol::PacketTimerPeriod::ID, protocol::PacketPeriods::ID,
+        protocol::BaudRates::ID, protocol::Alignment::ID, protocol::FilterOptions::ID };
+    vector<uint8_t> request = makePacket<protocol::Request>(ids);
+
+    vector<uint8_t> alignment_payload(protocol::Alignment::SIZE, 0);
+    RAW_SET(&alignment_payload[37], TEST_FP4_ONE.binary);
+    vector<uint8_t> reply;
+    for (auto const& packet : {
+            makePacket<protocol::PacketTimerPeriod>({ 0, 1, 0xE8, 0x03 }),
+            makePacket<protocol::RawSensors>(),
+            makePacket<protocol::PacketPeriods>({ 0, 0, protocol::RawSensors::ID, 2, 0, 0, 0 }),
+            makePacket<protocol::BaudRates>({ 0, 0x00, 0xC2, 0x01, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }),
+            makePacket<protocol::Alignment>(alignment_payload),
+            makePacket<protocol::FilterOptions>({ 0, 2, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }) })
+        reply.insert(reply.end(), packet.begin(), packet.end());
+    EXPECT_REPLY(request, reply);
+
+    Profile profile = driver.readProfile();
+    ASSERT_EQ(1000, profile.configuration.packet_timer_period.toMicroseconds());
+    ASSERT_TRUE(profile.configuration.utc_synchronization);
+    ASSERT_THAT(profile.packet_periods, ElementsAre(make_pair(protocol::RawSensors::ID, 2)));
+    ASSERT_EQ(115200u, profile.baudrate);
+    ASSERT_EQ(base::Vector3d(1, 0, 0), profile.configuration.gnss_antenna_offset);
+    ASSERT_EQ(VEHICLE_CAR, profile.configuration.vehicle_type);
+    ASSERT_TRUE(profile.configuration.enabled_internal_gnss);
+}
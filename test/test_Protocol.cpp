@@ -11,6 +11,23 @@ using namespace testing;
 
 static_assert(sizeof(Header) == Header::SIZE, "SIZE and sizeof() do not agree");
 
+TEST(protocol, write64_encodes_all_bytes_in_little_endian_order)
+{
+    uint8_t marshalled[8];
+    write64(marshalled, static_cast<uint64_t>(0x0807060504030201ull));
+    for (int i = 0; i < 8; ++i)
+        ASSERT_EQ(i + 1, marshalled[i]);
+}
+
+TEST(protocol, read64_reads_back_what_write64_wrote)
+{
+    uint8_t marshalled[8];
+    write64(marshalled, -1234.5678);
+    ASSERT_EQ(-1234.5678, read64<double>(marshalled));
+    write64(marshalled, static_cast<uint64_t>(0x80000000000000FFull));
+    ASSERT_EQ(0x80000000000000FFull, read64<uint64_t>(marshalled));
+}
+
 TEST(protocol_Header, it_is_invalid_when_constructed)
 {
     Header header;
@@ -1325,6 +1342,67 @@ TEST(protocol_MagneticCalibrationStatus, unmarshal_throws_if_given_too_much_data
     ASSERT_THROW(MagneticCalibrationStatus::unmarshal(ptr, ptr + MagneticCalibrationStatus::SIZE + 1), std::length_error);
 }
 
+/** Check that marshal() writes back what unmarshal() read
+ *
+ * The bytes are kept below 0x40 so that no floating-point value is a NaN
+ */
+template<typename Packet>
+static void assertMarshalIsInverseOfUnmarshal()
+{
+    vector<uint8_t> marshalled(Packet::SIZE);
+    for (size_t i = 0; i < marshalled.size(); ++i)
+        marshalled[i] = (i * 7 + 1) % 64;
+
+    Packet packet = Packet::unmarshal(marshalled.begin(), marshalled.end());
+    vector<uint8_t> remarshalled(Packet::SIZE);
+    ASSERT_EQ(remarshalled.end(), packet.marshal(remarshalled.begin()));
+    ASSERT_EQ(marshalled, remarshalled);
+}
+
+TEST(protocol, the_packets_sent_by_the_device_can_be_marshalled)
+{
+    assertMarshalIsInverseOfUnmarshal<Acknowledge>();
+    assertMarshalIsInverseOfUnmarshal<DeviceInformation>();
+    assertMarshalIsInverseOfUnmarshal<SystemState>();
+    assertMarshalIsInverseOfUnmarshal<UnixTime>();
+    assertMarshalIsInverseOfUnmarshal<Status>();
+    assertMarshalIsInverseOfUnmarshal<GeodeticPositionStandardDeviation>();
+    assertMarshalIsInverseOfUnmarshal<NEDVelocityStandardDeviation>();
+    assertMarshalIsInverseOfUnmarshal<EulerOrientationStandardDeviation>();
+    assertMarshalIsInverseOfUnmarshal<RawSensors>();
+    assertMarshalIsInverseOfUnmarshal<RawGNSS>();
+    assertMarshalIsInverseOfUnmarshal<Satellites>();
+    assertMarshalIsInverseOfUnmarshal<SatelliteInfo>();
+    assertMarshalIsInverseOfUnmarshal<GeodeticPosition>();
+    assertMarshalIsInverseOfUnmarshal<NEDVelocity>();
+    assertMarshalIsInverseOfUnmarshal<BodyVelocity>();
+    assertMarshalIsInverseOfUnmarshal<Acceleration>();
+    assertMarshalIsInverseOfUnmarshal<BodyAcceleration>();
+    assertMarshalIsInverseOfUnmarshal<QuaternionOrientation>();
+    assertMarshalIsInverseOfUnmarshal<AngularVelocity>();
+    assertMarshalIsInverseOfUnmarshal<AngularAcceleration>();
+    assertMarshalIsInverseOfUnmarshal<LocalMagneticField>();
+    assertMarshalIsInverseOfUnmarshal<MagneticCalibrationStatus>();
+}
+
+TEST(protocol_NorthSeekingInitializationStatus, marshal_zeroes_the_reserved_field)
+{
+    NorthSeekingInitializationStatus status;
+    status.flags = imu_advanced_navigation_anpp::NORTH_SEEKING_INITIALIZATION_COMPLETE;
+    std::fill_n(status.progress, 4, 100);
+    status.current_rotation_angle = 0;
+    std::fill_n(status.gyroscope_bias_solution_xyz, 3, 0);
+    status.gyroscope_bias_solution_error = 0;
+
+    vector<uint8_t> out(NorthSeekingInitializationStatus::SIZE, 0xFF);
+    status.marshal(out.begin());
+    ASSERT_EQ(0, out[2]);
+    ASSERT_EQ(0, out[3]);
+    auto unmarshalled = NorthSeekingInitializationStatus::unmarshal(out.begin(), out.end());
+    ASSERT_EQ(status.flags, unmarshalled.flags);
+    ASSERT_EQ(100, unmarshalled.progress[3]);
+}
+
 struct protocol_FunctionsTest : DriverTestBase
 {
     protocol_FunctionsTest()
@@ -0,0 +1,187 @@
+#include "test_Helpers.hpp"
+#include <imu_advanced_navigation_anpp/StartupProfile.hpp>
+#include <sstream>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+
+TEST(StartupProfilerTest, it_records_nothing_when_disabled)
+{
+    StartupProfiler profiler;
+    ASSERT_EQ(StartupProfiler::NO_STEP, profiler.begin("openURI"));
+    ASSERT_FALSE(profiler.isRecording());
+    profiler.end(StartupProfiler::NO_STEP);
+    ASSERT_TRUE(profiler.getProfile().steps.empty());
+}
+
+TEST(StartupProfilerTest, it_records_nested_steps_in_start_order)
+{
+    StartupProfiler profiler;
+    profiler.setEnabled(true);
+    {
+        StartupStepScope outer(profiler, "openURI");
+        StartupStepScope inner(profiler, "setPacketPeriod", 20);
+    }
+    {
+        StartupStepScope next(profiler, "readConfiguration");
+    }
+
+    auto const& steps = profiler.getProfile().steps;
+    ASSERT_EQ(3u, steps.size());
+    ASSERT_STREQ("openURI", steps[0].name);
+    ASSERT_EQ(0, steps[0].depth);
+    ASSERT_EQ(-1, steps[0].packet_id);
+    ASSERT_STREQ("setPacketPeriod", steps[1].name);
+    ASSERT_EQ(1, steps[1].depth);
+    ASSERT_EQ(20, steps[1].packet_id);
+    ASSERT_STREQ("readConfiguration", steps[2].name);
+    ASSERT_EQ(0, steps[2].depth);
+    ASSERT_LE(steps[0].start, steps[1].start);
+    ASSERT_LE(steps[1].start + steps[1].duration, steps[0].start + steps[0].duration);
+    ASSERT_FALSE(profiler.isRecording());
+}
+
+TEST(StartupProfilerTest, it_attributes_the_round_trips_to_all_open_steps)
+{
+    StartupProfiler profiler;
+    profiler.setEnabled(true);
+    {
+        StartupStepScope outer(profiler, "openURI");
+        {
+            StartupStepScope inner(profiler, "clearPeriodicPackets");
+            profiler.addRoundTrip(base::Time::fromMilliseconds(2));
+        }
+        profiler.addRoundTrip(base::Time::fromMilliseconds(3));
+    }
+    profiler.addRoundTrip(base::Time::fromMilliseconds(10));
+
+    StartupProfile const& profile = profiler.getProfile();
+    ASSERT_EQ(2, profile.steps[0].round_trips);
+    ASSERT_EQ(base::Time::fromMilliseconds(5), profile.steps[0].ack_wait);
+    ASSERT_EQ(1, profile.steps[1].round_trips);
+    ASSERT_EQ(base::Time::fromMilliseconds(2), profile.steps[1].ack_wait);
+    ASSERT_EQ(2, profile.getRoundTrips());
+    ASSERT_EQ(base::Time::fromMilliseconds(5), profile.getAckWait());
+}
+
+TEST(StartupProfileTest, it_computes_the_duration_from_the_first_start_to_the_last_end)
+{
+    StartupProfile profile;
+    ASSERT_EQ(base::Time(), profile.getDuration());
+
+    StartupStep step;
+    step.start = base::Time::fromMilliseconds(100);
+    step.duration = base::Time::fromMilliseconds(50);
+    profile.steps.push_back(step);
+    step.start = base::Time::fromMilliseconds(200);
+    step.duration = base::Time::fromMilliseconds(20);
+    profile.steps.push_back(step);
+    ASSERT_EQ(base::Time::fromMilliseconds(120), profile.getDuration());
+}
+
+TEST(StartupProfileTest, it_writes_the_steps_as_an_indented_table)
+{
+    StartupProfile profile;
+    StartupStep step;
+    step.name = "openURI";
+    step.start = base::Time::fromMilliseconds(100);
+    step.duration = base::Time::fromMicroseconds(1500);
+    step.round_trips = 1;
+    step.ack_wait = base::Time::fromMicroseconds(1250);
+    profile.steps.push_back(step);
+    step.name = "setPacketPeriod";
+    step.packet_id = 20;
+    step.depth = 1;
+    profile.steps.push_back(step);
+
+    ostringstream out;
+    profile.write(out);
+    string text = out.str();
+    ASSERT_EQ(0u, text.find("step "));
+    ASSERT_NE(string::npos, text.find("\nopenURI "));
+    ASSERT_NE(string::npos, text.find("\n  setPacketPeriod(20) "));
+    ASSERT_NE(string::npos, text.find("1.500"));
+    ASSERT_NE(string::npos, text.find("1.250"));
+    ASSERT_NE(string::npos, text.find("\ntotal "));
+}
+
+TEST(DriverStartupProfilingTest, it_is_disabled_by_default)
+{
+    Driver driver;
+    ASSERT_FALSE(driver.isStartupProfilingEnabled());
+}
+
+struct DriverStartupProfileTest : DriverTestBase
+{
+    DriverStartupProfileTest()
+    {
+        driver.setStartupProfilingEnabled(true);
+    }
+};
+
+TEST_F(DriverStartupProfileTest, it_profiles_openURI)
+{
+    openTestURI();
+
+    auto const& steps = driver.getStartupProfile().steps;
+    ASSERT_EQ(3u, steps.size());
+    ASSERT_STREQ("openURI", steps[0].name);
+    ASSERT_STREQ("clearPeriodicPackets", steps[1].name);
+    ASSERT_EQ(1, steps[1].depth);
+    ASSERT_STREQ("setPacketPeriod", steps[2].name);
+    ASSERT_EQ(2, steps[2].depth);
+    ASSERT_EQ(protocol::UnixTime::ID, steps[2].packet_id);
+    for (auto const& step : steps)
+        ASSERT_EQ(1, step.round_trips);
+    ASSERT_EQ(1, driver.getStartupProfile().getRoundTrips());
+}
+
+struct OpenedDriverStartupProfileTest : DriverStartupProfileTest
+{
+    OpenedDriverStartupProfileTest()
+    {
+        openTestURI();
+        driver.resetStartupProfile();
+    }
+};
+
+TEST_F(OpenedDriverStartupProfileTest, it_counts_the_round_trips_of_readConfiguration)
+{ IODRIVERS_BASE_MOCK();
+    EXPECT_REPLY(makeQuery<protocol::PacketTimerPeriod>(),
+                 makePacket<protocol::PacketTimerPeriod>());
+    EXPECT_REPLY(makeQuery<protocol::Alignment>(),
+                 makePacket<protocol::Alignment>());
+    EXPECT_REPLY(makeQuery<protocol::FilterOptions>(),
+                 makePacket<protocol::FilterOptions>());
+    EXPECT_REPLY(makeQuery<protocol::MagneticCalibrationValues>(),
+                 makePacket<protocol::MagneticCalibrationValues>());
+    EXPECT_REPLY(makeQuery<protocol::MagneticCalibrationStatus>(),
+                 makePacket<protocol::MagneticCalibrationStatus>());
+    driver.readConfiguration();
+
+    auto const& steps = driver.getStartupProfile().steps;
+    ASSERT_EQ(1u, steps.size());
+    ASSERT_STREQ("readConfiguration", steps[0].name);
+    ASSERT_EQ(5, steps[0].round_trips);
+    ASSERT_LE(steps[0].ack_wait, steps[0].duration);
+}
+
+TEST_F(OpenedDriverStartupProfileTest, it_records_each_packet_period_of_the_set_period_methods)
+{ IODRIVERS_BASE_MOCK();
+    EXPECT_PACKET_PERIOD(protocol::QuaternionOrientation::ID, 5);
+    EXPECT_PACKET_PERIOD(protocol::EulerOrientationStandardDeviation::ID, 0);
+    driver.setOrientationPeriod(5, false);
+
+    auto const& steps = driver.getStartupProfile().steps;
+    ASSERT_EQ(2u, steps.size());
+    ASSERT_EQ(protocol::QuaternionOrientation::ID, steps[0].packet_id);
+    ASSERT_EQ(protocol::EulerOrientationStandardDeviation::ID, steps[1].packet_id);
+    ASSERT_EQ(2, driver.getStartupProfile().getRoundTrips());
+}
+
+TEST_F(DriverStartupProfileTest, resetStartupProfile_clears_the_steps)
+{
+    openTestURI();
+    driver.resetStartupProfile();
+    ASSERT_TRUE(driver.getStartupProfile().steps.empty());
+}
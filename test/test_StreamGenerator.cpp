@@ -0,0 +1,211 @@
+#include "test_Helpers.hpp"
+#include <imu_advanced_navigation_anpp/StreamGenerator.hpp>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+using protocol::Header;
+
+struct StreamGeneratorTest : ::testing::Test
+{
+    map<uint8_t, uint32_t> periods {
+        { protocol::UnixTime::ID, 1 },
+        { protocol::RawSensors::ID, 1 },
+        { protocol::Satellites::ID, 10 },
+        { protocol::DetailedSatellites::ID, 10 },
+        { protocol::QuaternionOrientation::ID, 2 },
+        { 150, 5 }
+    };
+
+    /** Parse a complete stream, returning the count of valid packets per ID */
+    map<uint8_t, uint64_t> parse(vector<uint8_t> const& stream)
+    {
+        map<uint8_t, uint64_t> counts;
+        for (size_t start = 0; start < stream.size(); )
+        {
+            int result = protocol::extractPacket(&stream[start], stream.size() - start);
+            if (result > 0)
+            {
+                counts[stream[start + 1]]++;
+                start += result;
+            }
+            else if (result < 0)
+                start += -result;
+            else
+                break;
+        }
+        return counts;
+    }
+
+    /** Generate a corrupted stream that ends with clean packets, so that it
+     * can be completely parsed
+     */
+    vector<uint8_t> generateCorrupted(StreamGenerator& generator,
+                                      StreamGenerator::Corruption const& corruption,
+                                      size_t size)
+    {
+        vector<uint8_t> stream;
+        generator.setPacketPeriods(periods);
+        generator.setCorruption(corruption);
+        generator.generate(stream, size);
+        generator.setCorruption(StreamGenerator::Corruption());
+        generator.generate(stream, protocol::MAX_PACKET_SIZE);
+        return stream;
+    }
+};
+
+TEST_F(StreamGeneratorTest, it_generates_the_packet_trains_in_ID_order)
+{
+    StreamGenerator generator;
+    generator.setPacketPeriods({ { protocol::RawSensors::ID, 2 }, { protocol::UnixTime::ID, 1 } });
+
+    vector<uint8_t> stream;
+    for (int i = 0; i < 3; ++i)
+        generator.generateTrain(stream);
+
+    vector<uint8_t> ids;
+    for (size_t start = 0; start < stream.size(); )
+    {
+        int result = protocol::extractPacket(&stream[start], stream.size() - start);
+        ASSERT_GT(result, 0);
+        ids.push_back(stream[start + 1]);
+        start += result;
+    }
+    ASSERT_THAT(ids, testing::ElementsAre(
+        protocol::UnixTime::ID, protocol::RawSensors::ID,
+        protocol::UnixTime::ID,
+        protocol::UnixTime::ID, protocol::RawSensors::ID));
+    ASSERT_EQ(base::Time::fromSeconds(1577836800) + base::Time::fromMilliseconds(3),
+              generator.getTime());
+}
+
+TEST_F(StreamGeneratorTest, a_clean_stream_contains_only_valid_packets_at_the_configured_rates)
+{
+    StreamGenerator generator;
+    generator.setPacketPeriods(periods);
+    generator.setRandomPayloadSize(150, 200);
+    vector<uint8_t> stream;
+    generator.generate(stream, 1000000);
+
+    auto const& stats = generator.getStatistics();
+    ASSERT_EQ(stream.size(), stats.bytes);
+    ASSERT_EQ(stats.valid_packets_by_id, parse(stream));
+    uint64_t trains = stats.trains;
+    ASSERT_EQ(trains, stats.valid_packets_by_id.at(protocol::RawSensors::ID));
+    ASSERT_EQ((trains + 1) / 2, stats.valid_packets_by_id.at(protocol::QuaternionOrientation::ID));
+    ASSERT_EQ((trains + 4) / 5, stats.valid_packets_by_id.at(150));
+}
+
+TEST_F(StreamGeneratorTest, the_parser_finds_exactly_the_intact_packets_in_a_stream_with_bit_flips)
+{
+    StreamGenerator generator(1);
+    StreamGenerator::Corruption corruption;
+    corruption.bit_flip = 0.2;
+    auto stream = generateCorrupted(generator, corruption, 200000);
+    ASSERT_GT(generator.getStatistics().bit_flips, 0u);
+    ASSERT_EQ(generator.getStatistics().valid_packets_by_id, parse(stream));
+}
+
+TEST_F(StreamGeneratorTest, the_parser_finds_exactly_the_intact_packets_in_a_stream_with_truncations)
+{
+    StreamGenerator generator(2);
+    StreamGenerator::Corruption corruption;
+    corruption.truncation = 0.2;
+    auto stream = generateCorrupted(generator, corruption, 200000);
+    ASSERT_GT(generator.getStatistics().truncations, 0u);
+    ASSERT_EQ(generator.getStatistics().valid_packets_by_id, parse(stream));
+}
+
+TEST_F(StreamGeneratorTest, the_parser_finds_all_packets_in_a_stream_with_inserted_garbage)
+{
+    StreamGenerator generator(3);
+    StreamGenerator::Corruption corruption;
+    corruption.garbage = 0.5;
+    auto stream = generateCorrupted(generator, corruption, 200000);
+    auto const& stats = generator.getStatistics();
+    ASSERT_GT(stats.garbage_bytes, 0u);
+    ASSERT_EQ(stream.size(), stats.bytes);
+    ASSERT_EQ(stats.valid_packets_by_id, parse(stream));
+}
+
+TEST_F(StreamGeneratorTest, the_parser_finds_all_packets_in_a_stream_with_false_headers)
+{
+    StreamGenerator generator(4);
+    StreamGenerator::Corruption corruption;
+    corruption.false_header = 0.5;
+    auto stream = generateCorrupted(generator, corruption, 200000);
+    ASSERT_GT(generator.getStatistics().false_headers, 0u);
+    ASSERT_EQ(generator.getStatistics().valid_packets_by_id, parse(stream));
+}
+
+TEST_F(StreamGeneratorTest, the_output_is_determined_by_the_seed)
+{
+    StreamGenerator::Corruption corruption;
+    corruption.bit_flip = 0.1;
+    corruption.truncation = 0.1;
+    corruption.garbage = 0.1;
+    corruption.false_header = 0.1;
+
+    StreamGenerator a(5), b(5), c(6);
+    for (auto* generator : { &a, &b, &c })
+        generator->setNoise(1);
+    auto stream_a = generateCorrupted(a, corruption, 50000);
+    auto stream_b = generateCorrupted(b, corruption, 50000);
+    auto stream_c = generateCorrupted(c, corruption, 50000);
+    ASSERT_EQ(stream_a, stream_b);
+    ASSERT_NE(stream_a, stream_c);
+}
+
+TEST_F(StreamGeneratorTest, it_rejects_payloads_that_do_not_fit_in_a_packet)
+{
+    StreamGenerator generator;
+    ASSERT_THROW(generator.setRandomPayloadSize(150, 256), invalid_argument);
+}
+
+struct StreamGeneratorDriverTest : DriverTestBase
+{
+    StreamGeneratorDriverTest()
+    {
+        openTestURI();
+    }
+};
+
+TEST_F(StreamGeneratorDriverTest, the_driver_processes_a_sustained_corrupted_stream)
+{
+    map<uint8_t, uint32_t> periods {
+        { protocol::UnixTime::ID, 1 },
+        { protocol::RawSensors::ID, 1 },
+        { protocol::NEDVelocity::ID, 1 },
+        { protocol::QuaternionOrientation::ID, 1 }
+    };
+    driver.setReplayConfiguration(periods, true);
+
+    StreamGenerator generator(7);
+    generator.setPacketPeriods(periods);
+    StreamGenerator::Corruption corruption;
+    corruption.bit_flip = 0.01;
+    corruption.garbage = 0.01;
+    corruption.false_header = 0.01;
+    generator.setCorruption(corruption);
+
+    vector<uint8_t> stream;
+    generator.generate(stream, 100000);
+    generator.setCorruption(StreamGenerator::Corruption());
+    generator.generate(stream, protocol::MAX_PACKET_SIZE);
+    pushDataToDriver(stream);
+
+    uint64_t processed = 0;
+    try
+    {
+        while (true)
+        {
+            driver.poll();
+            processed++;
+        }
+    }
+    catch (iodrivers_base::TimeoutError const&) {}
+
+    ASSERT_EQ(generator.getStatistics().valid_packets, processed);
+    auto imu = driver.getIMUSensors();
+    ASSERT_NEAR(9.81, imu.acc.norm(), 0.01);
+    ASSERT_GT(imu.time, base::Time::fromSeconds(1577836800));
+}
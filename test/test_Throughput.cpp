@@ -0,0 +1,157 @@
+#include "test_Helpers.hpp"
+#include <imu_advanced_navigation_anpp/StreamGenerator.hpp>
+#include <imu_advanced_navigation_anpp/AllocationCounter.hpp>
+#include <chrono>
+#include <cstdlib>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+
+/** Environment variable overriding MAX_NS_PER_PACKET, 0 disabling the check */
+static const char* MAX_NS_PER_PACKET_ENV = "IMU_ADVANCED_NAVIGATION_ANPP_MAX_NS_PER_PACKET";
+
+/** Default ceiling on the average time poll() may take per packet
+ *
+ * It is meant to catch gross regressions in the decode path, and is
+ * therefore well above what a debug build needs on a slow machine.
+ */
+static const double MAX_NS_PER_PACKET = 20000;
+
+struct ThroughputTest : DriverTestBase
+{
+    static const int TRAIN_COUNT = 20000;
+    static const int TRAINS_PER_BATCH = 100;
+    /** Trains processed before the allocations are counted */
+    static const int WARMUP_TRAINS = 1000;
+
+    map<uint8_t, uint32_t> periods {
+        { protocol::UnixTime::ID, 1 },
+        { protocol::Status::ID, 5 },
+        { protocol::RawSensors::ID, 1 },
+        { protocol::DetailedSatellites::ID, 10 },
+        { protocol::GeodeticPosition::ID, 10 },
+        { protocol::QuaternionOrientation::ID, 1 },
+        { protocol::NEDVelocity::ID, 2 }
+    };
+
+    ThroughputTest()
+    {
+        openTestURI();
+        driver.setReplayConfiguration(periods, true);
+    }
+
+    /** The values poll() should return for the packets of the given train
+     *
+     * A period is completed by the packet with the highest ID among the
+     * packets that have this period
+     */
+    vector<int> expectedResults(uint64_t train) const
+    {
+        vector<int> results;
+        for (auto const& period : periods)
+        {
+            if (train % period.second != 0)
+                continue;
+            else if (period.first == protocol::UnixTime::ID)
+            {
+                results.push_back(0);
+                continue;
+            }
+
+            bool completes = true;
+            for (auto const& other : periods)
+            {
+                if (other.first != protocol::UnixTime::ID &&
+                    other.second == period.second && other.first > period.first)
+                    completes = false;
+            }
+            results.push_back(completes ? period.second : 0);
+        }
+        return results;
+    }
+
+    static double maxNanosecondsPerPacket()
+    {
+        if (char const* value = getenv(MAX_NS_PER_PACKET_ENV))
+            return strtod(value, nullptr);
+        return MAX_NS_PER_PACKET;
+    }
+};
+
+TEST_F(ThroughputTest, a_sustained_stream_is_decoded_quickly_without_allocations)
+{
+    StreamGenerator generator;
+    generator.setPacketPeriods(periods);
+
+    vector<uint8_t> stream;
+    vector<int> expected;
+    vector<int> results;
+    results.reserve(TRAINS_PER_BATCH * periods.size());
+
+    uint64_t packets = 0;
+    uint64_t mismatches = 0;
+    size_t allocations = 0;
+    chrono::nanoseconds duration(0);
+    for (int train = 0; train < TRAIN_COUNT; train += TRAINS_PER_BATCH)
+    {
+        stream.clear();
+        expected.clear();
+        for (int i = 0; i < TRAINS_PER_BATCH; ++i)
+        {
+            generator.generateTrain(stream);
+            auto train_results = expectedResults(train + i);
+            expected.insert(expected.end(), train_results.begin(), train_results.end());
+        }
+        pushDataToDriver(stream);
+
+        results.clear();
+        size_t allocations_before = getAllocationCount();
+        auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < expected.size(); ++i)
+            results.push_back(driver.poll());
+        duration += chrono::steady_clock::now() - start;
+        if (train >= WARMUP_TRAINS)
+            allocations += getAllocationCount() - allocations_before;
+
+        packets += results.size();
+        for (size_t i = 0; i < results.size(); ++i)
+            mismatches += (results[i] != expected[i]);
+    }
+
+    ASSERT_THROW(driver.poll(), iodrivers_base::TimeoutError);
+    ASSERT_EQ(generator.getStatistics().valid_packets, packets);
+    ASSERT_EQ(0u, mismatches);
+    ASSERT_EQ(0u, allocations);
+
+    double ns_per_packet = static_cast<double>(duration.count()) / packets;
+    RecordProperty("ns_per_packet", to_string(ns_per_packet));
+    double ceiling = maxNanosecondsPerPacket();
+    if (ceiling > 0)
+    {
+        ASSERT_LT(ns_per_packet, ceiling)
+            << "set " << MAX_NS_PER_PACKET_ENV << " to change the ceiling on this machine";
+    }
+}
+
+TEST_F(ThroughputTest, the_decoded_samples_follow_the_stream)
+{
+    StreamGenerator generator;
+    generator.setPacketPeriods(periods);
+
+    vector<uint8_t> stream;
+    for (int i = 0; i < 1000; ++i)
+        generator.generateTrain(stream);
+    pushDataToDriver(stream);
+    try
+    {
+        while (true)
+            driver.poll();
+    }
+    catch (iodrivers_base::TimeoutError const&) {}
+
+    // The last train was generated one packet timer period before getTime()
+    base::Time last_train = generator.getTime() - base::Time::fromMilliseconds(1);
+    ASSERT_EQ(last_train, driver.getCurrentTimestamp());
+    ASSERT_EQ(last_train, driver.getIMUSensors().time);
+    ASSERT_EQ(10u, driver.getGNSSSatelliteInfo().knownSatellites.size());
+}
@@ -0,0 +1,169 @@
+#include "test_Helpers.hpp"
+#include <imu_advanced_navigation_anpp/TraceRecorder.hpp>
+#include <imu_advanced_navigation_anpp/StreamGenerator.hpp>
+#include <sstream>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+
+TEST(TraceRecorderTest, it_returns_the_events_oldest_first)
+{
+    TraceRecorder recorder(4);
+    recorder.record(TRACE_READ, 1, 100, 150);
+    recorder.record(TRACE_PROCESS, 2, 200, 210);
+
+    auto events = recorder.getEvents();
+    ASSERT_EQ(2u, events.size());
+    ASSERT_EQ(TRACE_READ, events[0].span);
+    ASSERT_EQ(1, events[0].packet_id);
+    ASSERT_EQ(100, events[0].start);
+    ASSERT_EQ(50, events[0].duration);
+    ASSERT_EQ(TRACE_PROCESS, events[1].span);
+    ASSERT_EQ(10, events[1].duration);
+}
+
+TEST(TraceRecorderTest, it_overwrites_the_oldest_events_once_full)
+{
+    TraceRecorder recorder(3);
+    for (int i = 0; i < 5; ++i)
+        recorder.record(TRACE_FRAMING, i, i * 10, i * 10 + 1);
+
+    ASSERT_EQ(3u, recorder.size());
+    ASSERT_EQ(2u, recorder.getOverwrittenCount());
+    auto events = recorder.getEvents();
+    ASSERT_EQ(2, events[0].packet_id);
+    ASSERT_EQ(3, events[1].packet_id);
+    ASSERT_EQ(4, events[2].packet_id);
+}
+
+TEST(TraceRecorderTest, it_rejects_a_zero_capacity)
+{
+    ASSERT_THROW(TraceRecorder(0), std::invalid_argument);
+}
+
+TEST(TraceRecorderTest, it_writes_the_events_as_complete_events_of_a_chrome_trace)
+{
+    TraceRecorder recorder(4);
+    recorder.record(TRACE_PROCESS, 28, 1500, 4000);
+    recorder.record(TRACE_UTM_CONVERSION, -1, 2000, 2500);
+
+    ostringstream out;
+    recorder.writeChromeTrace(out);
+    string trace = out.str();
+    ASSERT_EQ(0u, trace.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["));
+    ASSERT_NE(string::npos, trace.find(
+        "{\"name\":\"process\",\"cat\":\"anpp\",\"ph\":\"X\",\"ts\":1.500,\"dur\":2.500,"));
+    ASSERT_NE(string::npos, trace.find("\"args\":{\"packet_id\":28}}"));
+    ASSERT_NE(string::npos, trace.find(
+        "{\"name\":\"utm_conversion\",\"cat\":\"anpp\",\"ph\":\"X\",\"ts\":2.000,\"dur\":0.500,"));
+    ASSERT_EQ("\n]}\n", trace.substr(trace.size() - 4));
+    ASSERT_EQ(2u, recorder.size());
+}
+
+TEST(TraceRecorderTest, flush_writes_the_trace_and_clears_the_ring)
+{
+    TraceRecorder recorder(4);
+    recorder.record(TRACE_PROCESS, 28, 1500, 4000);
+    ostringstream out;
+    recorder.flush(out);
+    ASSERT_NE(string::npos, out.str().find("\"process\""));
+    ASSERT_EQ(0u, recorder.size());
+    ASSERT_TRUE(recorder.getEvents().empty());
+}
+
+TEST(TraceSpanTest, it_records_nothing_without_a_recorder)
+{
+    TraceSpan span(nullptr, TRACE_READ);
+    span.setPacketID(10);
+}
+
+TEST(TraceSpanTest, it_records_the_span_at_destruction)
+{
+    TraceRecorder recorder(4);
+    int64_t before = TraceRecorder::now();
+    {
+        TraceSpan span(&recorder, TRACE_READ);
+        span.setPacketID(10);
+        ASSERT_EQ(0u, recorder.size());
+    }
+    int64_t after = TraceRecorder::now();
+
+    auto events = recorder.getEvents();
+    ASSERT_EQ(1u, events.size());
+    ASSERT_EQ(TRACE_READ, events[0].span);
+    ASSERT_EQ(10, events[0].packet_id);
+    ASSERT_LE(before, events[0].start);
+    ASSERT_LE(events[0].start + events[0].duration, after);
+}
+
+struct DriverTraceTest : DriverTestBase
+{
+    map<uint8_t, uint32_t> periods {
+        { protocol::UnixTime::ID, 1 },
+        { protocol::RawSensors::ID, 1 },
+        { protocol::GeodeticPosition::ID, 1 }
+    };
+
+    DriverTraceTest()
+    {
+        openTestURI();
+        driver.setReplayConfiguration(periods, true);
+    }
+
+    map<TRACE_SPANS, size_t> countSpans() const
+    {
+        map<TRACE_SPANS, size_t> counts;
+        for (auto const& event : driver.getTraceRecorder()->getEvents())
+            counts[event.span]++;
+        return counts;
+    }
+};
+
+TEST_F(DriverTraceTest, it_does_not_trace_by_default)
+{
+    ASSERT_EQ(nullptr, driver.getTraceRecorder());
+    ostringstream out;
+    driver.flushTrace(out);
+    ASSERT_TRUE(out.str().empty());
+}
+
+TEST_F(DriverTraceTest, it_traces_the_reads_framing_and_processing_of_polled_packets)
+{
+    driver.enableTracing(1024);
+
+    StreamGenerator generator;
+    generator.setPacketPeriods(periods);
+    vector<uint8_t> stream = { 0x10, 0x10, 0x10 };
+    for (int i = 0; i < 5; ++i)
+        generator.generateTrain(stream);
+    pushDataToDriver(stream);
+    for (int i = 0; i < 15; ++i)
+        driver.poll();
+
+    auto counts = countSpans();
+    ASSERT_EQ(15u, counts[TRACE_READ]);
+    ASSERT_EQ(15u, counts[TRACE_FRAMING]);
+    ASSERT_EQ(15u, counts[TRACE_PROCESS]);
+    ASSERT_EQ(1u, counts[TRACE_RESYNC]);
+    // Once per GeodeticPosition packet after the first UnixTime
+    ASSERT_EQ(5u, counts[TRACE_UTM_CONVERSION]);
+
+    auto events = driver.getTraceRecorder()->getEvents();
+    auto read = find_if(events.begin(), events.end(),
+        [](TraceEvent const& e) { return e.span == TRACE_READ; });
+    ASSERT_EQ(protocol::UnixTime::ID, read->packet_id);
+}
+
+TEST_F(DriverTraceTest, it_traces_commands)
+{ IODRIVERS_BASE_MOCK();
+    driver.enableTracing(1024);
+    EXPECT_PACKET_PERIOD(protocol::RawSensors::ID, 1);
+    driver.setRawSensorsPeriod(1);
+
+    auto events = driver.getTraceRecorder()->getEvents();
+    auto command = find_if(events.begin(), events.end(),
+        [](TraceEvent const& e) { return e.span == TRACE_COMMAND; });
+    ASSERT_NE(events.end(), command);
+    ASSERT_EQ(protocol::PacketPeriods::ID, command->packet_id);
+    ASSERT_EQ(1u, countSpans()[TRACE_FRAMING]);
+}
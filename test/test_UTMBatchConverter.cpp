@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+#include <imu_advanced_navigation_anpp/UTMBatchConverter.hpp>
+#include <gps_base/UTMConverter.hpp>
+#include <base/Float.hpp>
+
+using namespace std;
+using namespace imu_advanced_navigation_anpp;
+
+struct UTMBatchConverterTest : ::testing::Test
+{
+    vector<double> latitudes;
+    vector<double> longitudes;
+    vector<double> altitudes;
+
+    /** Generate points spanning the given UTM zone */
+    void makeGrid(int zone, double min_lat, double max_lat, int size)
+    {
+        double central_meridian = (zone - 1) * 6 - 180 + 3;
+        for (int i = 0; i < size; ++i)
+        {
+            for (int j = 0; j < size; ++j)
+            {
+                latitudes.push_back(min_lat + (max_lat - min_lat) * i / (size - 1));
+                longitudes.push_back(central_meridian - 3 + 6.0 * j / (size - 1));
+                altitudes.push_back(i * 10 - j);
+            }
+        }
+    }
+
+    void assertMatchesUTMConverter(int zone, bool north, Eigen::Vector3d const& origin,
+                                   size_t thread_count = 0)
+    {
+        gps_base::UTMConverter reference;
+        reference.setUTMZone(zone);
+        reference.setUTMNorth(north);
+        reference.setNWUOrigin(origin);
+
+        size_t count = latitudes.size();
+        vector<double> x(count), y(count), z(count);
+        UTMBatchConverter converter(zone, north, origin);
+        converter.convertToNWU(latitudes.data(), longitudes.data(), altitudes.data(), count,
+                               x.data(), y.data(), z.data(), thread_count);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            gps_base::Solution solution;
+            solution.latitude  = latitudes[i];
+            solution.longitude = longitudes[i];
+            solution.altitude  = altitudes[i];
+            Eigen::Vector3d expected = reference.convertToNWU(solution).position;
+            ASSERT_NEAR(expected.x(), x[i], UTMBatchConverter::ACCURACY) << "point " << i;
+            ASSERT_NEAR(expected.y(), y[i], UTMBatchConverter::ACCURACY) << "point " << i;
+            ASSERT_NEAR(expected.z(), z[i], UTMBatchConverter::ACCURACY) << "point " << i;
+        }
+    }
+};
+
+TEST_F(UTMBatchConverterTest, it_matches_UTMConverter_in_the_northern_hemisphere)
+{
+    makeGrid(32, 0, 80, 41);
+    assertMatchesUTMConverter(32, true, Eigen::Vector3d::Zero());
+}
+
+TEST_F(UTMBatchConverterTest, it_matches_UTMConverter_in_the_southern_hemisphere)
+{
+    makeGrid(23, -80, 0, 41);
+    assertMatchesUTMConverter(23, false, Eigen::Vector3d::Zero());
+}
+
+TEST_F(UTMBatchConverterTest, it_applies_the_NWU_origin)
+{
+    makeGrid(32, 40, 50, 11);
+    assertMatchesUTMConverter(32, true, Eigen::Vector3d(5e6, -3e5, 100));
+}
+
+TEST_F(UTMBatchConverterTest, it_gives_the_same_results_when_using_multiple_threads)
+{
+    makeGrid(32, 40, 50, 300);
+    ASSERT_GT(latitudes.size(), UTMBatchConverter::PARALLEL_THRESHOLD);
+
+    size_t count = latitudes.size();
+    UTMBatchConverter converter(32, true);
+    vector<double> x1(count), y1(count), z1(count);
+    converter.convertToNWU(latitudes.data(), longitudes.data(), altitudes.data(), count,
+                           x1.data(), y1.data(), z1.data(), 1);
+    vector<double> x4(count), y4(count), z4(count);
+    converter.convertToNWU(latitudes.data(), longitudes.data(), altitudes.data(), count,
+                           x4.data(), y4.data(), z4.data(), 7);
+    ASSERT_EQ(x1, x4);
+    ASSERT_EQ(y1, y4);
+    ASSERT_EQ(z1, z4);
+}
+
+TEST_F(UTMBatchConverterTest, it_propagates_unknown_positions)
+{
+    double latitude = base::unknown<double>();
+    double longitude = 9;
+    double altitude = 0;
+    double x, y, z;
+    UTMBatchConverter converter(32, true);
+    converter.convertToNWU(&latitude, &longitude, &altitude, 1, &x, &y, &z);
+    ASSERT_TRUE(base::isUnknown(x));
+    ASSERT_TRUE(base::isUnknown(y));
+}